@@ -15,7 +15,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDENCIES --------------------------------------------------------- */
 
-#include <math.h> /* pow, ceil */
+#include <stddef.h> /* NULL */
 
 #include "lorahub_aux.h"
 #include "lorahub_hal.h"
@@ -23,24 +23,48 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
 
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct lora_sf_param_s
+{
+    uint8_t n_symbol_sync_x4; /* sync word and SFD duration after the preamble, in quarters of symbol */
+    int8_t  n_bit_offset;     /* number of bits added to the payload bits, before header and CRC */
+    uint8_t n_bit_block;      /* number of bits carried by a block of (4 + cr) payload symbols */
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE CONSTANTS ----------------------------------------------------- */
 
 static const char* TAG_AUX = "LORAHUB_AUX";
 
+/* Precomputed LoRa parameters per spreading factor, from DR_LORA_SF5 to DR_LORA_SF12. The sync and SFD last 4.25
+ * symbols (6.25 for SF5 and SF6), and the low datarate optimization is enabled for SF11 and SF12 */
+static const struct lora_sf_param_s lora_sf_params[] = {
+    { 25, -20, 20 }, /* SF5 */
+    { 25, -24, 24 }, /* SF6 */
+    { 17, -20, 28 }, /* SF7 */
+    { 17, -24, 32 }, /* SF8 */
+    { 17, -28, 36 }, /* SF9 */
+    { 17, -32, 40 }, /* SF10 */
+    { 17, -36, 36 }, /* SF11 */
+    { 17, -40, 40 }, /* SF12 */
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
 uint32_t lora_packet_time_on_air( const uint8_t bw, const uint8_t sf, const uint8_t cr,
                                   const uint16_t n_symbol_preamble, const bool no_header, const bool no_crc,
-                                  const uint8_t size, double* out_nb_symbols, uint32_t* out_nb_symbols_payload,
+                                  const uint8_t size, uint32_t* out_nb_symbols_x4, uint32_t* out_nb_symbols_payload,
                                   uint16_t* out_t_symbol_us )
 {
-    uint8_t  H, DE, n_bit_crc;
-    uint8_t  bw_pow;
-    uint16_t t_symbol_us;
-    double   n_symbol;
-    uint32_t toa_us, n_symbol_payload;
+    const struct lora_sf_param_s* param;
+    uint8_t                       bw_shift;
+    uint16_t                      t_symbol_us;
+    int32_t                       n_bit;
+    uint32_t                      n_symbol_x4;
+    uint32_t                      toa_us, n_symbol_payload;
 
     /* Check input parameters */
     if( IS_LORA_DR( sf ) == false )
@@ -59,50 +83,41 @@ uint32_t lora_packet_time_on_air( const uint8_t bw, const uint8_t sf, const uint
         return 0;
     }
 
-    /* Get bandwidth 125KHz divider*/
+    /* Get bandwidth 125KHz divider, as a power of 2 */
     switch( bw )
     {
     case BW_125KHZ:
-        bw_pow = 1;
+        bw_shift = 0;
         break;
     case BW_250KHZ:
-        bw_pow = 2;
+        bw_shift = 1;
         break;
     case BW_500KHZ:
-        bw_pow = 4;
+        bw_shift = 2;
         break;
     default:
         ESP_LOGE( TAG_AUX, "ERROR: unsupported bandwidth 0x%02X (%s)\n", bw, __FUNCTION__ );
         return 0;
     }
 
-    /* Duration of 1 symbol */
-    t_symbol_us = ( 1 << sf ) * 8 / bw_pow; /* 2^SF / BW , in microseconds */
-
-    /* Packet parameters */
-    H         = ( no_header == false ) ? 1 : 0; /* header is always enabled, except for beacons */
-    DE        = ( sf >= 11 ) ? 1 : 0;           /* Low datarate optimization enabled for SF11 and SF12 */
-    n_bit_crc = ( no_crc == false ) ? 16 : 0;
+    /* Duration of 1 symbol, always a multiple of 4us */
+    t_symbol_us = ( ( 1 << sf ) * 8 ) >> bw_shift; /* 2^SF / BW , in microseconds */
 
-    /* Number of symbols in the payload */
-    n_symbol_payload =
-        ceil( MAX( ( double ) ( 8 * size + n_bit_crc - 4 * sf + ( ( sf >= 7 ) ? 8 : 0 ) + 20 * H ), 0.0 ) /
-              ( double ) ( 4 * ( sf - 2 * DE ) ) ) *
-        ( cr + 4 ); /* Explicitely cast to double to keep precision of the division */
+    /* Number of symbols in the payload, by blocks of (4 + cr) symbols */
+    param = &lora_sf_params[sf - DR_LORA_SF5];
+    n_bit = 8 * size + param->n_bit_offset + ( ( no_crc == false ) ? 16 : 0 ) + ( ( no_header == false ) ? 20 : 0 );
+    n_symbol_payload = ( n_bit > 0 ) ? ( ( n_bit + param->n_bit_block - 1 ) / param->n_bit_block ) * ( cr + 4 ) : 0;
 
-    /* number of symbols in packet */
-    n_symbol = ( double ) n_symbol_preamble + ( ( sf >= 7 ) ? 4.25 : 6.25 ) + 8.0 + ( double ) n_symbol_payload;
+    /* number of symbols in packet, in quarters of symbol to keep the sync and SFD fraction */
+    n_symbol_x4 = 4 * ( uint32_t ) n_symbol_preamble + param->n_symbol_sync_x4 + 4 * 8 + 4 * n_symbol_payload;
 
     /* Duration of packet in microseconds */
-    toa_us = ( uint32_t )( ( double ) n_symbol * ( double ) t_symbol_us );
-
-    // ESP_LOGI(TAG_AUX, "INFO: LoRa packet ToA: %lu us (n_symbol:%f, t_symbol_us:%u)\n", toa_us, n_symbol,
-    // t_symbol_us);
+    toa_us = n_symbol_x4 * ( t_symbol_us / 4 );
 
     /* Return details if required */
-    if( out_nb_symbols != NULL )
+    if( out_nb_symbols_x4 != NULL )
     {
-        *out_nb_symbols = n_symbol;
+        *out_nb_symbols_x4 = n_symbol_x4;
     }
     if( out_nb_symbols_payload != NULL )
     {
@@ -116,4 +131,30 @@ uint32_t lora_packet_time_on_air( const uint8_t bw, const uint8_t sf, const uint
     return toa_us;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t lora_packet_end_from_header( const uint8_t bw, const uint8_t sf, const uint8_t cr,
+                                      const uint16_t n_symbol_preamble, const bool no_crc, const uint8_t size,
+                                      const uint32_t count_us_header, uint32_t* out_count_us_preamble )
+{
+    uint32_t n_symbol_x4;
+    uint32_t n_symbol_payload;
+    uint16_t t_symbol_us;
+    uint32_t toa_us;
+    uint32_t count_us_preamble;
+
+    toa_us = lora_packet_time_on_air( bw, sf, cr, n_symbol_preamble, false, no_crc, size, &n_symbol_x4,
+                                      &n_symbol_payload, &t_symbol_us );
+
+    /* the header ends with the first 8 symbols following the preamble, the remaining symbols are the payload */
+    count_us_preamble = count_us_header - ( n_symbol_x4 - 4 * n_symbol_payload ) * ( t_symbol_us / 4 );
+
+    if( out_count_us_preamble != NULL )
+    {
+        *out_count_us_preamble = count_us_preamble;
+    }
+
+    return count_us_preamble + toa_us;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
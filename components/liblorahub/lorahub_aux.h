@@ -92,7 +92,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
 /**
-@brief Calculate the time on air of a LoRa packet in microseconds
+@brief Calculate the time on air of a LoRa packet in microseconds, with integer arithmetic only
 @param bw packet bandwidth
 @param sf packet spreading factor
 @param cr packet coding rate
@@ -100,16 +100,32 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 @param no_header true if packet has no header
 @param no_crc true if packet has no CRC
 @param size packet size in bytes
-@param nb_symbols pointer to return the total number of symbols in packet
+@param nb_symbols_x4 pointer to return the total number of symbols in packet, in quarters of symbol
 @param nb_symbols_payload pointer to return the number of symbols in packet payload
 @param t_symbol_us pointer to return the duration of a symbol in microseconds
 @return the packet time on air in microseconds
 */
 uint32_t lora_packet_time_on_air( const uint8_t bw, const uint8_t sf, const uint8_t cr,
                                   const uint16_t n_symbol_preamble, const bool no_header, const bool no_crc,
-                                  const uint8_t size, double* nb_symbols, uint32_t* nb_symbols_payload,
+                                  const uint8_t size, uint32_t* nb_symbols_x4, uint32_t* nb_symbols_payload,
                                   uint16_t* t_symbol_us );
 
+/**
+@brief Calculate the start and the end of an explicit header LoRa packet from the time its header ended
+@param bw packet bandwidth
+@param sf packet spreading factor
+@param cr packet coding rate
+@param n_symbol_preamble packet preamble length (number of symbols)
+@param no_crc true if packet has no CRC
+@param size packet size in bytes
+@param count_us_header counter value at the end of the packet header
+@param count_us_preamble pointer to return the counter value at the start of the packet preamble
+@return the counter value at the end of the packet
+*/
+uint32_t lora_packet_end_from_header( const uint8_t bw, const uint8_t sf, const uint8_t cr,
+                                      const uint16_t n_symbol_preamble, const bool no_crc, const uint8_t size,
+                                      const uint32_t count_us_header, uint32_t* count_us_preamble );
+
 #endif
 
 /* --- EOF ------------------------------------------------------------------ */
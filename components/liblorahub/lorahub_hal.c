@@ -18,14 +18,19 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include <string.h>
 
 #include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 #include "lorahub_aux.h"
 #include "lorahub_hal.h"
 #include "lorahub_hal_rx.h"
 #include "lorahub_hal_tx.h"
+#include "lorahub_trace.h"
 
 #include "radio_context.h"
+#include "radio_spi.h"
 #include "ral.h"
+#include "ral_shadow.h"
 
 #if defined( CONFIG_HELTEC_WIFI_LORA_32_V3 )
 #if !defined( CONFIG_RADIO_TYPE_SX1262 )
@@ -69,15 +74,61 @@ static const char* TAG_HAL = "LORAHUB_HAL";
 #define LORA_SYNC_WORD_PRIVATE 0x12  // 0x12 Private Network
 #define LORA_SYNC_WORD_PUBLIC 0x34   // 0x34 Public Network
 
+#define TX_FIRE_ADVANCE_US 500 /* the TX timer expires this early, the exact start time is then busy-waited */
+#define TX_DONE_MARGIN_MS 100  /* TX_DONE is considered lost this long after the expected end of the TX */
+
+#define TX_TASK_STACK_SIZE 3072 /* stack of the task starting the TX, in bytes */
+#define TX_TASK_PRIO 20         /* above the forwarder threads and lwIP, below the WiFi and esp_timer tasks */
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE TYPES -------------------------------------------------------- */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-static bool    is_started = false;
-static uint8_t rx_status  = RX_STATUS_UNKNOWN;
-static uint8_t tx_status  = TX_STATUS_UNKNOWN;
+static bool             is_started = false;
+static uint8_t          rx_status  = RX_STATUS_UNKNOWN;
+static volatile uint8_t tx_status  = TX_STATUS_UNKNOWN;
+
+/* TX state machine: lgw_send_prepare() loads the packet (TX_SCHEDULED), lgw_send_fire() arms tx_timer which wakes up
+ * tx_task to start the TX (TX_EMITTING), and lgw_receive() completes it on the TX_DONE interrupt (TX_FREE). While a TX
+ * is scheduled, the radio is only accessed by tx_task. The exact start time is busy-waited by tx_task, not by the
+ * esp_timer task, whose other timers are not delayed */
+static esp_timer_handle_t     tx_timer        = NULL;  /* fire instant, then TX_DONE timeout */
+static TaskHandle_t           tx_task         = NULL;  /* starts the TX and handles the TX_DONE timeout */
+static volatile bool          tx_armed        = false; /* true once lgw_send_fire() has been called for the packet */
+static bool                   tx_immediate    = false; /* true if the packet loaded has to be sent when fired */
+static uint32_t               tx_fire_us;              /* internal counter value at which the radio is set in TX */
+static uint32_t               tx_start_delay_us;       /* TCXO startup time, between SetTx and the actual TX start */
+static uint32_t               tx_toa_ms;               /* time on air of the packet being sent */
+static volatile bool          tx_timeout      = false; /* true if the TX could not be started or TX_DONE was lost */
+static struct lgw_tx_report_s tx_report;               /* timestamps of the last TX */
+static bool                   tx_report_ready = false; /* true if tx_report has not been read yet */
+
+/* TX timing statistics, updated by the caller of lgw_send_prepare() and by the TX timer */
+static portMUX_TYPE tx_stats_lock        = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     tx_stats_nb_prepare  = 0;         /* number of packets loaded in the radio */
+static uint32_t     tx_stats_prepare_sum = 0;         /* sum of the durations of the packet loads, in microseconds */
+static uint32_t     tx_stats_prepare_max = 0;         /* max duration of a packet load, in microseconds */
+static uint32_t     tx_stats_nb_fire     = 0;         /* number of TX started */
+static uint32_t     tx_stats_fire_sum    = 0;         /* sum of the durations of the SetTx commands, in microseconds */
+static uint32_t     tx_stats_fire_max    = 0;         /* max duration of a SetTx command, in microseconds */
+static uint32_t     tx_stats_nb_timed    = 0;         /* number of TX started at a timestamp */
+static int32_t      tx_stats_margin_min  = INT32_MAX; /* min time left to the timestamp when fired, in microseconds */
+static uint32_t     tx_stats_nb_late     = 0;         /* number of TX fired after their timestamp */
+static uint32_t     tx_stats_late_max    = 0;         /* max delay of a late TX, in microseconds */
+
+#if defined( CONFIG_RADIO_TYPE_SX1261 )
+static const char* radio_name = "SX1261";
+#elif defined( CONFIG_RADIO_TYPE_SX1262 )
+static const char* radio_name = "SX1262";
+#elif defined( CONFIG_RADIO_TYPE_SX1268 )
+static const char* radio_name = "SX1268";
+#elif defined( CONFIG_RADIO_TYPE_LLCC68 )
+static const char* radio_name = "LLCC68";
+#elif defined( CONFIG_RADIO_TYPE_LR1121 )
+static const char* radio_name = "LR1121";
+#endif
 
 static struct lgw_conf_rxrf_s rxrf_conf = { .freq_hz = 0, .rssi_offset = 0.0, .tx_enable = false };
 
@@ -91,11 +142,11 @@ static radio_context_t radio_context = { 0 };
 #define RADIO_CONTEXT ( ( void* ) &radio_context )
 
 #if defined( CONFIG_RADIO_TYPE_SX1261 ) || defined( CONFIG_RADIO_TYPE_SX1262 ) || defined( CONFIG_RADIO_TYPE_SX1268 )
-const ral_t lgw_ral = RAL_SX126X_INSTANTIATE( RADIO_CONTEXT );
+ral_t lgw_ral = RAL_SX126X_INSTANTIATE( RADIO_CONTEXT );
 #elif defined( CONFIG_RADIO_TYPE_LLCC68 )
-const ral_t lgw_ral = RAL_LLCC68_INSTANTIATE( RADIO_CONTEXT );
+ral_t lgw_ral = RAL_LLCC68_INSTANTIATE( RADIO_CONTEXT );
 #elif defined( CONFIG_RADIO_TYPE_LR1121 )
-const ral_t lgw_ral = RAL_LR11XX_INSTANTIATE( RADIO_CONTEXT );
+ral_t lgw_ral = RAL_LR11XX_INSTANTIATE( RADIO_CONTEXT );
 #else
 #error "Please select radio type.."
 #endif
@@ -103,9 +154,160 @@ const ral_t lgw_ral = RAL_LR11XX_INSTANTIATE( RADIO_CONTEXT );
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
+static void tx_fire( void );
+
+static void tx_timer_cb( void* arg );
+
+static void tx_task_run( void* arg );
+
+static void tx_complete( void );
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+static void tx_fire( void )
+{
+    uint32_t count_us_now;
+    uint32_t count_us_fire;
+    uint32_t duration_us;
+    int32_t  margin_us;
+
+    /* Wait for time to send packet, the time left is the margin of the timer expiry, negative if the TX is late */
+    lgw_get_instcnt( &count_us_fire );
+    margin_us = ( int32_t ) ( tx_fire_us - count_us_fire );
+    while( ( int32_t ) ( tx_fire_us - count_us_fire ) > 0 )
+    {
+        lgw_get_instcnt( &count_us_fire );
+    }
+
+    /* Send packet, this is the only radio command issued at the fire instant */
+    ral_status_t status = ral_set_tx( &lgw_ral );
+    lgw_get_instcnt( &count_us_now );
+    duration_us = count_us_now - count_us_fire;
+
+    portENTER_CRITICAL( &tx_stats_lock );
+    tx_stats_nb_fire += 1;
+    tx_stats_fire_sum += duration_us;
+    if( duration_us > tx_stats_fire_max )
+    {
+        tx_stats_fire_max = duration_us;
+    }
+    if( tx_immediate == false )
+    {
+        tx_stats_nb_timed += 1;
+        if( margin_us < tx_stats_margin_min )
+        {
+            tx_stats_margin_min = margin_us;
+        }
+        if( margin_us < 0 )
+        {
+            tx_stats_nb_late += 1;
+            if( ( uint32_t ) ( -margin_us ) > tx_stats_late_max )
+            {
+                tx_stats_late_max = ( uint32_t ) ( -margin_us );
+            }
+        }
+    }
+    portEXIT_CRITICAL( &tx_stats_lock );
+
+    if( ( tx_immediate == false ) && ( margin_us < 0 ) )
+    {
+        ESP_LOGW( TAG_HAL, "WARNING: TX fired %ld us late\n", -margin_us );
+    }
+
+    if( status != RAL_STATUS_OK )
+    {
+        ESP_LOGE( TAG_HAL, "ERROR: failed to start TX\n" );
+        tx_timeout = true;
+        tx_status  = TX_EMITTING;
+        lgw_radio_abort_wait_irq( ); /* let lgw_receive() complete the TX */
+        return;
+    }
+    tx_report.start_us = count_us_now + tx_start_delay_us;
+    lgw_trace( LGW_TRACE_TX_START, tx_report.count_us );
+
+    /* Guard against a lost TX_DONE, the radio would stay out of RX. Armed before the TX status update, so that it can
+     * only be stopped by the completion of this TX */
+    esp_timer_start_once( tx_timer, ( uint64_t ) ( tx_toa_ms + TX_DONE_MARGIN_MS ) * 1000 );
+
+    /* Update TX status */
+    tx_status = TX_EMITTING;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void tx_timer_cb( void* arg )
+{
+    xTaskNotifyGive( tx_task );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void tx_task_run( void* arg )
+{
+    uint32_t count_us_now;
+
+    while( true )
+    {
+        ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+        lgw_get_instcnt( &count_us_now );
+        if( ( tx_status == TX_SCHEDULED ) && ( tx_armed == true ) &&
+            ( ( int32_t ) ( tx_fire_us - count_us_now ) <= TX_FIRE_ADVANCE_US ) )
+        {
+            tx_fire( );
+        }
+        else if( tx_status == TX_EMITTING )
+        {
+            tx_timeout = true;
+            lgw_radio_abort_wait_irq( ); /* let lgw_receive() complete the TX */
+        }
+        /* else a notification of a timer stopped meanwhile, which must not fire the next TX early */
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void tx_complete( void )
+{
+    bool     radio_timeout = false;
+    uint32_t count_us_end;
+
+    /* Wait for TX_DONE */
+    if( lgw_radio_tx_done( &lgw_ral, &radio_timeout, &count_us_end ) == false )
+    {
+        if( tx_timeout == false )
+        {
+            return; /* still emitting */
+        }
+        lgw_get_instcnt( &count_us_end );
+        radio_timeout = true;
+    }
+    esp_timer_stop( tx_timer );
+
+    if( radio_timeout == true )
+    {
+        ESP_LOGW( TAG_HAL, "%lu: TX:IRQ_TIMEOUT\n", count_us_end );
+    }
+    lgw_trace( LGW_TRACE_TX_DONE, tx_report.count_us );
+    tx_report.end_us = count_us_end;
+    tx_report.done   = !radio_timeout;
+    tx_report_ready  = true;
+    tx_timeout       = false;
+
+    /* Update TX status */
+    tx_armed  = false;
+    tx_status = TX_FREE;
+
+    /* Back to RX config */
+    lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
+
+    /* Update RX status */
+    rx_status = RX_ON;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_connect( void )
 {
     esp_err_t ret;
@@ -188,7 +390,12 @@ int lgw_connect( void )
         ESP_LOGI( TAG_HAL, "LED_TX_GPIO not set" );
     }
 
-    /* SPI configuration */
+    /* SPI configuration, the transport lock first */
+    if( radio_spi_init( ) == false )
+    {
+        ESP_LOGE( TAG_HAL, "ERROR: radio_spi_init failed" );
+        return -1;
+    }
     spi_bus_config_t spi_bus_config = { .mosi_io_num   = radio_context.spi_mosi,
                                         .miso_io_num   = radio_context.spi_miso,
                                         .sclk_io_num   = radio_context.spi_sclk,
@@ -224,6 +431,16 @@ int lgw_connect( void )
 
 int lgw_radio_setup( void )
 {
+#if defined( CONFIG_RADIO_SHADOW_CACHE )
+    /* Skip the configuration commands which would not change anything, must be attached before the radio reset */
+    static bool shadow_attached = false;
+    if( shadow_attached == false )
+    {
+        ral_shadow_attach( &lgw_ral );
+        shadow_attached = true;
+    }
+#endif
+
     ASSERT_RAL_RC( ral_reset( &lgw_ral ) );
     ASSERT_RAL_RC( ral_init( &lgw_ral ) );
 
@@ -374,6 +591,25 @@ int lgw_start( void )
     /* Update RX status */
     rx_status = RX_ON;
 
+    /* Create the TX task and its timer, the timer callback only wakes up the task */
+    if( tx_task == NULL )
+    {
+        if( xTaskCreate( tx_task_run, "lgw_tx", TX_TASK_STACK_SIZE, NULL, TX_TASK_PRIO, &tx_task ) != pdPASS )
+        {
+            ESP_LOGE( TAG_HAL, "ERROR: FAILED TO CREATE TX TASK\n" );
+            return LGW_HAL_ERROR;
+        }
+    }
+    if( tx_timer == NULL )
+    {
+        const esp_timer_create_args_t tx_timer_args = { .callback = tx_timer_cb, .name = "lgw_tx" };
+        if( esp_timer_create( &tx_timer_args, &tx_timer ) != ESP_OK )
+        {
+            ESP_LOGE( TAG_HAL, "ERROR: FAILED TO CREATE TX TIMER\n" );
+            return LGW_HAL_ERROR;
+        }
+    }
+
     /* Update TX status */
     if( rxrf_conf.tx_enable == false )
     {
@@ -410,16 +646,18 @@ int lgw_stop( void )
 
 int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
 {
-    struct lgw_pkt_rx_s* p = &pkt_data[0];
+    struct lgw_pkt_rx_s* p;
     uint32_t             count_us;
+    uint32_t             count_us_hdr;
+    uint32_t             count_us_preamble;
+    bool                 hdr_received;
     int8_t               rssi, snr;
     uint8_t              status;
     uint16_t             size;
-    bool                 irq_received;
+    bool                 rx_stopped;
+    bool                 rx_restart         = false;
     int                  nb_packet_received = 0;
 
-    /* max_pkt is ignored, only 1 packet can be received at a time */
-
     /* check if the concentrator is running */
     if( is_started == false )
     {
@@ -427,33 +665,71 @@ int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
         return LGW_HAL_ERROR;
     }
 
-    memset( p, 0, sizeof( struct lgw_pkt_rx_s ) );
-    nb_packet_received =
-        lgw_radio_get_pkt( &lgw_ral, &irq_received, &count_us, &rssi, &snr, &status, &size, p->payload );
-    if( nb_packet_received > 0 )
+    /* the radio is not in RX while a TX is scheduled or emitting, only check for the end of the TX. The packets
+     * received before the TX are kept by the radio layer until then */
+    if( tx_status == TX_EMITTING )
     {
-        p->count_us   = count_us;
-        p->freq_hz    = rxrf_conf.freq_hz;
-        p->if_chain   = 0;
-        p->rf_chain   = 0;
-        p->status     = status;
-        p->modulation = rxif_conf.modulation;
-        p->datarate   = rxif_conf.datarate;
-        p->bandwidth  = rxif_conf.bandwidth;
-        p->coderate   = rxif_conf.coderate;
-        p->rssic      = ( float ) rssi;
-        p->snr        = ( float ) snr;
-        p->size       = size;
+        tx_complete( );
+    }
+    if( ( tx_status == TX_SCHEDULED ) || ( tx_status == TX_EMITTING ) )
+    {
+        return 0;
+    }
 
-        /* Compensate timestamp with for radio processing delay */
-        uint32_t count_us_correction = lgw_radio_timestamp_correction( rxif_conf.datarate, rxif_conf.bandwidth );
-        ESP_LOGI( TAG_HAL, "count_us correction: %lu us", count_us_correction );
-        p->count_us -= count_us_correction;
+    /* fetch the packets queued by the radio layer, oldest first */
+    while( nb_packet_received < max_pkt )
+    {
+        p = &pkt_data[nb_packet_received];
+        memset( p, 0, sizeof( struct lgw_pkt_rx_s ) );
+        if( lgw_radio_get_pkt( &lgw_ral, &rx_stopped, &count_us, &hdr_received, &count_us_hdr, &rssi, &snr, &status,
+                               &size, p->payload ) == 0 )
+        {
+            rx_restart |= rx_stopped;
+            break;
+        }
+        rx_restart |= rx_stopped;
+
+        p->count_us     = count_us;
+        p->irq_count_us = count_us;
+        p->freq_hz      = rxrf_conf.freq_hz;
+        p->if_chain     = 0;
+        p->rf_chain     = 0;
+        p->status       = status;
+        p->modulation   = rxif_conf.modulation;
+        p->datarate     = rxif_conf.datarate;
+        p->bandwidth    = rxif_conf.bandwidth;
+        p->coderate     = rxif_conf.coderate;
+        p->rssic        = ( float ) rssi;
+        p->snr          = ( float ) snr;
+        p->size         = size;
+        lgw_trace_at( LGW_TRACE_RX_IRQ, count_us, count_us );
+        lgw_trace( LGW_TRACE_RX_FETCH, count_us );
+
+        if( ( hdr_received == true ) && ( status == STAT_CRC_OK ) )
+        {
+            /* Get the end of the packet from the header IRQ, which does not depend on the payload processing. The
+             * preamble length is the one of the RX configuration */
+            count_us_hdr -= lgw_radio_hdr_irq_delay( rxif_conf.datarate, rxif_conf.bandwidth );
+            p->count_us = lora_packet_end_from_header( rxif_conf.bandwidth, rxif_conf.datarate, rxif_conf.coderate,
+                                                       STD_LORA_PREAMBLE, false, size, count_us_hdr,
+                                                       &count_us_preamble );
+            ESP_LOGD( TAG_HAL, "header at %lu us, preamble at %lu us, end at %lu us (RX_DONE at %lu us)", count_us_hdr,
+                      count_us_preamble, p->count_us, count_us );
+        }
+        else
+        {
+            /* Compensate timestamp with for radio processing delay */
+            uint32_t count_us_correction = lgw_radio_timestamp_correction( rxif_conf.datarate, rxif_conf.bandwidth );
+            ESP_LOGI( TAG_HAL, "count_us correction: %lu us", count_us_correction );
+            p->count_us -= count_us_correction;
+        }
+
+        nb_packet_received += 1;
     }
 
-    if( irq_received == true )
+    /* The radio is in continuous RX, it only has to be reconfigured if it has left RX */
+    if( rx_restart == true )
     {
-        /* Reconfigure RX */
         lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
     }
 
@@ -462,8 +738,29 @@ int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data )
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_send( struct lgw_pkt_tx_s* pkt_data )
+bool lgw_wait_irq( uint32_t timeout_ms )
 {
+    return lgw_radio_wait_irq( timeout_ms, tx_status );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_abort_wait_irq( void )
+{
+    lgw_radio_abort_wait_irq( );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_send_prepare( struct lgw_pkt_tx_s* pkt_data )
+{
+    uint32_t count_us_start;
+    uint32_t count_us_end;
+    uint32_t duration_us;
+
+    CHECK_NULL( pkt_data );
+    lgw_trace( LGW_TRACE_TX_PREPARE, pkt_data->count_us );
+
     /* check if the concentrator is running */
     if( is_started == false )
     {
@@ -471,14 +768,40 @@ int lgw_send( struct lgw_pkt_tx_s* pkt_data )
         return LGW_HAL_ERROR;
     }
 
+    /* the previous TX may be over without lgw_receive() having been called since */
+    if( tx_status == TX_EMITTING )
+    {
+        tx_complete( );
+    }
+    if( tx_status != TX_FREE )
+    {
+        ESP_LOGE( TAG_HAL, "ERROR: TX BUSY, CANNOT SEND PACKET\n" );
+        return LGW_HAL_ERROR;
+    }
+
     /* Update RX status */
     rx_status = RX_SUSPENDED;
 
-    /* Configure for TX */
-    lgw_radio_configure_tx( &lgw_ral, pkt_data );
+    /* Configure for TX, the packets already received are kept but a packet being received is lost */
+    lgw_get_instcnt( &count_us_start );
+    lgw_radio_clear_irq( &lgw_ral );
+    if( lgw_radio_configure_tx( &lgw_ral, pkt_data ) != LGW_HAL_SUCCESS )
+    {
+        lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
+        rx_status = RX_ON;
+        return LGW_HAL_ERROR;
+    }
+    lgw_get_instcnt( &count_us_end );
+    duration_us = count_us_end - count_us_start;
 
-    /* Update TX status */
-    tx_status = TX_SCHEDULED;
+    portENTER_CRITICAL( &tx_stats_lock );
+    tx_stats_nb_prepare += 1;
+    tx_stats_prepare_sum += duration_us;
+    if( duration_us > tx_stats_prepare_max )
+    {
+        tx_stats_prepare_max = duration_us;
+    }
+    portEXIT_CRITICAL( &tx_stats_lock );
 
     /* Get TCXO startup time, if any */
     uint32_t tcxo_startup_time_in_tick = 0;
@@ -489,57 +812,66 @@ int lgw_send( struct lgw_pkt_tx_s* pkt_data )
 #elif defined( CONFIG_RADIO_TYPE_LR1121 )
     ral_lr11xx_bsp_get_xosc_cfg( NULL, NULL, NULL, &tcxo_startup_time_in_tick );
 #endif
-    uint32_t tcxo_startup_time_us = tcxo_startup_time_in_tick * 15625 / 1000;
-
-    /* Wait for time to send packet */
-    uint32_t count_us_now;
-    do
-    {
-        lgw_get_instcnt( &count_us_now );
-        WAIT_US( 100 );
-    } while( ( int32_t )( pkt_data->count_us - count_us_now ) > ( int32_t ) tcxo_startup_time_us );
+    tx_start_delay_us = tcxo_startup_time_in_tick * 15625 / 1000;
 
-    /* Send packet */
-    ASSERT_RAL_RC( ral_set_tx( &lgw_ral ) );
+    /* Prepare the report of this TX */
+    memset( &tx_report, 0, sizeof tx_report );
+    tx_report.count_us = pkt_data->count_us;
+    tx_toa_ms          = lgw_time_on_air( pkt_data );
+    tx_immediate       = ( pkt_data->tx_mode == IMMEDIATE );
+    tx_fire_us         = pkt_data->count_us - tx_start_delay_us;
+    tx_armed           = false;
 
     /* Update TX status */
-    tx_status = TX_EMITTING;
+    tx_status = TX_SCHEDULED;
 
-    /* Wait for TX_DONE */
-    bool      flag_tx_done    = false;
-    bool      flag_tx_timeout = false;
-    ral_irq_t irq_regs;
-    do
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_send_fire( void )
+{
+    uint32_t count_us_now;
+    int32_t  delay_us;
+
+    if( ( tx_status != TX_SCHEDULED ) || ( tx_armed == true ) )
     {
-        ASSERT_RAL_RC( ral_get_and_clear_irq_status( &lgw_ral, &irq_regs ) );
-        if( ( irq_regs & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
-        {
-            lgw_get_instcnt( &count_us_now );
-            printf( "%lu: IRQ_TX_DONE\n", count_us_now );
-            flag_tx_done = true;
-        }
-        if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
-        {  // TODO: check if IRQ also valid for TX
-            lgw_get_instcnt( &count_us_now );
-            ESP_LOGW( TAG_HAL, "%lu: TX:IRQ_TIMEOUT\n", count_us_now );
-            flag_tx_timeout = true;
-        }
+        ESP_LOGE( TAG_HAL, "ERROR: NO PACKET PREPARED, CANNOT FIRE TX\n" );
+        return LGW_HAL_ERROR;
+    }
+    tx_armed = true;
 
-        /* Yield for 10ms (avoid TWDT watchdog timeout) for long TX */
-        vTaskDelay( pdMS_TO_TICKS( 10 ) );
-    } while( ( flag_tx_done == false ) && ( flag_tx_timeout == false ) );
+    /* Arm the timer for the time to send packet, or send it right away if it is too close */
+    lgw_get_instcnt( &count_us_now );
+    if( tx_immediate == true )
+    {
+        tx_fire_us = count_us_now;
+    }
+    delay_us = ( int32_t ) ( tx_fire_us - count_us_now ) - TX_FIRE_ADVANCE_US;
+    lgw_trace( LGW_TRACE_TX_ARMED, tx_report.count_us );
+    if( ( delay_us <= 0 ) || ( esp_timer_start_once( tx_timer, ( uint64_t ) delay_us ) != ESP_OK ) )
+    {
+        tx_fire( );
+    }
 
-    /* Update TX status */
-    tx_status = TX_FREE;
+    return LGW_HAL_SUCCESS;
+}
 
-    /* Back to RX config */
-    lgw_radio_set_rx( &lgw_ral, rxrf_conf.freq_hz, rxif_conf.datarate, rxif_conf.bandwidth, rxif_conf.coderate );
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    /* Update RX status */
-    rx_status = RX_ON;
+int lgw_send( struct lgw_pkt_tx_s* pkt_data )
+{
+    int err;
 
-    return ( flag_tx_timeout == false ) ? LGW_HAL_SUCCESS : LGW_HAL_ERROR;
-};
+    err = lgw_send_prepare( pkt_data );
+    if( err != LGW_HAL_SUCCESS )
+    {
+        return err;
+    }
+
+    return lgw_send_fire( );
+}
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
@@ -589,6 +921,23 @@ int lgw_status( uint8_t rf_chain, uint8_t select, uint8_t* code )
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+int lgw_get_tx_report( struct lgw_tx_report_s* report )
+{
+    CHECK_NULL( report );
+
+    if( tx_report_ready == false )
+    {
+        return LGW_HAL_ERROR;
+    }
+
+    memcpy( report, &tx_report, sizeof( struct lgw_tx_report_s ) );
+    tx_report_ready = false;
+
+    return LGW_HAL_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_get_instcnt( uint32_t* inst_cnt_us )
 {
     int64_t count_us_64 = esp_timer_get_time( );
@@ -614,7 +963,7 @@ uint32_t lgw_time_on_air( const struct lgw_pkt_tx_s* packet )
     {
         toa_us = lora_packet_time_on_air( packet->bandwidth, packet->datarate, packet->coderate, packet->preamble,
                                           packet->no_header, packet->no_crc, packet->size, NULL, NULL, NULL );
-        toa_ms = ( uint32_t )( ( double ) toa_us / 1000.0 + 0.5 );
+        toa_ms = ( toa_us + 500 ) / 1000;
     }
     else
     {
@@ -662,4 +1011,107 @@ void lgw_get_min_max_power_dbm( int8_t* min_power_dbm, int8_t* max_power_dbm )
     *max_power_dbm = shield_capabilities->power_dbm_max;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_spi_stats_report( void )
+{
+    radio_spi_cmd_stats_t stats[RADIO_SPI_STATS_CMD_NB];
+    int                   nb;
+    int                   i;
+
+    nb = radio_spi_stats_get( stats, RADIO_SPI_STATS_CMD_NB );
+    radio_spi_stats_reset( );
+
+    for( i = 0; i < nb; i++ )
+    {
+        printf( "# SPI cmd 0x%04X: %lu calls, %lu bytes, avg %lu us, max %lu us\n", stats[i].opcode, stats[i].nb_calls,
+                stats[i].nb_bytes, stats[i].total_us / stats[i].nb_calls, stats[i].max_us );
+    }
+
+#if defined( CONFIG_RADIO_SHADOW_CACHE )
+    /* the shadow cache counters are never reset, only display the increments since last call */
+    static ral_shadow_cmd_stats_t shadow_stats_prev[RAL_SHADOW_CMD_NB] = { 0 };
+    ral_shadow_cmd_stats_t        shadow_stats[RAL_SHADOW_CMD_NB];
+
+    ral_shadow_get_stats( shadow_stats );
+    for( i = 0; i < RAL_SHADOW_CMD_NB; i++ )
+    {
+        printf( "# RAL %s: %lu issued, %lu elided\n", ral_shadow_cmd_name( i ),
+                shadow_stats[i].issued - shadow_stats_prev[i].issued,
+                shadow_stats[i].elided - shadow_stats_prev[i].elided );
+    }
+    memcpy( shadow_stats_prev, shadow_stats, sizeof shadow_stats_prev );
+#endif
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_rx_stats_report( void )
+{
+    uint32_t nb_set_rx;
+    uint32_t nb_window;
+    uint32_t nb_irq_overflow;
+    uint32_t nb_pkt_overflow;
+
+    lgw_radio_get_rx_stats( &nb_set_rx, &nb_window, &nb_irq_overflow, &nb_pkt_overflow );
+
+    printf( "# RX configurations: %lu, packets ended while reading a packet: %lu\n", nb_set_rx, nb_window );
+    printf( "# RX events dropped: %lu IRQs, %lu packets\n", nb_irq_overflow, nb_pkt_overflow );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_tx_stats_report( void )
+{
+    uint32_t nb_prepare;
+    uint32_t prepare_sum;
+    uint32_t prepare_max;
+    uint32_t nb_fire;
+    uint32_t fire_sum;
+    uint32_t fire_max;
+    uint32_t nb_timed;
+    int32_t  margin_min;
+    uint32_t nb_late;
+    uint32_t late_max;
+
+    portENTER_CRITICAL( &tx_stats_lock );
+    nb_prepare           = tx_stats_nb_prepare;
+    prepare_sum          = tx_stats_prepare_sum;
+    prepare_max          = tx_stats_prepare_max;
+    nb_fire              = tx_stats_nb_fire;
+    fire_sum             = tx_stats_fire_sum;
+    fire_max             = tx_stats_fire_max;
+    nb_timed             = tx_stats_nb_timed;
+    margin_min           = tx_stats_margin_min;
+    nb_late              = tx_stats_nb_late;
+    late_max             = tx_stats_late_max;
+    tx_stats_nb_prepare  = 0;
+    tx_stats_prepare_sum = 0;
+    tx_stats_prepare_max = 0;
+    tx_stats_nb_fire     = 0;
+    tx_stats_fire_sum    = 0;
+    tx_stats_fire_max    = 0;
+    tx_stats_nb_timed    = 0;
+    tx_stats_margin_min  = INT32_MAX;
+    tx_stats_nb_late     = 0;
+    tx_stats_late_max    = 0;
+    portEXIT_CRITICAL( &tx_stats_lock );
+
+    if( nb_prepare > 0 )
+    {
+        printf( "# %s TX prepare: %lu packets, avg %lu us, max %lu us\n", radio_name, nb_prepare,
+                prepare_sum / nb_prepare, prepare_max );
+    }
+    if( nb_fire > 0 )
+    {
+        printf( "# %s TX fire: %lu packets, avg %lu us, max %lu us\n", radio_name, nb_fire, fire_sum / nb_fire,
+                fire_max );
+    }
+    if( nb_timed > 0 )
+    {
+        printf( "# TX fire margin: %lu timestamped packets, min %ld us of %d us, %lu late (max %lu us)\n", nb_timed,
+                margin_min, TX_FIRE_ADVANCE_US, nb_late, late_max );
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
\ No newline at end of file
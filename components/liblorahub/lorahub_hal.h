@@ -150,6 +150,7 @@ struct lgw_pkt_rx_s
     uint8_t  if_chain;     /*!> by which IF chain was packet received */
     uint8_t  status;       /*!> status of the received packet */
     uint32_t count_us;     /*!> internal concentrator counter for timestamping, 1 microsecond resolution */
+    uint32_t irq_count_us; /*!> internal counter value when the radio raised the RX interrupt (not compensated) */
     uint8_t  rf_chain;     /*!> through which RF chain the packet was received */
     uint8_t  modulation;   /*!> modulation used by the packet */
     uint8_t  bandwidth;    /*!> modulation bandwidth (LoRa only) */
@@ -185,6 +186,18 @@ struct lgw_pkt_tx_s
     uint8_t  payload[256]; /*!> buffer containing the payload */
 };
 
+/**
+@struct lgw_tx_report_s
+@brief Structure containing the actual timing of a packet sent
+*/
+struct lgw_tx_report_s
+{
+    uint32_t count_us; /*!> requested timestamp of the packet */
+    uint32_t start_us; /*!> internal counter value when the radio started to emit */
+    uint32_t end_us;   /*!> internal counter value when the radio raised the TX_DONE interrupt */
+    bool     done;     /*!> false if TX_DONE was not received */
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
 
@@ -219,13 +232,53 @@ int lgw_stop( void );
 @param max_pkt maximum number of packet that must be retrieved (equal to the size of the array of struct)
 @param pkt_data pointer to an array of struct that will receive the packet metadata and payload pointers
 @return LGW_HAL_ERROR id the operation failed, else the number of packets retrieved
+
+The radio interrupts are timestamped and the packets read from the radio are queued, so several packets can be
+retrieved by a single call when it has been delayed.
 */
 int lgw_receive( uint8_t max_pkt, struct lgw_pkt_rx_s* pkt_data );
 
+/**
+@brief Block the calling task until the radio raises an interrupt, so that lgw_receive() can be called right away
+@param timeout_ms maximum time to wait for an interrupt, in milliseconds
+@return true if the task has been woken up by an interrupt or by lgw_abort_wait_irq(), false on timeout
+
+While a TX is scheduled or emitting, the packets already received do not end the wait, as lgw_receive() only fetches
+them once the TX is over.
+*/
+bool lgw_wait_irq( uint32_t timeout_ms );
+
+/**
+@brief Wake up the task blocked in lgw_wait_irq(), if any
+@return N/A
+*/
+void lgw_abort_wait_irq( void );
+
+/**
+@brief Load a packet in the radio, without starting the TX
+@param pkt_data structure containing the data and metadata for the packet to send
+@return LGW_HAL_ERROR id the operation failed or a TX is already ongoing, LGW_HAL_SUCCESS else
+
+The radio leaves RX when the packet is loaded, and stays out of RX until the end of the TX started by lgw_send_fire().
+*/
+int lgw_send_prepare( struct lgw_pkt_tx_s* pkt_data );
+
+/**
+@brief Start the TX of the packet loaded by lgw_send_prepare(), immediately or at its timestamp depending on tx_mode
+@return LGW_HAL_ERROR if no packet has been prepared, LGW_HAL_SUCCESS else
+
+Only the SetTx command is sent to the radio at the fire instant, from a timer.
+*/
+int lgw_send_fire( void );
+
 /**
 @brief Schedule a packet to be send immediately or after a delay depending on tx_mode
 @param pkt_data structure containing the data and metadata for the packet to send
-@return LGW_HAL_ERROR id the operation failed, LGW_HAL_SUCCESS else
+@return LGW_HAL_ERROR id the operation failed or a TX is already ongoing, LGW_HAL_SUCCESS else
+
+This function does not wait for the packet to be sent: it calls lgw_send_prepare() and lgw_send_fire(). The end of the
+TX is handled by lgw_receive() when the radio raises the TX_DONE interrupt, the radio is then set back in RX and the
+TX timing is available from lgw_get_tx_report().
 
 /!\ When sending a packet, there is a delay (approx 1.5ms) for the analog
 circuitry to start and be stable. This delay is adjusted by the HAL depending
@@ -256,6 +309,15 @@ int lgw_send( struct lgw_pkt_tx_s* pkt_data );
 */
 int lgw_status( uint8_t rf_chain, uint8_t select, uint8_t* code );
 
+/**
+@brief Get the actual timing of the last packet sent, once its TX is over
+@param report pointer to receive the TX timing
+@return LGW_HAL_ERROR if no TX has ended since the previous call, LGW_HAL_SUCCESS else
+
+Must be called with the same access control as lgw_send() and lgw_receive().
+*/
+int lgw_get_tx_report( struct lgw_tx_report_s* report );
+
 /**
 @brief Return instateneous value of internal counter
 @param inst_cnt_us pointer to receive timestamp value
@@ -286,6 +348,27 @@ void lgw_get_min_max_freq_hz( uint32_t* min_freq_hz, uint32_t* max_freq_hz );
 */
 void lgw_get_min_max_power_dbm( int8_t* min_power_dbm, int8_t* max_power_dbm );
 
+/**
+@brief Display the timing statistics of the SPI commands sent to the radio since last call, and reset them. With the radio
+shadow cache, the number of configuration commands issued and elided is also displayed
+@return N/A
+*/
+void lgw_spi_stats_report( void );
+
+/**
+@brief Display the number of RX configurations, of packets that ended while the previous one was read, and of RX events
+dropped as the queues were full, since last call, and reset them
+@return N/A
+*/
+void lgw_rx_stats_report( void );
+
+/**
+@brief Display the durations of the TX preparations and TX starts, and the margin left to the timestamped TX starts,
+since last call, and reset them
+@return N/A
+*/
+void lgw_tx_stats_report( void );
+
 #endif  // _LORAHUB_HAL_H
 
 /* --- EOF ------------------------------------------------------------------ */
\ No newline at end of file
@@ -17,6 +17,9 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #include <string.h>
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
 #include "lorahub_aux.h"
 #include "lorahub_hal.h"
 #include "lorahub_hal_rx.h"
@@ -36,58 +39,275 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 static const char* TAG_HAL_RX = "HAL_RX";
 
-#define RX_TIMEOUT_MS 120000 /* 2 minutes */
+#define RX_TIMEOUT_MS RAL_RX_TIMEOUT_CONTINUOUS_MODE /* the radio stays in RX after RX_DONE and CRC errors */
+
+#define IRQ_RING_SIZE 8 /* number of DIO interrupts timestamped by the ISR and not processed yet */
+#define PKT_RING_SIZE 4 /* number of packets read from the radio and not fetched yet */
 
 /* -------------------------------------------------------------------------- */
-/* --- PRIVATE TYPES --------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+typedef struct rx_pkt_s
+{
+    uint32_t count_us;     /* time of the IRQ which reported the end of the packet */
+    uint32_t count_us_hdr; /* time of the IRQ which reported the header of the packet */
+    bool     hdr_received; /* true if count_us_hdr is valid */
+    int8_t   rssi;
+    int8_t   snr;
+    uint8_t  status;
+    uint16_t size;
+    uint8_t  payload[256];
+} rx_pkt_t;
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-static volatile bool irq_fired    = false;
-static uint32_t      irq_count_us = 0;
+/* DIO interrupt timestamps, pushed by the ISR and popped by radio_irq_process(). The IRQ line is held until the radio
+ * IRQ status is cleared, so each entry matches one read of the IRQ status, the IRQs raised while it is read excepted */
+static portMUX_TYPE      irq_ring_lock     = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t          irq_ring[IRQ_RING_SIZE];
+static volatile uint32_t irq_ring_wr       = 0; /* number of interrupts pushed */
+static volatile uint32_t irq_ring_rd       = 0; /* number of interrupts popped */
+static uint32_t          irq_ring_overflow = 0; /* number of interrupts dropped as the ring was full */
+
+static uint32_t irq_count_us = 0; /* time of the last IRQ processed */
+static uint32_t hdr_count_us = 0; /* time of the IRQ which reported the header of the packet being received */
+
+static TaskHandle_t volatile irq_task = NULL; /* task to be notified when the radio raises an interrupt */
+
+/* Packets read from the radio by radio_irq_process() and fetched by lgw_radio_get_pkt(), both called with the HAL
+ * access control */
+static rx_pkt_t pkt_ring[PKT_RING_SIZE];
+static uint32_t pkt_ring_wr = 0; /* number of packets pushed */
+static uint32_t pkt_ring_rd = 0; /* number of packets popped */
 
-static bool flag_rx_done      = false;
-static bool flag_rx_crc_error = false;
 static bool flag_rx_timeout   = false;
+static bool flag_rx_hdr_ok    = false;
+static bool flag_tx_done      = false;
+static bool flag_rx_read_busy = false; /* an IRQ was raised while the last packet was read, its status not read yet */
+
+/* Delay between the end of the header of a packet and the time the header valid IRQ is timestamped, in microseconds,
+ * per spreading factor (SF5 to SF12) and bandwidth (125, 250 and 500 kHz). The sx126x family raises the IRQ once the
+ * last header symbol has been demodulated, the table assumes one symbol after its end, as the RX_DONE correction
+ * does. These values are not measured, so the header IRQ is only used to timestamp the packets when
+ * CONFIG_RADIO_HEADER_TIMESTAMP is enabled, the packets being timestamped from RX_DONE otherwise. No figure is known
+ * for the LR1121 yet. */
+#if defined( CONFIG_RADIO_HEADER_TIMESTAMP ) && \
+    ( defined( CONFIG_RADIO_TYPE_SX1261 ) || defined( CONFIG_RADIO_TYPE_SX1262 ) || \
+      defined( CONFIG_RADIO_TYPE_SX1268 ) || defined( CONFIG_RADIO_TYPE_LLCC68 ) )
+static const bool     hdr_irq_timestamp      = true;
+static const uint16_t hdr_irq_delay_us[8][3] = {
+    { 256, 128, 64 },        /* SF5 */
+    { 512, 256, 128 },       /* SF6 */
+    { 1024, 512, 256 },      /* SF7 */
+    { 2048, 1024, 512 },     /* SF8 */
+    { 4096, 2048, 1024 },    /* SF9 */
+    { 8192, 4096, 2048 },    /* SF10 */
+    { 16384, 8192, 4096 },   /* SF11 */
+    { 32768, 16384, 8192 },  /* SF12 */
+};
+#else
+static const bool     hdr_irq_timestamp      = false;
+static const uint16_t hdr_irq_delay_us[8][3] = { { 0 } };
+#endif
+
+/* RX statistics */
+static portMUX_TYPE rx_stats_lock            = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t     rx_stats_nb_set_rx       = 0; /* number of full RX configurations */
+static uint32_t     rx_stats_nb_window       = 0; /* number of packets ended while the previous one was being read */
+static uint32_t     rx_stats_nb_pkt_overflow = 0; /* number of packets dropped as the packet ring was full */
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
+static bool irq_ring_pop( uint32_t* count_us );
+
+static bool irq_ring_is_empty( void );
+
+static void radio_read_pkt( const ral_t* ral, bool crc_error, uint32_t count_us );
+
+static void set_led_rx( const ral_t* ral, bool on );
+
+static void set_led_tx( const ral_t* ral, bool on );
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
 static void IRAM_ATTR radio_on_dio_irq( void* args )
 {
-    irq_fired = true;
-    lgw_get_instcnt( &irq_count_us );
+    BaseType_t task_woken = pdFALSE;
+    uint32_t   count_us;
+
+    lgw_get_instcnt( &count_us );
+
+    portENTER_CRITICAL_ISR( &irq_ring_lock );
+    if( ( irq_ring_wr - irq_ring_rd ) < IRQ_RING_SIZE )
+    {
+        irq_ring[irq_ring_wr % IRQ_RING_SIZE] = count_us;
+        irq_ring_wr += 1;
+    }
+    else
+    {
+        irq_ring_overflow += 1;
+    }
+    portEXIT_CRITICAL_ISR( &irq_ring_lock );
+
+    /* wake up the task waiting for radio events, if any */
+    if( irq_task != NULL )
+    {
+        vTaskNotifyGiveFromISR( irq_task, &task_woken );
+        portYIELD_FROM_ISR( task_woken );
+    }
+}
+
+static bool irq_ring_pop( uint32_t* count_us )
+{
+    bool popped = false;
+
+    portENTER_CRITICAL( &irq_ring_lock );
+    if( irq_ring_wr != irq_ring_rd )
+    {
+        *count_us = irq_ring[irq_ring_rd % IRQ_RING_SIZE];
+        irq_ring_rd += 1;
+        popped = true;
+    }
+    portEXIT_CRITICAL( &irq_ring_lock );
+
+    return popped;
+}
+
+static bool irq_ring_is_empty( void )
+{
+    return ( irq_ring_wr == irq_ring_rd );
+}
+
+static void radio_read_pkt( const ral_t* ral, bool crc_error, uint32_t count_us )
+{
+    rx_pkt_t*                pkt;
+    ral_lora_rx_pkt_status_t pkt_status_lora;
+    bool                     hdr_received = ( flag_rx_hdr_ok == true ) && ( hdr_irq_timestamp == true );
+
+    /* the header reported belongs to this packet, whatever happens to it */
+    flag_rx_hdr_ok = false;
+
+    if( ( pkt_ring_wr - pkt_ring_rd ) >= PKT_RING_SIZE )
+    {
+        portENTER_CRITICAL( &rx_stats_lock );
+        rx_stats_nb_pkt_overflow += 1;
+        portEXIT_CRITICAL( &rx_stats_lock );
+        return;
+    }
+
+    set_led_rx( ral, true );
+
+    pkt               = &pkt_ring[pkt_ring_wr % PKT_RING_SIZE];
+    pkt->count_us     = count_us;
+    pkt->hdr_received = hdr_received;
+    pkt->count_us_hdr = hdr_count_us;
+    pkt->size         = 0;
+    if( ral_get_lora_rx_pkt_status( ral, &pkt_status_lora ) != RAL_STATUS_OK )
+    {
+        ESP_LOGW( TAG_HAL_RX, "%lu: failed to get packet status", count_us );
+        set_led_rx( ral, false );
+        return;
+    }
+    pkt->rssi = pkt_status_lora.rssi_pkt_in_dbm;
+    pkt->snr  = pkt_status_lora.snr_pkt_in_db;
+
+    if( crc_error == true )
+    {
+        pkt->status = STAT_CRC_BAD;
+    }
+    else
+    {
+        pkt->status = STAT_CRC_OK;
+
+        /* Get packet payload */
+        if( ral_get_pkt_payload( ral, sizeof pkt->payload, pkt->payload, &pkt->size ) != RAL_STATUS_OK )
+        {
+            ESP_LOGW( TAG_HAL_RX, "%lu: failed to get packet payload", count_us );
+            set_led_rx( ral, false );
+            return;
+        }
+#if 0
+        ESP_LOGI(TAG_HAL_RX, "%d byte packet received:", pkt->size);
+        ESP_LOG_BUFFER_HEX_LEVEL(TAG_HAL_RX, pkt->payload, pkt->size, ESP_LOG_INFO);
+#endif
+    }
+    pkt_ring_wr += 1;
+
+    /* An IRQ raised while this packet was read is only known once its status is read, see radio_irq_process() */
+    flag_rx_read_busy = ( irq_ring_is_empty( ) == false );
+
+    set_led_rx( ral, false );
 }
 
 void radio_irq_process( const ral_t* ral )
 {
-    if( irq_fired == true )
+    const radio_context_t* radio_context = ( const radio_context_t* ) ( ral->context );
+    uint32_t               count_us;
+    ral_irq_t              irq_regs;
+    bool                   irq_pending;
+
+    irq_pending = irq_ring_pop( &count_us );
+    while( irq_pending == true )
     {
-        irq_fired = false;
+        irq_count_us = count_us;
 
-        ral_irq_t irq_regs;
         ral_get_and_clear_irq_status( ral, &irq_regs );
-        if( ( irq_regs & RAL_IRQ_RX_DONE ) == RAL_IRQ_RX_DONE )
+
+        /* A packet ended while the previous one was read, its data may have overwritten the one read. A header IRQ
+         * alone does not touch the buffer, it is not counted */
+        if( ( flag_rx_read_busy == true ) && ( ( irq_regs & ( RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR ) ) != 0 ) )
         {
-            // printf("%lu: IRQ_RX_DONE\n", irq_count_us);
-            flag_rx_done = true;
+            portENTER_CRITICAL( &rx_stats_lock );
+            rx_stats_nb_window += 1;
+            portEXIT_CRITICAL( &rx_stats_lock );
+        }
+        flag_rx_read_busy = false;
+
+        if( ( irq_regs & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
+        {
+            flag_tx_done = true;
+        }
+
+        if( ( irq_regs & RAL_IRQ_RX_HDR_OK ) == RAL_IRQ_RX_HDR_OK )
+        {
+            /* the IRQ line is held until cleared: when processed late, the time of the first IRQ is the header one */
+            hdr_count_us   = count_us;
+            flag_rx_hdr_ok = true;
+        }
+
+        if( ( irq_regs & RAL_IRQ_RX_HDR_ERROR ) == RAL_IRQ_RX_HDR_ERROR )
+        {
+            flag_rx_hdr_ok = false; /* no RX_DONE will follow */
         }
 
         if( ( irq_regs & RAL_IRQ_RX_CRC_ERROR ) == RAL_IRQ_RX_CRC_ERROR )
         {
-            ESP_LOGW( TAG_HAL_RX, "%lu: IRQ_CRC_ERROR", irq_count_us );
-            flag_rx_crc_error = true;
+            ESP_LOGW( TAG_HAL_RX, "%lu: IRQ_CRC_ERROR", count_us );
+            radio_read_pkt( ral, true, count_us );
+        }
+        else if( ( irq_regs & RAL_IRQ_RX_DONE ) == RAL_IRQ_RX_DONE )
+        {
+            radio_read_pkt( ral, false, count_us );
         }
 
         if( ( irq_regs & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT )
         {
-            ESP_LOGW( TAG_HAL_RX, "%lu: RX:IRQ_TIMEOUT", irq_count_us );
+            ESP_LOGW( TAG_HAL_RX, "%lu: RX:IRQ_TIMEOUT", count_us );
             flag_rx_timeout = true;
         }
+
+        /* DIO1 only interrupts on its rising edge: an IRQ raised between the read and the clear of the status keeps the
+         * line high, and nothing is pushed for it. Read the status again until it is empty or DIO1 is low, such an IRQ
+         * being timestamped when detected */
+        irq_pending = irq_ring_pop( &count_us );
+        if( ( irq_pending == false ) && ( irq_regs != 0 ) && ( gpio_get_level( radio_context->gpio_dio1 ) == 1 ) )
+        {
+            lgw_get_instcnt( &count_us );
+            irq_pending = true;
+        }
     }
 }
 
@@ -126,11 +346,86 @@ int lgw_radio_init_rx( const ral_t* ral )
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+bool lgw_radio_wait_irq( uint32_t timeout_ms, uint8_t tx_status )
+{
+    bool irq_ready;
+    bool pkt_ready;
+
+    /* register the calling task, notifications are counted so an IRQ cannot be missed once registered */
+    irq_task = xTaskGetCurrentTaskHandle( );
+
+    /* an IRQ may have fired before the task was registered, or packets may be waiting to be fetched. Only the events
+     * lgw_receive() handles in this TX status count: nothing is processed while a TX is scheduled, and the packets
+     * received before a TX are only fetched once it is over, returning for them would make the caller spin */
+    irq_ready = ( irq_ring_is_empty( ) == false ) && ( tx_status != TX_SCHEDULED );
+    pkt_ready = ( pkt_ring_wr != pkt_ring_rd ) && ( tx_status != TX_SCHEDULED ) && ( tx_status != TX_EMITTING );
+    if( ( irq_ready == true ) || ( pkt_ready == true ) )
+    {
+        return true;
+    }
+
+    /* round up to one tick, a non-zero timeout shorter than a tick must still block */
+    TickType_t timeout_ticks = pdMS_TO_TICKS( timeout_ms );
+    if( ( timeout_ticks == 0 ) && ( timeout_ms > 0 ) )
+    {
+        timeout_ticks = 1;
+    }
+
+    return ( ulTaskNotifyTake( pdTRUE, timeout_ticks ) > 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_radio_abort_wait_irq( void )
+{
+    if( irq_task != NULL )
+    {
+        xTaskNotifyGive( irq_task );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_radio_clear_irq( const ral_t* ral )
+{
+    /* packets already received are kept, only the events of the current radio operation are dropped */
+    radio_irq_process( ral );
+    flag_rx_timeout = false;
+    flag_rx_hdr_ok  = false;
+    flag_tx_done    = false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+bool lgw_radio_tx_done( const ral_t* ral, bool* timeout, uint32_t* count_us )
+{
+    radio_irq_process( ral );
+    if( ( flag_tx_done == false ) && ( flag_rx_timeout == false ) )
+    {
+        return false;
+    }
+
+    /* the timeout IRQ is also enabled for TX */
+    *timeout  = ( flag_tx_done == false );
+    *count_us = irq_count_us;
+
+    flag_tx_done    = false;
+    flag_rx_timeout = false;
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
 int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uint8_t bandwidth, uint8_t coderate )
 {
     set_led_rx( ral, false );
     set_led_tx( ral, false );
 
+    portENTER_CRITICAL( &rx_stats_lock );
+    rx_stats_nb_set_rx += 1;
+    portEXIT_CRITICAL( &rx_stats_lock );
+
     ASSERT_RAL_RC( ral_set_standby( ral, RAL_STANDBY_CFG_RC ) );
 
     ASSERT_RAL_RC( ral_set_pkt_type( ral, RAL_PKT_TYPE_LORA ) );
@@ -217,7 +512,8 @@ int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uin
 
     ASSERT_RAL_RC( ral_set_lora_pkt_params( ral, &lora_pkt_params ) );
 
-    const ral_irq_t rx_irq_mask = RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR | RAL_IRQ_RX_TIMEOUT;
+    const ral_irq_t rx_irq_mask =
+        RAL_IRQ_RX_DONE | RAL_IRQ_RX_CRC_ERROR | RAL_IRQ_RX_TIMEOUT | RAL_IRQ_RX_HDR_OK | RAL_IRQ_RX_HDR_ERROR;
     ASSERT_RAL_RC( ral_set_dio_irq_params( ral, rx_irq_mask ) );
     ASSERT_RAL_RC( ral_clear_irq_status( ral, RAL_IRQ_ALL ) );
 
@@ -231,64 +527,92 @@ int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uin
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-int lgw_radio_get_pkt( const ral_t* ral, bool* irq_received, uint32_t* count_us, int8_t* rssi, int8_t* snr,
-                       uint8_t* status, uint16_t* size, uint8_t* payload )
+int lgw_radio_get_pkt( const ral_t* ral, bool* rx_stopped, uint32_t* count_us, bool* hdr_received,
+                       uint32_t* count_us_hdr, int8_t* rssi, int8_t* snr, uint8_t* status, uint16_t* size,
+                       uint8_t* payload )
 {
-    int nb_pkt_received = 0;
+    rx_pkt_t* pkt;
 
     /* Initialize return values */
     *count_us     = 0;
+    *hdr_received = false;
+    *count_us_hdr = 0;
     *rssi         = 0;
     *snr          = 0;
     *status       = STAT_UNDEFINED;
     *size         = 0;
-    *irq_received = false;
+    *rx_stopped   = false;
 
-    /* Check if a packet has been received */
+    /* Read the packets received since last call, the radio is still in RX */
     radio_irq_process( ral );
-    if( ( flag_rx_done == true ) || ( flag_rx_crc_error == true ) )
+    if( flag_rx_timeout == true )
     {
-        set_led_rx( ral, true );
+        /* not expected in continuous mode, the radio has left RX */
+        *rx_stopped = true;
 
-        *irq_received = true;
-        *count_us     = irq_count_us;
+        /* Update status */
+        flag_rx_timeout = false;
+    }
 
-        ral_lora_rx_pkt_status_t pkt_status_lora;
-        ASSERT_RAL_RC( ral_get_lora_rx_pkt_status( ral, &pkt_status_lora ) );
-        *rssi = pkt_status_lora.rssi_pkt_in_dbm;
-        *snr  = pkt_status_lora.snr_pkt_in_db;
+    if( pkt_ring_wr == pkt_ring_rd )
+    {
+        return 0;
+    }
 
-        if( flag_rx_crc_error == true )
-        {
-            *status = STAT_CRC_BAD;
-        }
-        else
-        {
-            *status = STAT_CRC_OK;
+    pkt           = &pkt_ring[pkt_ring_rd % PKT_RING_SIZE];
+    *count_us     = pkt->count_us;
+    *hdr_received = pkt->hdr_received;
+    *count_us_hdr = pkt->count_us_hdr;
+    *rssi         = pkt->rssi;
+    *snr          = pkt->snr;
+    *status       = pkt->status;
+    *size         = pkt->size;
+    memcpy( payload, pkt->payload, pkt->size );
+    pkt_ring_rd += 1;
+
+    return 1;
+}
 
-            /* Get packet payload */
-            ASSERT_RAL_RC( ral_get_pkt_payload( ral, 256, payload, size ) );
-#if 0
-            ESP_LOGI(TAG_HAL_RX, "%d byte packet received:", *size);
-            ESP_LOG_BUFFER_HEX_LEVEL(TAG_HAL_RX, payload, *size, ESP_LOG_INFO);
-#endif
-        }
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-        nb_pkt_received += 1;
+void lgw_radio_get_rx_stats( uint32_t* nb_set_rx, uint32_t* nb_window, uint32_t* nb_irq_overflow,
+                             uint32_t* nb_pkt_overflow )
+{
+    portENTER_CRITICAL( &rx_stats_lock );
+    *nb_set_rx               = rx_stats_nb_set_rx;
+    *nb_window               = rx_stats_nb_window;
+    *nb_pkt_overflow         = rx_stats_nb_pkt_overflow;
+    rx_stats_nb_set_rx       = 0;
+    rx_stats_nb_window       = 0;
+    rx_stats_nb_pkt_overflow = 0;
+    portEXIT_CRITICAL( &rx_stats_lock );
+
+    portENTER_CRITICAL( &irq_ring_lock );
+    *nb_irq_overflow  = irq_ring_overflow;
+    irq_ring_overflow = 0;
+    portEXIT_CRITICAL( &irq_ring_lock );
+}
 
-        /* Update status */
-        flag_rx_done      = false;
-        flag_rx_crc_error = false;
-    }
-    else if( flag_rx_timeout == true )
-    {
-        *irq_received = true;
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-        /* Update status */
-        flag_rx_timeout = false;
+uint32_t lgw_radio_hdr_irq_delay( uint32_t sf, uint8_t bw )
+{
+    if( ( sf < DR_LORA_SF5 ) || ( sf > DR_LORA_SF12 ) )
+    {
+        return 0;
     }
 
-    return nb_pkt_received;
+    switch( bw )
+    {
+    case BW_125KHZ:
+        return hdr_irq_delay_us[sf - DR_LORA_SF5][0];
+    case BW_250KHZ:
+        return hdr_irq_delay_us[sf - DR_LORA_SF5][1];
+    case BW_500KHZ:
+        return hdr_irq_delay_us[sf - DR_LORA_SF5][2];
+    default:
+        return 0;
+    }
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -34,10 +34,24 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 int lgw_radio_init_rx( const ral_t* ral );
 
+bool lgw_radio_wait_irq( uint32_t timeout_ms, uint8_t tx_status );
+
+void lgw_radio_abort_wait_irq( void );
+
+void lgw_radio_clear_irq( const ral_t* ral );
+
+bool lgw_radio_tx_done( const ral_t* ral, bool* timeout, uint32_t* count_us );
+
 int lgw_radio_set_rx( const ral_t* ral, uint32_t freq_hz, uint32_t datarate, uint8_t bandwidth, uint8_t coderate );
 
-int lgw_radio_get_pkt( const ral_t* ral, bool* irq_received, uint32_t* count_us, int8_t* rssi, int8_t* snr,
-                       uint8_t* status, uint16_t* size, uint8_t* payload );
+int lgw_radio_get_pkt( const ral_t* ral, bool* rx_stopped, uint32_t* count_us, bool* hdr_received,
+                       uint32_t* count_us_hdr, int8_t* rssi, int8_t* snr, uint8_t* status, uint16_t* size,
+                       uint8_t* payload );
+
+void lgw_radio_get_rx_stats( uint32_t* nb_set_rx, uint32_t* nb_window, uint32_t* nb_irq_overflow,
+                             uint32_t* nb_pkt_overflow );
+
+uint32_t lgw_radio_hdr_irq_delay( uint32_t sf, uint8_t bw );
 
 uint32_t lgw_radio_timestamp_correction( uint32_t sf, uint8_t bw );
 
@@ -0,0 +1,144 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub per-packet latency trace
+
+    The writers reserve a slot with a single atomic increment, and publish it with its sequence number once filled, so
+    recording an event never waits, even from the TX timer. The reader only keeps the slots whose sequence number is
+    the expected one before and after the copy, the slots being overwritten meanwhile are skipped.
+
+    Only built with CONFIG_LATENCY_TRACE.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>    /* C99 types */
+#include <stdatomic.h> /* C11 atomics */
+
+#include <freertos/FreeRTOS.h>
+#include <esp_timer.h>
+
+#include "lorahub_trace.h"
+
+#if defined( CONFIG_LATENCY_TRACE )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+/* the slot index is masked, and stays consistent when the 32-bit event index wraps around */
+_Static_assert( ( LGW_TRACE_CAPACITY & ( LGW_TRACE_CAPACITY - 1 ) ) == 0, "LGW_TRACE_CAPACITY must be a power of 2" );
+
+#define TRACE_INDEX_MASK ( LGW_TRACE_CAPACITY - 1 )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct trace_slot_s
+{
+    _Atomic uint32_t       seq; /* index of the event + 1 once recorded, 0 while being recorded */
+    struct lgw_trace_rec_s rec;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES ---------------------------------------------------- */
+
+static struct trace_slot_s trace_ring[LGW_TRACE_CAPACITY];
+static _Atomic uint32_t    trace_next = 0; /* index of the next event to be recorded */
+
+static const char* const trace_event_str[LGW_TRACE_EVENT_NB] = {
+    "irq", "fetch", "serialize", "send", "push_ack", "pull_resp", "parse", "jit_enqueue", "jit_dequeue", "lock",
+    "lgw_send", "armed", "tx_start", "tx_done"
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void trace_record( uint8_t event, uint32_t pkt_id, uint32_t ts_us, uint8_t core );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void trace_record( uint8_t event, uint32_t pkt_id, uint32_t ts_us, uint8_t core )
+{
+    uint32_t             idx  = atomic_fetch_add_explicit( &trace_next, 1, memory_order_relaxed );
+    struct trace_slot_s* slot = &trace_ring[idx & TRACE_INDEX_MASK];
+
+    atomic_store_explicit( &slot->seq, 0, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    slot->rec.ts_us  = ts_us;
+    slot->rec.pkt_id = pkt_id;
+    slot->rec.event  = event;
+    slot->rec.core   = core;
+    atomic_store_explicit( &slot->seq, idx + 1, memory_order_release );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void lgw_trace( enum lgw_trace_event_e event, uint32_t pkt_id )
+{
+    trace_record( ( uint8_t ) event, pkt_id, ( uint32_t ) esp_timer_get_time( ), ( uint8_t ) xPortGetCoreID( ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lgw_trace_at( enum lgw_trace_event_e event, uint32_t pkt_id, uint32_t ts_us )
+{
+    trace_record( ( uint8_t ) event, pkt_id, ts_us, LGW_TRACE_CORE_UNKNOWN );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lgw_trace_get( struct lgw_trace_rec_s* recs, int max_recs )
+{
+    uint32_t             next = atomic_load_explicit( &trace_next, memory_order_acquire );
+    uint32_t             nb   = ( next < LGW_TRACE_CAPACITY ) ? next : LGW_TRACE_CAPACITY;
+    uint32_t             idx;
+    uint32_t             seq;
+    struct trace_slot_s* slot;
+    int                  nb_recs = 0;
+
+    if( nb > ( uint32_t ) max_recs )
+    {
+        nb = ( uint32_t ) max_recs; /* the latest ones */
+    }
+
+    for( idx = next - nb; idx != next; idx++ )
+    {
+        slot = &trace_ring[idx & TRACE_INDEX_MASK];
+        seq  = atomic_load_explicit( &slot->seq, memory_order_acquire );
+        if( seq != ( idx + 1 ) )
+        {
+            continue; /* being recorded, or already overwritten */
+        }
+        recs[nb_recs] = slot->rec;
+        atomic_thread_fence( memory_order_acquire );
+        if( atomic_load_explicit( &slot->seq, memory_order_relaxed ) != seq )
+        {
+            continue; /* overwritten while copied */
+        }
+        nb_recs += 1;
+    }
+
+    return nb_recs;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+const char* lgw_trace_event_str( uint8_t event )
+{
+    return ( event < LGW_TRACE_EVENT_NB ) ? trace_event_str[event] : "unknown";
+}
+
+#endif  // CONFIG_LATENCY_TRACE
+
+/* --- EOF ------------------------------------------------------------------ */
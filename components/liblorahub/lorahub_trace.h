@@ -0,0 +1,125 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub per-packet latency trace, a ring of the latest events of the uplinks and downlinks along their path
+
+    An uplink is identified by the internal counter value of its radio IRQ, a downlink by its TX time, as the same
+    counter value. Both are known at each stage without any state being carried along, a stage only known by its time
+    before the packet identifier is known is recorded afterwards with lgw_trace_at().
+
+    The trace is enabled with CONFIG_LATENCY_TRACE, the recording functions being empty otherwise.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _LORAHUB_TRACE_H
+#define _LORAHUB_TRACE_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h> /* C99 types */
+
+#include "sdkconfig.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#if defined( CONFIG_LATENCY_TRACE )
+#define LGW_TRACE_CAPACITY CONFIG_LATENCY_TRACE_CAPACITY /* Number of events kept, the oldest ones overwritten */
+#endif
+
+#define LGW_TRACE_CORE_UNKNOWN 0xFF /* the event was recorded afterwards, not by the core which handled it */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/* stages of the packets, in path order, the downlink ones after LGW_TRACE_DW_PULL_RESP */
+enum lgw_trace_event_e
+{
+    LGW_TRACE_RX_IRQ,       /* radio IRQ of the uplink */
+    LGW_TRACE_RX_FETCH,     /* uplink fetched from the radio layer by lgw_receive() */
+    LGW_TRACE_UP_SERIALIZE, /* uplink being serialized in a PUSH_DATA datagram */
+    LGW_TRACE_UP_SEND,      /* PUSH_DATA datagram sent */
+    LGW_TRACE_UP_ACK,       /* PUSH_ACK of the datagram received */
+    LGW_TRACE_DW_PULL_RESP, /* PULL_RESP datagram received */
+    LGW_TRACE_DW_PARSE,     /* PULL_RESP datagram being parsed */
+    LGW_TRACE_JIT_ENQUEUE,  /* downlink inserted in the JIT queue */
+    LGW_TRACE_JIT_DEQUEUE,  /* downlink removed from the JIT queue to be sent */
+    LGW_TRACE_DW_LOCK,      /* concentrator lock requested to send the downlink */
+    LGW_TRACE_TX_PREPARE,   /* downlink being loaded in the radio by lgw_send() */
+    LGW_TRACE_TX_ARMED,     /* TX timer armed, lgw_send() returns */
+    LGW_TRACE_TX_START,     /* radio set in TX */
+    LGW_TRACE_TX_DONE,      /* TX_DONE interrupt, or TX timeout */
+    LGW_TRACE_EVENT_NB
+};
+
+struct lgw_trace_rec_s
+{
+    uint32_t ts_us;  /* 32 LSBs of the esp_timer time of the event, as the internal counter */
+    uint32_t pkt_id; /* radio IRQ time of an uplink, TX time of a downlink */
+    uint8_t  event;  /* enum lgw_trace_event_e */
+    uint8_t  core;   /* core which recorded the event, LGW_TRACE_CORE_UNKNOWN if recorded afterwards */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+#if defined( CONFIG_LATENCY_TRACE )
+
+/**
+@brief Record an event of a packet now, from any task or core
+@param event stage reached by the packet
+@param pkt_id identifier of the packet
+*/
+void lgw_trace( enum lgw_trace_event_e event, uint32_t pkt_id );
+
+/**
+@brief Record an event of a packet which happened before its identifier was known, from any task or core
+@param event stage reached by the packet
+@param pkt_id identifier of the packet
+@param ts_us 32 LSBs of the esp_timer time of the event
+*/
+void lgw_trace_at( enum lgw_trace_event_e event, uint32_t pkt_id, uint32_t ts_us );
+
+/**
+@brief Get a copy of the events in the ring
+@param recs pointer to an array to be filled with the events, in recording order, which is not exactly time order
+@param max_recs size of the array, LGW_TRACE_CAPACITY to get all of them
+@return the number of events copied, the ones being recorded meanwhile are skipped
+*/
+int lgw_trace_get( struct lgw_trace_rec_s* recs, int max_recs );
+
+/**
+@brief Get the name of an event
+@param event stage reached by a packet
+@return a short name of the stage
+*/
+const char* lgw_trace_event_str( uint8_t event );
+
+#else
+
+static inline void lgw_trace( enum lgw_trace_event_e event, uint32_t pkt_id )
+{
+    ( void ) event;
+    ( void ) pkt_id;
+}
+
+static inline void lgw_trace_at( enum lgw_trace_event_e event, uint32_t pkt_id, uint32_t ts_us )
+{
+    ( void ) event;
+    ( void ) pkt_id;
+    ( void ) ts_us;
+}
+
+#endif  // CONFIG_LATENCY_TRACE
+
+#endif  // _LORAHUB_TRACE_H
+
+/* --- EOF ------------------------------------------------------------------ */
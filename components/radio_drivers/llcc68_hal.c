@@ -47,6 +47,7 @@
 
 #include "llcc68_hal.h"
 #include "radio_context.h"
+#include "radio_spi.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -81,11 +82,6 @@
  */
 void llcc68_hal_wait_on_busy( const void* context );
 
-/**
- * @brief SPI tranfer
- */
-static uint8_t spi_transfer( const void* context, uint8_t address );
-
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -119,52 +115,34 @@ llcc68_hal_status_t llcc68_hal_write( const void* context, const uint8_t* comman
 
 {
     const radio_context_t* llcc68_context = ( const radio_context_t* ) context;
-    int                    i;
+    int64_t                start_us;
+    bool                   ret;
 
     llcc68_hal_wait_on_busy( context );
 
-    gpio_set_level( llcc68_context->spi_nss, 0 );
-
-    /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
-    /* Write data */
-    for( i = 0; i < data_length; i++ )
-    {
-        spi_transfer( context, data[i] );
-    }
+    /* Write command and data in a single transaction */
+    start_us = radio_spi_stats_start( );
+    ret      = radio_spi_transfer( llcc68_context, command, command_length, data, NULL, data_length );
+    radio_spi_stats_add( ( command_length > 0 ) ? command[0] : 0, command_length + data_length, start_us );
 
-    gpio_set_level( llcc68_context->spi_nss, 1 );
-
-    return LLCC68_HAL_STATUS_OK;
+    return ( ret == true ) ? LLCC68_HAL_STATUS_OK : LLCC68_HAL_STATUS_ERROR;
 }
 
 llcc68_hal_status_t llcc68_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
                                      uint8_t* data, const uint16_t data_length )
 {
     const radio_context_t* llcc68_context = ( const radio_context_t* ) context;
-    int                    i;
+    int64_t                start_us;
+    bool                   ret;
 
     llcc68_hal_wait_on_busy( context );
 
-    gpio_set_level( llcc68_context->spi_nss, 0 );
+    /* Write command and read data in a single transaction */
+    start_us = radio_spi_stats_start( );
+    ret      = radio_spi_transfer( llcc68_context, command, command_length, NULL, data, data_length );
+    radio_spi_stats_add( ( command_length > 0 ) ? command[0] : 0, command_length + data_length, start_us );
 
-    /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
-    /* Read data */
-    for( i = 0; i < data_length; i++ )
-    {
-        data[i] = spi_transfer( context, 0x00 );
-    }
-
-    gpio_set_level( llcc68_context->spi_nss, 1 );
-
-    return LLCC68_HAL_STATUS_OK;
+    return ( ret == true ) ? LLCC68_HAL_STATUS_OK : LLCC68_HAL_STATUS_ERROR;
 }
 
 /*
@@ -183,29 +161,4 @@ void llcc68_hal_wait_on_busy( const void* context )
     } while( gpio_state == 1 );
 }
 
-bool spi_rw_byte( const void* context, uint8_t* data_in, uint8_t* data_out, size_t length )
-{
-    const radio_context_t*   llcc68_context = ( const radio_context_t* ) context;
-    static spi_transaction_t spi_transaction;
-
-    if( length > 0 )
-    {
-        memset( &spi_transaction, 0, sizeof( spi_transaction_t ) );
-        spi_transaction.length    = length * 8; /* in bits */
-        spi_transaction.tx_buffer = data_out;
-        spi_transaction.rx_buffer = data_in;
-        spi_device_transmit( llcc68_context->spi_handle, &spi_transaction );
-    }
-
-    return true;
-}
-
-static uint8_t spi_transfer( const void* context, uint8_t address )
-{
-    uint8_t data_in;
-    uint8_t data_out = address;
-    spi_rw_byte( context, &data_in, &data_out, 1 );
-    return data_in;
-}
-
 /* --- EOF ------------------------------------------------------------------ */
@@ -47,6 +47,7 @@
 
 #include "lr11xx_hal.h"
 #include "radio_context.h"
+#include "radio_spi.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -56,6 +57,8 @@
 #define WAIT_US( us ) esp_rom_delay_us( us )
 #define WAIT_MS( ms ) esp_rom_delay_us( ms * 1000 )
 
+#define LR11XX_OPCODE( cmd, len ) ( ( ( len ) >= 2 ) ? ( uint16_t ) ( ( ( cmd )[0] << 8 ) | ( cmd )[1] ) : 0 )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -81,11 +84,6 @@
  */
 void lr11xx_hal_wait_on_busy( const void* context );
 
-/**
- * @brief SPI tranfer
- */
-static uint8_t spi_transfer( const void* context, uint8_t address );
-
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -121,85 +119,59 @@ lr11xx_hal_status_t lr11xx_hal_write( const void* context, const uint8_t* comman
 
 {
     const radio_context_t* lr11xx_context = ( const radio_context_t* ) context;
-    int                    i;
+    int64_t                start_us;
+    bool                   ret;
 
     lr11xx_hal_wait_on_busy( context );
 
-    gpio_set_level( lr11xx_context->spi_nss, 0 );
-
-    /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
-    /* Write data */
-    for( i = 0; i < data_length; i++ )
-    {
-        spi_transfer( context, data[i] );
-    }
+    /* Write command and data in a single transaction */
+    start_us = radio_spi_stats_start( );
+    ret      = radio_spi_transfer( lr11xx_context, command, command_length, data, NULL, data_length );
+    radio_spi_stats_add( LR11XX_OPCODE( command, command_length ), command_length + data_length, start_us );
 
-    gpio_set_level( lr11xx_context->spi_nss, 1 );
-
-    return LR11XX_HAL_STATUS_OK;
+    return ( ret == true ) ? LR11XX_HAL_STATUS_OK : LR11XX_HAL_STATUS_ERROR;
 }
 
 lr11xx_hal_status_t lr11xx_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
                                      uint8_t* data, const uint16_t data_length )
 {
     const radio_context_t* lr11xx_context = ( const radio_context_t* ) context;
-    int                    i;
+    const uint8_t          dummy          = 0x00;
+    int64_t                start_us;
+    bool                   ret;
 
     lr11xx_hal_wait_on_busy( context );
 
-    gpio_set_level( lr11xx_context->spi_nss, 0 );
-
     /* Write command */
-    for( i = 0; i < command_length; i++ )
-    {
-        spi_transfer( context, command[i] );
-    }
+    start_us = radio_spi_stats_start( );
+    ret      = radio_spi_transfer( lr11xx_context, command, command_length, NULL, NULL, 0 );
 
-    gpio_set_level( lr11xx_context->spi_nss, 1 );
-
-    /* Read data */
-    if( data_length > 0 )
+    /* Read data: the LR11xx needs a second transaction, starting with a dummy byte */
+    if( ( ret == true ) && ( data_length > 0 ) )
     {
         lr11xx_hal_wait_on_busy( context );
 
-        gpio_set_level( lr11xx_context->spi_nss, 0 );
-
-        /* dummy read */
-        spi_transfer( context, 0x00 );
-
-        for( i = 0; i < data_length; i++ )
-        {
-            data[i] = spi_transfer( context, 0x00 );
-        }
-
-        gpio_set_level( lr11xx_context->spi_nss, 1 );
+        ret = radio_spi_transfer( lr11xx_context, &dummy, 1, NULL, data, data_length );
     }
+    radio_spi_stats_add( LR11XX_OPCODE( command, command_length ), command_length + 1 + data_length, start_us );
 
-    return LR11XX_HAL_STATUS_OK;
+    return ( ret == true ) ? LR11XX_HAL_STATUS_OK : LR11XX_HAL_STATUS_ERROR;
 }
 
 lr11xx_hal_status_t lr11xx_hal_direct_read( const void* context, uint8_t* data, const uint16_t data_length )
 {
     const radio_context_t* lr11xx_context = ( const radio_context_t* ) context;
-    int                    i;
+    int64_t                start_us;
+    bool                   ret;
 
     lr11xx_hal_wait_on_busy( context );
 
-    gpio_set_level( lr11xx_context->spi_nss, 0 );
-
-    /* Read data */
-    for( i = 0; i < data_length; i++ )
-    {
-        data[i] = spi_transfer( context, 0x00 );
-    }
+    /* Read data in a single transaction, accounted as opcode 0x0000 */
+    start_us = radio_spi_stats_start( );
+    ret      = radio_spi_transfer( lr11xx_context, NULL, 0, NULL, data, data_length );
+    radio_spi_stats_add( 0x0000, data_length, start_us );
 
-    gpio_set_level( lr11xx_context->spi_nss, 1 );
-
-    return LR11XX_HAL_STATUS_OK;
+    return ( ret == true ) ? LR11XX_HAL_STATUS_OK : LR11XX_HAL_STATUS_ERROR;
 }
 
 /*
@@ -218,29 +190,4 @@ void lr11xx_hal_wait_on_busy( const void* context )
     } while( gpio_state == 1 );
 }
 
-bool spi_rw_byte( const void* context, uint8_t* data_in, uint8_t* data_out, size_t length )
-{
-    const radio_context_t*   lr11xx_context = ( const radio_context_t* ) context;
-    static spi_transaction_t spi_transaction;
-
-    if( length > 0 )
-    {
-        memset( &spi_transaction, 0, sizeof( spi_transaction_t ) );
-        spi_transaction.length    = length * 8; /* in bits */
-        spi_transaction.tx_buffer = data_out;
-        spi_transaction.rx_buffer = data_in;
-        spi_device_transmit( lr11xx_context->spi_handle, &spi_transaction );
-    }
-
-    return true;
-}
-
-static uint8_t spi_transfer( const void* context, uint8_t address )
-{
-    uint8_t data_in;
-    uint8_t data_out = address;
-    spi_rw_byte( context, &data_in, &data_out, 1 );
-    return data_in;
-}
-
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,246 @@
+/**
+ * @file      radio_spi.c
+ *
+ * @brief     SPI transport shared by the SX126x, LLCC68 and LR11xx radio HALs
+ *
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2022. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "radio_spi.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS ----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+static const char* TAG_SPI = "RADIO_SPI";
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+/* DMA-capable buffers holding a complete transaction (command + data) */
+static DMA_ATTR uint8_t spi_tx_buffer[RADIO_SPI_BUFFER_SIZE];
+static DMA_ATTR uint8_t spi_rx_buffer[RADIO_SPI_BUFFER_SIZE];
+
+static spi_transaction_t spi_transaction;
+
+/* Serializes the users of the buffers and transaction above: the HAL callers, under the HAL access control, and the TX
+ * task starting a scheduled TX */
+static SemaphoreHandle_t spi_mutex = NULL;
+
+static radio_spi_cmd_stats_t spi_stats[RADIO_SPI_STATS_CMD_NB];
+static int                   spi_stats_nb   = 0;
+static portMUX_TYPE          spi_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool radio_spi_init( void )
+{
+    if( spi_mutex == NULL )
+    {
+        spi_mutex = xSemaphoreCreateMutex( );
+    }
+
+    return ( spi_mutex != NULL );
+}
+
+bool radio_spi_transfer( const radio_context_t* context, const uint8_t* command, uint16_t command_length,
+                         const uint8_t* data_out, uint8_t* data_in, uint16_t data_length )
+{
+    size_t    length = command_length + data_length;
+    esp_err_t err;
+
+    if( length == 0 )
+    {
+        return true;
+    }
+
+    if( length > RADIO_SPI_BUFFER_SIZE )
+    {
+        ESP_LOGE( TAG_SPI, "ERROR: transaction too long (%u bytes)", ( unsigned int ) length );
+        return false;
+    }
+
+    xSemaphoreTake( spi_mutex, portMAX_DELAY );
+
+    /* Build the whole transaction in the DMA buffer */
+    if( command_length > 0 )
+    {
+        memcpy( spi_tx_buffer, command, command_length );
+    }
+    if( data_out != NULL )
+    {
+        memcpy( spi_tx_buffer + command_length, data_out, data_length );
+    }
+    else
+    {
+        memset( spi_tx_buffer + command_length, 0x00, data_length );
+    }
+
+    memset( &spi_transaction, 0, sizeof( spi_transaction_t ) );
+    spi_transaction.length    = length * 8; /* in bits */
+    spi_transaction.tx_buffer = spi_tx_buffer;
+    spi_transaction.rx_buffer = ( data_in != NULL ) ? spi_rx_buffer : NULL;
+
+    gpio_set_level( context->spi_nss, 0 );
+    if( length <= RADIO_SPI_POLLING_MAX_SIZE )
+    {
+        /* Short commands: busy-wait on the transaction, no interrupt/context switch overhead */
+        err = spi_device_polling_transmit( context->spi_handle, &spi_transaction );
+    }
+    else
+    {
+        /* Long payloads: let the DMA do the job while the calling task is blocked */
+        err = spi_device_transmit( context->spi_handle, &spi_transaction );
+    }
+    gpio_set_level( context->spi_nss, 1 );
+
+    if( ( err == ESP_OK ) && ( data_in != NULL ) )
+    {
+        memcpy( data_in, spi_rx_buffer + command_length, data_length );
+    }
+
+    xSemaphoreGive( spi_mutex );
+
+    if( err != ESP_OK )
+    {
+        ESP_LOGE( TAG_SPI, "ERROR: SPI transaction failed with %d", err );
+        return false;
+    }
+
+    return true;
+}
+
+int64_t radio_spi_stats_start( void )
+{
+    return esp_timer_get_time( );
+}
+
+void radio_spi_stats_add( uint16_t opcode, uint32_t nb_bytes, int64_t start_us )
+{
+    uint32_t duration_us = ( uint32_t ) ( esp_timer_get_time( ) - start_us );
+    int      i;
+
+    portENTER_CRITICAL( &spi_stats_lock );
+    for( i = 0; i < spi_stats_nb; i++ )
+    {
+        if( spi_stats[i].opcode == opcode )
+        {
+            break;
+        }
+    }
+    if( i == spi_stats_nb )
+    {
+        if( spi_stats_nb == RADIO_SPI_STATS_CMD_NB )
+        {
+            /* table full, command not accounted */
+            portEXIT_CRITICAL( &spi_stats_lock );
+            return;
+        }
+        memset( &spi_stats[i], 0, sizeof( radio_spi_cmd_stats_t ) );
+        spi_stats[i].opcode = opcode;
+        spi_stats_nb += 1;
+    }
+    spi_stats[i].nb_calls += 1;
+    spi_stats[i].nb_bytes += nb_bytes;
+    spi_stats[i].total_us += duration_us;
+    if( duration_us > spi_stats[i].max_us )
+    {
+        spi_stats[i].max_us = duration_us;
+    }
+    portEXIT_CRITICAL( &spi_stats_lock );
+}
+
+int radio_spi_stats_get( radio_spi_cmd_stats_t* stats, int max_nb )
+{
+    int nb;
+
+    if( stats == NULL )
+    {
+        return 0;
+    }
+
+    portENTER_CRITICAL( &spi_stats_lock );
+    nb = ( spi_stats_nb < max_nb ) ? spi_stats_nb : max_nb;
+    memcpy( stats, spi_stats, nb * sizeof( radio_spi_cmd_stats_t ) );
+    portEXIT_CRITICAL( &spi_stats_lock );
+
+    return nb;
+}
+
+void radio_spi_stats_reset( void )
+{
+    portENTER_CRITICAL( &spi_stats_lock );
+    spi_stats_nb = 0;
+    portEXIT_CRITICAL( &spi_stats_lock );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/* --- EOF ------------------------------------------------------------------ */
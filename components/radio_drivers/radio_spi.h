@@ -0,0 +1,167 @@
+/**
+ * @file      radio_spi.h
+ *
+ * @brief     SPI transport shared by the SX126x, LLCC68 and LR11xx radio HALs
+ *
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2022. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RADIO_SPI_H
+#define RADIO_SPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "radio_context.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * @brief Maximum number of bytes (command + data) that can be exchanged in a single transaction
+ */
+#define RADIO_SPI_BUFFER_SIZE 512
+
+/*!
+ * @brief Transactions up to this size are sent in polling mode, bigger ones are queued to the DMA
+ */
+#define RADIO_SPI_POLLING_MAX_SIZE 32
+
+/*!
+ * @brief Maximum number of different commands for which timing statistics are collected
+ */
+#define RADIO_SPI_STATS_CMD_NB 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * @brief Timing statistics of a radio command
+ */
+typedef struct
+{
+    uint16_t opcode;    //!< Command opcode (1 byte for SX126x/LLCC68, 2 bytes for LR11xx)
+    uint32_t nb_calls;  //!< Number of times the command has been issued
+    uint32_t nb_bytes;  //!< Total number of bytes exchanged on the bus (command + data)
+    uint32_t total_us;  //!< Cumulated transaction duration, in microseconds
+    uint32_t max_us;    //!< Longest transaction duration, in microseconds
+} radio_spi_cmd_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Create the lock of the SPI transport, to be called before the first transaction
+ *
+ * @returns true if the lock is created, false otherwise
+ */
+bool radio_spi_init( void );
+
+/**
+ * @brief Exchange a command and its data with the radio in a single SPI transaction
+ *
+ * NSS is driven low for the whole transaction. The bytes clocked in while the command is sent are discarded.
+ * The radio BUSY line is not checked, this is the responsibility of the caller.
+ *
+ * The transactions share a single DMA buffer, they are serialized by a mutex so that the function can be called from
+ * several tasks. The mutex only covers one transaction: a radio command made of several transactions (BUSY wait,
+ * command, read) must still be issued by a single task at a time. The HAL guarantees it with its access control,
+ * except for the SetTx command of a scheduled TX issued by the HAL TX task, which is the only radio access while a TX
+ * is scheduled.
+ *
+ * @param [in]  context        Radio context
+ * @param [in]  command        Command buffer (can be NULL if command_length is 0)
+ * @param [in]  command_length Number of command bytes
+ * @param [in]  data_out       Data to be written after the command (NULL to send zeros)
+ * @param [out] data_in        Buffer receiving the bytes clocked in after the command (NULL to discard)
+ * @param [in]  data_length    Number of data bytes
+ *
+ * @returns true if the transaction succeeded, false otherwise
+ */
+bool radio_spi_transfer( const radio_context_t* context, const uint8_t* command, uint16_t command_length,
+                         const uint8_t* data_out, uint8_t* data_in, uint16_t data_length );
+
+/**
+ * @brief Get the current time to be given to radio_spi_stats_add() once the command is complete
+ *
+ * @returns Current time, in microseconds
+ */
+int64_t radio_spi_stats_start( void );
+
+/**
+ * @brief Account a completed command in the timing statistics
+ *
+ * @param [in] opcode   Command opcode
+ * @param [in] nb_bytes Number of bytes exchanged on the bus for this command
+ * @param [in] start_us Time returned by radio_spi_stats_start() before the command was issued
+ */
+void radio_spi_stats_add( uint16_t opcode, uint32_t nb_bytes, int64_t start_us );
+
+/**
+ * @brief Get a copy of the timing statistics collected so far
+ *
+ * @param [out] stats  Array receiving the statistics, one entry per command
+ * @param [in]  max_nb Size of the stats array
+ *
+ * @returns Number of entries copied in the stats array
+ */
+int radio_spi_stats_get( radio_spi_cmd_stats_t* stats, int max_nb );
+
+/**
+ * @brief Reset the timing statistics
+ */
+void radio_spi_stats_reset( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RADIO_SPI_H
+
+/* --- EOF ------------------------------------------------------------------ */
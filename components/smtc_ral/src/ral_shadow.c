@@ -0,0 +1,333 @@
+/**
+ * @file      ral_shadow.c
+ *
+ * @brief     Radio abstraction layer shadow cache implementation
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "ral_shadow.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/**
+ * @brief Last configuration written to the radio, an entry is only relevant if its bit is set in valid
+ */
+typedef struct ral_shadow_state_s
+{
+    uint32_t              valid;  //!< Bitmask of the ral_shadow_cmd_t entries holding the radio configuration
+    ral_pkt_type_t        pkt_type;
+    uint32_t              rf_freq_in_hz;
+    int8_t                tx_cfg_pwr_in_dbm;
+    uint32_t              tx_cfg_freq_in_hz;
+    ral_lora_mod_params_t lora_mod_params;
+    ral_lora_pkt_params_t lora_pkt_params;
+    uint16_t              lora_symb_nb_timeout;
+    uint8_t               lora_sync_word;
+    ral_irq_t             dio_irq;
+} ral_shadow_state_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static ral_drv_t              shadow_drv;  // driver functions of the radio the cache is attached to
+static ral_shadow_state_t     shadow_state;
+static ral_shadow_cmd_stats_t shadow_stats[RAL_SHADOW_CMD_NB];
+
+static const char* shadow_cmd_names[RAL_SHADOW_CMD_NB] = {
+    "pkt_type",        "rf_freq",  "tx_cfg", "lora_mod_params", "lora_pkt_params", "lora_symb_nb_timeout",
+    "lora_sync_word", "dio_irq_params",
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief Account for a configuration command, and tell if it has to be issued
+ *
+ * @param [in] cmd Command
+ * @param [in] same_value True if the cached value is the one requested
+ *
+ * @returns True if the command has to be forwarded to the driver
+ */
+static bool ral_shadow_check( ral_shadow_cmd_t cmd, bool same_value );
+
+/**
+ * @brief Update the cache after a configuration command has been forwarded to the driver
+ *
+ * @param [in] cmd Command
+ * @param [in] status Status returned by the driver, the entry is invalidated if not RAL_STATUS_OK
+ *
+ * @returns status
+ */
+static ral_status_t ral_shadow_update( ral_shadow_cmd_t cmd, ral_status_t status );
+
+static ral_status_t ral_shadow_reset( const void* context );
+static ral_status_t ral_shadow_init( const void* context );
+static ral_status_t ral_shadow_wakeup( const void* context );
+static ral_status_t ral_shadow_set_sleep( const void* context, const bool retain_config );
+static ral_status_t ral_shadow_set_pkt_type( const void* context, const ral_pkt_type_t pkt_type );
+static ral_status_t ral_shadow_set_rf_freq( const void* context, const uint32_t freq_in_hz );
+static ral_status_t ral_shadow_set_tx_cfg( const void* context, const int8_t output_pwr_in_dbm,
+                                           const uint32_t rf_freq_in_hz );
+static ral_status_t ral_shadow_set_lora_mod_params( const void* context, const ral_lora_mod_params_t* params );
+static ral_status_t ral_shadow_set_lora_pkt_params( const void* context, const ral_lora_pkt_params_t* params );
+static ral_status_t ral_shadow_set_lora_symb_nb_timeout( const void* context, const uint16_t nb_of_symbs );
+static ral_status_t ral_shadow_set_lora_sync_word( const void* context, const uint8_t sync_word );
+static ral_status_t ral_shadow_set_dio_irq_params( const void* context, const ral_irq_t irq );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void ral_shadow_attach( ral_t* radio )
+{
+    shadow_drv = radio->driver;
+    ral_shadow_invalidate( );
+    memset( shadow_stats, 0, sizeof( shadow_stats ) );
+
+    radio->driver.reset                    = ral_shadow_reset;
+    radio->driver.init                     = ral_shadow_init;
+    radio->driver.wakeup                   = ral_shadow_wakeup;
+    radio->driver.set_sleep                = ral_shadow_set_sleep;
+    radio->driver.set_pkt_type             = ral_shadow_set_pkt_type;
+    radio->driver.set_rf_freq              = ral_shadow_set_rf_freq;
+    radio->driver.set_tx_cfg               = ral_shadow_set_tx_cfg;
+    radio->driver.set_lora_mod_params      = ral_shadow_set_lora_mod_params;
+    radio->driver.set_lora_pkt_params      = ral_shadow_set_lora_pkt_params;
+    radio->driver.set_lora_symb_nb_timeout = ral_shadow_set_lora_symb_nb_timeout;
+    radio->driver.set_lora_sync_word       = ral_shadow_set_lora_sync_word;
+    radio->driver.set_dio_irq_params       = ral_shadow_set_dio_irq_params;
+}
+
+void ral_shadow_invalidate( void )
+{
+    shadow_state.valid = 0;
+}
+
+void ral_shadow_get_stats( ral_shadow_cmd_stats_t* stats )
+{
+    memcpy( stats, shadow_stats, sizeof( shadow_stats ) );
+}
+
+const char* ral_shadow_cmd_name( ral_shadow_cmd_t cmd )
+{
+    return ( cmd < RAL_SHADOW_CMD_NB ) ? shadow_cmd_names[cmd] : "unknown";
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool ral_shadow_check( ral_shadow_cmd_t cmd, bool same_value )
+{
+    if( ( ( shadow_state.valid & ( 1u << cmd ) ) != 0 ) && ( same_value == true ) )
+    {
+        shadow_stats[cmd].elided += 1;
+        return false;
+    }
+
+    shadow_stats[cmd].issued += 1;
+    return true;
+}
+
+static ral_status_t ral_shadow_update( ral_shadow_cmd_t cmd, ral_status_t status )
+{
+    if( status == RAL_STATUS_OK )
+    {
+        shadow_state.valid |= ( 1u << cmd );
+    }
+    else
+    {
+        shadow_state.valid &= ~( 1u << cmd );
+    }
+
+    return status;
+}
+
+static ral_status_t ral_shadow_reset( const void* context )
+{
+    ral_shadow_invalidate( );
+    return shadow_drv.reset( context );
+}
+
+static ral_status_t ral_shadow_init( const void* context )
+{
+    ral_shadow_invalidate( );
+    return shadow_drv.init( context );
+}
+
+static ral_status_t ral_shadow_wakeup( const void* context )
+{
+    ral_shadow_invalidate( );
+    return shadow_drv.wakeup( context );
+}
+
+static ral_status_t ral_shadow_set_sleep( const void* context, const bool retain_config )
+{
+    ral_shadow_invalidate( );
+    return shadow_drv.set_sleep( context, retain_config );
+}
+
+static ral_status_t ral_shadow_set_pkt_type( const void* context, const ral_pkt_type_t pkt_type )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_PKT_TYPE, shadow_state.pkt_type == pkt_type ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    // The modulation and packet parameters depend on the packet type
+    ral_shadow_invalidate( );
+    shadow_state.pkt_type = pkt_type;
+    return ral_shadow_update( RAL_SHADOW_CMD_PKT_TYPE, shadow_drv.set_pkt_type( context, pkt_type ) );
+}
+
+static ral_status_t ral_shadow_set_rf_freq( const void* context, const uint32_t freq_in_hz )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_RF_FREQ, shadow_state.rf_freq_in_hz == freq_in_hz ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.rf_freq_in_hz = freq_in_hz;
+    return ral_shadow_update( RAL_SHADOW_CMD_RF_FREQ, shadow_drv.set_rf_freq( context, freq_in_hz ) );
+}
+
+static ral_status_t ral_shadow_set_tx_cfg( const void* context, const int8_t output_pwr_in_dbm,
+                                           const uint32_t rf_freq_in_hz )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_TX_CFG, ( shadow_state.tx_cfg_pwr_in_dbm == output_pwr_in_dbm ) &&
+                                                     ( shadow_state.tx_cfg_freq_in_hz == rf_freq_in_hz ) ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.tx_cfg_pwr_in_dbm = output_pwr_in_dbm;
+    shadow_state.tx_cfg_freq_in_hz = rf_freq_in_hz;
+    return ral_shadow_update( RAL_SHADOW_CMD_TX_CFG,
+                              shadow_drv.set_tx_cfg( context, output_pwr_in_dbm, rf_freq_in_hz ) );
+}
+
+static ral_status_t ral_shadow_set_lora_mod_params( const void* context, const ral_lora_mod_params_t* params )
+{
+    const ral_lora_mod_params_t* cached = &shadow_state.lora_mod_params;
+
+    if( ral_shadow_check( RAL_SHADOW_CMD_LORA_MOD_PARAMS, ( cached->sf == params->sf ) &&
+                                                              ( cached->bw == params->bw ) &&
+                                                              ( cached->cr == params->cr ) &&
+                                                              ( cached->ldro == params->ldro ) ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.lora_mod_params = *params;
+    return ral_shadow_update( RAL_SHADOW_CMD_LORA_MOD_PARAMS, shadow_drv.set_lora_mod_params( context, params ) );
+}
+
+static ral_status_t ral_shadow_set_lora_pkt_params( const void* context, const ral_lora_pkt_params_t* params )
+{
+    const ral_lora_pkt_params_t* cached = &shadow_state.lora_pkt_params;
+
+    if( ral_shadow_check( RAL_SHADOW_CMD_LORA_PKT_PARAMS,
+                          ( cached->preamble_len_in_symb == params->preamble_len_in_symb ) &&
+                              ( cached->header_type == params->header_type ) &&
+                              ( cached->pld_len_in_bytes == params->pld_len_in_bytes ) &&
+                              ( cached->crc_is_on == params->crc_is_on ) &&
+                              ( cached->invert_iq_is_on == params->invert_iq_is_on ) ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.lora_pkt_params = *params;
+    return ral_shadow_update( RAL_SHADOW_CMD_LORA_PKT_PARAMS, shadow_drv.set_lora_pkt_params( context, params ) );
+}
+
+static ral_status_t ral_shadow_set_lora_symb_nb_timeout( const void* context, const uint16_t nb_of_symbs )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_LORA_SYMB_NB_TIMEOUT, shadow_state.lora_symb_nb_timeout == nb_of_symbs ) ==
+        false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.lora_symb_nb_timeout = nb_of_symbs;
+    return ral_shadow_update( RAL_SHADOW_CMD_LORA_SYMB_NB_TIMEOUT,
+                              shadow_drv.set_lora_symb_nb_timeout( context, nb_of_symbs ) );
+}
+
+static ral_status_t ral_shadow_set_lora_sync_word( const void* context, const uint8_t sync_word )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_LORA_SYNC_WORD, shadow_state.lora_sync_word == sync_word ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.lora_sync_word = sync_word;
+    return ral_shadow_update( RAL_SHADOW_CMD_LORA_SYNC_WORD, shadow_drv.set_lora_sync_word( context, sync_word ) );
+}
+
+static ral_status_t ral_shadow_set_dio_irq_params( const void* context, const ral_irq_t irq )
+{
+    if( ral_shadow_check( RAL_SHADOW_CMD_DIO_IRQ_PARAMS, shadow_state.dio_irq == irq ) == false )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    shadow_state.dio_irq = irq;
+    return ral_shadow_update( RAL_SHADOW_CMD_DIO_IRQ_PARAMS, shadow_drv.set_dio_irq_params( context, irq ) );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,134 @@
+/**
+ * @file      ral_shadow.h
+ *
+ * @brief     Radio abstraction layer shadow cache, skipping the configuration commands that would not change anything
+ *
+ * The Clear BSD License
+ * Copyright Semtech Corporation 2024. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the disclaimer
+ * below) provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE GRANTED BY
+ * THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ * CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ * NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RAL_SHADOW_H
+#define RAL_SHADOW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ral.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/**
+ * @brief Configuration commands tracked by the shadow cache
+ */
+typedef enum ral_shadow_cmd_e
+{
+    RAL_SHADOW_CMD_PKT_TYPE,
+    RAL_SHADOW_CMD_RF_FREQ,
+    RAL_SHADOW_CMD_TX_CFG,
+    RAL_SHADOW_CMD_LORA_MOD_PARAMS,
+    RAL_SHADOW_CMD_LORA_PKT_PARAMS,
+    RAL_SHADOW_CMD_LORA_SYMB_NB_TIMEOUT,
+    RAL_SHADOW_CMD_LORA_SYNC_WORD,
+    RAL_SHADOW_CMD_DIO_IRQ_PARAMS,
+    RAL_SHADOW_CMD_NB
+} ral_shadow_cmd_t;
+
+/**
+ * @brief Counters of a configuration command tracked by the shadow cache
+ */
+typedef struct ral_shadow_cmd_stats_s
+{
+    uint32_t issued;  //!< Number of calls forwarded to the radio driver
+    uint32_t elided;  //!< Number of calls skipped as the radio already had the requested configuration
+} ral_shadow_cmd_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/**
+ * @brief Insert the shadow cache between a radio abstraction layer and its driver
+ *
+ * @remark The shadow cache is a single instance: it can only be attached to one radio. The configuration commands
+ * tracked are then skipped when they would write the value already set. The cache is invalidated by ral_reset,
+ * ral_init, ral_wakeup and ral_set_sleep, and by ral_set_pkt_type when the packet type actually changes.
+ *
+ * @param [in,out] radio Pointer to radio data structure, its driver functions are replaced
+ */
+void ral_shadow_attach( ral_t* radio );
+
+/**
+ * @brief Forget the configuration cached, the next configuration commands will all be issued
+ */
+void ral_shadow_invalidate( void );
+
+/**
+ * @brief Get the counters of the configuration commands tracked since the shadow cache has been attached
+ *
+ * @param [out] stats Array of RAL_SHADOW_CMD_NB counters, indexed by ral_shadow_cmd_t
+ */
+void ral_shadow_get_stats( ral_shadow_cmd_stats_t* stats );
+
+/**
+ * @brief Get the name of a configuration command tracked by the shadow cache
+ *
+ * @param [in] cmd Command
+ *
+ * @returns Constant string
+ */
+const char* ral_shadow_cmd_name( ral_shadow_cmd_t cmd );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RAL_SHADOW_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -29,10 +29,16 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* Size of the following string must be < CFG_NVS_KEY_STR_MAX_SIZE */
 #define CFG_NVS_KEY_LNS_ADDRESS "lns_addr"
 #define CFG_NVS_KEY_LNS_PORT "lns_port"
+#define CFG_NVS_KEY_LNS_FALLBACKS "lns_fallbacks"
+#define CFG_NVS_KEY_LNS_FANOUT "lns_fanout"
 #define CFG_NVS_KEY_CHAN_FREQ "chan_freq"
 #define CFG_NVS_KEY_CHAN_DR "chan_dr"
 #define CFG_NVS_KEY_CHAN_BW "chan_bw"
 #define CFG_NVS_KEY_SNTP_ADDRESS "sntp_addr"
+#define CFG_NVS_KEY_PUSH_MAX_PKT "push_max_pkt"
+#define CFG_NVS_KEY_PUSH_MAX_BYTES "push_max_bytes"
+#define CFG_NVS_KEY_PUSH_HOLD_US "push_hold_us"
+#define CFG_NVS_KEY_UPLINK_FILTER "uplink_filter"
 
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC TYPES --------------------------------------------------------- */
@@ -0,0 +1,193 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub per-device uplink statistics, indexed by DevAddr
+
+    The devices are stored in a fixed size open addressing hash table with linear probing, twice as large as the
+    number of devices tracked. Entries are removed with backward shift deletion, so no tombstone is needed.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <pthread.h>
+
+#include <esp_timer.h>
+
+#include "dev_stats.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define DEV_STATS_HOME( devaddr ) ( ( uint32_t ) ( ( devaddr ) * 2654435761U ) % DEV_STATS_NB_SLOTS ) /* Knuth hash */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEV_STATS_NB_SLOTS ( 2 * DEV_STATS_CAPACITY ) /* hash table size, keeps the load factor under 0.5 */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static pthread_mutex_t          mx_dev_stats = PTHREAD_MUTEX_INITIALIZER; /* control access to the table */
+static struct dev_stats_entry_s dev_stats_slots[DEV_STATS_NB_SLOTS];
+static int                      dev_stats_nb_dev = 0; /* number of devices tracked */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void dev_stats_remove( uint32_t slot );
+
+static uint32_t dev_stats_find_lru( void );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void dev_stats_remove( uint32_t slot )
+{
+    uint32_t hole = slot;
+    uint32_t i    = slot;
+    uint32_t home;
+
+    /* move back the following entries of the cluster which are not at their home slot or after */
+    while( true )
+    {
+        i = ( i + 1 ) % DEV_STATS_NB_SLOTS;
+        if( dev_stats_slots[i].nb_pkt == 0 )
+        {
+            break;
+        }
+        home = DEV_STATS_HOME( dev_stats_slots[i].devaddr );
+        if( ( ( i > hole ) && ( ( home <= hole ) || ( home > i ) ) ) ||
+            ( ( i < hole ) && ( home <= hole ) && ( home > i ) ) )
+        {
+            dev_stats_slots[hole] = dev_stats_slots[i];
+            hole                  = i;
+        }
+    }
+
+    dev_stats_slots[hole].nb_pkt = 0;
+    dev_stats_nb_dev -= 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t dev_stats_find_lru( void )
+{
+    uint32_t i;
+    uint32_t lru         = 0;
+    uint64_t lru_seen_us = UINT64_MAX;
+
+    /* only called when the table is full, the scan is bounded by the table size */
+    for( i = 0; i < DEV_STATS_NB_SLOTS; i++ )
+    {
+        if( ( dev_stats_slots[i].nb_pkt != 0 ) && ( dev_stats_slots[i].last_seen_us < lru_seen_us ) )
+        {
+            lru         = i;
+            lru_seen_us = dev_stats_slots[i].last_seen_us;
+        }
+    }
+
+    return lru;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void dev_stats_update( uint32_t devaddr, uint16_t fcnt, int16_t rssi, int16_t snr )
+{
+    struct dev_stats_entry_s* e;
+    uint32_t                  i;
+    uint16_t                  fcnt_diff;
+    uint64_t                  now_us = ( uint64_t ) esp_timer_get_time( );
+
+    pthread_mutex_lock( &mx_dev_stats );
+
+    /* look for the device, up to the end of its cluster */
+    i = DEV_STATS_HOME( devaddr );
+    while( ( dev_stats_slots[i].nb_pkt != 0 ) && ( dev_stats_slots[i].devaddr != devaddr ) )
+    {
+        i = ( i + 1 ) % DEV_STATS_NB_SLOTS;
+    }
+    e = &dev_stats_slots[i];
+
+    if( e->nb_pkt == 0 )
+    {
+        /* new device, make room for it if needed. The removal may shift the cluster, so probe again */
+        if( dev_stats_nb_dev >= DEV_STATS_CAPACITY )
+        {
+            dev_stats_remove( dev_stats_find_lru( ) );
+            i = DEV_STATS_HOME( devaddr );
+            while( dev_stats_slots[i].nb_pkt != 0 )
+            {
+                i = ( i + 1 ) % DEV_STATS_NB_SLOTS;
+            }
+            e = &dev_stats_slots[i];
+        }
+        dev_stats_nb_dev += 1;
+
+        e->devaddr  = devaddr;
+        e->nb_pkt   = 0;
+        e->nb_lost  = 0;
+        e->rssi_sum = 0;
+        e->snr_sum  = 0;
+        e->rssi_min = rssi;
+        e->rssi_max = rssi;
+        e->snr_min  = snr;
+        e->snr_max  = snr;
+    }
+    else
+    {
+        /* count the frames missing since the previous one, the FCnt rolls over on 16 bits */
+        fcnt_diff = fcnt - e->last_fcnt;
+        if( ( fcnt_diff > 1 ) && ( fcnt_diff < 0x8000 ) )
+        {
+            e->nb_lost += fcnt_diff - 1;
+        }
+
+        e->rssi_min = ( rssi < e->rssi_min ) ? rssi : e->rssi_min;
+        e->rssi_max = ( rssi > e->rssi_max ) ? rssi : e->rssi_max;
+        e->snr_min  = ( snr < e->snr_min ) ? snr : e->snr_min;
+        e->snr_max  = ( snr > e->snr_max ) ? snr : e->snr_max;
+    }
+
+    e->nb_pkt += 1;
+    e->rssi_sum += rssi;
+    e->snr_sum += snr;
+    e->last_fcnt    = fcnt;
+    e->last_seen_us = now_us;
+
+    pthread_mutex_unlock( &mx_dev_stats );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int dev_stats_get( struct dev_stats_entry_s* entries, int max_entries )
+{
+    uint32_t i;
+    int      nb_entries = 0;
+
+    pthread_mutex_lock( &mx_dev_stats );
+    for( i = 0; ( i < DEV_STATS_NB_SLOTS ) && ( nb_entries < max_entries ); i++ )
+    {
+        if( dev_stats_slots[i].nb_pkt != 0 )
+        {
+            entries[nb_entries++] = dev_stats_slots[i];
+        }
+    }
+    pthread_mutex_unlock( &mx_dev_stats );
+
+    return nb_entries;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
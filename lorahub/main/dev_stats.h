@@ -0,0 +1,71 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub per-device uplink statistics, indexed by DevAddr
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _DEV_STATS_H
+#define _DEV_STATS_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h> /* C99 types */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define DEV_STATS_CAPACITY CONFIG_DEV_STATS_CAPACITY /* Maximum number of devices tracked, least recent evicted */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct dev_stats_entry_s
+{
+    uint32_t devaddr;      /* DevAddr of the device */
+    uint32_t nb_pkt;       /* number of uplinks received, 0 for an empty entry */
+    uint32_t nb_lost;      /* number of uplinks missing from the FCnt sequence */
+    uint64_t last_seen_us; /* esp_timer time of the last uplink received */
+    int32_t  rssi_sum;     /* sum of the RSSI of the uplinks received, in dBm */
+    int32_t  snr_sum;      /* sum of the SNR of the uplinks received, in 0.25 dB */
+    int16_t  rssi_min;     /* minimum RSSI, in dBm */
+    int16_t  rssi_max;     /* maximum RSSI, in dBm */
+    int16_t  snr_min;      /* minimum SNR, in 0.25 dB */
+    int16_t  snr_max;      /* maximum SNR, in 0.25 dB */
+    uint16_t last_fcnt;    /* 16 LSBs of the FCnt of the last uplink received */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Account for an uplink received from a device
+@param devaddr DevAddr of the device
+@param fcnt 16 LSBs of the FCnt of the uplink
+@param rssi RSSI of the uplink, in dBm
+@param snr SNR of the uplink, in 0.25 dB
+
+If the device is not tracked yet and the table is full, the device with the oldest uplink is evicted. A FCnt going
+backward (device reset or rejoin) restarts the FCnt sequence, a repeated FCnt is not counted as a loss.
+*/
+void dev_stats_update( uint32_t devaddr, uint16_t fcnt, int16_t rssi, int16_t snr );
+
+/**
+@brief Get a copy of the statistics of the devices tracked
+@param entries pointer to an array to be filled with the tracked devices, in no particular order
+@param max_entries size of the array, DEV_STATS_CAPACITY to get all of them
+@return the number of entries copied
+*/
+int dev_stats_get( struct dev_stats_entry_s* entries, int max_entries );
+
+#endif  // _DEV_STATS_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -17,17 +17,26 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #include <stdint.h>  /* C99 types */
 #include <stdbool.h> /* bool type */
+#include <stdlib.h>  /* qsort */
 #include <string.h>
 
 #include <esp_log.h>
 
 #include <esp_http_server.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
 
 #include "http_server.h"
 #include "wifi.h"
 #include "parson.h"
 #include "config_nvs.h"
+#include "dev_stats.h"
+#include "uplink_filter.h"
+#include "lns_supervisor.h"
+#include "lns_fanout.h"
+#include "pkt_fwd.h"
+
+#include "lorahub_trace.h"
 
 #include "lorahub_aux.h"
 
@@ -104,10 +113,13 @@ const char html_header[] =
 #define CHAN_DR_STR_MAX_SIZE ( 4 )    /* [7..12] + \0 */
 #define CHAN_BW_STR_MAX_SIZE ( 4 )    /* [125,250,500] + \0 */
 #define SNTP_ADDRESS_STR_MAX_SIZE ( 64 )
-#define SUBMIT_VALUE_STR_MAX_SIZE ( 10 ) /* could be "configure" or "reboot" + \0 */
+#define PUSH_MAX_PKT_STR_MAX_SIZE ( 2 )   /* [1..8] + \0 */
+#define PUSH_MAX_BYTES_STR_MAX_SIZE ( 5 ) /* [540..4320] + \0 */
+#define PUSH_HOLD_US_STR_MAX_SIZE ( 8 )   /* [0..1000000] + \0 */
+#define SUBMIT_VALUE_STR_MAX_SIZE ( 10 )  /* could be "configure" or "reboot" + \0 */
 
 #define FORM_FIELD_NAME_STR_MAX_SIZE CFG_NVS_KEY_STR_MAX_SIZE
-#define FORM_FIELD_NB ( 7 ) /* Update this when adding new field returned by form */
+#define FORM_FIELD_NB ( 10 ) /* Update this when adding new field returned by form */
 /* Size of the following string must be < FORM_FIELD_REQ_STR_MAX_SIZE */
 #define FORM_FIELD_NAME_LNS_ADDRESS CFG_NVS_KEY_LNS_ADDRESS
 #define FORM_FIELD_NAME_LNS_PORT CFG_NVS_KEY_LNS_PORT
@@ -115,20 +127,28 @@ const char html_header[] =
 #define FORM_FIELD_NAME_CHAN_DR CFG_NVS_KEY_CHAN_DR
 #define FORM_FIELD_NAME_CHAN_BW CFG_NVS_KEY_CHAN_BW
 #define FORM_FIELD_NAME_SNTP_ADDRESS CFG_NVS_KEY_SNTP_ADDRESS
+#define FORM_FIELD_NAME_PUSH_MAX_PKT CFG_NVS_KEY_PUSH_MAX_PKT
+#define FORM_FIELD_NAME_PUSH_MAX_BYTES CFG_NVS_KEY_PUSH_MAX_BYTES
+#define FORM_FIELD_NAME_PUSH_HOLD_US CFG_NVS_KEY_PUSH_HOLD_US
+#define FORM_FIELD_NAME_UPLINK_FILTER CFG_NVS_KEY_UPLINK_FILTER /* API only */
+#define FORM_FIELD_NAME_LNS_FALLBACKS CFG_NVS_KEY_LNS_FALLBACKS /* API only */
+#define FORM_FIELD_NAME_LNS_FANOUT CFG_NVS_KEY_LNS_FANOUT       /* API only */
 #define FORM_FIELD_NAME_SUBMIT "submit"
 
 /* Maximum size of a configuration string resulting from the html web form */
 #define FORM_FULL_CONTENT_MAX_SIZE                                                                          \
     ( ( FORM_FIELD_NB * 2 ) + ( FORM_FIELD_NB * FORM_FIELD_NAME_STR_MAX_SIZE ) + LNS_ADDRESS_STR_MAX_SIZE + \
       LNS_PORT_STR_MAX_SIZE + CHAN_FREQ_STR_MAX_SIZE + CHAN_DR_STR_MAX_SIZE + CHAN_BW_STR_MAX_SIZE +        \
-      SNTP_ADDRESS_STR_MAX_SIZE +                                                                           \
+      SNTP_ADDRESS_STR_MAX_SIZE + PUSH_MAX_PKT_STR_MAX_SIZE + PUSH_MAX_BYTES_STR_MAX_SIZE +                 \
+      PUSH_HOLD_US_STR_MAX_SIZE +                                                                           \
       SUBMIT_VALUE_STR_MAX_SIZE ) /* sum of all fields max sizes + names + separators for each fields (=, &) */
 
 /* Maximum size of a configuration string resulting from an API call in JSON format */
-#define JSON_FULL_CONTENT_MAX_SIZE     \
-    ( FORM_FULL_CONTENT_MAX_SIZE + 2 + \
-      ( FORM_FIELD_NB *                \
-        4 ) ) /* when converting a web form string to a json string, need to add {} and "" for each key/values */
+#define JSON_FULL_CONTENT_MAX_SIZE                                                                                 \
+    ( FORM_FULL_CONTENT_MAX_SIZE + 2 + ( FORM_FIELD_NB * 4 ) + ( 3 * FORM_FIELD_NAME_STR_MAX_SIZE ) +              \
+      UPLINK_FILTER_STR_MAX_SIZE + LNS_FALLBACKS_STR_MAX_SIZE + LNS_FANOUT_STR_MAX_SIZE +                          \
+      18 ) /* when converting a web form string to a json string, need to add {} and "" for each key/values, plus \
+              the fields only available from the API */
 
 /* Radio type configured */
 #if defined( CONFIG_RADIO_TYPE_SX1261 )
@@ -157,16 +177,25 @@ typedef enum
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES ---------------------------------------------------- */
 
-static char     web_cfg_lns_address[LNS_ADDRESS_STR_MAX_SIZE]        = { 0 };
-static char     web_cfg_lns_port_str[LNS_PORT_STR_MAX_SIZE]          = { 0 };
-static char     web_cfg_chan_freq_mhz_str[CHAN_FREQ_STR_MAX_SIZE]    = { 0 };
-static char     web_cfg_chan_datarate_str[CHAN_DR_STR_MAX_SIZE]      = { 0 };
-static char     web_cfg_chan_bandwidth_khz_str[CHAN_BW_STR_MAX_SIZE] = { 0 };
-static uint16_t web_cfg_lns_port                                     = 0;
-static uint32_t web_cfg_chan_freq_hz                                 = 0;
-static uint32_t web_cfg_chan_datarate                                = 0;
-static uint16_t web_cfg_chan_bandwidth_khz                           = 0;
-static char     web_cfg_sntp_address[SNTP_ADDRESS_STR_MAX_SIZE]      = { 0 };
+static char     web_cfg_lns_address[LNS_ADDRESS_STR_MAX_SIZE]           = { 0 };
+static char     web_cfg_lns_port_str[LNS_PORT_STR_MAX_SIZE]             = { 0 };
+static char     web_cfg_chan_freq_mhz_str[CHAN_FREQ_STR_MAX_SIZE]       = { 0 };
+static char     web_cfg_chan_datarate_str[CHAN_DR_STR_MAX_SIZE]         = { 0 };
+static char     web_cfg_chan_bandwidth_khz_str[CHAN_BW_STR_MAX_SIZE]    = { 0 };
+static uint16_t web_cfg_lns_port                                        = 0;
+static uint32_t web_cfg_chan_freq_hz                                    = 0;
+static uint32_t web_cfg_chan_datarate                                   = 0;
+static uint16_t web_cfg_chan_bandwidth_khz                              = 0;
+static char     web_cfg_sntp_address[SNTP_ADDRESS_STR_MAX_SIZE]         = { 0 };
+static char     web_cfg_push_max_pkt_str[PUSH_MAX_PKT_STR_MAX_SIZE]     = { 0 };
+static char     web_cfg_push_max_bytes_str[PUSH_MAX_BYTES_STR_MAX_SIZE] = { 0 };
+static char     web_cfg_push_hold_us_str[PUSH_HOLD_US_STR_MAX_SIZE]     = { 0 };
+static uint8_t  web_cfg_push_max_pkt                                    = 0;
+static uint16_t web_cfg_push_max_bytes                                  = 0;
+static uint32_t web_cfg_push_hold_us                                    = 0;
+static char     web_cfg_uplink_filter[UPLINK_FILTER_STR_MAX_SIZE]       = { 0 };
+static char     web_cfg_lns_fallbacks[LNS_FALLBACKS_STR_MAX_SIZE]       = { 0 };
+static char     web_cfg_lns_fanout[LNS_FANOUT_STR_MAX_SIZE]             = { 0 };
 
 static uint8_t web_inf_mac_addr[6]      = { 0 };
 static char    web_inf_mac_addr_str[18] = "unknown";
@@ -174,6 +203,17 @@ static char    web_inf_mac_addr_str[18] = "unknown";
 static char post_content_form[FORM_FULL_CONTENT_MAX_SIZE] = { 0 };
 static char post_content_json[JSON_FULL_CONTENT_MAX_SIZE] = { 0 };
 
+static struct dev_stats_entry_s dev_stats_snapshot[DEV_STATS_CAPACITY]; /* too large for the server task stack */
+
+#if defined( CONFIG_LATENCY_TRACE )
+static struct lgw_trace_rec_s trace_snapshot[LGW_TRACE_CAPACITY]; /* too large for the server task stack */
+static int16_t                trace_next_rec[LGW_TRACE_CAPACITY]; /* next event of the same packet, -1 if none */
+static int16_t                trace_prev_rec[LGW_TRACE_CAPACITY]; /* previous event of the same packet, -1 if none */
+#endif
+
+static struct uplink_filter_rule_s web_cfg_uplink_filter_rules[UPLINK_FILTER_RULES_MAX]; /* only for validation */
+static struct lns_server_s         web_cfg_lns_servers[LNS_SERVERS_MAX];                 /* only for validation */
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
@@ -194,6 +234,15 @@ static esp_err_t get_config_from_nvs( void )
     snprintf( web_cfg_lns_address, sizeof web_cfg_lns_address, "%s", CONFIG_NETWORK_SERVER_ADDRESS );
     snprintf( web_cfg_lns_port_str, sizeof web_cfg_lns_port_str, "%" PRIu16, ( uint16_t ) CONFIG_NETWORK_SERVER_PORT );
     snprintf( web_cfg_sntp_address, sizeof web_cfg_sntp_address, "%s", CONFIG_SNTP_SERVER_ADDRESS );
+    web_cfg_push_max_pkt   = CONFIG_PUSH_DATA_MAX_PKT;
+    web_cfg_push_max_bytes = CONFIG_PUSH_DATA_MAX_BYTES;
+    web_cfg_push_hold_us   = CONFIG_PUSH_DATA_HOLD_US;
+    snprintf( web_cfg_push_max_pkt_str, sizeof web_cfg_push_max_pkt_str, "%" PRIu8, web_cfg_push_max_pkt );
+    snprintf( web_cfg_push_max_bytes_str, sizeof web_cfg_push_max_bytes_str, "%" PRIu16, web_cfg_push_max_bytes );
+    snprintf( web_cfg_push_hold_us_str, sizeof web_cfg_push_hold_us_str, "%" PRIu32, web_cfg_push_hold_us );
+    snprintf( web_cfg_uplink_filter, sizeof web_cfg_uplink_filter, "%s", CONFIG_UPLINK_FILTER );
+    snprintf( web_cfg_lns_fallbacks, sizeof web_cfg_lns_fallbacks, "%s", CONFIG_NETWORK_SERVER_FALLBACKS );
+    snprintf( web_cfg_lns_fanout, sizeof web_cfg_lns_fanout, "%s", CONFIG_NETWORK_SERVER_FANOUT );
 
     /* Get configuration from NVS */
     printf( "Opening Non-Volatile Storage (NVS) handle for reading... " );
@@ -274,6 +323,73 @@ static esp_err_t get_config_from_nvs( void )
         {
             ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_SNTP_ADDRESS, esp_err_to_name( err ) );
         }
+
+        err = nvs_get_u8( my_handle, CFG_NVS_KEY_PUSH_MAX_PKT, &web_cfg_push_max_pkt );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu8 "\n", CFG_NVS_KEY_PUSH_MAX_PKT, web_cfg_push_max_pkt );
+            snprintf( web_cfg_push_max_pkt_str, sizeof web_cfg_push_max_pkt_str, "%" PRIu8, web_cfg_push_max_pkt );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_MAX_PKT, esp_err_to_name( err ) );
+        }
+
+        err = nvs_get_u16( my_handle, CFG_NVS_KEY_PUSH_MAX_BYTES, &web_cfg_push_max_bytes );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu16 "\n", CFG_NVS_KEY_PUSH_MAX_BYTES, web_cfg_push_max_bytes );
+            snprintf( web_cfg_push_max_bytes_str, sizeof web_cfg_push_max_bytes_str, "%" PRIu16,
+                      web_cfg_push_max_bytes );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_MAX_BYTES, esp_err_to_name( err ) );
+        }
+
+        err = nvs_get_u32( my_handle, CFG_NVS_KEY_PUSH_HOLD_US, &web_cfg_push_hold_us );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu32 "us\n", CFG_NVS_KEY_PUSH_HOLD_US, web_cfg_push_hold_us );
+            snprintf( web_cfg_push_hold_us_str, sizeof web_cfg_push_hold_us_str, "%" PRIu32, web_cfg_push_hold_us );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_HOLD_US, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( web_cfg_uplink_filter );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_UPLINK_FILTER, web_cfg_uplink_filter, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_UPLINK_FILTER, web_cfg_uplink_filter );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_UPLINK_FILTER, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( web_cfg_lns_fallbacks );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_LNS_FALLBACKS, web_cfg_lns_fallbacks, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_LNS_FALLBACKS, web_cfg_lns_fallbacks );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_LNS_FALLBACKS, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( web_cfg_lns_fanout );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_LNS_FANOUT, web_cfg_lns_fanout, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_LNS_FANOUT, web_cfg_lns_fanout );
+        }
+        else
+        {
+            ESP_LOGW( TAG_WEB, "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_LNS_FANOUT, esp_err_to_name( err ) );
+        }
     }
     nvs_close( my_handle );
     printf( "Closed NVS handle for reading.\n" );
@@ -504,6 +620,69 @@ static esp_err_t http_root_get_handler( httpd_req_t* req )
         httpd_resp_sendstr_chunk( req, web_cfg_sntp_address );
     httpd_resp_sendstr_chunk( req, "\"><br>" );
 
+    /* Uplink forwarding configuration */
+    httpd_resp_sendstr_chunk( req, "<h2>Uplink forwarding</h2>" );
+
+    /* max packets per PUSH_DATA */
+    httpd_resp_sendstr_chunk( req, "<label for=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_PKT );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\">max packets per datagram</label>" );
+
+    httpd_resp_sendstr_chunk( req, "<input type=\"number\" id=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_PKT );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );
+    httpd_resp_sendstr_chunk( req, " step=1 min=1 max=8" );                                /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, " name=\"" );                                           /* 1 space prefix */
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_PKT ); /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );        /* close string */
+    httpd_resp_sendstr_chunk( req, " value=\"" ); /* 1 space prefix */
+    if( strlen( web_cfg_push_max_pkt_str ) )
+        httpd_resp_sendstr_chunk( req, web_cfg_push_max_pkt_str );
+    httpd_resp_sendstr_chunk( req, "\"><br>" );
+
+    /* max bytes per PUSH_DATA */
+    httpd_resp_sendstr_chunk( req, "<label for=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_BYTES );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\">max bytes per datagram</label>" );
+
+    httpd_resp_sendstr_chunk( req, "<input type=\"number\" id=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_BYTES );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );
+    httpd_resp_sendstr_chunk( req, " step=1 min=540 max=4320" );                             /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, " name=\"" );                                             /* 1 space prefix */
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_MAX_BYTES ); /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );        /* close string */
+    httpd_resp_sendstr_chunk( req, " value=\"" ); /* 1 space prefix */
+    if( strlen( web_cfg_push_max_bytes_str ) )
+        httpd_resp_sendstr_chunk( req, web_cfg_push_max_bytes_str );
+    httpd_resp_sendstr_chunk( req, "\"><br>" );
+
+    /* max hold time */
+    httpd_resp_sendstr_chunk( req, "<label for=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_HOLD_US );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\">max hold time (us)</label>" );
+
+    httpd_resp_sendstr_chunk( req, "<input type=\"number\" id=\"" );
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_HOLD_US );
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );
+    httpd_resp_sendstr_chunk( req, " step=1 min=0 max=1000000" );                          /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, " name=\"" );                                           /* 1 space prefix */
+    snprintf( field_name_str, sizeof field_name_str, "%s", FORM_FIELD_NAME_PUSH_HOLD_US ); /* 1 space prefix */
+    httpd_resp_sendstr_chunk( req, field_name_str );
+    httpd_resp_sendstr_chunk( req, "\"" );        /* close string */
+    httpd_resp_sendstr_chunk( req, " value=\"" ); /* 1 space prefix */
+    if( strlen( web_cfg_push_hold_us_str ) )
+        httpd_resp_sendstr_chunk( req, web_cfg_push_hold_us_str );
+    httpd_resp_sendstr_chunk( req, "\"><br>" );
+
     /* Submit form button */
     httpd_resp_sendstr_chunk( req, "<br><input class=\"btn_cfg\" type=\"submit\"" );
     httpd_resp_sendstr_chunk( req, " name=\"" );                                     /* 1 space prefix */
@@ -679,6 +858,90 @@ static esp_err_t store_config_to_nvs( void )
         return ESP_FAIL;
     }
 
+    printf( "NVS <- %s = %" PRIu8 " ... ", CFG_NVS_KEY_PUSH_MAX_PKT, web_cfg_push_max_pkt );
+    err = nvs_set_u8( my_handle, CFG_NVS_KEY_PUSH_MAX_PKT, web_cfg_push_max_pkt );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
+    printf( "NVS <- %s = %" PRIu16 " ... ", CFG_NVS_KEY_PUSH_MAX_BYTES, web_cfg_push_max_bytes );
+    err = nvs_set_u16( my_handle, CFG_NVS_KEY_PUSH_MAX_BYTES, web_cfg_push_max_bytes );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
+    printf( "NVS <- %s = %" PRIu32 " ... ", CFG_NVS_KEY_PUSH_HOLD_US, web_cfg_push_hold_us );
+    err = nvs_set_u32( my_handle, CFG_NVS_KEY_PUSH_HOLD_US, web_cfg_push_hold_us );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
+    printf( "NVS <- %s = %s ... ", CFG_NVS_KEY_UPLINK_FILTER, web_cfg_uplink_filter );
+    err = nvs_set_str( my_handle, CFG_NVS_KEY_UPLINK_FILTER, web_cfg_uplink_filter );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
+    printf( "NVS <- %s = %s ... ", CFG_NVS_KEY_LNS_FALLBACKS, web_cfg_lns_fallbacks );
+    err = nvs_set_str( my_handle, CFG_NVS_KEY_LNS_FALLBACKS, web_cfg_lns_fallbacks );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
+    printf( "NVS <- %s = %s ... ", CFG_NVS_KEY_LNS_FANOUT, web_cfg_lns_fanout );
+    err = nvs_set_str( my_handle, CFG_NVS_KEY_LNS_FANOUT, web_cfg_lns_fanout );
+    if( err == ESP_OK )
+    {
+        printf( "Done\n" );
+    }
+    else
+    {
+        printf( "Failed\n" );
+        nvs_close( my_handle );
+        printf( "Closed NVS handle for writing.\n" );
+        return ESP_FAIL;
+    }
+
     printf( "Committing updates in NVS ... " );
     err = nvs_commit( my_handle );
     if( err == ESP_OK )
@@ -703,7 +966,11 @@ static esp_err_t store_config_to_nvs( void )
 
 /* POSTMAN:
 POST http://xxx.xxx.xxx.xxxx:8000/api/v1/set_config
-{"lns_addr":"eu1.cloud.thethings.network","lns_port":1700,"chan_freq":868.1,"chan_dr":7,"chan_bw":125,"sntp_addr":"pool.ntp.org"}
+{"lns_addr":"eu1.cloud.thethings.network","lns_port":1700,"chan_freq":868.1,"chan_dr":7,"chan_bw":125,"sntp_addr":"pool.ntp.org",
+"push_max_pkt":8,"push_max_bytes":1200,"push_hold_us":0,
+"uplink_filter":"netid:000013 join:70B3D57ED0000000-70B3D57ED0FFFFFF",
+"lns_fallbacks":"eu2.cloud.thethings.network nam1.cloud.thethings.network:1700",
+"lns_fanout":"192.168.1.10:1700"}
 */
 
 static esp_err_t set_config_post_handler( httpd_req_t* req )
@@ -1040,6 +1307,259 @@ static esp_err_t set_config_post_handler( httpd_req_t* req )
                     return ESP_FAIL;
                 }
             }
+
+            /* Get PUSH_DATA max packets */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_PUSH_MAX_PKT );
+            if( val != NULL )
+            {
+                double          val_num;
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONNumber )
+                {
+                    val_num = json_value_get_number( val );
+                }
+                else if( val_type == JSONString )
+                {
+                    val_num = atof( json_value_get_string( val ) );
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_PUSH_MAX_PKT, val_type );
+                    err = ESP_FAIL;
+                }
+                /* sanity check */
+                if( err == ESP_OK )
+                {
+                    printf( "%s:%.0f\n", FORM_FIELD_NAME_PUSH_MAX_PKT, val_num );
+                    if( ( val_num < 1 ) || ( val_num > 8 ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - out of range, configuration failed",
+                                  FORM_FIELD_NAME_PUSH_MAX_PKT );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        web_cfg_push_max_pkt = ( uint8_t ) val_num;
+                    }
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_PUSH_MAX_PKT );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
+
+            /* Get PUSH_DATA max bytes */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_PUSH_MAX_BYTES );
+            if( val != NULL )
+            {
+                double          val_num;
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONNumber )
+                {
+                    val_num = json_value_get_number( val );
+                }
+                else if( val_type == JSONString )
+                {
+                    val_num = atof( json_value_get_string( val ) );
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_PUSH_MAX_BYTES, val_type );
+                    err = ESP_FAIL;
+                }
+                /* sanity check */
+                if( err == ESP_OK )
+                {
+                    printf( "%s:%.0f\n", FORM_FIELD_NAME_PUSH_MAX_BYTES, val_num );
+                    if( ( val_num < 540 ) || ( val_num > 4320 ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - out of range, configuration failed",
+                                  FORM_FIELD_NAME_PUSH_MAX_BYTES );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        web_cfg_push_max_bytes = ( uint16_t ) val_num;
+                    }
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_PUSH_MAX_BYTES );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
+
+            /* Get PUSH_DATA hold time (us) */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_PUSH_HOLD_US );
+            if( val != NULL )
+            {
+                double          val_num;
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONNumber )
+                {
+                    val_num = json_value_get_number( val );
+                }
+                else if( val_type == JSONString )
+                {
+                    val_num = atof( json_value_get_string( val ) );
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_PUSH_HOLD_US, val_type );
+                    err = ESP_FAIL;
+                }
+                /* sanity check */
+                if( err == ESP_OK )
+                {
+                    printf( "%s:%.0f\n", FORM_FIELD_NAME_PUSH_HOLD_US, val_num );
+                    if( ( val_num < 0 ) || ( val_num > 1000000 ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - out of range, configuration failed",
+                                  FORM_FIELD_NAME_PUSH_HOLD_US );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        web_cfg_push_hold_us = ( uint32_t ) val_num;
+                    }
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_PUSH_HOLD_US );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
+
+            /* Get uplink filtering rules */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_UPLINK_FILTER );
+            if( val != NULL )
+            {
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONString )
+                {
+                    str = json_value_get_string( val );
+                    if( strlen( str ) >= sizeof( web_cfg_uplink_filter ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - too long", FORM_FIELD_NAME_UPLINK_FILTER );
+                        err = ESP_FAIL;
+                    }
+                    else if( uplink_filter_parse( str, web_cfg_uplink_filter_rules ) < 0 )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - invalid rules, configuration failed",
+                                  FORM_FIELD_NAME_UPLINK_FILTER );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        strcpy( web_cfg_uplink_filter, str );
+                        printf( "%s:%s\n", FORM_FIELD_NAME_UPLINK_FILTER, web_cfg_uplink_filter );
+                    }
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_UPLINK_FILTER, val_type );
+                    err = ESP_FAIL;
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_UPLINK_FILTER );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
+
+            /* Get fallback servers */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_LNS_FALLBACKS );
+            if( val != NULL )
+            {
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONString )
+                {
+                    str = json_value_get_string( val );
+                    if( strlen( str ) >= sizeof( web_cfg_lns_fallbacks ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - too long", FORM_FIELD_NAME_LNS_FALLBACKS );
+                        err = ESP_FAIL;
+                    }
+                    else if( lns_parse_servers( str, web_cfg_lns_port_str, web_cfg_lns_servers,
+                                                LNS_SERVERS_MAX - 1 ) < 0 )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - invalid servers, configuration failed",
+                                  FORM_FIELD_NAME_LNS_FALLBACKS );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        strcpy( web_cfg_lns_fallbacks, str );
+                        printf( "%s:%s\n", FORM_FIELD_NAME_LNS_FALLBACKS, web_cfg_lns_fallbacks );
+                    }
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_LNS_FALLBACKS, val_type );
+                    err = ESP_FAIL;
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_LNS_FALLBACKS );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
+
+            /* Get additional servers */
+            val = json_object_get_value( root_obj, FORM_FIELD_NAME_LNS_FANOUT );
+            if( val != NULL )
+            {
+                JSON_Value_Type val_type = json_value_get_type( val );
+                if( val_type == JSONString )
+                {
+                    str = json_value_get_string( val );
+                    if( strlen( str ) >= sizeof( web_cfg_lns_fanout ) )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - too long", FORM_FIELD_NAME_LNS_FANOUT );
+                        err = ESP_FAIL;
+                    }
+                    else if( lns_parse_servers( str, web_cfg_lns_port_str, web_cfg_lns_servers, LNS_FANOUT_MAX ) < 0 )
+                    {
+                        ESP_LOGE( TAG_WEB, "ERROR: %s - invalid servers, configuration failed",
+                                  FORM_FIELD_NAME_LNS_FANOUT );
+                        err = ESP_FAIL;
+                    }
+                    else
+                    {
+                        strcpy( web_cfg_lns_fanout, str );
+                        printf( "%s:%s\n", FORM_FIELD_NAME_LNS_FANOUT, web_cfg_lns_fanout );
+                    }
+                }
+                else
+                {
+                    ESP_LOGE( TAG_WEB, "ERROR: %s - invalid format %d, configuration failed",
+                              FORM_FIELD_NAME_LNS_FANOUT, val_type );
+                    err = ESP_FAIL;
+                }
+                /* response on error */
+                if( err != ESP_OK )
+                {
+                    httpd_resp_send_err( req, HTTPD_400_BAD_REQUEST, FORM_FIELD_NAME_LNS_FANOUT );
+                    json_value_free( root_val );
+                    return ESP_FAIL;
+                }
+            }
         }
     }
 
@@ -1126,9 +1646,12 @@ esp_err_t get_config_get_handler( httpd_req_t* req )
     /* Generate the JSON string */
     snprintf(
         post_content_json, JSON_FULL_CONTENT_MAX_SIZE,
-        "{\"lns_addr\":\"%s\",\"lns_port\":%s,\"chan_freq\":%s,\"chan_dr\":%s,\"chan_bw\":%s,\"sntp_addr\":\"%s\"}",
+        "{\"lns_addr\":\"%s\",\"lns_port\":%s,\"chan_freq\":%s,\"chan_dr\":%s,\"chan_bw\":%s,\"sntp_addr\":\"%s\","
+        "\"push_max_pkt\":%s,\"push_max_bytes\":%s,\"push_hold_us\":%s,\"uplink_filter\":\"%s\","
+        "\"lns_fallbacks\":\"%s\",\"lns_fanout\":\"%s\"}",
         web_cfg_lns_address, web_cfg_lns_port_str, web_cfg_chan_freq_mhz_str, web_cfg_chan_datarate_str,
-        web_cfg_chan_bandwidth_khz_str, web_cfg_sntp_address );
+        web_cfg_chan_bandwidth_khz_str, web_cfg_sntp_address, web_cfg_push_max_pkt_str, web_cfg_push_max_bytes_str,
+        web_cfg_push_hold_us_str, web_cfg_uplink_filter, web_cfg_lns_fallbacks, web_cfg_lns_fanout );
 
     /* Send response */
     httpd_resp_set_type( req, "application/json" );
@@ -1159,14 +1682,194 @@ esp_err_t get_info_get_handler( httpd_req_t* req )
     return ESP_OK;
 }
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* POSTMAN:
+GET http://xxx.xxx.xxx.xxxx:8000/api/v1/get_dev_stats
+*/
+
+esp_err_t get_dev_stats_get_handler( httpd_req_t* req )
+{
+    struct dev_stats_entry_s* e;
+    char                      dev_json[256];
+    int                       nb_dev;
+    int                       i;
+    uint64_t                  now_us = ( uint64_t ) esp_timer_get_time( );
+
+    ESP_LOGI( TAG_WEB, "%s: req->uri=%s", __FUNCTION__, req->uri );
+    ESP_LOGI( TAG_WEB, "%s: content length %d", __FUNCTION__, req->content_len );
+
+    /* Get a copy of the table, so that the uplinks are not blocked while the response is sent */
+    nb_dev = dev_stats_get( dev_stats_snapshot, DEV_STATS_CAPACITY );
+
+    /* Send the JSON string, one device per chunk */
+    httpd_resp_set_type( req, "application/json" );
+    snprintf( dev_json, sizeof dev_json, "{\"capacity\":%d,\"devices\":[", DEV_STATS_CAPACITY );
+    httpd_resp_sendstr_chunk( req, dev_json );
+    for( i = 0; i < nb_dev; i++ )
+    {
+        e = &dev_stats_snapshot[i];
+        snprintf( dev_json, sizeof dev_json,
+                  "%s{\"devaddr\":\"%08lX\",\"pkt\":%lu,\"lost\":%lu,\"rssi\":{\"min\":%d,\"avg\":%.1f,\"max\":%d},"
+                  "\"snr\":{\"min\":%.2f,\"avg\":%.1f,\"max\":%.2f},\"fcnt\":%u,\"last_seen_s\":%lu}",
+                  ( i == 0 ) ? "" : ",", e->devaddr, e->nb_pkt, e->nb_lost, e->rssi_min,
+                  ( double ) e->rssi_sum / e->nb_pkt, e->rssi_max, e->snr_min / 4.0,
+                  ( double ) e->snr_sum / ( 4.0 * e->nb_pkt ), e->snr_max / 4.0, e->last_fcnt,
+                  ( uint32_t ) ( ( now_us - e->last_seen_us ) / 1000000 ) );
+        httpd_resp_sendstr_chunk( req, dev_json );
+    }
+    httpd_resp_sendstr_chunk( req, "]}" );
+    httpd_resp_sendstr_chunk( req, NULL );
+
+    return ESP_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void metrics_write_chunk( void* ctx, const char* str )
+{
+    httpd_resp_sendstr_chunk( ( httpd_req_t* ) ctx, str );
+}
+
+/* POSTMAN:
+GET http://xxx.xxx.xxx.xxxx:8000/metrics
+*/
+
+esp_err_t metrics_get_handler( httpd_req_t* req )
+{
+    ESP_LOGI( TAG_WEB, "%s: req->uri=%s", __FUNCTION__, req->uri );
+    ESP_LOGI( TAG_WEB, "%s: content length %d", __FUNCTION__, req->content_len );
+
+    /* Send the OpenMetrics text, one line per chunk, the counters being read while it is sent */
+    httpd_resp_set_type( req, "application/openmetrics-text; version=1.0.0; charset=utf-8" );
+    pkt_fwd_get_metrics( metrics_write_chunk, req );
+    httpd_resp_sendstr_chunk( req, "# EOF\n" );
+    httpd_resp_sendstr_chunk( req, NULL );
+
+    return ESP_OK;
+}
+
+#if defined( CONFIG_LATENCY_TRACE )
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int trace_rec_cmp( const void* a, const void* b )
+{
+    const struct lgw_trace_rec_s* ra = ( const struct lgw_trace_rec_s* ) a;
+    const struct lgw_trace_rec_s* rb = ( const struct lgw_trace_rec_s* ) b;
+    int32_t                       diff = ( int32_t ) ( ra->ts_us - rb->ts_us ); /* the timestamps wrap around */
+
+    if( diff != 0 )
+    {
+        return ( diff < 0 ) ? -1 : 1;
+    }
+    return ( int ) ra->event - ( int ) rb->event; /* path order for the events of a packet recorded at once */
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* POSTMAN:
+GET http://xxx.xxx.xxx.xxxx:8000/api/v1/get_trace
+*/
+
+esp_err_t get_trace_get_handler( httpd_req_t* req )
+{
+    struct lgw_trace_rec_s* r;
+    struct lgw_trace_rec_s* n;
+    char                    event_json[256];
+    const char*             cat;
+    uint32_t                base_us;
+    int                     nb_rec;
+    int                     i;
+    int                     j;
+
+    ESP_LOGI( TAG_WEB, "%s: req->uri=%s", __FUNCTION__, req->uri );
+    ESP_LOGI( TAG_WEB, "%s: content length %d", __FUNCTION__, req->content_len );
+
+    /* Get a copy of the ring, so that the packets are not delayed while the response is sent, in time order */
+    nb_rec = lgw_trace_get( trace_snapshot, LGW_TRACE_CAPACITY );
+    qsort( trace_snapshot, nb_rec, sizeof trace_snapshot[0], trace_rec_cmp );
+    base_us = ( nb_rec > 0 ) ? trace_snapshot[0].ts_us : 0;
+
+    /* Link each event to the next one of the same packet, in the same direction as the ids may collide */
+    for( i = 0; i < nb_rec; i++ )
+    {
+        trace_next_rec[i] = -1;
+        trace_prev_rec[i] = -1;
+    }
+    for( i = 0; i < nb_rec; i++ )
+    {
+        r = &trace_snapshot[i];
+        for( j = i + 1; j < nb_rec; j++ )
+        {
+            n = &trace_snapshot[j];
+            if( ( n->pkt_id == r->pkt_id ) && ( trace_prev_rec[j] < 0 ) &&
+                ( ( n->event < LGW_TRACE_DW_PULL_RESP ) == ( r->event < LGW_TRACE_DW_PULL_RESP ) ) )
+            {
+                trace_next_rec[i] = ( int16_t ) j;
+                trace_prev_rec[j] = ( int16_t ) i;
+                break;
+            }
+        }
+    }
+
+    /* Send the Chrome trace event JSON, one event per chunk. Each packet is an async track made of the slices between
+     * its consecutive events, a packet seen only once being an instant event. The events are sent in time order, a
+     * slice ending before the next one of the packet begins, so that they never nest. */
+    httpd_resp_set_type( req, "application/json" );
+    httpd_resp_set_hdr( req, "Content-Disposition", "attachment; filename=\"lorahub_trace.json\"" );
+    httpd_resp_sendstr_chunk( req, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+    for( i = 0; i < nb_rec; i++ )
+    {
+        r   = &trace_snapshot[i];
+        cat = ( r->event < LGW_TRACE_DW_PULL_RESP ) ? "uplink" : "downlink";
+        if( trace_prev_rec[i] >= 0 )
+        {
+            n = &trace_snapshot[trace_prev_rec[i]];
+            snprintf( event_json, sizeof event_json,
+                      ",{\"name\":\"%s -> %s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":\"0x%08lX\",\"pid\":1,"
+                      "\"tid\":%u,\"ts\":%lu}",
+                      lgw_trace_event_str( n->event ), lgw_trace_event_str( r->event ), cat, r->pkt_id, r->core,
+                      r->ts_us - base_us );
+            httpd_resp_sendstr_chunk( req, event_json );
+        }
+        if( trace_next_rec[i] >= 0 )
+        {
+            n = &trace_snapshot[trace_next_rec[i]];
+            snprintf( event_json, sizeof event_json,
+                      "%s{\"name\":\"%s -> %s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":\"0x%08lX\",\"pid\":1,"
+                      "\"tid\":%u,\"ts\":%lu,\"args\":{\"core\":%u}}",
+                      ( i == 0 ) ? "" : ",", lgw_trace_event_str( r->event ), lgw_trace_event_str( n->event ), cat,
+                      r->pkt_id, r->core, r->ts_us - base_us, r->core );
+            httpd_resp_sendstr_chunk( req, event_json );
+        }
+        else if( trace_prev_rec[i] < 0 )
+        {
+            snprintf( event_json, sizeof event_json,
+                      "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"n\",\"id\":\"0x%08lX\",\"pid\":1,"
+                      "\"tid\":%u,\"ts\":%lu,\"args\":{\"core\":%u}}",
+                      ( i == 0 ) ? "" : ",", lgw_trace_event_str( r->event ), cat, r->pkt_id, r->core,
+                      r->ts_us - base_us, r->core );
+            httpd_resp_sendstr_chunk( req, event_json );
+        }
+    }
+    httpd_resp_sendstr_chunk( req, "]}" );
+    httpd_resp_sendstr_chunk( req, NULL );
+
+    return ESP_OK;
+}
+
+#endif  // CONFIG_LATENCY_TRACE
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
 
 void http_server_init( void )
 {
-    httpd_handle_t server = NULL;
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG( );
-    config.server_port    = 8000;  // TODO: make it configurable
+    httpd_handle_t server   = NULL;
+    httpd_config_t config   = HTTPD_DEFAULT_CONFIG( );
+    config.server_port      = 8000;  // TODO: make it configurable
+    config.max_uri_handlers = 10;    /* the web and API handlers, and /metrics */
 
     /* Use the URI wildcard matching function in order to
      * allow the same handler to respond to multiple different
@@ -1225,4 +1928,24 @@ void http_server_init( void )
         .uri = "/api/v1/get_info", .method = HTTP_GET, .handler = get_info_get_handler, .user_ctx = NULL
     };
     httpd_register_uri_handler( server, &api_get_info_get_uri );
+
+    /* URI handler got get_dev_stats GET from API */
+    httpd_uri_t api_get_dev_stats_get_uri = {
+        .uri = "/api/v1/get_dev_stats", .method = HTTP_GET, .handler = get_dev_stats_get_handler, .user_ctx = NULL
+    };
+    httpd_register_uri_handler( server, &api_get_dev_stats_get_uri );
+
+#if defined( CONFIG_LATENCY_TRACE )
+    /* URI handler got get_trace GET from API */
+    httpd_uri_t api_get_trace_get_uri = {
+        .uri = "/api/v1/get_trace", .method = HTTP_GET, .handler = get_trace_get_handler, .user_ctx = NULL
+    };
+    httpd_register_uri_handler( server, &api_get_trace_get_uri );
+#endif
+
+    /* URI handler for metrics GET, in the OpenMetrics text format */
+    httpd_uri_t metrics_get_uri = {
+        .uri = "/metrics", .method = HTTP_GET, .handler = metrics_get_handler, .user_ctx = NULL
+    };
+    httpd_register_uri_handler( server, &metrics_get_uri );
 }
\ No newline at end of file
@@ -15,7 +15,6 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 /* -------------------------------------------------------------------------- */
 /* --- DEPENDENCIES --------------------------------------------------------- */
 
-#include <stdlib.h> /* qsort_r */
 #include <stdio.h>  /* printf, fprintf, snprintf, fopen, fputs */
 #include <string.h> /* memset, memcpy */
 #include <pthread.h>
@@ -26,6 +25,7 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #include "trace.h"
 #include "jitqueue.h"
+#include "lorahub_trace.h"
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE MACROS ------------------------------------------------------- */
@@ -50,9 +50,186 @@ static const char* TAG_JITQ = "jit_queue";
 /* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
 static pthread_mutex_t mx_jit_queue = PTHREAD_MUTEX_INITIALIZER; /* control access to JIT queue */
 
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+bool jit_collision_test( uint32_t p1_count_us, uint32_t p1_pre_delay, uint32_t p1_post_delay, uint32_t p2_count_us,
+                         uint32_t p2_pre_delay, uint32_t p2_post_delay );
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
 
+/* Position in order[] of the first node whose timestamp is not before count_us. The order is roll-over safe as long as
+ * all packets of the queue are less than 2^31 us apart, which is ensured by TX_MAX_ADVANCE_DELAY */
+static int jit_order_search( struct jit_queue_s* queue, uint32_t count_us )
+{
+    int low  = 0;
+    int high = queue->num_pkt;
+    int mid;
+
+    while( low < high )
+    {
+        mid = ( low + high ) / 2;
+        if( ( int32_t ) ( queue->nodes[queue->order[mid]].pkt.count_us - count_us ) < 0 )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/* Position in order[] of a used node */
+static int jit_order_pos( struct jit_queue_s* queue, int index )
+{
+    int pos = jit_order_search( queue, queue->nodes[index].pkt.count_us );
+
+    while( queue->order[pos] != index )
+    {
+        pos++;
+    }
+
+    return pos;
+}
+
+/* Check a packet against the node of the given index, the beacon guard is ignored for Class A/C downlinks */
+static bool jit_node_collision( struct jit_queue_s* queue, int index, uint32_t count_us, uint32_t pre_delay,
+                                uint32_t post_delay, enum jit_pkt_type_e pkt_type )
+{
+    uint32_t target_pre_delay;
+
+    if( ( ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A ) || ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C ) ) &&
+        ( queue->nodes[index].pkt_type == JIT_PKT_TYPE_BEACON ) )
+    {
+        target_pre_delay = TX_START_DELAY;
+    }
+    else
+    {
+        target_pre_delay = queue->nodes[index].pre_delay;
+    }
+
+    return jit_collision_test( count_us, pre_delay, post_delay, queue->nodes[index].pkt.count_us, target_pre_delay,
+                               queue->nodes[index].post_delay );
+}
+
+/* Return the index of a node colliding with the given packet among the nodes from the given position in order[], -1
+ * if none. Only the nodes closer than the longest pre delay of the queue can collide on their pre delay (the next one
+ * only, unless beacons are queued and their guard applies to the packet) */
+static int jit_find_collision_from( struct jit_queue_s* queue, int pos, uint32_t count_us, uint32_t pre_delay,
+                                    uint32_t post_delay, enum jit_pkt_type_e pkt_type )
+{
+    uint32_t max_pre_delay;
+
+    if( ( queue->num_beacon > 0 ) && ( pkt_type != JIT_PKT_TYPE_DOWNLINK_CLASS_A ) &&
+        ( pkt_type != JIT_PKT_TYPE_DOWNLINK_CLASS_C ) )
+    {
+        max_pre_delay = TX_START_DELAY + BEACON_GUARD + TX_JIT_DELAY;
+    }
+    else
+    {
+        max_pre_delay = TX_START_DELAY + TX_JIT_DELAY;
+    }
+    for( ; pos < queue->num_pkt; pos++ )
+    {
+        if( ( int32_t ) ( queue->nodes[queue->order[pos]].pkt.count_us - count_us ) >
+            ( int32_t ) ( max_pre_delay + post_delay + TX_MARGIN_DELAY ) )
+        {
+            break; /* the nodes starting before the packet are checked too */
+        }
+        if( jit_node_collision( queue, queue->order[pos], count_us, pre_delay, post_delay, pkt_type ) )
+        {
+            return queue->order[pos];
+        }
+    }
+
+    return -1;
+}
+
+/* Return the index of a node colliding with the given packet, -1 if none.
+ * The time on air of queued packets never overlap, so their ends are sorted like their timestamps: only the previous
+ * node can collide on its post delay, and only the next nodes can collide on their pre delay. */
+static int jit_find_collision( struct jit_queue_s* queue, uint32_t count_us, uint32_t pre_delay, uint32_t post_delay,
+                               enum jit_pkt_type_e pkt_type )
+{
+    int pos = jit_order_search( queue, count_us );
+
+    if( ( pos > 0 ) && jit_node_collision( queue, queue->order[pos - 1], count_us, pre_delay, post_delay, pkt_type ) )
+    {
+        /* report the earliest colliding node, as the type of the collision is returned: the previous nodes within the
+         * pre delay of the packet collide too */
+        while( ( pos > 1 ) &&
+               jit_node_collision( queue, queue->order[pos - 2], count_us, pre_delay, post_delay, pkt_type ) )
+        {
+            pos--;
+        }
+        return queue->order[pos - 1];
+    }
+
+    return jit_find_collision_from( queue, pos, count_us, pre_delay, post_delay, pkt_type );
+}
+
+/* Timestamp of the slot right after the node at the given position in order[], for a packet of the given pre delay.
+ * Those slots are sorted like the ends of the nodes. */
+static uint32_t jit_slot_after( struct jit_queue_s* queue, int pos, uint32_t pre_delay )
+{
+    struct jit_node_s* node = &( queue->nodes[queue->order[pos]] );
+
+    return node->pkt.count_us + node->post_delay + pre_delay + TX_JIT_DELAY + TX_MARGIN_DELAY;
+}
+
+/* Position in order[] of the first node whose slot is not too late to be sent */
+static int jit_slot_search( struct jit_queue_s* queue, uint32_t time_us, uint32_t pre_delay )
+{
+    int low  = 0;
+    int high = queue->num_pkt;
+    int mid;
+
+    while( low < high )
+    {
+        mid = ( low + high ) / 2;
+        if( ( int32_t ) ( jit_slot_after( queue, mid, pre_delay ) - time_us ) <=
+            ( TX_START_DELAY + TX_MARGIN_DELAY + TX_JIT_DELAY ) )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/* Remove a node from the queue, the last node is moved to the freed index to keep nodes[] packed */
+static void jit_remove_node( struct jit_queue_s* queue, int index )
+{
+    int pos  = jit_order_pos( queue, index );
+    int last = queue->num_pkt - 1;
+
+    if( queue->nodes[index].pkt_type == JIT_PKT_TYPE_BEACON )
+    {
+        queue->num_beacon--;
+    }
+
+    /* remove from order */
+    memmove( &( queue->order[pos] ), &( queue->order[pos + 1] ), last - pos );
+    queue->num_pkt--;
+
+    /* pack nodes */
+    if( index != last )
+    {
+        pos = jit_order_pos( queue, last );
+        memcpy( &( queue->nodes[index] ), &( queue->nodes[last] ), sizeof( struct jit_node_s ) );
+        queue->order[pos] = ( uint8_t ) index;
+    }
+    memset( &( queue->nodes[last] ), 0, sizeof( struct jit_node_s ) );
+}
+
 /* -------------------------------------------------------------------------- */
 /* --- PUBLIC FUNCTIONS DEFINITION ----------------------------------------- */
 
@@ -98,36 +275,6 @@ void jit_queue_init( struct jit_queue_s* queue )
     pthread_mutex_unlock( &mx_jit_queue );
 }
 
-int compare( const void* a, const void* b, void* arg )
-{
-    struct jit_node_s* p       = ( struct jit_node_s* ) a;
-    struct jit_node_s* q       = ( struct jit_node_s* ) b;
-    int*               counter = ( int* ) arg;
-    int                p_count, q_count;
-
-    p_count = p->pkt.count_us;
-    q_count = q->pkt.count_us;
-
-    if( p_count > q_count )
-        *counter = *counter + 1;
-
-    return p_count - q_count;
-}
-
-void jit_sort_queue( struct jit_queue_s* queue )
-{
-    int counter = 0;
-
-    if( queue->num_pkt == 0 )
-    {
-        return;
-    }
-
-    MSG_DEBUG( DEBUG_JIT, "sorting queue in ascending order packet timestamp - queue size:%u\n", queue->num_pkt );
-    qsort_r( queue->nodes, queue->num_pkt, sizeof( queue->nodes[0] ), compare, &counter );
-    MSG_DEBUG( DEBUG_JIT, "sorting queue done - swapped:%d\n", counter );
-}
-
 bool jit_collision_test( uint32_t p1_count_us, uint32_t p1_pre_delay, uint32_t p1_post_delay, uint32_t p2_count_us,
                          uint32_t p2_pre_delay, uint32_t p2_post_delay )
 {
@@ -146,11 +293,13 @@ enum jit_error_e jit_enqueue( struct jit_queue_s* queue, uint32_t time_us, struc
                               enum jit_pkt_type_e pkt_type )
 {
     int              i                 = 0;
+    int              pos               = 0;
     uint32_t         packet_post_delay = 0;
     uint32_t         packet_pre_delay  = 0;
-    uint32_t         target_pre_delay  = 0;
     enum jit_error_e err_collision;
     uint32_t         asap_count_us;
+    uint32_t         slot_count_us;
+    bool             asap_free;
 
     MSG_DEBUG( DEBUG_JIT, "Current concentrator time is %lu, pkt_type=%d\n", time_us, pkt_type );
 
@@ -205,66 +354,40 @@ enum jit_error_e jit_enqueue( struct jit_queue_s* queue, uint32_t time_us, struc
         {
             /* Else we can try to insert it:
                 - ASAP meaning NOW + MARGIN
-                - at the last index of the queue
-                - between 2 downlinks in the queue
+                - right after a downlink of the queue, the earliest slot that does not collide with any other one,
+                  which can be before the ASAP time
             */
 
             /* First, try if the ASAP time collides with an already enqueued downlink */
-            for( i = 0; i < queue->num_pkt; i++ )
-            {
-                if( jit_collision_test( asap_count_us, packet_pre_delay, packet_post_delay,
-                                        queue->nodes[i].pkt.count_us, queue->nodes[i].pre_delay,
-                                        queue->nodes[i].post_delay ) == true )
-                {
-                    MSG_DEBUG(
-                        DEBUG_JIT,
-                        "DEBUG: cannot insert IMMEDIATE downlink at count_us=%lu, collides with %lu (index=%d)\n",
-                        asap_count_us, queue->nodes[i].pkt.count_us, i );
-                    break;
-                }
-            }
-            if( i == queue->num_pkt )
+            i         = jit_find_collision( queue, asap_count_us, packet_pre_delay, packet_post_delay, pkt_type );
+            asap_free = ( i < 0 );
+            if( asap_free == false )
             {
-                /* No collision with ASAP time, we can insert it */
-                MSG_DEBUG( DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink ASAP at %lu (no collision)\n", asap_count_us );
+                MSG_DEBUG( DEBUG_JIT,
+                           "DEBUG: cannot insert IMMEDIATE downlink at count_us=%lu, collides with %lu (index=%d)\n",
+                           asap_count_us, queue->nodes[i].pkt.count_us, i );
             }
-            else
+
+            /* Search for the earliest gap after a downlink then (if none is free and the ASAP time collides, the
+             * collision is reported below). The slots that are too late are skipped at once, then the gaps are walked
+             * in time order: the slot right after a node cannot collide with it nor with the nodes before it, which
+             * end earlier, so it is only checked against the next node (or two, if the next one is a beacon whose
+             * guard is ignored). The search is O(log n + n) instead of a collision search for each gap. */
+            for( pos = jit_slot_search( queue, time_us, packet_pre_delay ); pos < queue->num_pkt; pos++ )
             {
-                /* Search for the best slot then */
-                for( i = 0; i < queue->num_pkt; i++ )
+                slot_count_us = jit_slot_after( queue, pos, packet_pre_delay );
+                if( ( asap_free == true ) && ( ( int32_t ) ( slot_count_us - asap_count_us ) >= 0 ) )
                 {
-                    asap_count_us = queue->nodes[i].pkt.count_us + queue->nodes[i].post_delay + packet_pre_delay +
-                                    TX_JIT_DELAY + TX_MARGIN_DELAY;
-                    if( i == ( queue->num_pkt - 1 ) )
-                    {
-                        /* Last packet index, we can insert after this one */
-                        MSG_DEBUG( DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink, last in JiT queue (count_us=%lu)\n",
-                                   asap_count_us );
-                    }
-                    else
-                    {
-                        /* Check if packet can be inserted between this index and the next one */
-                        MSG_DEBUG(
-                            DEBUG_JIT,
-                            "DEBUG: try to insert IMMEDIATE downlink (count_us=%lu) between index %d and index %d?\n",
-                            asap_count_us, i, i + 1 );
-                        if( jit_collision_test( asap_count_us, packet_pre_delay, packet_post_delay,
-                                                queue->nodes[i + 1].pkt.count_us, queue->nodes[i + 1].pre_delay,
-                                                queue->nodes[i + 1].post_delay ) == true )
-                        {
-                            MSG_DEBUG( DEBUG_JIT,
-                                       "DEBUG: failed to insert IMMEDIATE downlink (count_us=%lu), continue...\n",
-                                       asap_count_us );
-                            continue;
-                        }
-                        else
-                        {
-                            MSG_DEBUG( DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink (count_us=%lu)\n", asap_count_us );
-                            break;
-                        }
-                    }
+                    break; /* no gap before the ASAP time */
+                }
+                if( jit_find_collision_from( queue, pos + 1, slot_count_us, packet_pre_delay, packet_post_delay,
+                                             pkt_type ) < 0 )
+                {
+                    asap_count_us = slot_count_us;
+                    break;
                 }
             }
+            MSG_DEBUG( DEBUG_JIT, "DEBUG: insert IMMEDIATE downlink (count_us=%lu)\n", asap_count_us );
         }
         /* Set packet with ASAP timestamp */
         packet->count_us = asap_count_us;
@@ -315,76 +438,65 @@ enum jit_error_e jit_enqueue( struct jit_queue_s* queue, uint32_t time_us, struc
      *  Note: - need to take into account packet's pre_delay and post_delay of each packet
      *        - Valid for both Downlinks and beacon packets
      *        - Beacon guard can be ignored if we try to queue a Class A downlink
+     *        - Only the neighbours of the packet in the time ordered queue need to be checked
+     *
+     *  Warning: unsigned arithmetic (handle roll-over)
+     *      t_packet_new - pre_delay_packet_new < t_packet_prev + post_delay_packet_prev (OVERLAP on post delay)
+     *      t_packet_new + post_delay_packet_new > t_packet_prev - pre_delay_packet_prev (OVERLAP on pre delay)
      */
-    for( i = 0; i < queue->num_pkt; i++ )
+    i = jit_find_collision( queue, packet->count_us, packet_pre_delay, packet_post_delay, pkt_type );
+    if( i >= 0 )
     {
-        /* We ignore Beacon Guard for Class A/C downlinks */
-        if( ( ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A ) || ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C ) ) &&
-            ( queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON ) )
-        {
-            target_pre_delay = TX_START_DELAY;
-        }
-        else
+        switch( queue->nodes[i].pkt_type )
         {
-            target_pre_delay = queue->nodes[i].pre_delay;
-        }
-
-        /* Check if there is a collision
-         *  Warning: unsigned arithmetic (handle roll-over)
-         *      t_packet_new - pre_delay_packet_new < t_packet_prev + post_delay_packet_prev (OVERLAP on post delay)
-         *      t_packet_new + post_delay_packet_new > t_packet_prev - pre_delay_packet_prev (OVERLAP on pre delay)
-         */
-        if( jit_collision_test( packet->count_us, packet_pre_delay, packet_post_delay, queue->nodes[i].pkt.count_us,
-                                target_pre_delay, queue->nodes[i].post_delay ) == true )
-        {
-            switch( queue->nodes[i].pkt_type )
+        case JIT_PKT_TYPE_DOWNLINK_CLASS_A:
+        case JIT_PKT_TYPE_DOWNLINK_CLASS_B:
+        case JIT_PKT_TYPE_DOWNLINK_CLASS_C:
+            MSG_DEBUG( DEBUG_JIT_ERROR,
+                       "ERROR: Packet (type=%d) REJECTED, collision with packet already programmed at %lu (%lu)\n",
+                       pkt_type, queue->nodes[i].pkt.count_us, packet->count_us );
+            err_collision = JIT_ERROR_COLLISION_PACKET;
+            break;
+        case JIT_PKT_TYPE_BEACON:
+            if( pkt_type != JIT_PKT_TYPE_BEACON )
             {
-            case JIT_PKT_TYPE_DOWNLINK_CLASS_A:
-            case JIT_PKT_TYPE_DOWNLINK_CLASS_B:
-            case JIT_PKT_TYPE_DOWNLINK_CLASS_C:
-                MSG_DEBUG( DEBUG_JIT_ERROR,
-                           "ERROR: Packet (type=%d) REJECTED, collision with packet already programmed at %lu (%lu)\n",
-                           pkt_type, queue->nodes[i].pkt.count_us, packet->count_us );
-                err_collision = JIT_ERROR_COLLISION_PACKET;
-                break;
-            case JIT_PKT_TYPE_BEACON:
-                if( pkt_type != JIT_PKT_TYPE_BEACON )
-                {
-                    /* do not overload logs for beacon/beacon collision, as it is expected to happen with beacon
-                     * pre-scheduling algorith used */
-                    MSG_DEBUG(
-                        DEBUG_JIT_ERROR,
-                        "ERROR: Packet (type=%d) REJECTED, collision with beacon already programmed at %lu (%lu)\n",
-                        pkt_type, queue->nodes[i].pkt.count_us, packet->count_us );
-                }
-                err_collision = JIT_ERROR_COLLISION_BEACON;
-                break;
-            default:
-                ESP_LOGE( TAG_JITQ, "ERROR: Unknown packet type, should not occur, BUG?\n" );
-                assert( 0 );
-                break;
+                /* do not overload logs for beacon/beacon collision, as it is expected to happen with beacon
+                 * pre-scheduling algorith used */
+                MSG_DEBUG(
+                    DEBUG_JIT_ERROR,
+                    "ERROR: Packet (type=%d) REJECTED, collision with beacon already programmed at %lu (%lu)\n",
+                    pkt_type, queue->nodes[i].pkt.count_us, packet->count_us );
             }
-            pthread_mutex_unlock( &mx_jit_queue );
-            return err_collision;
+            err_collision = JIT_ERROR_COLLISION_BEACON;
+            break;
+        default:
+            ESP_LOGE( TAG_JITQ, "ERROR: Unknown packet type, should not occur, BUG?\n" );
+            assert( 0 );
+            break;
         }
+        pthread_mutex_unlock( &mx_jit_queue );
+        return err_collision;
     }
 
     /* Finally enqueue it */
-    /* Insert packet at the end of the queue */
-    memcpy( &( queue->nodes[queue->num_pkt].pkt ), packet, sizeof( struct lgw_pkt_tx_s ) );
-    queue->nodes[queue->num_pkt].pre_delay  = packet_pre_delay;
-    queue->nodes[queue->num_pkt].post_delay = packet_post_delay;
-    queue->nodes[queue->num_pkt].pkt_type   = pkt_type;
+    /* Insert packet at the end of the nodes, and at its place in the time ordered queue */
+    i   = queue->num_pkt;
+    pos = jit_order_search( queue, packet->count_us );
+    memcpy( &( queue->nodes[i].pkt ), packet, sizeof( struct lgw_pkt_tx_s ) );
+    queue->nodes[i].pre_delay  = packet_pre_delay;
+    queue->nodes[i].post_delay = packet_post_delay;
+    queue->nodes[i].pkt_type   = pkt_type;
+    memmove( &( queue->order[pos + 1] ), &( queue->order[pos] ), i - pos );
+    queue->order[pos] = ( uint8_t ) i;
     if( pkt_type == JIT_PKT_TYPE_BEACON )
     {
         queue->num_beacon++;
     }
     queue->num_pkt++;
-    /* Sort the queue in ascending order of packet timestamp */
-    jit_sort_queue( queue );
 
     /* Done */
     pthread_mutex_unlock( &mx_jit_queue );
+    lgw_trace( LGW_TRACE_JIT_ENQUEUE, packet->count_us );
 
     jit_print_queue( queue, false, DEBUG_JIT );
 
@@ -403,12 +515,6 @@ enum jit_error_e jit_dequeue( struct jit_queue_s* queue, int index, struct lgw_p
         return JIT_ERROR_INVALID;
     }
 
-    if( ( index < 0 ) || ( index >= JIT_QUEUE_MAX ) )
-    {
-        ESP_LOGE( TAG_JITQ, "ERROR: invalid parameter\n" );
-        return JIT_ERROR_INVALID;
-    }
-
     if( jit_queue_is_empty( queue ) )
     {
         ESP_LOGE( TAG_JITQ, "ERROR: cannot dequeue packet, JIT queue is empty\n" );
@@ -417,25 +523,25 @@ enum jit_error_e jit_dequeue( struct jit_queue_s* queue, int index, struct lgw_p
 
     pthread_mutex_lock( &mx_jit_queue );
 
+    if( ( index < 0 ) || ( index >= queue->num_pkt ) )
+    {
+        pthread_mutex_unlock( &mx_jit_queue );
+        ESP_LOGE( TAG_JITQ, "ERROR: invalid parameter\n" );
+        return JIT_ERROR_INVALID;
+    }
+
     /* Dequeue requested packet */
     memcpy( packet, &( queue->nodes[index].pkt ), sizeof( struct lgw_pkt_tx_s ) );
-    queue->num_pkt--;
     *pkt_type = queue->nodes[index].pkt_type;
     if( *pkt_type == JIT_PKT_TYPE_BEACON )
     {
-        queue->num_beacon--;
         MSG_DEBUG( DEBUG_BEACON, "--- Beacon dequeued ---\n" );
     }
-
-    /* Replace dequeued packet with last packet of the queue */
-    memcpy( &( queue->nodes[index] ), &( queue->nodes[queue->num_pkt] ), sizeof( struct jit_node_s ) );
-    memset( &( queue->nodes[queue->num_pkt] ), 0, sizeof( struct jit_node_s ) );
-
-    /* Sort queue in ascending order of packet timestamp */
-    jit_sort_queue( queue );
+    jit_remove_node( queue, index );
 
     /* Done */
     pthread_mutex_unlock( &mx_jit_queue );
+    lgw_trace( LGW_TRACE_JIT_DEQUEUE, packet->count_us );
 
     jit_print_queue( queue, false, DEBUG_JIT );
 
@@ -447,14 +553,16 @@ enum jit_error_e jit_dequeue( struct jit_queue_s* queue, int index, struct lgw_p
 enum jit_error_e jit_peek( struct jit_queue_s* queue, uint32_t time_us, int* pkt_idx )
 {
     /* Return index of node containing a packet inline with given time */
-    int i                    = 0;
-    int idx_highest_priority = -1;
+    int idx_highest_priority;
+
     if( pkt_idx == NULL )
     {
         ESP_LOGE( TAG_JITQ, "ERROR: invalid parameter\n" );
         return JIT_ERROR_INVALID;
     }
 
+    *pkt_idx = -1;
+
     if( jit_queue_is_empty( queue ) )
     {
         return JIT_ERROR_EMPTY;
@@ -462,9 +570,11 @@ enum jit_error_e jit_peek( struct jit_queue_s* queue, uint32_t time_us, int* pkt
 
     pthread_mutex_lock( &mx_jit_queue );
 
-    /* Search for highest priority packet to be sent */
-    for( i = 0; i < queue->num_pkt; i++ )
+    /* The highest priority packet to be sent is the first of the time ordered queue */
+    while( queue->num_pkt > 0 )
     {
+        idx_highest_priority = queue->order[0];
+
         /* First check if that packet is outdated:
          *  If a packet seems too much in advance, and was not rejected at enqueue time,
          *  it means that we missed it for peeking, we need to drop it
@@ -472,43 +582,29 @@ enum jit_error_e jit_peek( struct jit_queue_s* queue, uint32_t time_us, int* pkt
          *  Warning: unsigned arithmetic
          *      t_packet > t_current + TX_MAX_ADVANCE_DELAY
          */
-        if( ( queue->nodes[i].pkt.count_us - time_us ) >= TX_MAX_ADVANCE_DELAY )
+        if( ( queue->nodes[idx_highest_priority].pkt.count_us - time_us ) < TX_MAX_ADVANCE_DELAY )
         {
-            /* We drop the packet to avoid lock-up */
-            queue->num_pkt--;
-            if( queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON )
-            {
-                queue->num_beacon--;
-                ESP_LOGW( TAG_JITQ, "WARNING: --- Beacon dropped (current_time=%lu, packet_time=%lu) ---\n", time_us,
-                          queue->nodes[i].pkt.count_us );
-            }
-            else
-            {
-                ESP_LOGW( TAG_JITQ, "WARNING: --- Packet dropped (current_time=%lu, packet_time=%lu) ---\n", time_us,
-                          queue->nodes[i].pkt.count_us );
-            }
-
-            /* Replace dropped packet with last packet of the queue */
-            memcpy( &( queue->nodes[i] ), &( queue->nodes[queue->num_pkt] ), sizeof( struct jit_node_s ) );
-            memset( &( queue->nodes[queue->num_pkt] ), 0, sizeof( struct jit_node_s ) );
-
-            /* Sort queue in ascending order of packet timestamp */
-            jit_sort_queue( queue );
-
-            /* restart loop  after purge to find packet to be sent */
-            i = 0;
-            continue;
+            break;
         }
 
-        /* Then look for highest priority packet to be sent:
-         *  Warning: unsigned arithmetic (handle roll-over)
-         *      t_packet < t_highest
-         */
-        if( ( idx_highest_priority == -1 ) || ( ( ( queue->nodes[i].pkt.count_us - time_us ) <
-                                                  ( queue->nodes[idx_highest_priority].pkt.count_us - time_us ) ) ) )
+        /* We drop the packet to avoid lock-up */
+        if( queue->nodes[idx_highest_priority].pkt_type == JIT_PKT_TYPE_BEACON )
         {
-            idx_highest_priority = i;
+            ESP_LOGW( TAG_JITQ, "WARNING: --- Beacon dropped (current_time=%lu, packet_time=%lu) ---\n", time_us,
+                      queue->nodes[idx_highest_priority].pkt.count_us );
         }
+        else
+        {
+            ESP_LOGW( TAG_JITQ, "WARNING: --- Packet dropped (current_time=%lu, packet_time=%lu) ---\n", time_us,
+                      queue->nodes[idx_highest_priority].pkt.count_us );
+        }
+        jit_remove_node( queue, idx_highest_priority );
+    }
+
+    if( queue->num_pkt == 0 )
+    {
+        pthread_mutex_unlock( &mx_jit_queue );
+        return JIT_ERROR_EMPTY;
     }
 
     /* Peek criteria 1: look for a packet to be sent in next TX_JIT_DELAY ms timeframe
@@ -521,14 +617,34 @@ enum jit_error_e jit_peek( struct jit_queue_s* queue, uint32_t time_us, int* pkt
         MSG_DEBUG( DEBUG_JIT, "peek packet with count_us=%lu at index %d\n",
                    queue->nodes[idx_highest_priority].pkt.count_us, idx_highest_priority );
     }
-    else
+
+    pthread_mutex_unlock( &mx_jit_queue );
+
+    return JIT_ERROR_OK;
+}
+
+enum jit_error_e jit_next_dispatch( struct jit_queue_s* queue, uint32_t* dispatch_us )
+{
+    enum jit_error_e result = JIT_ERROR_EMPTY;
+
+    if( dispatch_us == NULL )
     {
-        *pkt_idx = -1;
+        ESP_LOGE( TAG_JITQ, "ERROR: invalid parameter\n" );
+        return JIT_ERROR_INVALID;
+    }
+
+    pthread_mutex_lock( &mx_jit_queue );
+
+    /* Same criteria as jit_peek: t_packet < t_current + TX_JIT_DELAY */
+    if( queue->num_pkt > 0 )
+    {
+        *dispatch_us = queue->nodes[queue->order[0]].pkt.count_us - TX_JIT_DELAY + 1;
+        result       = JIT_ERROR_OK;
     }
 
     pthread_mutex_unlock( &mx_jit_queue );
 
-    return JIT_ERROR_OK;
+    return result;
 }
 
 void jit_print_queue( struct jit_queue_s* queue, bool show_all, int debug_level )
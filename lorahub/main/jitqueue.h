@@ -71,7 +71,8 @@ struct jit_queue_s
 {
     uint8_t           num_pkt;              /* Total number of packets in the queue (downlinks, beacons...) */
     uint8_t           num_beacon;           /* Number of beacons in the queue */
-    struct jit_node_s nodes[JIT_QUEUE_MAX]; /* Nodes/packets array in the queue */
+    struct jit_node_s nodes[JIT_QUEUE_MAX]; /* Nodes/packets array in the queue, num_pkt first entries used */
+    uint8_t           order[JIT_QUEUE_MAX]; /* Indexes of the used nodes sorted by packet timestamp */
 };
 
 /* -------------------------------------------------------------------------- */
@@ -147,6 +148,17 @@ enough the current concentrator time.
 */
 enum jit_error_e jit_peek( struct jit_queue_s* queue, uint32_t time_us, int* pkt_idx );
 
+/**
+@brief Get the time at which the first packet of the JiT queue will be returned by jit_peek.
+
+@param queue[in] Just in Time queue to be checked
+@param dispatch_us[out] Concentrator time from which the first packet can be peeked
+@return JIT_ERROR_EMPTY if the queue is empty, success otherwise.
+
+This function is typically used to sleep until there is a packet to be sent, instead of polling with jit_peek.
+*/
+enum jit_error_e jit_next_dispatch( struct jit_queue_s* queue, uint32_t* dispatch_us );
+
 /**
 @brief Debug function to print the queue's content on console
 
@@ -0,0 +1,387 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub fan-out of the forwarded traffic to additional servers, each with its own sockets and state
+
+    The PUSH_DATA datagrams built for the primary server are sent as is to the additional servers, which only differ
+    by the tracking of their tokens, their counters and the acceptance of their downlinks.
+
+    The addresses are resolved by the resolver thread, the network thread only connects the sockets once a result is
+    available, so an unreachable DNS server never stalls its event loop.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdlib.h>  /* rand */
+#include <string.h>  /* memset, memcpy */
+#include <pthread.h>
+
+#include <unistd.h> /* close */
+#include <sys/socket.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "lns_fanout.h"
+#include "lns_resolver.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define PROTOCOL_VERSION 2 /* v1.6 */
+
+#define PKT_PUSH_ACK 1
+#define PKT_PULL_DATA 2
+#define PKT_PULL_RESP 3
+#define PKT_PULL_ACK 4
+
+#define RESOLVE_PULL_MISSED 3        /* nb of PULL_DATA sent without any PULL_ACK before resolving the address again */
+#define RESOLVE_BACKOFF_MIN_MS 10000 /* delay before resolving again an address which was just resolved */
+#define RESOLVE_BACKOFF_MAX_MS 600000 /* maximum delay between two resolutions of the same address */
+
+static const char* TAG_FANOUT = "LNS_FANOUT";
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct fanout_server_s
+{
+    struct lns_server_s       cfg;                                        /* address, ports and downlink policy */
+    int                       sock_up;                                    /* socket for upstream traffic */
+    int                       sock_down;                                  /* socket for downstream traffic */
+    uint8_t                   push_token[LNS_FANOUT_PUSH_INFLIGHT_NB][2]; /* tokens of the latest PUSH_DATA */
+    bool                      push_pending[LNS_FANOUT_PUSH_INFLIGHT_NB];  /* true while waiting for the PUSH_ACK */
+    unsigned                  push_next;                                  /* next slot of the PUSH_DATA tokens */
+    uint8_t                   pull_token[2];                              /* token of the latest PULL_DATA */
+    bool                      pull_pending;                               /* true while waiting for the PULL_ACK */
+    uint32_t                  pull_missed_cnt;                            /* PULL_DATA sent since the latest PULL_ACK */
+    struct lns_resolver_req_s resolve_req;                                /* resolution of the server address */
+    int64_t                   resolve_due_us;                             /* esp_timer time of the next resolution */
+    uint32_t                  resolve_backoff_ms;                         /* delay after the next resolution */
+    struct lns_fanout_stats_s stats;                                      /* counters, copied by lns_fanout_get_stats */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static pthread_mutex_t        mx_fanout = PTHREAD_MUTEX_INITIALIZER; /* control access to the servers state */
+static struct fanout_server_s fanout_servers[LNS_FANOUT_MAX];
+static int                    fanout_nb_servers = 0;
+static uint8_t                fanout_buff_req[12]; /* PULL_DATA, only the token changes */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void fanout_connect( struct fanout_server_s* s, int64_t now_us );
+
+static int fanout_recv( struct fanout_server_s* s, int sock, uint8_t* buff, int size );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void fanout_connect( struct fanout_server_s* s, int64_t now_us )
+{
+    struct sockaddr_in        addr_up;
+    struct sockaddr_in        addr_down;
+    enum lns_resolver_state_e state;
+    bool                      connected;
+
+    /* the sockets are connected again once the resolver thread has a new address, it only sets their peer address */
+    state = lns_resolver_result( &s->resolve_req, &addr_up, &addr_down );
+    if( state == LNS_RESOLVER_DONE )
+    {
+        connected = ( lns_connect( s->sock_up, s->sock_down, &addr_up, &addr_down ) == 0 );
+        if( connected == true )
+        {
+            s->pull_missed_cnt = 0;
+        }
+        pthread_mutex_lock( &mx_fanout );
+        s->stats.connected = connected;
+        pthread_mutex_unlock( &mx_fanout );
+    }
+    else if( state == LNS_RESOLVER_FAILED )
+    {
+        pthread_mutex_lock( &mx_fanout );
+        s->stats.nb_resolve_fail += 1;
+        pthread_mutex_unlock( &mx_fanout );
+    }
+
+    /* unreachable or silent server: its address is resolved again, less and less often while it does not answer */
+    if( ( state != LNS_RESOLVER_PENDING ) && ( now_us >= s->resolve_due_us ) &&
+        ( ( s->stats.connected == false ) || ( s->pull_missed_cnt >= RESOLVE_PULL_MISSED ) ) )
+    {
+        lns_resolver_request( &s->resolve_req, &s->cfg );
+        s->resolve_due_us = now_us + ( ( int64_t ) s->resolve_backoff_ms * 1000 );
+        s->resolve_backoff_ms *= 2;
+        if( s->resolve_backoff_ms > RESOLVE_BACKOFF_MAX_MS )
+        {
+            s->resolve_backoff_ms = RESOLVE_BACKOFF_MAX_MS;
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int fanout_recv( struct fanout_server_s* s, int sock, uint8_t* buff, int size )
+{
+    int msg_len;
+    int pull_resp_len = 0;
+    int i;
+
+    msg_len = recv( sock, ( void* ) buff, size, 0 );
+    if( ( msg_len < 4 ) || ( buff[0] != PROTOCOL_VERSION ) )
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock( &mx_fanout );
+    if( ( sock == s->sock_up ) && ( buff[3] == PKT_PUSH_ACK ) )
+    {
+        for( i = 0; i < LNS_FANOUT_PUSH_INFLIGHT_NB; i++ )
+        {
+            if( ( s->push_pending[i] == true ) && ( s->push_token[i][0] == buff[1] ) &&
+                ( s->push_token[i][1] == buff[2] ) )
+            {
+                s->push_pending[i] = false;
+                s->stats.nb_push_ack += 1;
+                break;
+            }
+        }
+    }
+    else if( ( sock == s->sock_down ) && ( buff[3] == PKT_PULL_ACK ) )
+    {
+        if( ( s->pull_pending == true ) && ( s->pull_token[0] == buff[1] ) && ( s->pull_token[1] == buff[2] ) )
+        {
+            s->pull_pending       = false;
+            s->pull_missed_cnt    = 0;
+            s->resolve_backoff_ms = RESOLVE_BACKOFF_MIN_MS;
+            s->stats.nb_pull_ack += 1;
+        }
+    }
+    else if( ( sock == s->sock_down ) && ( buff[3] == PKT_PULL_RESP ) )
+    {
+        if( s->cfg.downlink == true )
+        {
+            s->stats.nb_dw_rcv += 1;
+            pull_resp_len = msg_len;
+        }
+        else
+        {
+            s->stats.nb_dw_rejected += 1;
+            ESP_LOGW( TAG_FANOUT, "WARNING: downlink from %s dropped, not allowed\n", s->cfg.addr );
+        }
+    }
+    pthread_mutex_unlock( &mx_fanout );
+
+    return pull_resp_len;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lns_fanout_init( const struct lns_server_s* servers, int nb_servers, uint32_t net_mac_h, uint32_t net_mac_l )
+{
+    struct fanout_server_s* s;
+    int                     nb_open = 0;
+    int                     i;
+
+    fanout_buff_req[0]                     = PROTOCOL_VERSION;
+    fanout_buff_req[3]                     = PKT_PULL_DATA;
+    *( uint32_t* ) ( fanout_buff_req + 4 ) = net_mac_h;
+    *( uint32_t* ) ( fanout_buff_req + 8 ) = net_mac_l;
+
+    for( i = 0; ( i < nb_servers ) && ( i < LNS_FANOUT_MAX ); i++ )
+    {
+        s = &fanout_servers[fanout_nb_servers];
+        memset( s, 0, sizeof( struct fanout_server_s ) );
+        s->cfg = servers[i];
+        memcpy( s->stats.addr, servers[i].addr, sizeof s->stats.addr );
+        s->stats.downlink = servers[i].downlink;
+
+        s->sock_up   = socket( AF_INET, SOCK_DGRAM, 0 );
+        s->sock_down = socket( AF_INET, SOCK_DGRAM, 0 );
+        if( ( s->sock_up < 0 ) || ( s->sock_down < 0 ) )
+        {
+            ESP_LOGE( TAG_FANOUT, "ERROR: failed to open sockets for %s\n", s->cfg.addr );
+            if( s->sock_up >= 0 )
+            {
+                close( s->sock_up );
+            }
+            if( s->sock_down >= 0 )
+            {
+                close( s->sock_down );
+            }
+            continue;
+        }
+
+        /* resolved by the resolver thread, the sockets are connected at the first lns_fanout_pull after that */
+        s->resolve_backoff_ms = RESOLVE_BACKOFF_MIN_MS;
+        lns_resolver_request( &s->resolve_req, &s->cfg );
+        ESP_LOGI( TAG_FANOUT, "INFO: fan-out to %s:%s, downlinks %s", s->cfg.addr, s->cfg.port_up,
+                  ( s->cfg.downlink == true ) ? "accepted" : "dropped" );
+        fanout_nb_servers += 1;
+        nb_open += 1;
+    }
+
+    return nb_open;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_fanout_push( const uint8_t* dgram, int size )
+{
+    struct fanout_server_s* s;
+    bool                    connected;
+    int                     i;
+
+    for( i = 0; i < fanout_nb_servers; i++ )
+    {
+        s = &fanout_servers[i];
+
+        pthread_mutex_lock( &mx_fanout );
+        connected = s->stats.connected;
+        if( connected == true )
+        {
+            s->push_token[s->push_next][0] = dgram[1];
+            s->push_token[s->push_next][1] = dgram[2];
+            s->push_pending[s->push_next]  = true;
+            s->push_next                   = ( s->push_next + 1 ) % LNS_FANOUT_PUSH_INFLIGHT_NB;
+            s->stats.nb_push_sent += 1;
+        }
+        pthread_mutex_unlock( &mx_fanout );
+
+        /* same datagram for all the servers, a failure only concerns this server */
+        if( ( connected == true ) && ( send( s->sock_up, ( const void* ) dgram, size, 0 ) < 0 ) )
+        {
+            ESP_LOGW( TAG_FANOUT, "WARNING: failed to send PUSH_DATA to %s\n", s->cfg.addr );
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_fanout_pull( void )
+{
+    struct fanout_server_s* s;
+    uint8_t                 buff_req[12];
+    int64_t                 now_us;
+    int                     i;
+
+    memcpy( buff_req, fanout_buff_req, sizeof buff_req );
+    now_us = esp_timer_get_time( );
+
+    for( i = 0; i < fanout_nb_servers; i++ )
+    {
+        s = &fanout_servers[i];
+
+        if( s->pull_pending == true )
+        {
+            s->pull_missed_cnt += 1;
+        }
+        fanout_connect( s, now_us );
+        if( s->stats.connected == false )
+        {
+            continue;
+        }
+
+        buff_req[1] = ( uint8_t ) rand( );
+        buff_req[2] = ( uint8_t ) rand( );
+
+        pthread_mutex_lock( &mx_fanout );
+        s->pull_token[0] = buff_req[1];
+        s->pull_token[1] = buff_req[2];
+        s->pull_pending  = true;
+        s->stats.nb_pull_sent += 1;
+        pthread_mutex_unlock( &mx_fanout );
+
+        if( send( s->sock_down, ( void* ) buff_req, sizeof buff_req, 0 ) < 0 )
+        {
+            ESP_LOGW( TAG_FANOUT, "WARNING: failed to send PULL_DATA to %s\n", s->cfg.addr );
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_fanout_fd_set( fd_set* fds, int max_fd )
+{
+    struct fanout_server_s* s;
+    int                     i;
+
+    for( i = 0; i < fanout_nb_servers; i++ )
+    {
+        s = &fanout_servers[i];
+        if( s->stats.connected == true )
+        {
+            FD_SET( s->sock_up, fds );
+            FD_SET( s->sock_down, fds );
+            max_fd = ( s->sock_up > max_fd ) ? s->sock_up : max_fd;
+            max_fd = ( s->sock_down > max_fd ) ? s->sock_down : max_fd;
+        }
+    }
+
+    return max_fd;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_fanout_recv( const fd_set* fds, uint8_t* buff, int size, int* sock )
+{
+    struct fanout_server_s* s;
+    int                     msg_len;
+    int                     i;
+
+    /* handle all the pending acknowledges, the first PULL_RESP is returned and the next ones are left queued */
+    for( i = 0; i < fanout_nb_servers; i++ )
+    {
+        s = &fanout_servers[i];
+        if( s->stats.connected == false )
+        {
+            continue;
+        }
+        if( FD_ISSET( s->sock_up, fds ) )
+        {
+            fanout_recv( s, s->sock_up, buff, size );
+        }
+        if( FD_ISSET( s->sock_down, fds ) )
+        {
+            msg_len = fanout_recv( s, s->sock_down, buff, size );
+            if( msg_len > 0 )
+            {
+                *sock = s->sock_down;
+                return msg_len;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_fanout_get_stats( struct lns_fanout_stats_s* stats )
+{
+    int i;
+
+    pthread_mutex_lock( &mx_fanout );
+    for( i = 0; i < fanout_nb_servers; i++ )
+    {
+        stats[i] = fanout_servers[i].stats;
+    }
+    pthread_mutex_unlock( &mx_fanout );
+
+    return fanout_nb_servers;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,118 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub fan-out of the forwarded traffic to additional servers, each with its own sockets and state
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _LNS_FANOUT_H
+#define _LNS_FANOUT_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+#include <sys/select.h> /* fd_set */
+
+#include "lns_supervisor.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LNS_FANOUT_MAX 3              /* Maximum number of additional servers */
+#define LNS_FANOUT_STR_MAX_SIZE 200   /* Maximum size of the additional servers string, null char included */
+#define LNS_FANOUT_PUSH_INFLIGHT_NB 4 /* Number of PUSH_DATA tracked per server while waiting for their PUSH_ACK */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct lns_fanout_stats_s
+{
+    char     addr[LNS_SERVER_ADDR_STR_MAX_SIZE]; /* host name or IPv4 address of the server */
+    bool     downlink;                           /* true if the downlinks sent by this server are accepted */
+    bool     connected;                          /* true once the server address has been resolved */
+    uint32_t nb_resolve_fail;                    /* number of failed DNS resolutions */
+    uint32_t nb_push_sent;                       /* number of PUSH_DATA sent */
+    uint32_t nb_push_ack;                        /* number of PUSH_DATA acknowledged */
+    uint32_t nb_pull_sent;                       /* number of PULL_DATA sent */
+    uint32_t nb_pull_ack;                        /* number of PULL_DATA acknowledged */
+    uint32_t nb_dw_rcv;                          /* number of PULL_RESP accepted */
+    uint32_t nb_dw_rejected;                     /* number of PULL_RESP dropped by the downlink policy */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Open and connect the sockets of the additional servers
+@param servers pointer to the additional servers
+@param nb_servers number of additional servers, up to LNS_FANOUT_MAX
+@param net_mac_h most significant nibble of the gateway ID, network order
+@param net_mac_l least significant nibble of the gateway ID, network order
+@return the number of servers whose sockets could be opened
+
+The addresses are only requested to the resolver thread, which must be started first. The servers are skipped until
+lns_fanout_pull finds their address resolved.
+*/
+int lns_fanout_init( const struct lns_server_s* servers, int nb_servers, uint32_t net_mac_h, uint32_t net_mac_l );
+
+/**
+@brief Send a copy of a PUSH_DATA datagram to all the additional servers
+@param dgram pointer to the datagram, serialized once for all the servers
+@param size size of the datagram
+
+The token of the datagram is tracked per server, to match the PUSH_ACK of each server.
+*/
+void lns_fanout_push( const uint8_t* dgram, int size );
+
+/**
+@brief Send a PULL_DATA to all the additional servers, each with its own token
+
+The sockets of a server whose address was resolved meanwhile are connected first, this does not block. The address of
+a server not resolved yet, or which did not acknowledge the last 3 PULL_DATA, is requested again to the resolver thread,
+with a backoff delay doubling from 10 seconds up to 10 minutes until the server acknowledges.
+*/
+void lns_fanout_pull( void );
+
+/**
+@brief Add the sockets of the additional servers to a set of sockets to be watched
+@param fds pointer to the set of sockets, updated
+@param max_fd highest socket of the set before the call
+@return the highest socket of the set after the call
+
+Only the servers whose address is resolved are watched.
+*/
+int lns_fanout_fd_set( fd_set* fds, int max_fd );
+
+/**
+@brief Handle the datagrams pending on the sockets of the additional servers
+@param fds pointer to the set of readable sockets, as returned by select
+@param buff pointer to the buffer receiving a PULL_RESP
+@param size size of the buffer
+@param sock pointer to the downstream socket of the server which sent the PULL_RESP, for its TX_ACK
+@return the size of the PULL_RESP received from a server allowed to send downlinks, 0 if there is none
+
+The PUSH_ACK and PULL_ACK are matched with the tokens of the server they were received from. The PULL_RESP of the
+servers not allowed to send downlinks are counted and dropped.
+*/
+int lns_fanout_recv( const fd_set* fds, uint8_t* buff, int size, int* sock );
+
+/**
+@brief Get the state and counters of the additional servers
+@param stats pointer to an array of at least LNS_FANOUT_MAX structures to be filled
+@return the number of additional servers
+*/
+int lns_fanout_get_stats( struct lns_fanout_stats_s* stats );
+
+#endif  // _LNS_FANOUT_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,162 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub server address resolver, running the blocking DNS resolutions in its own thread
+
+    getaddrinfo can block for seconds when the DNS server is unreachable. The requests of the network thread are
+    queued here, and their results polled, so that its event loop never waits for a resolution.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <pthread.h>
+
+#include <esp_log.h>
+
+#include "lns_resolver.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static pthread_mutex_t mx_resolver = PTHREAD_MUTEX_INITIALIZER; /* control access to the requests and their queue */
+static pthread_cond_t  cv_resolver = PTHREAD_COND_INITIALIZER;  /* signaled when a request is queued */
+static struct lns_resolver_req_s* resolver_queue[LNS_RESOLVER_REQ_MAX]; /* requests pending, oldest first */
+static int                        resolver_nb_queued = 0;
+
+static const char* TAG_RESOLVER = "LNS_RESOLVER";
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static bool queue_push( struct lns_resolver_req_s* req );
+
+static void thread_resolver( void );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* to be called with mx_resolver locked, a request is queued at most once */
+static bool queue_push( struct lns_resolver_req_s* req )
+{
+    if( resolver_nb_queued >= LNS_RESOLVER_REQ_MAX )
+    {
+        return false;
+    }
+    resolver_queue[resolver_nb_queued] = req;
+    resolver_nb_queued += 1;
+    pthread_cond_signal( &cv_resolver );
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void thread_resolver( void )
+{
+    struct lns_resolver_req_s* req;
+    struct lns_server_s        server;
+    struct sockaddr_in         addr_up;
+    struct sockaddr_in         addr_down;
+    uint32_t                   seq;
+    int                        i;
+
+    while( true )
+    {
+        pthread_mutex_lock( &mx_resolver );
+        while( resolver_nb_queued == 0 )
+        {
+            pthread_cond_wait( &cv_resolver, &mx_resolver );
+        }
+        req = resolver_queue[0];
+        resolver_nb_queued -= 1;
+        for( i = 0; i < resolver_nb_queued; i++ )
+        {
+            resolver_queue[i] = resolver_queue[i + 1];
+        }
+        server = req->server;
+        seq    = req->seq;
+        pthread_mutex_unlock( &mx_resolver );
+
+        i = lns_resolve( &server, &addr_up, &addr_down );
+
+        pthread_mutex_lock( &mx_resolver );
+        if( req->seq != seq )
+        {
+            queue_push( req ); /* requested again for another server meanwhile, the slot just freed is reused */
+        }
+        else
+        {
+            req->addr_up   = addr_up;
+            req->addr_down = addr_down;
+            req->state     = ( i == 0 ) ? LNS_RESOLVER_DONE : LNS_RESOLVER_FAILED;
+        }
+        pthread_mutex_unlock( &mx_resolver );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lns_resolver_start( void )
+{
+    pthread_t thrid_resolver;
+
+    if( pthread_create( &thrid_resolver, NULL, ( void* ( * ) ( void* ) ) thread_resolver, NULL ) != 0 )
+    {
+        ESP_LOGE( TAG_RESOLVER, "ERROR: impossible to create the resolver thread\n" );
+        return -1;
+    }
+    pthread_detach( thrid_resolver );
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_resolver_request( struct lns_resolver_req_s* req, const struct lns_server_s* server )
+{
+    pthread_mutex_lock( &mx_resolver );
+    req->server = *server;
+    req->seq += 1;
+    if( req->state != LNS_RESOLVER_PENDING )
+    {
+        req->state = ( queue_push( req ) == true ) ? LNS_RESOLVER_PENDING : LNS_RESOLVER_FAILED;
+    }
+    pthread_mutex_unlock( &mx_resolver );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum lns_resolver_state_e lns_resolver_result( struct lns_resolver_req_s* req, struct sockaddr_in* addr_up,
+                                               struct sockaddr_in* addr_down )
+{
+    enum lns_resolver_state_e state;
+
+    pthread_mutex_lock( &mx_resolver );
+    state = req->state;
+    if( state == LNS_RESOLVER_DONE )
+    {
+        *addr_up   = req->addr_up;
+        *addr_down = req->addr_down;
+    }
+    if( ( state == LNS_RESOLVER_DONE ) || ( state == LNS_RESOLVER_FAILED ) )
+    {
+        req->state = LNS_RESOLVER_IDLE;
+    }
+    pthread_mutex_unlock( &mx_resolver );
+
+    return state;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,84 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub server address resolver, running the blocking DNS resolutions in its own thread
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _LNS_RESOLVER_H
+#define _LNS_RESOLVER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+#include <netinet/in.h> /* sockaddr_in */
+
+#include "lns_supervisor.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LNS_RESOLVER_REQ_MAX 4 /* Maximum number of requests pending together, one per server in use */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+enum lns_resolver_state_e
+{
+    LNS_RESOLVER_IDLE,    /* no resolution requested, or its result already read */
+    LNS_RESOLVER_PENDING, /* resolution queued or in progress */
+    LNS_RESOLVER_DONE,    /* address resolved, not read yet */
+    LNS_RESOLVER_FAILED   /* address not resolved, not read yet */
+};
+
+/* resolution request, owned by the caller and only accessed through the functions below */
+struct lns_resolver_req_s
+{
+    struct lns_server_s       server;    /* server to be resolved */
+    enum lns_resolver_state_e state;     /* state of the latest request */
+    uint32_t                  seq;       /* incremented at each request, to discard the result of a previous one */
+    struct sockaddr_in        addr_up;   /* resolved address for upstream traffic */
+    struct sockaddr_in        addr_down; /* resolved address for downstream traffic */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Start the resolver thread
+@return 0 if the thread is running, -1 else
+*/
+int lns_resolver_start( void );
+
+/**
+@brief Request the resolution of a server address, without blocking
+@param req pointer to the request, initialized to zero before its first use
+@param server pointer to the server to be resolved, copied
+
+A request still pending is updated with the new server, the result of the previous server is discarded.
+*/
+void lns_resolver_request( struct lns_resolver_req_s* req, const struct lns_server_s* server );
+
+/**
+@brief Get the result of a resolution request, without blocking
+@param req pointer to the request
+@param addr_up pointer to the address for upstream traffic, filled if the resolution is done
+@param addr_down pointer to the address for downstream traffic, filled if the resolution is done
+@return the state of the request, back to LNS_RESOLVER_IDLE once a result is returned
+*/
+enum lns_resolver_state_e lns_resolver_result( struct lns_resolver_req_s* req, struct sockaddr_in* addr_up,
+                                               struct sockaddr_in* addr_down );
+
+#endif  // _LNS_RESOLVER_H
+
+/* --- EOF ------------------------------------------------------------------ */
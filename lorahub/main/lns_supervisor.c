@@ -0,0 +1,323 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub connection supervisor, (re)connecting the forwarder sockets to the primary or fallback servers
+
+    The UDP sockets are created once and connected again to the new server address, instead of being closed and
+    opened again, so the threads using them are not disturbed.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* snprintf */
+#include <stdlib.h>  /* rand, strtoul */
+#include <string.h>  /* memset, memcpy, strcspn, strncmp */
+#include <pthread.h>
+
+#include <sys/socket.h>
+#include <netdb.h>
+#include <arpa/inet.h> /* inet_ntoa */
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include "lns_supervisor.h"
+#include "lns_resolver.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define BACKOFF_MIN_MS 1000  /* delay before the first reconnection */
+#define BACKOFF_MAX_MS 60000 /* maximum delay between two reconnections */
+
+static const char* TAG_LNS = "LNS_SUPERVISOR";
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static pthread_mutex_t     mx_lns = PTHREAD_MUTEX_INITIALIZER; /* control access to the connection state */
+static struct lns_server_s lns_servers[LNS_SERVERS_MAX];
+static int                 lns_nb_servers      = 0;
+static int                 lns_sock_up         = -1;
+static int                 lns_sock_down       = -1;
+static int                 lns_idx             = 0;     /* index of the server in use */
+static bool                lns_retried         = false; /* true if the server in use was already resolved again */
+static bool                lns_acked           = false; /* true once the server in use acknowledged */
+static int64_t             lns_acked_us        = 0;     /* esp_timer time of the first acknowledge */
+static uint32_t            lns_backoff_ms      = BACKOFF_MIN_MS;
+static uint32_t            lns_nb_reconnect    = 0;
+static uint32_t            lns_nb_resolve_fail = 0;
+
+static struct lns_resolver_req_s lns_resolve_req; /* resolution of the server selected for the next connection */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static int connect_server( int idx );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int connect_server( int idx )
+{
+    struct sockaddr_in addr_up;
+    struct sockaddr_in addr_down;
+
+    /* both sockets are only connected once the address is resolved, so that they always point to the same server */
+    if( lns_resolve( &lns_servers[idx], &addr_up, &addr_down ) != 0 )
+    {
+        pthread_mutex_lock( &mx_lns );
+        lns_nb_resolve_fail += 1;
+        pthread_mutex_unlock( &mx_lns );
+        return -1;
+    }
+
+    return lns_connect( lns_sock_up, lns_sock_down, &addr_up, &addr_down );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int lns_resolve( const struct lns_server_s* server, struct sockaddr_in* addr_up, struct sockaddr_in* addr_down )
+{
+    struct addrinfo  hints;
+    struct addrinfo* result;
+    int              i;
+
+    memset( &hints, 0, sizeof hints );
+    hints.ai_family   = AF_INET; /* WA: Forcing IPv4 as AF_UNSPEC makes connection on localhost to fail */
+    hints.ai_socktype = SOCK_DGRAM;
+
+    /* the address is resolved at each connection, DNS caching is left to the IP stack */
+    i = getaddrinfo( server->addr, server->port_up, &hints, &result );
+    if( ( i != 0 ) || ( result == NULL ) )
+    {
+        ESP_LOGW( TAG_LNS, "WARNING: getaddrinfo on address %s (PORT %s) returned %d\n", server->addr,
+                  server->port_up, i );
+        return -1;
+    }
+    memcpy( addr_up, result->ai_addr, sizeof( struct sockaddr_in ) );
+    freeaddrinfo( result );
+
+    *addr_down          = *addr_up;
+    addr_down->sin_port = htons( ( uint16_t ) strtoul( server->port_down, NULL, 10 ) );
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_connect( int sock_up, int sock_down, const struct sockaddr_in* addr_up, const struct sockaddr_in* addr_down )
+{
+    if( ( connect( sock_up, ( const struct sockaddr* ) addr_up, sizeof( struct sockaddr_in ) ) != 0 ) ||
+        ( connect( sock_down, ( const struct sockaddr* ) addr_down, sizeof( struct sockaddr_in ) ) != 0 ) )
+    {
+        ESP_LOGW( TAG_LNS, "WARNING: connect to %s failed\n", inet_ntoa( addr_up->sin_addr ) );
+        return -1;
+    }
+    ESP_LOGI( TAG_LNS, "INFO: connected to %s, ports %u/%u", inet_ntoa( addr_up->sin_addr ), ntohs( addr_up->sin_port ),
+              ntohs( addr_down->sin_port ) );
+
+    return 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_parse_servers( const char* str, const char* default_port, struct lns_server_s* servers, int max_nb )
+{
+    int           nb_servers = 0;
+    int           len;
+    int           host_len;
+    const char*   colon;
+    char*         end;
+    unsigned long port;
+
+    while( *str != '\0' )
+    {
+        len = strcspn( str, " ," );
+        if( len == 0 )
+        {
+            str += 1; /* separator */
+            continue;
+        }
+        if( nb_servers >= max_nb )
+        {
+            ESP_LOGE( TAG_LNS, "ERROR: more than %d servers\n", max_nb );
+            return -1;
+        }
+
+        /* optional downlink acceptance prefix */
+        servers[nb_servers].downlink = ( strncmp( str, "dl:", 3 ) == 0 );
+        if( servers[nb_servers].downlink == true )
+        {
+            str += 3;
+            len -= 3;
+        }
+
+        /* optional port after a colon */
+        colon    = memchr( str, ':', len );
+        host_len = ( colon != NULL ) ? ( int ) ( colon - str ) : len;
+        if( ( host_len == 0 ) || ( host_len >= LNS_SERVER_ADDR_STR_MAX_SIZE ) )
+        {
+            ESP_LOGE( TAG_LNS, "ERROR: invalid server \"%.*s\"\n", len, str );
+            return -1;
+        }
+        memcpy( servers[nb_servers].addr, str, host_len );
+        servers[nb_servers].addr[host_len] = '\0';
+        if( colon != NULL )
+        {
+            port = strtoul( colon + 1, &end, 10 );
+            if( ( end != ( str + len ) ) || ( end == ( colon + 1 ) ) || ( port == 0 ) || ( port > 65535 ) )
+            {
+                ESP_LOGE( TAG_LNS, "ERROR: invalid port in \"%.*s\"\n", len, str );
+                return -1;
+            }
+            snprintf( servers[nb_servers].port_up, LNS_SERVER_PORT_STR_MAX_SIZE, "%lu", port );
+        }
+        else
+        {
+            snprintf( servers[nb_servers].port_up, LNS_SERVER_PORT_STR_MAX_SIZE, "%s", default_port );
+        }
+        strcpy( servers[nb_servers].port_down, servers[nb_servers].port_up );
+
+        nb_servers += 1;
+        str += len;
+    }
+
+    return nb_servers;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_supervisor_init( const struct lns_server_s* servers, int nb_servers, int sock_up, int sock_down )
+{
+    pthread_mutex_lock( &mx_lns );
+    memcpy( lns_servers, servers, nb_servers * sizeof( struct lns_server_s ) );
+    lns_nb_servers = nb_servers;
+    lns_sock_up    = sock_up;
+    lns_sock_down  = sock_down;
+    lns_idx        = 0;
+    lns_retried    = false;
+    lns_acked      = false;
+    lns_backoff_ms = BACKOFF_MIN_MS;
+    pthread_mutex_unlock( &mx_lns );
+
+    ESP_LOGI( TAG_LNS, "%d server(s) configured, primary %s", nb_servers, servers[0].addr );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_supervisor_connect( void )
+{
+    int idx;
+
+    for( idx = 0; idx < lns_nb_servers; idx++ )
+    {
+        if( connect_server( idx ) == 0 )
+        {
+            pthread_mutex_lock( &mx_lns );
+            lns_idx = idx;
+            pthread_mutex_unlock( &mx_lns );
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+uint32_t lns_supervisor_next( void )
+{
+    uint32_t delay_ms;
+    int      idx;
+
+    pthread_mutex_lock( &mx_lns );
+    /* the server in use is retried once, then the next servers are tried once each until one acknowledges */
+    if( lns_retried == true )
+    {
+        lns_idx = ( lns_idx + 1 ) % lns_nb_servers;
+    }
+    lns_retried = ( lns_nb_servers > 1 );
+    idx         = lns_idx;
+    lns_acked   = false;
+    lns_nb_reconnect += 1;
+
+    /* random jitter of up to a quarter of the delay, so that hubs cut off together do not retry together */
+    delay_ms       = lns_backoff_ms + ( ( uint32_t ) rand( ) % ( ( lns_backoff_ms / 4 ) + 1 ) );
+    lns_backoff_ms = ( ( 2 * lns_backoff_ms ) < BACKOFF_MAX_MS ) ? ( 2 * lns_backoff_ms ) : BACKOFF_MAX_MS;
+    pthread_mutex_unlock( &mx_lns );
+
+    /* resolved in background during the backoff delay */
+    lns_resolver_request( &lns_resolve_req, &lns_servers[idx] );
+    ESP_LOGW( TAG_LNS, "WARNING: connecting to server %d (%s) in %lu ms\n", idx, lns_servers[idx].addr, delay_ms );
+
+    return delay_ms;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int lns_supervisor_reconnect( void )
+{
+    struct sockaddr_in addr_up;
+    struct sockaddr_in addr_down;
+
+    switch( lns_resolver_result( &lns_resolve_req, &addr_up, &addr_down ) )
+    {
+    case LNS_RESOLVER_DONE:
+        return lns_connect( lns_sock_up, lns_sock_down, &addr_up, &addr_down );
+    case LNS_RESOLVER_PENDING:
+        return 1;
+    default:
+        pthread_mutex_lock( &mx_lns );
+        lns_nb_resolve_fail += 1;
+        pthread_mutex_unlock( &mx_lns );
+        return -1;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_supervisor_ack( void )
+{
+    pthread_mutex_lock( &mx_lns );
+    if( lns_acked == false )
+    {
+        lns_acked      = true;
+        lns_acked_us   = esp_timer_get_time( );
+        lns_retried    = false;
+        lns_backoff_ms = BACKOFF_MIN_MS;
+        ESP_LOGI( TAG_LNS, "INFO: server %d (%s) acknowledged", lns_idx, lns_servers[lns_idx].addr );
+    }
+    pthread_mutex_unlock( &mx_lns );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void lns_supervisor_get_stats( struct lns_supervisor_stats_s* stats )
+{
+    pthread_mutex_lock( &mx_lns );
+    stats->server_idx      = lns_idx;
+    stats->uptime_s        = 0;
+    if( lns_acked == true )
+    {
+        stats->uptime_s = ( uint32_t ) ( ( esp_timer_get_time( ) - lns_acked_us ) / 1000000 );
+    }
+    stats->nb_reconnect    = lns_nb_reconnect;
+    stats->nb_resolve_fail = lns_nb_resolve_fail;
+    stats->backoff_ms      = lns_backoff_ms;
+    pthread_mutex_unlock( &mx_lns );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
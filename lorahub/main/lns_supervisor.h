@@ -0,0 +1,140 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub connection supervisor, (re)connecting the forwarder sockets to the primary or fallback servers
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _LNS_SUPERVISOR_H
+#define _LNS_SUPERVISOR_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+#include <netinet/in.h> /* sockaddr_in */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define LNS_SERVERS_MAX 4               /* Primary server and up to 3 fallback servers */
+#define LNS_SERVER_ADDR_STR_MAX_SIZE 64 /* Maximum size of a server address, null char included */
+#define LNS_SERVER_PORT_STR_MAX_SIZE 8  /* Maximum size of a server port, null char included */
+#define LNS_FALLBACKS_STR_MAX_SIZE 200  /* Maximum size of the fallback servers string, null char included */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct lns_server_s
+{
+    char addr[LNS_SERVER_ADDR_STR_MAX_SIZE];      /* host name or IPv4 address */
+    char port_up[LNS_SERVER_PORT_STR_MAX_SIZE];   /* port for upstream traffic */
+    char port_down[LNS_SERVER_PORT_STR_MAX_SIZE]; /* port for downstream traffic */
+    bool downlink;                                /* true if the downlinks sent by this server are accepted */
+};
+
+struct lns_supervisor_stats_s
+{
+    int      server_idx;      /* index of the server in use, 0 for the primary server */
+    uint32_t uptime_s;        /* time since the server in use first acknowledged, 0 while not acknowledged */
+    uint32_t nb_reconnect;    /* number of reconnections since boot */
+    uint32_t nb_resolve_fail; /* number of failed DNS resolutions since boot */
+    uint32_t backoff_ms;      /* delay before the next reconnection */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Parse a list of servers
+@param str list of "host" or "host:port" entries, separated by spaces or commas, prefixed by "dl:" if the downlinks
+sent by the server are accepted
+@param default_port port used for the entries without port
+@param servers pointer to an array of at least max_nb servers, filled in order
+@param max_nb maximum number of entries
+@return the number of servers parsed, -1 if an entry is invalid or if there are too many entries
+*/
+int lns_parse_servers( const char* str, const char* default_port, struct lns_server_s* servers, int max_nb );
+
+/**
+@brief Resolve the address of a server, for its upstream and downstream ports
+@param server pointer to the server
+@param addr_up pointer to the address for upstream traffic, filled
+@param addr_down pointer to the address for downstream traffic, filled
+@return 0 if the address is resolved, -1 else
+
+The host name is resolved once, only the port differs between both addresses. The DNS resolution blocks.
+*/
+int lns_resolve( const struct lns_server_s* server, struct sockaddr_in* addr_up, struct sockaddr_in* addr_down );
+
+/**
+@brief Connect the UDP sockets of a server to its resolved addresses
+@param sock_up UDP socket for upstream traffic, already connected or not
+@param sock_down UDP socket for downstream traffic, already connected or not
+@param addr_up pointer to the address for upstream traffic
+@param addr_down pointer to the address for downstream traffic
+@return 0 if both sockets are connected, -1 else
+
+This function does not block, connecting a UDP socket only sets its peer address.
+*/
+int lns_connect( int sock_up, int sock_down, const struct sockaddr_in* addr_up, const struct sockaddr_in* addr_down );
+
+/**
+@brief Set the servers and the sockets to be supervised
+@param servers pointer to the servers, by order of preference, the primary server first
+@param nb_servers number of servers, up to LNS_SERVERS_MAX
+@param sock_up UDP socket for upstream traffic
+@param sock_down UDP socket for downstream traffic
+*/
+void lns_supervisor_init( const struct lns_server_s* servers, int nb_servers, int sock_up, int sock_down );
+
+/**
+@brief Connect the sockets to the first server which can be resolved, by order of preference
+@return 0 if the sockets are connected, -1 if no server address could be resolved
+*/
+int lns_supervisor_connect( void );
+
+/**
+@brief Select the server of the next connection attempt, after a server stopped acknowledging or could not be resolved
+@return the backoff delay to wait before calling lns_supervisor_reconnect, in milliseconds
+
+The address of the server in use is resolved again first, so that a change of its IP address is followed. Then the
+next servers of the list are tried once each, in order, back to the primary server after the last one. The backoff
+delay doubles at each attempt, up to one minute. The server in use, the backoff delay and the first retry are reset by
+lns_supervisor_ack. The address of the selected server is requested to the resolver thread, which must be started
+first, so that it is resolved during the backoff delay.
+*/
+uint32_t lns_supervisor_next( void );
+
+/**
+@brief Connect the sockets again to the server selected by lns_supervisor_next, once its address is resolved
+@return 0 if the sockets are connected, 1 if the address is not resolved yet, -1 if it could not be resolved
+
+The sockets are connected again in place, so the threads using them keep running. This function does not block, the
+caller calls it again a bit later while the resolution is pending. The backoff delay is left to the caller.
+*/
+int lns_supervisor_reconnect( void );
+
+/**
+@brief Signal that the server in use acknowledged a request
+*/
+void lns_supervisor_ack( void );
+
+/**
+@brief Get the connection state and counters
+@param stats pointer to the structure to be filled
+*/
+void lns_supervisor_get_stats( struct lns_supervisor_stats_s* stats );
+
+#endif  // _LNS_SUPERVISOR_H
+
+/* --- EOF ------------------------------------------------------------------ */
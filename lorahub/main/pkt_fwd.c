@@ -17,21 +17,25 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 #include <stdint.h>  /* C99 types */
 #include <stdbool.h> /* bool type */
-#include <time.h>    /* time, clock_gettime, strftime, gmtime */
+#include <time.h>    /* time, strftime, gmtime */
 #include <stdlib.h>  /* atoi, exit */
-#include <math.h>    /* modf */
+#include <math.h>    /* modf, lroundf */
 
 #include <sys/types.h>
 #include <sys/socket.h> /* socket specific definitions */
+#include <sys/time.h>   /* gettimeofday */
+#include <sys/select.h> /* select */
 #include <netdb.h>
 #include <arpa/inet.h> /* IP address conversion stuff */
 #include <pthread.h>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 
 #include <esp_log.h>
 #include <esp_pthread.h>
+#include <esp_timer.h>
 
 #include <nvs_flash.h>
 
@@ -39,9 +43,18 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #include "pkt_fwd.h"
 #include "trace.h"
 #include "jitqueue.h"
-#include "parson.h"
 #include "base64.h"
+#include "rxpk_serializer.h"
+#include "txpk_parser.h"
+#include "dev_stats.h"
+#include "uplink_filter.h"
+#include "uplink_store.h"
+#include "lns_supervisor.h"
+#include "lns_fanout.h"
+#include "lns_resolver.h"
+#include "stats_counter.h"
 #include "lorahub_hal.h"
+#include "lorahub_trace.h"
 
 /* Services */
 #include "display.h"
@@ -64,12 +77,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define DEFAULT_PORT_DW 1700
 #define DEFAULT_KEEPALIVE 10 /* default time interval for downstream keep-alive packet */
 #define DEFAULT_STAT 30      /* default time interval for statistics */
-#define PUSH_TIMEOUT_MS 100
-#define PULL_TIMEOUT_MS 200
-#define FETCH_SLEEP_MS 10 /* nb of ms waited when a fetch return no packets */
+#define PUSH_TIMEOUT_MS 100  /* a PUSH_ACK received later than this is counted as late */
+#define FETCH_WAIT_MS 1000 /* max nb of ms waited for a radio interrupt when a fetch return no packets */
+#define JIT_WAIT_MS 1000   /* max nb of ms the JIT thread sleeps before checking for exit */
+#define NET_WAIT_MS 1000   /* max nb of ms the network thread waits on the sockets before checking for exit */
+#define JIT_DOWN_GUARD_MS 50 /* packets to be handed to the radio within this delay are dispatched before a PULL_RESP */
 
 #define PROTOCOL_VERSION 2 /* v1.3 */
-#define PROTOCOL_JSON_RXPK_FRAME_FORMAT 1
 
 #define PKT_PUSH_DATA 0
 #define PKT_PUSH_ACK 1
@@ -78,21 +92,97 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 #define PKT_PULL_ACK 4
 #define PKT_TX_ACK 5
 
-#define NB_PKT_MAX 1 /* max number of packets per fetch/send cycle */
+#define NB_PKT_MAX 8 /* max number of packets staged and sent per PUSH_DATA datagram */
 
-#define STATUS_SIZE 200
-#define TX_BUFF_SIZE ( ( 540 * NB_PKT_MAX ) + 30 + STATUS_SIZE )
+#define RXPK_MAX_SIZE 540      /* worst case size of a serialized rxpk object */
+#define RXPK_OVERHEAD_SIZE 200 /* worst case size of a serialized rxpk object, base64 payload excluded */
+#define RXPK_TIME_SIZE 40      /* worst case size of the "time" field added to the replayed rxpk objects */
+#define STATUS_SIZE 544 /* worst case size of the status report, with the filtering, store, connection and RTT fields */
+#define TX_BUFF_SIZE ( ( ( RXPK_MAX_SIZE + RXPK_TIME_SIZE ) * NB_PKT_MAX ) + 30 + STATUS_SIZE )
 #define ACK_BUFF_SIZE 64
+#define PULL_RESP_MAX_SIZE 1000 /* max size of a PULL_RESP datagram, string terminator included */
+
+#define DOWN_QUEUE_NB 4 /* max number of PULL_RESP waiting to be processed by the JIT thread */
+
+#define PUSH_INFLIGHT_NB 8     /* max number of PUSH_DATA tracked while waiting for their PUSH_ACK */
+#define PUSH_RTT_SAMPLES_NB 64 /* max number of PUSH_ACK round-trip times kept per statistics interval */
+
+#define BACKHAUL_UNACKED_MAX 3 /* nb of PUSH_DATA sent without any PUSH_ACK before the server is deemed unreachable */
+
+#define RECONNECT_PULL_MISSED 3 /* nb of PULL_DATA sent without any PULL_ACK before reconnecting to the server */
+#define RECONNECT_POLL_MS 100   /* delay between two checks of a DNS resolution not done at the reconnection time */
+
+#define JIT_DELAY_HIST_NB 8 /* number of ranges of the JIT hand-off delay histogram */
+
+#define HIST_RTT_NB 10        /* number of buckets of the PUSH_ACK and PULL_ACK round-trip time histograms */
+#define HIST_UP_LATENCY_NB 11 /* number of buckets of the radio IRQ to forward latency histogram */
+#define HIST_JIT_LEAD_NB 9    /* number of buckets of the JIT lead time histogram */
+#define HIST_LGW_SEND_NB 9    /* number of buckets of the lgw_send duration histogram */
+#define HIST_JIT_DEPTH_NB 8   /* number of buckets of the JIT queue depth histogram */
+
+#define METRIC_LINE_SIZE 256 /* max size of a line of the OpenMetrics exposition */
 
 /* ESP32 logging tags */
 static const char* TAG_PKT_FWD = "lora-pkt-fwd";
 static const char* TAG_UP      = "th_up";
 static const char* TAG_DOWN    = "th_down";
+static const char* TAG_NET     = "th_net";
 static const char* TAG_JIT     = "th_jit";
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE TYPES -------------------------------------------------------- */
 
+/* PUSH_DATA datagram sent, waiting for its PUSH_ACK */
+struct push_inflight_s
+{
+    bool     pending;            /* true until the matching PUSH_ACK is received */
+    uint8_t  token_h;            /* token of the PUSH_DATA datagram */
+    uint8_t  token_l;            /* token of the PUSH_DATA datagram */
+    uint32_t send_count_us;      /* internal counter value when the datagram was sent */
+    uint8_t  nb_pkt;             /* number of radio packets of the datagram, stored ones excluded */
+    uint32_t pkt_id[NB_PKT_MAX]; /* radio IRQ timestamp of these packets, identifying them in the latency trace */
+};
+
+/* PULL_RESP received by the network thread, waiting to be processed by the JIT thread */
+struct pull_resp_msg_s
+{
+    int64_t rx_us;                    /* esp_timer time of the reception of the datagram */
+    int     sock;                     /* downstream socket of the server which sent it, for its TX_ACK */
+    int     size;                     /* size of the datagram */
+    uint8_t buff[PULL_RESP_MAX_SIZE]; /* datagram */
+};
+
+/* cumulative counter exported in the metrics, the samples of a family being consecutive. The sums of durations are
+ * not exported, 32 bits of microseconds wrap within hours */
+struct metric_counter_s
+{
+    const char*             name;    /* name of the family, without the _total suffix */
+    const char*             labels;  /* label set of the sample, empty if none */
+    const char*             help;    /* description of the family, only given with its first sample */
+    struct stats_counter_s* counter; /* counter of the sample */
+};
+
+/* histogram exported in the metrics */
+struct metric_hist_s
+{
+    const char*             name;      /* name of the family */
+    const char*             help;      /* description of the family */
+    const uint32_t*         bounds;    /* inclusive upper bounds of the buckets, the last bucket is unbounded */
+    int                     nb_bounds; /* number of bounds */
+    double                  scale;     /* factor from the accounted values to the unit of the family */
+    struct stats_counter_s* buckets;   /* nb_bounds + 1 counters, one per bucket */
+};
+
+/* events updating the backhaul state */
+enum backhaul_event_e
+{
+    BACKHAUL_EVT_ACK,         /* PUSH_ACK or PULL_ACK received */
+    BACKHAUL_EVT_PUSH_SENT,   /* PUSH_DATA sent */
+    BACKHAUL_EVT_SEND_ERROR,  /* datagram could not be sent */
+    BACKHAUL_EVT_PULL_MISSED, /* PULL_DATA not acknowledged before the next one */
+    BACKHAUL_EVT_NB
+};
+
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
 
@@ -111,6 +201,21 @@ static char     serv_port_up[8]   = STR( CONFIG_NETWORK_SERVER_PORT ); /* server
 static char     serv_port_down[8] = STR( CONFIG_NETWORK_SERVER_PORT ); /* server port for downstream traffic */
 static int      keepalive_time = DEFAULT_KEEPALIVE; /* send a PULL_DATA request every X seconds, negative = disabled */
 
+/* uplink coalescing configuration variables */
+static uint8_t  push_max_pkt   = CONFIG_PUSH_DATA_MAX_PKT;   /* max number of rxpk per PUSH_DATA datagram */
+static uint16_t push_max_bytes = CONFIG_PUSH_DATA_MAX_BYTES; /* max estimated size of the rxpk array of a datagram */
+static uint32_t push_hold_us   = CONFIG_PUSH_DATA_HOLD_US;   /* max time an uplink is held waiting for others */
+
+/* store-and-forward configuration variable */
+static uint32_t replay_interval_us = CONFIG_UPLINK_STORE_REPLAY_MS * 1000; /* min time between 2 replay datagrams */
+
+/* fallback and additional servers configuration variables */
+static char lns_fallbacks_str[LNS_FALLBACKS_STR_MAX_SIZE] = CONFIG_NETWORK_SERVER_FALLBACKS; /* "host[:port]" list */
+static char lns_fanout_str[LNS_FANOUT_STR_MAX_SIZE]       = CONFIG_NETWORK_SERVER_FANOUT; /* "[dl:]host[:port]" list */
+
+/* uplink filtering configuration variables */
+static char uplink_filter_str[UPLINK_FILTER_STR_MAX_SIZE] = CONFIG_UPLINK_FILTER; /* filtering rules */
+
 /* statistics collection configuration variables */
 static unsigned stat_interval =
     DEFAULT_STAT; /* time interval (in sec) at which statistics are collected and displayed */
@@ -124,53 +229,144 @@ static uint8_t  wifi_mac_addr[6] = { 0 };
 static int sock_up;   /* socket for upstream traffic */
 static int sock_down; /* socket for downstream traffic */
 
-/* network protocol variables */
-static struct timeval push_timeout_half = { 0, ( PUSH_TIMEOUT_MS * 500 ) };  /* cut in half, critical for throughput */
-static struct timeval pull_timeout      = { 0, ( PULL_TIMEOUT_MS * 1000 ) }; /* non critical for throughput */
+/* PULL_RESP handed from the network thread to the JIT thread, copied by value */
+static QueueHandle_t dw_queue = NULL;
+
+/* PUSH_DATA waiting for acknowledgement, oldest entries are overwritten first */
+static pthread_mutex_t        mx_push_inflight = PTHREAD_MUTEX_INITIALIZER; /* control access to the in-flight table */
+static struct push_inflight_s push_inflight[PUSH_INFLIGHT_NB];
+static unsigned               push_inflight_next = 0; /* index of the next slot to be filled */
+
+/* backhaul state, the uplinks are stored while the server is unreachable and replayed once it is back */
+static pthread_mutex_t mx_backhaul         = PTHREAD_MUTEX_INITIALIZER; /* control access to the backhaul state */
+static bool            backhaul_up         = true; /* false while the server is deemed unreachable */
+static uint32_t        backhaul_unacked_nb = 0;    /* number of PUSH_DATA sent since the latest PUSH_ACK */
 
 /* hardware access control and correction */
 pthread_mutex_t mx_concent = PTHREAD_MUTEX_INITIALIZER; /* control access to the concentrator */
 
-/* measurements to establish statistics */
-static pthread_mutex_t mx_meas_up       = PTHREAD_MUTEX_INITIALIZER; /* control access to the upstream measurements */
-static uint32_t        meas_nb_rx_rcv   = 0;                         /* count packets received */
-static uint32_t        meas_nb_rx_ok    = 0;                         /* count packets received with PAYLOAD CRC OK */
-static uint32_t        meas_nb_rx_bad   = 0;                         /* count packets received with PAYLOAD CRC ERROR */
-static uint32_t        meas_nb_rx_nocrc = 0;                         /* count packets received with NO PAYLOAD CRC */
-static uint32_t        meas_up_pkt_fwd  = 0;     /* number of radio packet forwarded to the server */
-static uint32_t        meas_up_network_byte = 0; /* sum of UDP bytes sent for upstream traffic */
-static uint32_t        meas_up_payload_byte = 0; /* sum of radio payload bytes sent for upstream traffic */
-static uint32_t        meas_up_dgram_sent   = 0; /* number of datagrams sent for upstream traffic */
-static uint32_t        meas_up_ack_rcv      = 0; /* number of datagrams acknowledged for upstream traffic */
-
-static pthread_mutex_t mx_meas_dw = PTHREAD_MUTEX_INITIALIZER; /* control access to the downstream measurements */
-static uint32_t        meas_dw_pull_sent    = 0;               /* number of PULL requests sent for downstream traffic */
-static uint32_t        meas_dw_ack_rcv      = 0; /* number of PULL requests acknowledged for downstream traffic */
-static uint32_t        meas_dw_dgram_rcv    = 0; /* count PULL response packets received for downstream traffic */
-static uint32_t        meas_dw_network_byte = 0; /* sum of UDP bytes sent for upstream traffic */
-static uint32_t        meas_dw_payload_byte = 0; /* sum of radio payload bytes sent for upstream traffic */
-static uint32_t        meas_nb_tx_ok        = 0; /* count packets emitted successfully */
-static uint32_t        meas_nb_tx_fail      = 0; /* count packets were TX failed for other reasons */
-static uint32_t        meas_nb_tx_requested = 0; /* count TX request from server (downlinks) */
-static uint32_t        meas_nb_tx_rejected_collision_packet =
-    0; /* count packets were TX request were rejected due to collision with another packet already programmed */
-static uint32_t meas_nb_tx_rejected_collision_beacon =
-    0; /* count packets were TX request were rejected due to collision with a beacon already programmed */
-static uint32_t meas_nb_tx_rejected_too_late =
-    0; /* count packets were TX request were rejected because it is too late to program it */
-static uint32_t meas_nb_tx_rejected_too_early =
-    0; /* count packets were TX request were rejected because timestamp is too much in advance */
+/* measurements to establish statistics, lock-free counters each written by a single thread (upstream, network or JIT)
+ * and read by difference with the previous report */
+static struct stats_counter_s meas_nb_rx_rcv;       /* count packets received */
+static struct stats_counter_s meas_nb_rx_ok;        /* count packets received with PAYLOAD CRC OK */
+static struct stats_counter_s meas_nb_rx_bad;       /* count packets received with PAYLOAD CRC ERROR */
+static struct stats_counter_s meas_nb_rx_nocrc;     /* count packets received with NO PAYLOAD CRC */
+static struct stats_counter_s meas_up_pkt_fwd;      /* number of radio packet forwarded to the server */
+static struct stats_counter_s meas_up_network_byte; /* sum of UDP bytes sent for upstream traffic */
+static struct stats_counter_s meas_up_payload_byte; /* sum of radio payload bytes sent for upstream traffic */
+static struct stats_counter_s meas_up_dgram_sent;   /* number of datagrams sent for upstream traffic */
+static struct stats_counter_s meas_up_ack_rcv;      /* number of datagrams acknowledged for upstream traffic */
+static struct stats_counter_s meas_up_ack_late;     /* number of PUSH_ACK received after PUSH_TIMEOUT_MS */
+static struct stats_counter_s meas_up_ack_nomatch;  /* number of PUSH_ACK matching no in-flight datagram */
+static struct stats_counter_s meas_up_ack_rtt_nb;   /* number of PUSH_ACK round-trip times measured */
+static uint32_t               meas_up_ack_rtt[PUSH_RTT_SAMPLES_NB]; /* last PUSH_ACK round-trip times, in us */
+static struct stats_counter_s meas_up_latency_nb;  /* number of packets accounted in the forward latency measurements */
+static struct stats_counter_s meas_up_latency_sum; /* sum of radio IRQ to forward latencies, in microseconds */
+static struct stats_max_s     meas_up_latency_max; /* max radio IRQ to forward latency, in microseconds */
+static struct stats_counter_s meas_up_batch_hist[NB_PKT_MAX + 1]; /* number of datagrams sent per nb of rxpk */
+static struct stats_counter_s meas_up_ack_rtt_hist[HIST_RTT_NB];        /* PUSH_ACK round-trip times, in us */
+static struct stats_counter_s meas_up_latency_hist[HIST_UP_LATENCY_NB]; /* radio IRQ to forward latencies, in us */
+
+static struct stats_counter_s meas_dw_pull_sent;    /* number of PULL requests sent for downstream traffic */
+static struct stats_counter_s meas_dw_ack_rcv;      /* number of PULL requests acknowledged for downstream traffic */
+static struct stats_counter_s meas_dw_dgram_rcv;    /* count PULL response packets received for downstream traffic */
+static struct stats_counter_s meas_dw_queue_drop;   /* count PULL response packets dropped, downstream queue full */
+static struct stats_counter_s meas_dw_network_byte; /* sum of UDP bytes sent for upstream traffic */
+static struct stats_counter_s meas_dw_payload_byte; /* sum of radio payload bytes sent for upstream traffic */
+static struct stats_counter_s meas_nb_tx_ok;        /* count packets emitted successfully */
+static struct stats_counter_s meas_nb_tx_fail;      /* count packets were TX failed for other reasons */
+static struct stats_counter_s meas_nb_tx_requested; /* count TX request from server (downlinks) */
+static struct stats_counter_s meas_nb_tx_rejected_collision_packet; /* TX rejected, collision with a packet */
+static struct stats_counter_s meas_nb_tx_rejected_collision_beacon; /* TX rejected, collision with a beacon */
+static struct stats_counter_s meas_nb_tx_rejected_too_late;         /* TX rejected, too late to program it */
+static struct stats_counter_s meas_nb_tx_rejected_too_early;        /* TX rejected, timestamp too much in advance */
+static struct stats_counter_s meas_dw_jit_delay_hist[JIT_DELAY_HIST_NB]; /* number of TX hand-off per delay range */
+static struct stats_max_s     meas_dw_tx_start_err_max; /* max gap between requested and actual TX start, in us */
+static struct stats_counter_s meas_dw_enqueue_nb;  /* number of PULL_RESP accounted in the JIT enqueue latency */
+static struct stats_counter_s meas_dw_enqueue_sum; /* sum of PULL_RESP reception to JIT enqueue latencies, in us */
+static struct stats_max_s     meas_dw_enqueue_max; /* max PULL_RESP reception to JIT enqueue latency, in us */
+static struct stats_counter_s meas_dw_ack_rtt_hist[HIST_RTT_NB];         /* PULL_ACK round-trip times, in us */
+static struct stats_counter_s meas_dw_jit_depth_hist[HIST_JIT_DEPTH_NB]; /* JIT queue depth met by the downlinks */
+static struct stats_counter_s meas_dw_jit_lead_hist[HIST_JIT_LEAD_NB];   /* time left before TX start at dequeue, us */
+static struct stats_counter_s meas_dw_lgw_send_hist[HIST_LGW_SEND_NB];   /* lgw_send durations, in us */
+
+/* upper bounds of the JIT hand-off delay ranges (actual - scheduled), in microseconds, the last range is unbounded */
+static const uint32_t jit_delay_hist_bound_us[JIT_DELAY_HIST_NB - 1] = { 100, 250, 500, 1000, 2500, 5000, 10000 };
+
+/* upper bounds of the buckets of the other histograms, the last bucket of each is unbounded */
+static const uint32_t up_batch_hist_bound[NB_PKT_MAX]    = { 0, 1, 2, 3, 4, 5, 6, 7 };
+static const uint32_t hist_rtt_bound_us[HIST_RTT_NB - 1] = { 5000,   10000,  25000,   50000,  100000,
+                                                             250000, 500000, 1000000, 2500000 };
+static const uint32_t hist_up_latency_bound_us[HIST_UP_LATENCY_NB - 1] = { 1000,  2500,   5000,   10000,  25000,
+                                                                           50000, 100000, 250000, 500000, 1000000 };
+static const uint32_t hist_jit_lead_bound_us[HIST_JIT_LEAD_NB - 1]     = { 1500,  5000,  10000, 20000,
+                                                                           25000, 30000, 35000, 50000 };
+static const uint32_t hist_lgw_send_bound_us[HIST_LGW_SEND_NB - 1]     = { 100,  250,  500,   1000,
+                                                                           2500, 5000, 10000, 25000 };
+static const uint32_t hist_jit_depth_bound[HIST_JIT_DEPTH_NB - 1]      = { 0, 1, 2, 3, 4, 8, 16 };
+
+/* counters exported in the metrics, cumulative since boot */
+static const struct metric_counter_s metric_counters[] = {
+    { "lorahub_rx_packets", "", "Radio packets received", &meas_nb_rx_rcv },
+    { "lorahub_rx_crc_packets", "{crc=\"ok\"}", "Radio packets received per payload CRC status", &meas_nb_rx_ok },
+    { "lorahub_rx_crc_packets", "{crc=\"bad\"}", NULL, &meas_nb_rx_bad },
+    { "lorahub_rx_crc_packets", "{crc=\"none\"}", NULL, &meas_nb_rx_nocrc },
+    { "lorahub_up_forwarded_packets", "", "Radio packets forwarded to the server", &meas_up_pkt_fwd },
+    { "lorahub_up_network_bytes", "", "UDP bytes sent for upstream traffic", &meas_up_network_byte },
+    { "lorahub_up_payload_bytes", "", "Radio payload bytes sent for upstream traffic", &meas_up_payload_byte },
+    { "lorahub_up_datagrams", "", "PUSH_DATA datagrams sent", &meas_up_dgram_sent },
+    { "lorahub_up_acks", "{status=\"ok\"}", "PUSH_ACK received, in time, late or matching no datagram",
+      &meas_up_ack_rcv },
+    { "lorahub_up_acks", "{status=\"late\"}", NULL, &meas_up_ack_late },
+    { "lorahub_up_acks", "{status=\"nomatch\"}", NULL, &meas_up_ack_nomatch },
+    { "lorahub_up_ack_rtt_samples", "", "PUSH_ACK round-trip times measured", &meas_up_ack_rtt_nb },
+    { "lorahub_dw_pull_requests", "", "PULL_DATA sent", &meas_dw_pull_sent },
+    { "lorahub_dw_pull_acks", "", "PULL_ACK received", &meas_dw_ack_rcv },
+    { "lorahub_dw_datagrams", "", "Valid PULL_RESP received", &meas_dw_dgram_rcv },
+    { "lorahub_dw_queue_drops", "", "PULL_RESP dropped as the downstream queue was full", &meas_dw_queue_drop },
+    { "lorahub_dw_network_bytes", "", "UDP bytes received for downstream traffic", &meas_dw_network_byte },
+    { "lorahub_dw_payload_bytes", "", "Radio payload bytes received for downstream traffic", &meas_dw_payload_byte },
+    { "lorahub_tx_requested", "", "TX requested by the servers", &meas_nb_tx_requested },
+    { "lorahub_tx_packets", "{status=\"ok\"}", "Packets emitted, or whose TX failed", &meas_nb_tx_ok },
+    { "lorahub_tx_packets", "{status=\"fail\"}", NULL, &meas_nb_tx_fail },
+    { "lorahub_tx_rejected", "{reason=\"collision_packet\"}", "TX rejected by the JIT queue",
+      &meas_nb_tx_rejected_collision_packet },
+    { "lorahub_tx_rejected", "{reason=\"collision_beacon\"}", NULL, &meas_nb_tx_rejected_collision_beacon },
+    { "lorahub_tx_rejected", "{reason=\"too_late\"}", NULL, &meas_nb_tx_rejected_too_late },
+    { "lorahub_tx_rejected", "{reason=\"too_early\"}", NULL, &meas_nb_tx_rejected_too_early },
+};
+
+/* histograms exported in the metrics */
+static const struct metric_hist_s metric_hists[] = {
+    { "lorahub_up_datagram_rxpk", "rxpk objects per PUSH_DATA datagram", up_batch_hist_bound,
+      ARRAY_SIZE( up_batch_hist_bound ), 1, meas_up_batch_hist },
+    { "lorahub_up_latency_seconds", "Radio IRQ to forward latency", hist_up_latency_bound_us,
+      ARRAY_SIZE( hist_up_latency_bound_us ), 1E-6, meas_up_latency_hist },
+    { "lorahub_push_ack_rtt_seconds", "PUSH_DATA to PUSH_ACK round-trip time", hist_rtt_bound_us,
+      ARRAY_SIZE( hist_rtt_bound_us ), 1E-6, meas_up_ack_rtt_hist },
+    { "lorahub_pull_ack_rtt_seconds", "PULL_DATA to PULL_ACK round-trip time", hist_rtt_bound_us,
+      ARRAY_SIZE( hist_rtt_bound_us ), 1E-6, meas_dw_ack_rtt_hist },
+    { "lorahub_jit_queue_depth", "Packets already in the JIT queue when a downlink is enqueued",
+      hist_jit_depth_bound, ARRAY_SIZE( hist_jit_depth_bound ), 1, meas_dw_jit_depth_hist },
+    { "lorahub_jit_lead_seconds", "Time left before the TX start when a packet is dequeued", hist_jit_lead_bound_us,
+      ARRAY_SIZE( hist_jit_lead_bound_us ), 1E-6, meas_dw_jit_lead_hist },
+    { "lorahub_jit_handoff_delay_seconds", "Delay of the hand-off to the radio, early ones in the first bucket",
+      jit_delay_hist_bound_us, ARRAY_SIZE( jit_delay_hist_bound_us ), 1E-6, meas_dw_jit_delay_hist },
+    { "lorahub_lgw_send_seconds", "Duration of lgw_send", hist_lgw_send_bound_us, ARRAY_SIZE( hist_lgw_send_bound_us ),
+      1E-6, meas_dw_lgw_send_hist },
+};
+
+static const char* const backhaul_event_str[BACKHAUL_EVT_NB] = { "ACK received", "PUSH_DATA not acknowledged",
+                                                                 "send error", "PULL_DATA not acknowledged" };
 
 static pthread_mutex_t mx_stat_rep  = PTHREAD_MUTEX_INITIALIZER; /* control access to the status report */
 static bool            report_ready = false;       /* true when there is a new report to send to the server */
 static char            status_report[STATUS_SIZE]; /* status report as a JSON object */
 
-/* auto-quit function */
-static uint32_t autoquit_threshold =
-    10; /* enable auto-quit after a number of non-acknowledged PULL_DATA (0 = disabled)*/
-
 /* Just In Time TX scheduling */
 static struct jit_queue_s jit_queue[LGW_RF_CHAIN_NB];
+static TaskHandle_t       jit_task  = NULL; /* JIT thread, notified when it has to check the queues */
+static esp_timer_handle_t jit_timer = NULL; /* one-shot timer armed for the next packet to be handed to the radio */
 
 /* Gateway specificities */
 static int8_t antenna_gain = 0;
@@ -183,7 +379,23 @@ static temperature_sensor_handle_t temp_sensor = NULL;
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
 
-static double difftimespec( struct timespec end, struct timespec beginning );
+static int compare_u32( const void* a, const void* b );
+
+static uint32_t percentile_u32( const uint32_t* sorted, unsigned nb, unsigned pct );
+
+static void jit_timer_cb( void* arg );
+
+static void jit_wakeup( void );
+
+static bool jit_tx_busy( uint8_t rf_chain );
+
+static int32_t jit_next_wait_us( void );
+
+static int jit_delay_hist_index( int32_t delay_us );
+
+static void jit_check_tx_report( void );
+
+static void backhaul_event( enum backhaul_event_e event );
 
 /* -------------------------------------------------------------------------- */
 /* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
@@ -350,8 +562,6 @@ static int parse_gateway_configuration( void )
 #endif
     ESP_LOGI( TAG_PKT_FWD, "Gateway ID: 0x%08llX", lgwm );
 
-    ESP_LOGI( TAG_PKT_FWD, "INFO: Auto-quit after %lu non-acknowledged PULL_DATA\n", autoquit_threshold );
-
     /* Configure LNS address and port from NVS */
 #ifdef CONFIG_GET_CFG_FROM_FLASH
     esp_err_t err = ESP_OK;
@@ -393,34 +603,287 @@ static int parse_gateway_configuration( void )
         {
             printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_LNS_PORT, esp_err_to_name( err ) );
         }
+
+        err = nvs_get_u8( my_handle, CFG_NVS_KEY_PUSH_MAX_PKT, &push_max_pkt );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu8 "\n", CFG_NVS_KEY_PUSH_MAX_PKT, push_max_pkt );
+            /* sanity check */
+            if( ( push_max_pkt < 1 ) || ( push_max_pkt > NB_PKT_MAX ) )
+            {
+                ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong PUSH_DATA max packets configuration from NVS, set to %d\n",
+                          CONFIG_PUSH_DATA_MAX_PKT );
+                push_max_pkt = CONFIG_PUSH_DATA_MAX_PKT;
+            }
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_MAX_PKT, esp_err_to_name( err ) );
+        }
+
+        err = nvs_get_u16( my_handle, CFG_NVS_KEY_PUSH_MAX_BYTES, &push_max_bytes );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu16 "\n", CFG_NVS_KEY_PUSH_MAX_BYTES, push_max_bytes );
+            /* sanity check */
+            if( ( push_max_bytes < RXPK_MAX_SIZE ) || ( push_max_bytes > ( RXPK_MAX_SIZE * NB_PKT_MAX ) ) )
+            {
+                ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong PUSH_DATA max bytes configuration from NVS, set to %d\n",
+                          CONFIG_PUSH_DATA_MAX_BYTES );
+                push_max_bytes = CONFIG_PUSH_DATA_MAX_BYTES;
+            }
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_MAX_BYTES, esp_err_to_name( err ) );
+        }
+
+        err = nvs_get_u32( my_handle, CFG_NVS_KEY_PUSH_HOLD_US, &push_hold_us );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %" PRIu32 "us\n", CFG_NVS_KEY_PUSH_HOLD_US, push_hold_us );
+            /* sanity check */
+            if( push_hold_us > 1000000 )
+            {
+                ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong PUSH_DATA hold time configuration from NVS, set to %dus\n",
+                          CONFIG_PUSH_DATA_HOLD_US );
+                push_hold_us = CONFIG_PUSH_DATA_HOLD_US;
+            }
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_PUSH_HOLD_US, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( lns_fallbacks_str );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_LNS_FALLBACKS, lns_fallbacks_str, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_LNS_FALLBACKS, lns_fallbacks_str );
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_LNS_FALLBACKS, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( lns_fanout_str );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_LNS_FANOUT, lns_fanout_str, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_LNS_FANOUT, lns_fanout_str );
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_LNS_FANOUT, esp_err_to_name( err ) );
+        }
+
+        size = sizeof( uplink_filter_str );
+        err  = nvs_get_str( my_handle, CFG_NVS_KEY_UPLINK_FILTER, uplink_filter_str, &size );
+        if( err == ESP_OK )
+        {
+            printf( "NVS -> %s = %s\n", CFG_NVS_KEY_UPLINK_FILTER, uplink_filter_str );
+        }
+        else
+        {
+            printf( "Failed to get %s from NVS - %s\n", CFG_NVS_KEY_UPLINK_FILTER, esp_err_to_name( err ) );
+        }
     }
     nvs_close( my_handle );
     printf( "Closed NVS handle for reading.\n" );
 #endif
 
+    ESP_LOGI( TAG_PKT_FWD, "INFO: PUSH_DATA coalescing up to %u packets, %u bytes, held %lu us max\n", push_max_pkt,
+              push_max_bytes, push_hold_us );
+
+    /* Configure uplink filtering, forward everything if the rules are invalid */
+    struct uplink_filter_rule_s filter_rules[UPLINK_FILTER_RULES_MAX];
+    int                         nb_filter_rules = uplink_filter_parse( uplink_filter_str, filter_rules );
+    if( nb_filter_rules < 0 )
+    {
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong uplink filtering rules \"%s\", filtering disabled\n", uplink_filter_str );
+        nb_filter_rules = 0;
+    }
+    uplink_filter_set( filter_rules, nb_filter_rules );
+
     return 0;
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-static double difftimespec( struct timespec end, struct timespec beginning )
+static int compare_u32( const void* a, const void* b )
 {
-    double x;
+    uint32_t x = *( const uint32_t* ) a;
+    uint32_t y = *( const uint32_t* ) b;
+
+    return ( x > y ) - ( x < y );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    x = 1E-9 * ( double ) ( end.tv_nsec - beginning.tv_nsec );
-    x += ( double ) ( end.tv_sec - beginning.tv_sec );
+static uint32_t percentile_u32( const uint32_t* sorted, unsigned nb, unsigned pct )
+{
+    /* nearest-rank method */
+    unsigned rank = ( ( pct * nb ) + 99 ) / 100;
 
-    return x;
+    return ( rank > 0 ) ? sorted[rank - 1] : sorted[0];
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-static uint8_t buff_tx_ack[ACK_BUFF_SIZE]; /* buffer to give feedback to server */
+static void jit_timer_cb( void* arg )
+{
+    xTaskNotifyGive( ( TaskHandle_t ) arg );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-static int send_tx_ack( uint8_t token_h, uint8_t token_l, enum jit_error_e error, int32_t error_value )
+static void jit_wakeup( void )
 {
-    int buff_index;
-    int j;
+    if( jit_task != NULL )
+    {
+        xTaskNotifyGive( jit_task );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* true while the radio is loaded with or emitting a packet, it cannot take the next one before the end of that TX */
+static bool jit_tx_busy( uint8_t rf_chain )
+{
+    uint8_t tx_status;
+
+    if( lgw_status( rf_chain, TX_STATUS, &tx_status ) != LGW_HAL_SUCCESS )
+    {
+        return false;
+    }
+
+    return ( tx_status == TX_SCHEDULED ) || ( tx_status == TX_EMITTING );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int32_t jit_next_wait_us( void )
+{
+    int32_t  wait_us = JIT_WAIT_MS * 1000;
+    int32_t  delay_us;
+    uint32_t dispatch_us;
+    uint32_t current_concentrator_time;
+    int      i;
+
+    /* time until the first packet of the queues has to be handed to the radio, negative if late. A packet due while
+     * the radio is busy is held until the end of the TX, which wakes the thread up */
+    lgw_get_instcnt( &current_concentrator_time );
+    for( i = 0; i < LGW_RF_CHAIN_NB; i++ )
+    {
+        if( jit_next_dispatch( &jit_queue[i], &dispatch_us ) == JIT_ERROR_OK )
+        {
+            delay_us = ( int32_t ) ( dispatch_us - current_concentrator_time );
+            if( ( delay_us <= 0 ) && ( jit_tx_busy( i ) == true ) )
+            {
+                continue;
+            }
+            if( delay_us < wait_us )
+            {
+                wait_us = delay_us;
+            }
+        }
+    }
+
+    return wait_us;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int jit_delay_hist_index( int32_t delay_us )
+{
+    int k = 0;
+
+    /* an early hand-off is accounted in the first range */
+    while( ( k < ( JIT_DELAY_HIST_NB - 1 ) ) && ( delay_us > ( int32_t ) jit_delay_hist_bound_us[k] ) )
+    {
+        k++;
+    }
+
+    return k;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void jit_check_tx_report( void )
+{
+    struct lgw_tx_report_s report;
+    int                    result;
+    uint32_t               start_err_us;
+
+    pthread_mutex_lock( &mx_concent );
+    result = lgw_get_tx_report( &report );
+    pthread_mutex_unlock( &mx_concent );
+    if( result != LGW_HAL_SUCCESS )
+    {
+        return; /* no TX ended since last check */
+    }
+
+    if( report.done == false )
+    {
+        stats_counter_add( &meas_nb_tx_fail, 1 );
+        ESP_LOGW( TAG_JIT, "WARNING: [jit] TX of packet count_us=%lu did not complete\n", report.count_us );
+        return;
+    }
+
+    start_err_us = ( uint32_t ) abs( ( int32_t ) ( report.start_us - report.count_us ) );
+    stats_counter_add( &meas_nb_tx_ok, 1 );
+    stats_max_update( &meas_dw_tx_start_err_max, start_err_us );
+    MSG_DEBUG( DEBUG_PKT_FWD, "TX done: count_us=%lu start_us=%lu end_us=%lu\n", report.count_us, report.start_us,
+               report.end_us );
+
+    /* Update display */
+    display_stats_t rx_tx_stats = { .nb_rx = 0, .nb_tx = 1 };
+    display_update_statistics( &rx_tx_stats );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void backhaul_event( enum backhaul_event_e event )
+{
+    bool up;
+
+    pthread_mutex_lock( &mx_backhaul );
+    switch( event )
+    {
+    case BACKHAUL_EVT_ACK:
+        backhaul_unacked_nb = 0;
+        up                  = true;
+        break;
+    case BACKHAUL_EVT_PUSH_SENT:
+        backhaul_unacked_nb += 1;
+        up = backhaul_up && ( backhaul_unacked_nb < BACKHAUL_UNACKED_MAX );
+        break;
+    default:
+        up = false;
+        break;
+    }
+    if( backhaul_up != up )
+    {
+        backhaul_up = up;
+        if( up == true )
+        {
+            ESP_LOGI( TAG_PKT_FWD, "INFO: server reachable, replaying stored uplinks\n" );
+        }
+        else
+        {
+            ESP_LOGW( TAG_PKT_FWD, "WARNING: server unreachable (%s), storing uplinks\n", backhaul_event_str[event] );
+        }
+    }
+    pthread_mutex_unlock( &mx_backhaul );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int send_tx_ack( int sock, uint8_t token_h, uint8_t token_l, enum jit_error_e error, int32_t error_value )
+{
+    uint8_t buff_tx_ack[ACK_BUFF_SIZE]; /* buffer to give feedback to server, local as sent from several threads */
+    int     buff_index;
+    int     j;
 
     /* reset buffer */
     memset( &buff_tx_ack, 0, sizeof buff_tx_ack );
@@ -460,33 +923,25 @@ static int send_tx_ack( uint8_t token_h, uint8_t token_l, enum jit_error_e error
             memcpy( ( void* ) ( buff_tx_ack + buff_index ), ( void* ) "\"COLLISION_PACKET\"", 18 );
             buff_index += 18;
             /* update stats */
-            pthread_mutex_lock( &mx_meas_dw );
-            meas_nb_tx_rejected_collision_packet += 1;
-            pthread_mutex_unlock( &mx_meas_dw );
+            stats_counter_add( &meas_nb_tx_rejected_collision_packet, 1 );
             break;
         case JIT_ERROR_TOO_LATE:
             memcpy( ( void* ) ( buff_tx_ack + buff_index ), ( void* ) "\"TOO_LATE\"", 10 );
             buff_index += 10;
             /* update stats */
-            pthread_mutex_lock( &mx_meas_dw );
-            meas_nb_tx_rejected_too_late += 1;
-            pthread_mutex_unlock( &mx_meas_dw );
+            stats_counter_add( &meas_nb_tx_rejected_too_late, 1 );
             break;
         case JIT_ERROR_TOO_EARLY:
             memcpy( ( void* ) ( buff_tx_ack + buff_index ), ( void* ) "\"TOO_EARLY\"", 11 );
             buff_index += 11;
             /* update stats */
-            pthread_mutex_lock( &mx_meas_dw );
-            meas_nb_tx_rejected_too_early += 1;
-            pthread_mutex_unlock( &mx_meas_dw );
+            stats_counter_add( &meas_nb_tx_rejected_too_early, 1 );
             break;
         case JIT_ERROR_COLLISION_BEACON:
             memcpy( ( void* ) ( buff_tx_ack + buff_index ), ( void* ) "\"COLLISION_BEACON\"", 18 );
             buff_index += 18;
             /* update stats */
-            pthread_mutex_lock( &mx_meas_dw );
-            meas_nb_tx_rejected_collision_beacon += 1;
-            pthread_mutex_unlock( &mx_meas_dw );
+            stats_counter_add( &meas_nb_tx_rejected_collision_beacon, 1 );
             break;
         case JIT_ERROR_TX_FREQ:
             memcpy( ( void* ) ( buff_tx_ack + buff_index ), ( void* ) "\"TX_FREQ\"", 9 );
@@ -533,14 +988,168 @@ static int send_tx_ack( uint8_t token_h, uint8_t token_l, enum jit_error_e error
     buff_tx_ack[buff_index] = 0; /* add string terminator, for safety */
 
     /* send datagram to server */
-    return send( sock_down, ( void* ) buff_tx_ack, buff_index, 0 );
+    return send( sock, ( void* ) buff_tx_ack, buff_index, 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int pull_resp_process( uint8_t* buff, int msg_len, int64_t rx_us, enum jit_error_e* jit_result,
+                              int32_t* warning_value )
+{
+    /* configuration and metadata for an outbound packet */
+    struct lgw_pkt_tx_s txpkt;
+
+    /* JSON parsing variables */
+    enum txpk_error_e    txpk_result;
+    struct txpk_status_s txpk_status;
+
+    /* Just In Time downlink */
+    uint32_t            current_concentrator_time;
+    enum jit_pkt_type_e downlink_type;
+    enum jit_error_e    warning_result = JIT_ERROR_OK;
+    enum jit_error_e    head_result;
+    uint32_t            head_dispatch_us;
+    uint32_t            dispatch_us;
+    uint32_t            latency_us;
+    uint32_t            parse_count_us;
+
+    buff[msg_len] = 0; /* add string terminator, just to be safe */
+    ESP_LOGI( TAG_DOWN, "INFO: [down] PULL_RESP received  - token[%d:%d] :)", buff[1], buff[2] ); /* very verbose */
+    printf( "\nJSON down: %s\n", ( char* ) ( buff + 4 ) ); /* DEBUG: display JSON payload */
+
+    /* parse the txpk object straight into the TX struct */
+    lgw_get_instcnt( &parse_count_us );
+    txpk_result = txpk_parse( ( const char* ) ( buff + 4 ), msg_len - 4, &txpkt, &txpk_status );
+    if( txpk_result != TXPK_ERROR_OK )
+    {
+        ESP_LOGW( TAG_DOWN, "WARNING: [down] %s (field: %s, offset: %d), TX aborted\n", txpk_error_str( txpk_result ),
+                  ( txpk_status.field != NULL ) ? txpk_status.field : "none", txpk_status.offset );
+        return -1;
+    }
+
+    if( txpkt.tx_mode == IMMEDIATE )
+    {
+        downlink_type = JIT_PKT_TYPE_DOWNLINK_CLASS_C;
+        ESP_LOGI( TAG_DOWN, "INFO: [down] a packet will be sent in \"immediate\" mode\n" );
+    }
+    else
+    {
+        /* Concentrator timestamp is given, we consider it is a Class A downlink */
+        downlink_type = JIT_PKT_TYPE_DOWNLINK_CLASS_A;
+    }
+
+    if( tx_enable[txpkt.rf_chain] == false )
+    {
+        ESP_LOGW( TAG_DOWN, "WARNING: [down] TX is not enabled on RF chain %u, TX aborted\n", txpkt.rf_chain );
+        return -1;
+    }
+
+    if( TXPK_HAS_FIELD( &txpk_status, TXPK_FIELD_POWE ) )
+    {
+        txpkt.rf_power = ( int8_t ) ( txpkt.rf_power - antenna_gain );
+    }
+
+    if( txpk_status.data_size != txpkt.size )
+    {
+        ESP_LOGW( TAG_DOWN, "WARNING: [down] mismatch between .size and .data size once converter to binary\n" );
+    }
+
+    /* record measurement data */
+    stats_counter_add( &meas_dw_dgram_rcv, 1 ); /* count only datagrams with no JSON errors */
+    stats_counter_add( &meas_dw_network_byte, msg_len );
+    stats_counter_add( &meas_dw_payload_byte, txpkt.size );
+
+    /* reset error/warning results */
+    *jit_result    = JIT_ERROR_OK;
+    *warning_value = 0;
+
+    /* check TX frequency before trying to queue packet */
+    uint32_t tx_freq_hz_min, tx_freq_hz_max;
+    lgw_get_min_max_freq_hz( &tx_freq_hz_min, &tx_freq_hz_max );
+    if( ( txpkt.freq_hz < tx_freq_hz_min ) || ( txpkt.freq_hz > tx_freq_hz_max ) )
+    {
+        *jit_result = JIT_ERROR_TX_FREQ;
+        ESP_LOGE( TAG_DOWN, "ERROR: Packet REJECTED, unsupported frequency - %lu (min:%lu,max:%lu)\n",
+                  txpkt.freq_hz, tx_freq_hz_min, tx_freq_hz_max );
+    }
+
+    /* check TX power before trying to queue packet, send a warning if not supported */
+    if( *jit_result == JIT_ERROR_OK )
+    {
+        int8_t tx_power_min, tx_power_max;
+        lgw_get_min_max_power_dbm( &tx_power_min, &tx_power_max );
+        if( txpkt.rf_power < tx_power_min )
+        {
+            /* this RF power is not supported, throw a warning, and use the closest lower power supported */
+            warning_result = JIT_ERROR_TX_POWER;
+            *warning_value = ( int32_t ) tx_power_min;
+            ESP_LOGW( TAG_DOWN, "WARNING: Requested TX power is not supported (%ddBm), actual power used: %lddBm\n",
+                      txpkt.rf_power, *warning_value );
+            txpkt.rf_power = tx_power_min;
+        }
+        if( txpkt.rf_power > tx_power_max )
+        {
+            /* this RF power is not supported, throw a warning, and use the closest lower power supported */
+            warning_result = JIT_ERROR_TX_POWER;
+            *warning_value = ( int32_t ) tx_power_max;
+            ESP_LOGW( TAG_DOWN, "WARNING: Requested TX power is not supported (%ddBm), actual power used: %lddBm\n",
+                      txpkt.rf_power, *warning_value );
+            txpkt.rf_power = tx_power_max;
+        }
+    }
+
+    /* insert packet to be sent into JIT queue */
+    if( *jit_result == JIT_ERROR_OK )
+    {
+        head_result = jit_next_dispatch( &jit_queue[txpkt.rf_chain], &head_dispatch_us );
+        stats_hist_add( meas_dw_jit_depth_hist, hist_jit_depth_bound, ARRAY_SIZE( hist_jit_depth_bound ),
+                        jit_queue[txpkt.rf_chain].num_pkt );
+        lgw_get_instcnt( &current_concentrator_time );
+        *jit_result = jit_enqueue( &jit_queue[txpkt.rf_chain], current_concentrator_time, &txpkt, downlink_type );
+        latency_us  = ( uint32_t ) ( esp_timer_get_time( ) - rx_us );
+        if( *jit_result != JIT_ERROR_OK )
+        {
+            ESP_LOGE( TAG_DOWN, "ERROR: Packet REJECTED (jit error=%d)\n", *jit_result );
+        }
+        else
+        {
+            /* The JIT thread has to re-arm its timer if this packet is now the first to be sent */
+            if( ( head_result != JIT_ERROR_OK ) ||
+                ( ( jit_next_dispatch( &jit_queue[txpkt.rf_chain], &dispatch_us ) == JIT_ERROR_OK ) &&
+                  ( dispatch_us != head_dispatch_us ) ) )
+            {
+                jit_wakeup( );
+            }
+
+            /* the downlink is identified by its TX time in the latency trace, only known now for an immediate one */
+            lgw_trace_at( LGW_TRACE_DW_PULL_RESP, txpkt.count_us, ( uint32_t ) rx_us );
+            lgw_trace_at( LGW_TRACE_DW_PARSE, txpkt.count_us, parse_count_us );
+
+            /* In case of a warning having been raised before, we notify it */
+            *jit_result = warning_result;
+        }
+        stats_counter_add( &meas_nb_tx_requested, 1 );
+        stats_counter_add( &meas_dw_enqueue_nb, 1 );
+        stats_counter_add( &meas_dw_enqueue_sum, latency_us );
+        stats_max_update( &meas_dw_enqueue_max, latency_us );
+    }
+
+    return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 /* --- THREAD 1: RECEIVING PACKETS AND FORWARDING THEM ---------------------- */
 
-static uint8_t buff_up[TX_BUFF_SIZE]; /* buffer to compose the upstream packet */
-static uint8_t buff_up_ack[32];       /* buffer to receive acknowledges */
+static struct lgw_pkt_rx_s rxpkt[NB_PKT_MAX];     /* staging ring of the inbound packets waiting to be forwarded */
+static uint8_t             buff_up[TX_BUFF_SIZE]; /* buffer to compose the upstream packet */
+static uint8_t             buff_up_ack[32];       /* buffer to receive acknowledges */
+static struct lgw_pkt_rx_s replay_pkt;            /* stored packet being replayed */
+
+static unsigned rxpk_size_estimate( const struct lgw_pkt_rx_s* p )
+{
+    /* worst case metadata + base64-encoded payload (4 chars per block of 3 bytes) */
+    return RXPK_OVERHEAD_SIZE + ( 4 * ( ( p->size + 2 ) / 3 ) );
+}
 
 void thread_up( void )
 {
@@ -549,10 +1158,21 @@ void thread_up( void )
     char     stat_timestamp[24];
     time_t   t;
 
-    /* allocate memory for packet fetching and processing */
-    struct lgw_pkt_rx_s  rxpkt[NB_PKT_MAX]; /* array containing inbound packets + metadata */
-    struct lgw_pkt_rx_s* p;                 /* pointer on a RX packet */
-    int                  nb_pkt;
+    /* packet fetching and processing variables */
+    struct lgw_pkt_rx_s* p;              /* pointer on a RX packet */
+    int                  nb_pkt;         /* nb of packets returned by the last fetch */
+    bool                 tx_ended;       /* true if the last fetch has completed a TX */
+    unsigned             stage_head = 0; /* index of the oldest packet in the staging ring */
+    unsigned             stage_nb   = 0; /* nb of packets in the staging ring */
+    unsigned             stage_tail;     /* index of the first free slot of the staging ring */
+    unsigned             stage_free;     /* nb of contiguous free slots from stage_tail */
+
+    /* coalescing policy variables */
+    unsigned batch_nb;    /* nb of staged packets to be sent in the next datagram */
+    unsigned batch_bytes; /* estimated size of the rxpk array of the next datagram */
+    uint32_t now_count_us;
+    uint32_t held_us = 0; /* time elapsed since the radio IRQ of the oldest staged packet */
+    bool     flush;
 
     /* data buffers */
     int buff_index;
@@ -561,24 +1181,36 @@ void thread_up( void )
     uint8_t token_h; /* random token for acknowledgement matching */
     uint8_t token_l; /* random token for acknowledgement matching */
 
-    /* ping measurement variables */
-    struct timespec send_time;
-    struct timespec recv_time;
+    /* latency measurement variables */
+    uint32_t pkt_irq_count_us[NB_PKT_MAX]; /* radio IRQ timestamp of the packets in the current datagram */
+    uint32_t fwd_count_us;
+    uint32_t latency_us;
 
     /* report management variable */
     bool send_report = false;
 
-    /* mote info variables */
-    uint32_t mote_addr = 0;
-    uint16_t mote_fcnt = 0;
+    /* uplink filtering variable */
+    bool filtered;
 
-    /* set upstream socket RX timeout */
-    i = setsockopt( sock_up, SOL_SOCKET, SO_RCVTIMEO, ( void* ) &push_timeout_half, sizeof push_timeout_half );
-    if( i != 0 )
-    {
-        ESP_LOGE( TAG_UP, "ERROR: [up] setsockopt returned %s\n", strerror( errno ) );
-        wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-    }
+    /* mote info variables */
+    uint32_t                 mote_addr = 0;
+    uint16_t                 mote_fcnt = 0;
+    display_last_rx_packet_t last_rx_pkt;
+
+    /* in-flight datagram tracking */
+    struct push_inflight_s* f;
+
+    /* store-and-forward variables */
+    bool           online;             /* backhaul state for this iteration */
+    struct timeval now_tv;             /* wall-clock time when the staged packets are stored */
+    struct timeval rx_tv;              /* wall-clock time of the reception of a packet */
+    int64_t        rx_time_us;         /* wall-clock time of the reception of a packet, in microseconds */
+    int64_t        replay_now_us;      /* esp_timer time when checking for a replay */
+    int64_t        replay_last_us = 0; /* esp_timer time of the latest replay */
+    bool           replay_due;         /* true when stored packets must be added to the next datagram */
+    uint32_t       replay_wait_ms;     /* time left before the next replay */
+    unsigned       replay_in_dgram;    /* nb of stored packets in the current datagram */
+    int            sep;                /* size of the inter-packet separator */
 
     /* pre-fill the data buffer with fixed fields */
     buff_up[0]                     = PROTOCOL_VERSION;
@@ -590,47 +1222,36 @@ void thread_up( void )
     {
         // ESP_LOGI(TAG_UP, "UP");
 
-        /* fetch packets */
-        pthread_mutex_lock( &mx_concent );
-        nb_pkt = lgw_receive( NB_PKT_MAX, rxpkt );
-        pthread_mutex_unlock( &mx_concent );
-        if( nb_pkt == LGW_HAL_ERROR )
+        /* fetch packets in the free contiguous slots of the staging ring */
+        if( stage_nb == 0 )
         {
-            ESP_LOGE( TAG_UP, "ERROR: [up] failed packet fetch, exiting\n" );
-            wait_on_error( LRHB_ERROR_HAL, __LINE__ );
+            stage_head = 0; /* rewind to make the whole ring contiguous */
         }
-
-        /* check if there are status report to send */
-        send_report = report_ready; /* copy the variable so it doesn't change mid-function */
-        /* no mutex, we're only reading */
-
-        /* wait a short time if no packets, nor status report */
-        if( ( nb_pkt == 0 ) && ( send_report == false ) )
+        stage_tail = ( stage_head + stage_nb ) % NB_PKT_MAX;
+        stage_free = ( stage_tail >= stage_head ) ? ( NB_PKT_MAX - stage_tail ) : ( stage_head - stage_tail );
+        nb_pkt     = 0;
+        if( stage_nb < NB_PKT_MAX )
         {
-            vTaskDelay( FETCH_SLEEP_MS / portTICK_PERIOD_MS );
-            continue;
+            pthread_mutex_lock( &mx_concent );
+            tx_ended = jit_tx_busy( 0 );
+            nb_pkt   = lgw_receive( stage_free, &rxpkt[stage_tail] );
+            tx_ended = ( tx_ended == true ) && ( jit_tx_busy( 0 ) == false );
+            pthread_mutex_unlock( &mx_concent );
+            if( nb_pkt == LGW_HAL_ERROR )
+            {
+                ESP_LOGE( TAG_UP, "ERROR: [up] failed packet fetch, exiting\n" );
+                wait_on_error( LRHB_ERROR_HAL, __LINE__ );
+            }
+            if( tx_ended == true )
+            {
+                jit_wakeup( ); /* a downlink held by the JIT thread during that TX can be handed to the radio */
+            }
         }
 
-        /* get timestamp for statistics */
-        t = time( NULL );
-        strftime( stat_timestamp, sizeof stat_timestamp, "%F %T %Z", gmtime( &t ) );
-
-        /* start composing datagram with the header */
-        token_h    = ( uint8_t ) rand( ); /* random token */
-        token_l    = ( uint8_t ) rand( ); /* random token */
-        buff_up[1] = token_h;
-        buff_up[2] = token_l;
-        buff_index = 12; /* 12-byte header */
-
-        /* start of JSON structure */
-        memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "{\"rxpk\":[", 9 );
-        buff_index += 9;
-
-        /* serialize Lora packets metadata and payload */
-        pkt_in_dgram = 0;
-        for( i = 0; i < nb_pkt; ++i )
-        {
-            p = &rxpkt[i];
+        /* filter fetched packets, the ones to be forwarded are kept contiguous in the staging ring */
+        for( i = 0; i < nb_pkt; ++i )
+        {
+            p = &rxpkt[stage_tail + i];
 
             /* Get mote information from current packet (addr, fcnt) */
             /* FHDR - DevAddr */
@@ -649,33 +1270,42 @@ void thread_up( void )
                 mote_addr = 0;
                 mote_fcnt = 0;
             }
+            last_rx_pkt.devaddr = mote_addr;
+            last_rx_pkt.rssi    = p->rssic;
+            last_rx_pkt.snr     = p->snr;
+
+            /* per-device statistics, for the data uplinks (MType 2 or 4) received without error */
+            if( ( p->status == STAT_CRC_OK ) && ( p->size >= 8 ) &&
+                ( ( ( p->payload[0] >> 5 ) == 2 ) || ( ( p->payload[0] >> 5 ) == 4 ) ) )
+            {
+                dev_stats_update( mote_addr, mote_fcnt, ( int16_t ) p->rssic, ( int16_t ) lroundf( p->snr * 4 ) );
+            }
+
+            /* drop the uplinks from foreign networks before they are serialized */
+            filtered = ( p->status == STAT_CRC_OK ) && ( uplink_filter_check( p->payload, p->size ) == false );
 
             /* basic packet filtering */
-            pthread_mutex_lock( &mx_meas_up );
-            meas_nb_rx_rcv += 1;
+            stats_counter_add( &meas_nb_rx_rcv, 1 );
             switch( p->status )
             {
             case STAT_CRC_OK:
-                meas_nb_rx_ok += 1;
-                if( !fwd_valid_pkt )
+                stats_counter_add( &meas_nb_rx_ok, 1 );
+                if( !fwd_valid_pkt || filtered )
                 {
-                    pthread_mutex_unlock( &mx_meas_up );
                     continue; /* skip that packet */
                 }
                 break;
             case STAT_CRC_BAD:
-                meas_nb_rx_bad += 1;
+                stats_counter_add( &meas_nb_rx_bad, 1 );
                 if( !fwd_error_pkt )
                 {
-                    pthread_mutex_unlock( &mx_meas_up );
                     continue; /* skip that packet */
                 }
                 break;
             case STAT_NO_CRC:
-                meas_nb_rx_nocrc += 1;
+                stats_counter_add( &meas_nb_rx_nocrc, 1 );
                 if( !fwd_nocrc_pkt )
                 {
-                    pthread_mutex_unlock( &mx_meas_up );
                     continue; /* skip that packet */
                 }
                 break;
@@ -684,253 +1314,192 @@ void thread_up( void )
                           "WARNING: [up] received packet with unknown status %u (size %u, modulation %u, BW %u, DR "
                           "%lu, RSSI %.1f)\n",
                           p->status, p->size, p->modulation, p->bandwidth, p->datarate, p->rssic );
-                pthread_mutex_unlock( &mx_meas_up );
                 continue; /* skip that packet */
             }
-            meas_up_pkt_fwd += 1;
-            meas_up_payload_byte += p->size;
-            pthread_mutex_unlock( &mx_meas_up );
+            stats_counter_add( &meas_up_pkt_fwd, 1 );
+            stats_counter_add( &meas_up_payload_byte, p->size );
             printf( "\nINFO: Received pkt from mote: %08lX (fcnt=%u)", mote_addr, mote_fcnt );
 
-            /* Start of packet, add inter-packet separator if necessary */
-            if( pkt_in_dgram == 0 )
+            /* stage the packet right after the previous kept one */
+            if( p != &rxpkt[( stage_head + stage_nb ) % NB_PKT_MAX] )
             {
-                buff_up[buff_index] = '{';
-                ++buff_index;
-            }
-            else
-            {
-                buff_up[buff_index]     = ',';
-                buff_up[buff_index + 1] = '{';
-                buff_index += 2;
+                memcpy( &rxpkt[( stage_head + stage_nb ) % NB_PKT_MAX], p, sizeof( struct lgw_pkt_rx_s ) );
             }
+            ++stage_nb;
+        }
 
-            /* JSON rxpk frame format version, 8 useful chars */
-            j = snprintf( ( char* ) ( buff_up + buff_index ), TX_BUFF_SIZE - buff_index, "\"jver\":%d",
-                          PROTOCOL_JSON_RXPK_FRAME_FORMAT );
-            if( j > 0 )
-            {
-                buff_index += j;
-            }
-            else
+        /* Update display */
+        if( nb_pkt > 0 )
+        {
+            display_stats_t rx_tx_stats = { .nb_rx = nb_pkt, .nb_tx = 0 };
+            display_update_statistics( &rx_tx_stats );
+            display_update_last_rx_packet( &last_rx_pkt );
+        }
+
+        /* check if there are status report to send */
+        send_report = report_ready; /* copy the variable so it doesn't change mid-function */
+        /* no mutex, we're only reading */
+
+        /* server unreachable, store the staged packets with their wall-clock reception time instead of sending them */
+        pthread_mutex_lock( &mx_backhaul );
+        online = backhaul_up;
+        pthread_mutex_unlock( &mx_backhaul );
+        if( ( online == false ) && ( stage_nb > 0 ) )
+        {
+            gettimeofday( &now_tv, NULL );
+            lgw_get_instcnt( &now_count_us );
+            for( i = 0; i < ( int ) stage_nb; ++i )
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] snprintf failed line %u\n", ( __LINE__ - 4 ) );
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+                p          = &rxpkt[( stage_head + i ) % NB_PKT_MAX];
+                rx_time_us = ( ( int64_t ) now_tv.tv_sec * 1000000 ) + now_tv.tv_usec - ( now_count_us - p->count_us );
+                rx_tv.tv_sec  = rx_time_us / 1000000;
+                rx_tv.tv_usec = rx_time_us % 1000000;
+                uplink_store_push( p, &rx_tv );
             }
+            stage_nb = 0;
+        }
 
-            /* RAW timestamp, 8-17 useful chars */
-            j = snprintf( ( char* ) ( buff_up + buff_index ), TX_BUFF_SIZE - buff_index, ",\"tmst\":%lu", p->count_us );
-            if( j > 0 )
+        /* select the oldest staged packets fitting in one datagram */
+        batch_nb    = 0;
+        batch_bytes = 0;
+        while( ( batch_nb < stage_nb ) && ( batch_nb < push_max_pkt ) )
+        {
+            j = rxpk_size_estimate( &rxpkt[( stage_head + batch_nb ) % NB_PKT_MAX] );
+            if( ( batch_bytes + j ) > push_max_bytes )
             {
-                buff_index += j;
+                break;
             }
-            else
+            batch_bytes += j;
+            ++batch_nb;
+        }
+
+        /* send when the datagram is full, when the oldest packet has been held long enough, or for a status report */
+        flush = send_report;
+        if( stage_nb > 0 )
+        {
+            lgw_get_instcnt( &now_count_us );
+            held_us = now_count_us - rxpkt[stage_head].irq_count_us;
+            if( ( batch_nb < stage_nb ) || ( batch_nb >= push_max_pkt ) || ( held_us >= push_hold_us ) )
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] snprintf failed line %u\n", ( __LINE__ - 4 ) );
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+                flush = true;
             }
+        }
 
-            /* Packet concentrator channel, RF chain & RX frequency, 34-36 useful chars */
-            j = snprintf( ( char* ) ( buff_up + buff_index ), TX_BUFF_SIZE - buff_index,
-                          ",\"chan\":%1u,\"rfch\":%1u,\"freq\":%.6lf", p->if_chain, p->rf_chain,
-                          ( ( double ) p->freq_hz / 1e6 ) );
-            if( j > 0 )
+        /* replay the stored packets at a limited pace once the server is reachable again */
+        replay_due     = false;
+        replay_wait_ms = FETCH_WAIT_MS;
+        if( ( online == true ) && ( uplink_store_is_empty( ) == false ) )
+        {
+            replay_now_us = esp_timer_get_time( );
+            if( ( replay_now_us - replay_last_us ) >= replay_interval_us )
             {
-                buff_index += j;
+                replay_due     = true;
+                replay_last_us = replay_now_us;
+                flush          = true;
             }
             else
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] snprintf failed line %u\n", ( __LINE__ - 4 ) );
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+                replay_wait_ms = ( uint32_t ) ( ( replay_last_us + replay_interval_us - replay_now_us + 999 ) / 1000 );
             }
+        }
 
-            /* Packet status, 9-10 useful chars */
-            switch( p->status )
-            {
-            case STAT_CRC_OK:
-                memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"stat\":1", 9 );
-                buff_index += 9;
-                break;
-            case STAT_CRC_BAD:
-                memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"stat\":-1", 10 );
-                buff_index += 10;
-                break;
-            case STAT_NO_CRC:
-                memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"stat\":0", 9 );
-                buff_index += 9;
-                break;
-            default:
-                ESP_LOGE( TAG_UP, "ERROR: [up] received packet with unknown status 0x%02X\n", p->status );
-                memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"stat\":?", 9 );
-                buff_index += 9;
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-            }
+        /* wait for the next radio interrupt, the end of the hold time of the oldest staged packet or the next replay */
+        if( flush == false )
+        {
+            j = ( stage_nb == 0 ) ? FETCH_WAIT_MS : ( ( push_hold_us - held_us + 999 ) / 1000 );
+            lgw_wait_irq( ( ( uint32_t ) j < replay_wait_ms ) ? ( uint32_t ) j : replay_wait_ms );
+            continue;
+        }
 
-            /* Packet modulation, 13-14 useful chars */
-            if( p->modulation == MOD_LORA )
-            {
-                memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"modu\":\"LORA\"", 14 );
-                buff_index += 14;
+        /* get timestamp for statistics */
+        t = time( NULL );
+        strftime( stat_timestamp, sizeof stat_timestamp, "%F %T %Z", gmtime( &t ) );
 
-                /* Lora datarate & bandwidth, 16-19 useful chars */
-                switch( p->datarate )
-                {
-                case DR_LORA_SF5:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF5", 12 );
-                    buff_index += 12;
-                    break;
-                case DR_LORA_SF6:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF6", 12 );
-                    buff_index += 12;
-                    break;
-                case DR_LORA_SF7:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF7", 12 );
-                    buff_index += 12;
-                    break;
-                case DR_LORA_SF8:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF8", 12 );
-                    buff_index += 12;
-                    break;
-                case DR_LORA_SF9:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF9", 12 );
-                    buff_index += 12;
-                    break;
-                case DR_LORA_SF10:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF10", 13 );
-                    buff_index += 13;
-                    break;
-                case DR_LORA_SF11:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF11", 13 );
-                    buff_index += 13;
-                    break;
-                case DR_LORA_SF12:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF12", 13 );
-                    buff_index += 13;
-                    break;
-                default:
-                    ESP_LOGE( TAG_UP, "ERROR: [up] lora packet with unknown datarate 0x%02lX\n", p->datarate );
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"datr\":\"SF?", 12 );
-                    buff_index += 12;
-                    wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-                }
-                switch( p->bandwidth )
-                {
-                case BW_125KHZ:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "BW125\"", 6 );
-                    buff_index += 6;
-                    break;
-                case BW_250KHZ:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "BW250\"", 6 );
-                    buff_index += 6;
-                    break;
-                case BW_500KHZ:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "BW500\"", 6 );
-                    buff_index += 6;
-                    break;
-                default:
-                    ESP_LOGE( TAG_UP, "ERROR: [up] lora packet with unknown bandwidth 0x%02X\n", p->bandwidth );
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "BW?\"", 4 );
-                    buff_index += 4;
-                    wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-                }
+        /* start composing datagram with the header */
+        token_h    = ( uint8_t ) rand( ); /* random token */
+        token_l    = ( uint8_t ) rand( ); /* random token */
+        buff_up[1] = token_h;
+        buff_up[2] = token_l;
+        buff_index = 12; /* 12-byte header */
 
-                /* Packet ECC coding rate, 11-13 useful chars */
-                switch( p->coderate )
-                {
-                case CR_LORA_4_5:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"4/5\"", 13 );
-                    buff_index += 13;
-                    break;
-                case CR_LORA_4_6:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"4/6\"", 13 );
-                    buff_index += 13;
-                    break;
-                case CR_LORA_4_7:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"4/7\"", 13 );
-                    buff_index += 13;
-                    break;
-                case CR_LORA_4_8:
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"4/8\"", 13 );
-                    buff_index += 13;
-                    break;
-                case 0: /* treat the CR0 case (mostly false sync) */
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"OFF\"", 13 );
-                    buff_index += 13;
-                    break;
-                default:
-                    ESP_LOGE( TAG_UP, "ERROR: [up] lora packet with unknown coderate 0x%02X\n", p->coderate );
-                    memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"codr\":\"?\"", 11 );
-                    buff_index += 11;
-                    wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-                }
+        /* start of JSON structure */
+        memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) "{\"rxpk\":[", 9 );
+        buff_index += 9;
 
-                /* Lora SNR */
-                j = snprintf( ( char* ) ( buff_up + buff_index ), TX_BUFF_SIZE - buff_index, ",\"lsnr\":%.1f", p->snr );
-                if( j > 0 )
-                {
-                    buff_index += j;
-                }
-                else
-                {
-                    ESP_LOGE( TAG_UP, "ERROR: [up] snprintf failed line %u\n", ( __LINE__ - 4 ) );
-                    wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
-                }
-            }
-            else
+        /* serialize Lora packets metadata and payload */
+        pkt_in_dgram = 0;
+        for( i = 0; i < ( int ) batch_nb; ++i )
+        {
+            p = &rxpkt[( stage_head + i ) % NB_PKT_MAX];
+
+            /* add inter-packet separator if necessary */
+            if( pkt_in_dgram > 0 )
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] received packet with unknown modulation 0x%02X\n", p->modulation );
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+                buff_up[buff_index] = ',';
+                ++buff_index;
             }
 
-            /* Channel RSSI, payload size, 18-23 useful chars */
-            j = snprintf( ( char* ) ( buff_up + buff_index ), TX_BUFF_SIZE - buff_index, ",\"rssi\":%.0f,\"size\":%u",
-                          roundf( p->rssic ), p->size );
+            /* serialize metadata and payload, braces included */
+            lgw_trace( LGW_TRACE_UP_SERIALIZE, p->irq_count_us );
+            j = rxpk_serialize( p, NULL, buff_up + buff_index, TX_BUFF_SIZE - buff_index );
             if( j > 0 )
             {
                 buff_index += j;
             }
             else
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] snprintf failed line %u\n", ( __LINE__ - 4 ) );
+                ESP_LOGE( TAG_UP,
+                          "ERROR: [up] failed to serialize packet (status 0x%02X, modulation 0x%02X, datarate 0x%02lX, "
+                          "bandwidth 0x%02X, coderate 0x%02X)\n",
+                          p->status, p->modulation, p->datarate, p->bandwidth, p->coderate );
                 wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
             }
+            pkt_irq_count_us[pkt_in_dgram] = p->irq_count_us;
+            ++pkt_in_dgram;
+        }
 
-            /* Packet base64-encoded payload, 14-350 useful chars */
-            memcpy( ( void* ) ( buff_up + buff_index ), ( void* ) ",\"data\":\"", 9 );
-            buff_index += 9;
-            j = bin_to_b64( p->payload, p->size, ( char* ) ( buff_up + buff_index ),
-                            341 ); /* 255 bytes = 340 chars in b64 + null char */
-            if( j >= 0 )
+        /* release the serialized packets from the staging ring */
+        stage_head = ( stage_head + batch_nb ) % NB_PKT_MAX;
+        stage_nb -= batch_nb;
+
+        /* add the oldest stored packets, with their original tmst and their reception time, in the room left */
+        replay_in_dgram = 0;
+        while( ( replay_due == true ) && ( pkt_in_dgram < push_max_pkt ) &&
+               ( uplink_store_peek( &replay_pkt, &rx_tv ) == true ) )
+        {
+            j = rxpk_size_estimate( &replay_pkt ) + RXPK_TIME_SIZE;
+            if( ( pkt_in_dgram > 0 ) && ( ( batch_bytes + j ) > push_max_bytes ) )
             {
-                buff_index += j;
+                break;
             }
-            else
+            batch_bytes += j;
+
+            /* add inter-packet separator if necessary, only kept if the packet is serialized */
+            sep = 0;
+            if( pkt_in_dgram > 0 )
             {
-                ESP_LOGE( TAG_UP, "ERROR: [up] bin_to_b64 failed line %u\n", ( __LINE__ - 4 ) );
-                wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+                buff_up[buff_index] = ',';
+                sep                 = 1;
             }
-            buff_up[buff_index] = '"';
-            ++buff_index;
-
-            /* End of packet serialization */
-            buff_up[buff_index] = '}';
-            ++buff_index;
-            ++pkt_in_dgram;
-        }
-
-        /* restart fetch sequence without sending empty JSON if all packets have been filtered out */
-        if( pkt_in_dgram == 0 )
-        {
-            if( send_report == true )
+            j = rxpk_serialize( &replay_pkt, &rx_tv, buff_up + buff_index + sep, TX_BUFF_SIZE - buff_index - sep );
+            if( j > 0 )
             {
-                /* need to clean up the beginning of the payload */
-                buff_index -= 8; /* removes "rxpk":[ */
+                buff_index += sep + j;
+                ++pkt_in_dgram;
+                ++replay_in_dgram;
             }
             else
             {
-                /* all packet have been filtered out and no report, restart loop */
-                continue;
+                ESP_LOGW( TAG_UP, "WARNING: [up] failed to serialize stored packet, dropped\n" );
             }
+            uplink_store_pop( );
+        }
+
+        /* no staged packets, this datagram only carries the status report */
+        if( pkt_in_dgram == 0 )
+        {
+            /* need to clean up the beginning of the payload */
+            buff_index -= 8; /* removes "rxpk":[ */
         }
         else
         {
@@ -970,118 +1539,185 @@ void thread_up( void )
 
         printf( "\nJSON up: %s\n", ( char* ) ( buff_up + 12 ) ); /* DEBUG: display JSON payload */
 
+        /* register the datagram before sending it, its PUSH_ACK is matched asynchronously by thread_net */
+        pthread_mutex_lock( &mx_push_inflight );
+        f = &push_inflight[push_inflight_next];
+        lgw_get_instcnt( &( f->send_count_us ) );
+        f->pending         = true;
+        f->token_h         = token_h;
+        f->token_l         = token_l;
+        f->nb_pkt          = pkt_in_dgram - replay_in_dgram;
+        memcpy( f->pkt_id, pkt_irq_count_us, f->nb_pkt * sizeof( uint32_t ) );
+        push_inflight_next = ( push_inflight_next + 1 ) % PUSH_INFLIGHT_NB;
+        pthread_mutex_unlock( &mx_push_inflight );
+
         /* send datagram to server */
         j = send( sock_up, ( void* ) buff_up, buff_index, 0 );
         if( j < 0 )
         {
             ESP_LOGE( TAG_UP, "ERROR: [up] failed to send datagram to server - %s\n", strerror( errno ) );
+            pthread_mutex_lock( &mx_push_inflight );
+            f->pending = false; /* no acknowledge expected */
+            pthread_mutex_unlock( &mx_push_inflight );
+            backhaul_event( BACKHAUL_EVT_SEND_ERROR );
         }
-        clock_gettime( CLOCK_MONOTONIC, &send_time );
-        pthread_mutex_lock( &mx_meas_up );
-        meas_up_dgram_sent += 1;
-        meas_up_network_byte += buff_index;
-
-        /* wait for acknowledge (in 2 times, to catch extra packets) */
-        for( i = 0; i < 2; ++i )
+        else
         {
-            j = recv( sock_up, ( void* ) buff_up_ack, sizeof buff_up_ack, 0 );
-            clock_gettime( CLOCK_MONOTONIC, &recv_time );
-            if( j == -1 )
-            {
-                if( errno == EAGAIN )
-                { /* timeout */
-                    continue;
-                }
-                else
-                { /* server connection error */
-                    break;
-                }
-            }
-            else if( ( j < 4 ) || ( buff_up_ack[0] != PROTOCOL_VERSION ) || ( buff_up_ack[3] != PKT_PUSH_ACK ) )
-            {
-                ESP_LOGW( TAG_UP, "WARNING: [up] ignored invalid non-ACL packet\n" );
-                continue;
-            }
-            else if( ( buff_up_ack[1] != token_h ) || ( buff_up_ack[2] != token_l ) )
-            {
-                ESP_LOGW( TAG_UP, "WARNING: [up] ignored out-of sync ACK packet\n" );
-                continue;
-            }
-            else
-            {
-                ESP_LOGI( TAG_UP, "INFO: [up] PUSH_ACK received in %i ms",
-                          ( int ) ( 1000 * difftimespec( recv_time, send_time ) ) );
-                meas_up_ack_rcv += 1;
-                break;
-            }
+            backhaul_event( BACKHAUL_EVT_PUSH_SENT );
         }
-        pthread_mutex_unlock( &mx_meas_up );
-
-        /* Update display */
-        if( nb_pkt > 0 )
+        lgw_get_instcnt( &fwd_count_us );
+        for( i = 0; i < ( int ) ( pkt_in_dgram - replay_in_dgram ); i++ )
         {
-            display_stats_t rx_tx_stats = { .nb_rx = nb_pkt, .nb_tx = 0 };
-            display_update_statistics( &rx_tx_stats );
+            lgw_trace( LGW_TRACE_UP_SEND, pkt_irq_count_us[i] );
+        }
 
-            display_last_rx_packet_t last_rx_pkt = { .devaddr = mote_addr,
-                                                     .rssi    = rxpkt[0].rssic,
-                                                     .snr     = rxpkt[0].snr };
-            display_update_last_rx_packet( &last_rx_pkt );
+        /* same datagram, not serialized again, for the additional servers */
+        lns_fanout_push( buff_up, buff_index );
+
+        stats_counter_add( &meas_up_dgram_sent, 1 );
+        stats_counter_add( &meas_up_network_byte, buff_index );
+        stats_counter_add( &meas_up_batch_hist[pkt_in_dgram], 1 );
+        for( i = 0; i < ( int ) ( pkt_in_dgram - replay_in_dgram ); i++ )
+        {
+            latency_us = fwd_count_us - pkt_irq_count_us[i];
+            stats_counter_add( &meas_up_latency_nb, 1 );
+            stats_counter_add( &meas_up_latency_sum, latency_us );
+            stats_max_update( &meas_up_latency_max, latency_us );
+            stats_hist_add( meas_up_latency_hist, hist_up_latency_bound_us, ARRAY_SIZE( hist_up_latency_bound_us ),
+                            latency_us );
         }
     }
+
+    /* keep the stored packets across the restart, if the flash log is enabled */
+    i = uplink_store_sync( );
+    if( i > 0 )
+    {
+        ESP_LOGI( TAG_UP, "INFO: [up] %d stored packets moved to flash\n", i );
+    }
     ESP_LOGI( TAG_UP, "\nINFO: End of upstream thread\n" );
 }
 
 /* -------------------------------------------------------------------------- */
-/* --- THREAD 2: POLLING SERVER AND ENQUEUING PACKETS IN JIT QUEUE ---------- */
+/* --- THREAD 2: MULTIPLEXING THE SOCKETS OF ALL THE SERVERS ---------------- */
 
-static uint8_t buff_down[1000]; /* buffer to receive downstream packets */
-static uint8_t buff_req[12];    /* buffer to compose pull requests */
+static uint8_t                buff_req[12]; /* buffer to compose pull requests */
+static struct pull_resp_msg_s net_msg;      /* buffer to receive downstream packets, handed to the JIT thread */
 
-void thread_down( void )
+static void net_push_ack( int msg_len, uint32_t recv_count_us )
 {
-    int i; /* loop variables */
-
-    /* configuration and metadata for an outbound packet */
-    struct lgw_pkt_tx_s txpkt;
-    bool                sent_immediate = false; /* option to sent the packet immediately */
+    struct push_inflight_s* f;
+    uint32_t                rtt_us  = 0;
+    bool                    matched = false;
+    uint32_t                pkt_id[NB_PKT_MAX];
+    int                     nb_pkt = 0;
+    int                     i;
+
+    if( ( msg_len < 4 ) || ( buff_up_ack[0] != PROTOCOL_VERSION ) || ( buff_up_ack[3] != PKT_PUSH_ACK ) )
+    {
+        ESP_LOGW( TAG_UP, "WARNING: [up] ignored invalid non-ACL packet\n" );
+        return;
+    }
 
-    /* data buffers */
-    int msg_len;
+    /* look for the matching in-flight datagram, expired ones are kept to classify late ACKs */
+    pthread_mutex_lock( &mx_push_inflight );
+    for( i = 0; i < PUSH_INFLIGHT_NB; i++ )
+    {
+        f = &push_inflight[i];
+        if( ( f->pending == true ) && ( f->token_h == buff_up_ack[1] ) && ( f->token_l == buff_up_ack[2] ) )
+        {
+            f->pending = false;
+            rtt_us     = recv_count_us - f->send_count_us;
+            matched    = true;
+            nb_pkt     = f->nb_pkt;
+            memcpy( pkt_id, f->pkt_id, nb_pkt * sizeof( uint32_t ) );
+            break;
+        }
+    }
+    pthread_mutex_unlock( &mx_push_inflight );
 
-    /* local timekeeping variables */
-    struct timespec send_time; /* time of the pull request */
-    struct timespec recv_time; /* time of return from recv socket call */
+    if( matched == true )
+    {
+        if( rtt_us <= ( PUSH_TIMEOUT_MS * 1000 ) )
+        {
+            stats_counter_add( &meas_up_ack_rcv, 1 );
+        }
+        else
+        {
+            stats_counter_add( &meas_up_ack_late, 1 );
+        }
+        /* single writer, the sample is stored before being counted */
+        meas_up_ack_rtt[stats_counter_get( &meas_up_ack_rtt_nb ) % PUSH_RTT_SAMPLES_NB] = rtt_us;
+        stats_counter_add( &meas_up_ack_rtt_nb, 1 );
+        stats_hist_add( meas_up_ack_rtt_hist, hist_rtt_bound_us, ARRAY_SIZE( hist_rtt_bound_us ), rtt_us );
+    }
+    else
+    {
+        stats_counter_add( &meas_up_ack_nomatch, 1 );
+    }
 
-    /* protocol variables */
-    uint8_t token_h;         /* random token for acknowledgement matching */
-    uint8_t token_l;         /* random token for acknowledgement matching */
-    bool    req_ack = false; /* keep track of whether PULL_DATA was acknowledged or not */
+    for( i = 0; i < nb_pkt; i++ )
+    {
+        lgw_trace( LGW_TRACE_UP_ACK, pkt_id[i] );
+    }
 
-    /* JSON parsing variables */
-    JSON_Value*  root_val = NULL;
-    JSON_Object* txpk_obj = NULL;
-    JSON_Value*  val      = NULL; /* needed to detect the absence of some fields */
-    const char*  str;             /* pointer to sub-strings in the JSON data */
-    short        x0, x1;
+    if( matched == true )
+    {
+        backhaul_event( BACKHAUL_EVT_ACK );
+        ESP_LOGI( TAG_UP, "INFO: [up] PUSH_ACK received in %lu us", rtt_us );
+    }
+    else
+    {
+        ESP_LOGW( TAG_UP, "WARNING: [up] ignored out-of sync ACK packet\n" );
+    }
+}
 
-    /* auto-quit variable */
-    uint32_t autoquit_cnt = 0; /* count the number of PULL_DATA sent since the latest PULL_ACK */
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
-    /* Just In Time downlink */
-    uint32_t            current_concentrator_time;
-    enum jit_error_e    jit_result = JIT_ERROR_OK;
-    enum jit_pkt_type_e downlink_type;
-    enum jit_error_e    warning_result = JIT_ERROR_OK;
-    int32_t             warning_value  = 0;
+static void net_pull_resp( int sock, int msg_len, int64_t rx_us )
+{
+    net_msg.rx_us = rx_us;
+    net_msg.sock  = sock;
+    net_msg.size  = msg_len;
 
-    /* set downstream socket RX timeout */
-    i = setsockopt( sock_down, SOL_SOCKET, SO_RCVTIMEO, ( void* ) &pull_timeout, sizeof pull_timeout );
-    if( i != 0 )
+    /* the datagram is copied, the network thread never waits for the JIT thread */
+    if( xQueueSend( dw_queue, &net_msg, 0 ) != pdTRUE )
     {
-        ESP_LOGE( TAG_DOWN, "ERROR: [down] setsockopt returned %s\n", strerror( errno ) );
-        wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+        stats_counter_add( &meas_dw_queue_drop, 1 );
+        ESP_LOGW( TAG_NET, "WARNING: [net] downstream queue full, PULL_RESP token[%d:%d] dropped\n", net_msg.buff[1],
+                  net_msg.buff[2] );
+        return;
     }
+    jit_wakeup( );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void thread_net( void )
+{
+    int            i; /* loop variables */
+    int            max_fd;
+    fd_set         fds;
+    struct timeval timeout;
+
+    /* data buffers */
+    int      msg_len;
+    int      sock; /* downstream socket of the server which sent the PULL_RESP */
+    uint32_t recv_count_us;
+
+    /* timers of the event loop, esp_timer time */
+    int64_t now_us;
+    int64_t wait_us;
+    int64_t send_us          = 0;  /* time of the pull request */
+    int64_t keepalive_due_us = 0;  /* time of the next pull request, right away */
+    int64_t reconnect_due_us = -1; /* time of the next connection attempt, negative if none is pending */
+
+    /* protocol variables */
+    uint8_t token_h = 0;     /* random token for acknowledgement matching */
+    uint8_t token_l = 0;     /* random token for acknowledgement matching */
+    bool    req_ack = false; /* keep track of whether PULL_DATA was acknowledged or not */
+
+    /* reconnection variable */
+    uint32_t pull_missed_cnt = 0; /* count the number of PULL_DATA sent since the latest PULL_ACK */
 
     /* pre-fill the pull request buffer with fixed fields */
     buff_req[0]                     = PROTOCOL_VERSION;
@@ -1089,447 +1725,175 @@ void thread_down( void )
     *( uint32_t* ) ( buff_req + 4 ) = net_mac_h;
     *( uint32_t* ) ( buff_req + 8 ) = net_mac_l;
 
-    /* JIT queue initialization */
-    for( i = 0; i < LGW_RF_CHAIN_NB; i++ )
-    {
-        jit_queue_init( &jit_queue[i] );
-    }
-
     while( !exit_sig )
     {
-        // ESP_LOGI(TAG_DOWN, "DOWN");
+        now_us = esp_timer_get_time( );
 
-        /* auto-quit if the threshold is crossed */
-        if( ( autoquit_threshold > 0 ) && ( autoquit_cnt >= autoquit_threshold ) )
+        /* keep-alive timer: poll all the servers, the primary one only if it is not about to be left */
+        if( now_us >= keepalive_due_us )
         {
-            exit_sig = true;
-            ESP_LOGW( TAG_DOWN, "WARNING: [down] the last %lu PULL_DATA were not ACKed, exiting application\n",
-                      autoquit_threshold );
-            break;
-        }
-
-        /* generate random token for request */
-        token_h     = ( uint8_t ) rand( ); /* random token */
-        token_l     = ( uint8_t ) rand( ); /* random token */
-        buff_req[1] = token_h;
-        buff_req[2] = token_l;
+            keepalive_due_us = now_us + ( ( int64_t ) keepalive_time * 1000000 );
 
-        /* send PULL_DATA request and record time */
-        i = send( sock_down, ( void* ) buff_req, sizeof buff_req, 0 );
-        if( i < 0 )
-        {
-            ESP_LOGE( TAG_DOWN, "ERROR: [down] failed to send PULL_DATA to server - %s\n", strerror( errno ) );
-        }
-        clock_gettime( CLOCK_MONOTONIC, &send_time );
-        pthread_mutex_lock( &mx_meas_dw );
-        meas_dw_pull_sent += 1;
-        pthread_mutex_unlock( &mx_meas_dw );
-        req_ack = false;
-        autoquit_cnt++;
-
-        /* listen to packets and process them until a new PULL request must be sent */
-        recv_time = send_time;
-        while( ( int ) difftimespec( recv_time, send_time ) < keepalive_time )
-        {
-            /* try to receive a datagram */
-            msg_len = recv( sock_down, ( void* ) buff_down, ( sizeof buff_down ) - 1, 0 );
-            clock_gettime( CLOCK_MONOTONIC, &recv_time );
-
-            /* if no network message was received, got back to listening sock_down socket */
-            if( msg_len == -1 )
+            /* the previous PULL_DATA was not acknowledged, store the uplinks until the server answers again */
+            if( pull_missed_cnt > 0 )
             {
-                // ESP_LOGW(TAG_DOWN, "WARNING: [down] recv returned %s\n", strerror(errno)); /* too verbose */
-                continue;
+                backhaul_event( BACKHAUL_EVT_PULL_MISSED );
             }
 
-            /* if the datagram does not respect protocol, just ignore it */
-            if( ( msg_len < 4 ) || ( buff_down[0] != PROTOCOL_VERSION ) ||
-                ( ( buff_down[3] != PKT_PULL_RESP ) && ( buff_down[3] != PKT_PULL_ACK ) ) )
+            /* the server stopped answering, resolve its address again or move to the next server, after a backoff */
+            if( ( pull_missed_cnt >= RECONNECT_PULL_MISSED ) && ( reconnect_due_us < 0 ) )
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] ignoring invalid packet len=%d, protocol_version=%d, id=%d\n",
-                          msg_len, buff_down[0], buff_down[3] );
-                continue;
+                ESP_LOGW( TAG_NET, "WARNING: [net] the last %d PULL_DATA were not ACKed, reconnecting\n",
+                          RECONNECT_PULL_MISSED );
+                reconnect_due_us = now_us + ( ( int64_t ) lns_supervisor_next( ) * 1000 );
             }
 
-            /* if the datagram is an ACK, check token */
-            if( buff_down[3] == PKT_PULL_ACK )
+            if( reconnect_due_us < 0 )
             {
-                if( ( buff_down[1] == token_h ) && ( buff_down[2] == token_l ) )
+                /* generate random token for request */
+                token_h     = ( uint8_t ) rand( ); /* random token */
+                token_l     = ( uint8_t ) rand( ); /* random token */
+                buff_req[1] = token_h;
+                buff_req[2] = token_l;
+
+                /* send PULL_DATA request and record time */
+                i = send( sock_down, ( void* ) buff_req, sizeof buff_req, 0 );
+                if( i < 0 )
                 {
-                    if( req_ack )
-                    {
-                        ESP_LOGI( TAG_DOWN, "INFO: [down] duplicate ACK received :)\n" );
-                    }
-                    else
-                    { /* if that packet was not already acknowledged */
-                        req_ack      = true;
-                        autoquit_cnt = 0;
-                        pthread_mutex_lock( &mx_meas_dw );
-                        meas_dw_ack_rcv += 1;
-                        pthread_mutex_unlock( &mx_meas_dw );
-                        ESP_LOGI( TAG_DOWN, "INFO: [down] PULL_ACK received in %i ms",
-                                  ( int ) ( 1000 * difftimespec( recv_time, send_time ) ) );
-                    }
-                }
-                else
-                { /* out-of-sync token */
-                    ESP_LOGI( TAG_DOWN, "INFO: [down] received out-of-sync ACK\n" );
+                    ESP_LOGE( TAG_NET, "ERROR: [net] failed to send PULL_DATA to server - %s\n", strerror( errno ) );
+                    backhaul_event( BACKHAUL_EVT_SEND_ERROR );
                 }
-                continue;
+                send_us = now_us;
+                stats_counter_add( &meas_dw_pull_sent, 1 );
+                req_ack = false;
+                pull_missed_cnt++;
             }
 
-            /* the datagram is a PULL_RESP */
-            buff_down[msg_len] = 0; /* add string terminator, just to be safe */
-            ESP_LOGI( TAG_DOWN, "INFO: [down] PULL_RESP received  - token[%d:%d] :)", buff_down[1],
-                      buff_down[2] );                                   /* very verbose */
-            printf( "\nJSON down: %s\n", ( char* ) ( buff_down + 4 ) ); /* DEBUG: display JSON payload */
+            /* the additional servers which did not answer the previous requests are resolved again, in background */
+            lns_fanout_pull( );
+        }
 
-            /* initialize TX struct and try to parse JSON */
-            memset( &txpkt, 0, sizeof txpkt );
-            root_val = json_parse_string_with_comments( ( const char* ) ( buff_down + 4 ) ); /* JSON offset */
-            if( root_val == NULL )
+        /* reconnection timer: the address was resolved in background, the next server is tried after a new backoff */
+        if( ( reconnect_due_us >= 0 ) && ( now_us >= reconnect_due_us ) )
+        {
+            i = lns_supervisor_reconnect( );
+            if( i == 0 )
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] invalid JSON, TX aborted\n" );
+                reconnect_due_us = -1;
+                pull_missed_cnt  = 0;
+                keepalive_due_us = 0; /* poll the new server right away */
                 continue;
             }
-
-            /* look for JSON sub-object 'txpk' */
-            txpk_obj = json_object_get_object( json_value_get_object( root_val ), "txpk" );
-            if( txpk_obj == NULL )
+            if( i > 0 )
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no \"txpk\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-
-            /* Parse "immediate" tag, or target timestamp, or UTC time to be converted by GPS (mandatory) */
-            i = json_object_get_boolean( txpk_obj,
-                                         "imme" ); /* can be 1 if true, 0 if false, or -1 if not a JSON boolean */
-            if( i == 1 )
-            {
-                /* TX procedure: send immediately */
-                sent_immediate = true;
-                downlink_type  = JIT_PKT_TYPE_DOWNLINK_CLASS_C;
-                ESP_LOGI( TAG_DOWN, "INFO: [down] a packet will be sent in \"immediate\" mode\n" );
+                reconnect_due_us = now_us + ( RECONNECT_POLL_MS * 1000 ); /* resolution still in progress */
             }
             else
             {
-                sent_immediate = false;
-                val            = json_object_get_value( txpk_obj, "tmst" );
-                if( val != NULL )
-                {
-                    /* TX procedure: send on timestamp value */
-                    txpkt.count_us = ( uint32_t ) json_value_get_number( val );
-
-                    /* Concentrator timestamp is given, we consider it is a Class A downlink */
-                    downlink_type = JIT_PKT_TYPE_DOWNLINK_CLASS_A;
-                }
-                else
-                {
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.tmst\" objects in JSON, TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-            }
-
-            /* Parse "No CRC" flag (optional field) */
-            val = json_object_get_value( txpk_obj, "ncrc" );
-            if( val != NULL )
-            {
-                txpkt.no_crc = ( bool ) json_value_get_boolean( val );
-            }
-
-            /* Parse "No header" flag (optional field) */
-            val = json_object_get_value( txpk_obj, "nhdr" );
-            if( val != NULL )
-            {
-                txpkt.no_header = ( bool ) json_value_get_boolean( val );
+                reconnect_due_us = now_us + ( ( int64_t ) lns_supervisor_next( ) * 1000 );
             }
+        }
 
-            /* parse target frequency (mandatory) */
-            val = json_object_get_value( txpk_obj, "freq" );
-            if( val == NULL )
-            {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.freq\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-            txpkt.freq_hz = ( uint32_t )( ( double ) ( 1.0e6 ) * json_value_get_number( val ) );
+        /* wait for a datagram on any socket until the next timer expires */
+        FD_ZERO( &fds );
+        FD_SET( sock_up, &fds );
+        FD_SET( sock_down, &fds );
+        max_fd = ( sock_up > sock_down ) ? sock_up : sock_down;
+        max_fd = lns_fanout_fd_set( &fds, max_fd );
+        wait_us = keepalive_due_us - now_us;
+        if( ( reconnect_due_us >= 0 ) && ( ( reconnect_due_us - now_us ) < wait_us ) )
+        {
+            wait_us = reconnect_due_us - now_us;
+        }
+        if( wait_us > ( NET_WAIT_MS * 1000 ) )
+        {
+            wait_us = NET_WAIT_MS * 1000; /* only bounds the exit latency */
+        }
+        if( wait_us < 0 )
+        {
+            wait_us = 0;
+        }
+        timeout.tv_sec  = ( time_t ) ( wait_us / 1000000 );
+        timeout.tv_usec = ( suseconds_t ) ( wait_us % 1000000 );
+        i               = select( max_fd + 1, &fds, NULL, NULL, &timeout );
+        if( i < 0 )
+        {
+            ESP_LOGE( TAG_NET, "ERROR: [net] select returned %s\n", strerror( errno ) );
+            vTaskDelay( pdMS_TO_TICKS( NET_WAIT_MS ) ); /* do not spin on it */
+            continue;
+        }
+        if( i == 0 )
+        {
+            continue; /* a timer expired */
+        }
 
-            /* parse RF chain used for TX (mandatory) */
-            val = json_object_get_value( txpk_obj, "rfch" );
-            if( val == NULL )
-            {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.rfch\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-            txpkt.rf_chain = ( uint8_t ) json_value_get_number( val );
-            if( tx_enable[txpkt.rf_chain] == false )
+        /* PUSH_ACK from the server in use */
+        if( FD_ISSET( sock_up, &fds ) )
+        {
+            msg_len = recv( sock_up, ( void* ) buff_up_ack, sizeof buff_up_ack, MSG_DONTWAIT );
+            lgw_get_instcnt( &recv_count_us );
+            if( msg_len >= 0 )
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] TX is not enabled on RF chain %u, TX aborted\n", txpkt.rf_chain );
-                json_value_free( root_val );
-                continue;
+                net_push_ack( msg_len, recv_count_us );
             }
+        }
 
-            /* parse TX power (optional field) */
-            val = json_object_get_value( txpk_obj, "powe" );
-            if( val != NULL )
+        /* PULL_ACK or PULL_RESP from the server in use */
+        if( FD_ISSET( sock_down, &fds ) )
+        {
+            msg_len = recv( sock_down, ( void* ) net_msg.buff, ( sizeof net_msg.buff ) - 1, MSG_DONTWAIT );
+            now_us  = esp_timer_get_time( );
+            if( msg_len < 0 )
             {
-                txpkt.rf_power = ( int8_t ) json_value_get_number( val ) - antenna_gain;
+                // ESP_LOGW(TAG_NET, "WARNING: [net] recv returned %s\n", strerror(errno)); /* too verbose */
             }
-
-            /* Parse modulation (mandatory) */
-            str = json_object_get_string( txpk_obj, "modu" );
-            if( str == NULL )
+            else if( ( msg_len < 4 ) || ( net_msg.buff[0] != PROTOCOL_VERSION ) ||
+                     ( ( net_msg.buff[3] != PKT_PULL_RESP ) && ( net_msg.buff[3] != PKT_PULL_ACK ) ) )
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.modu\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
+                /* if the datagram does not respect protocol, just ignore it */
+                ESP_LOGW( TAG_NET, "WARNING: [net] ignoring invalid packet len=%d, protocol_version=%d, id=%d\n",
+                          msg_len, net_msg.buff[0], net_msg.buff[3] );
             }
-            if( strcmp( str, "LORA" ) == 0 )
+            else if( net_msg.buff[3] == PKT_PULL_ACK )
             {
-                /* Lora modulation */
-                txpkt.modulation = MOD_LORA;
-
-                /* Parse Lora spreading-factor and modulation bandwidth (mandatory) */
-                str = json_object_get_string( txpk_obj, "datr" );
-                if( str == NULL )
-                {
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.datr\" object in JSON, TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-                i = sscanf( str, "SF%2hdBW%3hd", &x0, &x1 );
-                if( i != 2 )
-                {
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] format error in \"txpk.datr\", TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-                switch( x0 )
-                {
-                case 5:
-                    txpkt.datarate = DR_LORA_SF5;
-                    break;
-                case 6:
-                    txpkt.datarate = DR_LORA_SF6;
-                    break;
-                case 7:
-                    txpkt.datarate = DR_LORA_SF7;
-                    break;
-                case 8:
-                    txpkt.datarate = DR_LORA_SF8;
-                    break;
-                case 9:
-                    txpkt.datarate = DR_LORA_SF9;
-                    break;
-                case 10:
-                    txpkt.datarate = DR_LORA_SF10;
-                    break;
-                case 11:
-                    txpkt.datarate = DR_LORA_SF11;
-                    break;
-                case 12:
-                    txpkt.datarate = DR_LORA_SF12;
-                    break;
-                default:
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] format error in \"txpk.datr\", invalid SF, TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-                switch( x1 )
-                {
-                case 125:
-                    txpkt.bandwidth = BW_125KHZ;
-                    break;
-                case 250:
-                    txpkt.bandwidth = BW_250KHZ;
-                    break;
-                case 500:
-                    txpkt.bandwidth = BW_500KHZ;
-                    break;
-                default:
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] format error in \"txpk.datr\", invalid BW, TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-
-                /* Parse ECC coding rate (optional field) */
-                str = json_object_get_string( txpk_obj, "codr" );
-                if( str == NULL )
-                {
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.codr\" object in json, TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-                if( strcmp( str, "4/5" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_5;
-                else if( strcmp( str, "4/6" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_6;
-                else if( strcmp( str, "2/3" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_6;
-                else if( strcmp( str, "4/7" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_7;
-                else if( strcmp( str, "4/8" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_8;
-                else if( strcmp( str, "1/2" ) == 0 )
-                    txpkt.coderate = CR_LORA_4_8;
-                else
-                {
-                    ESP_LOGW( TAG_DOWN, "WARNING: [down] format error in \"txpk.codr\", TX aborted\n" );
-                    json_value_free( root_val );
-                    continue;
-                }
-
-                /* Parse signal polarity switch (optional field) */
-                val = json_object_get_value( txpk_obj, "ipol" );
-                if( val != NULL )
+                if( ( net_msg.buff[1] == token_h ) && ( net_msg.buff[2] == token_l ) )
                 {
-                    txpkt.invert_pol = ( bool ) json_value_get_boolean( val );
-                }
-
-                /* parse Lora preamble length (optional field, optimum min value enforced) */
-                val = json_object_get_value( txpk_obj, "prea" );
-                if( val != NULL )
-                {
-                    i = ( int ) json_value_get_number( val );
-                    if( i >= MIN_LORA_PREAMBLE )
+                    if( req_ack )
                     {
-                        txpkt.preamble = ( uint16_t ) i;
+                        ESP_LOGI( TAG_NET, "INFO: [net] duplicate ACK received :)\n" );
                     }
                     else
-                    {
-                        txpkt.preamble = ( uint16_t ) MIN_LORA_PREAMBLE;
+                    { /* if that packet was not already acknowledged */
+                        req_ack         = true;
+                        pull_missed_cnt = 0;
+                        backhaul_event( BACKHAUL_EVT_ACK );
+                        lns_supervisor_ack( );
+                        stats_counter_add( &meas_dw_ack_rcv, 1 );
+                        stats_hist_add( meas_dw_ack_rtt_hist, hist_rtt_bound_us, ARRAY_SIZE( hist_rtt_bound_us ),
+                                        ( uint32_t ) ( now_us - send_us ) );
+                        ESP_LOGI( TAG_NET, "INFO: [net] PULL_ACK received in %i ms",
+                                  ( int ) ( ( now_us - send_us ) / 1000 ) );
                     }
                 }
                 else
-                {
-                    txpkt.preamble = ( uint16_t ) STD_LORA_PREAMBLE;
+                { /* out-of-sync token */
+                    ESP_LOGI( TAG_NET, "INFO: [net] received out-of-sync ACK\n" );
                 }
             }
             else
             {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] invalid modulation in \"txpk.modu\", TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-
-            /* Parse payload length (mandatory) */
-            val = json_object_get_value( txpk_obj, "size" );
-            if( val == NULL )
-            {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.size\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-            txpkt.size = ( uint16_t ) json_value_get_number( val );
-
-            /* Parse payload data (mandatory) */
-            str = json_object_get_string( txpk_obj, "data" );
-            if( str == NULL )
-            {
-                ESP_LOGW( TAG_DOWN, "WARNING: [down] no mandatory \"txpk.data\" object in JSON, TX aborted\n" );
-                json_value_free( root_val );
-                continue;
-            }
-            i = b64_to_bin( str, strlen( str ), txpkt.payload, sizeof txpkt.payload );
-            if( i != txpkt.size )
-            {
-                ESP_LOGW( TAG_DOWN,
-                          "WARNING: [down] mismatch between .size and .data size once converter to binary\n" );
-            }
-
-            /* free the JSON parse tree from memory */
-            json_value_free( root_val );
-
-            /* select TX mode */
-            if( sent_immediate )
-            {
-                txpkt.tx_mode = IMMEDIATE;
-            }
-            else
-            {
-                txpkt.tx_mode = TIMESTAMPED;
-            }
-
-            /* record measurement data */
-            pthread_mutex_lock( &mx_meas_dw );
-            meas_dw_dgram_rcv += 1;          /* count only datagrams with no JSON errors */
-            meas_dw_network_byte += msg_len; /* meas_dw_network_byte */
-            meas_dw_payload_byte += txpkt.size;
-            pthread_mutex_unlock( &mx_meas_dw );
-
-            /* reset error/warning results */
-            jit_result = warning_result = JIT_ERROR_OK;
-            warning_value               = 0;
-
-            /* check TX frequency before trying to queue packet */
-            uint32_t tx_freq_hz_min, tx_freq_hz_max;
-            lgw_get_min_max_freq_hz( &tx_freq_hz_min, &tx_freq_hz_max );
-            if( ( txpkt.freq_hz < tx_freq_hz_min ) || ( txpkt.freq_hz > tx_freq_hz_max ) )
-            {
-                jit_result = JIT_ERROR_TX_FREQ;
-                ESP_LOGE( TAG_DOWN, "ERROR: Packet REJECTED, unsupported frequency - %lu (min:%lu,max:%lu)\n",
-                          txpkt.freq_hz, tx_freq_hz_min, tx_freq_hz_max );
-            }
-
-            /* check TX power before trying to queue packet, send a warning if not supported */
-            if( jit_result == JIT_ERROR_OK )
-            {
-                int8_t tx_power_min, tx_power_max;
-                lgw_get_min_max_power_dbm( &tx_power_min, &tx_power_max );
-                if( txpkt.rf_power < tx_power_min )
-                {
-                    /* this RF power is not supported, throw a warning, and use the closest lower power supported */
-                    warning_result = JIT_ERROR_TX_POWER;
-                    warning_value  = ( int32_t ) tx_power_min;
-                    ESP_LOGW( TAG_DOWN,
-                              "WARNING: Requested TX power is not supported (%ddBm), actual power used: %lddBm\n",
-                              txpkt.rf_power, warning_value );
-                    txpkt.rf_power = tx_power_min;
-                }
-                if( txpkt.rf_power > tx_power_max )
-                {
-                    /* this RF power is not supported, throw a warning, and use the closest lower power supported */
-                    warning_result = JIT_ERROR_TX_POWER;
-                    warning_value  = ( int32_t ) tx_power_max;
-                    ESP_LOGW( TAG_DOWN,
-                              "WARNING: Requested TX power is not supported (%ddBm), actual power used: %lddBm\n",
-                              txpkt.rf_power, warning_value );
-                    txpkt.rf_power = tx_power_max;
-                }
-            }
-
-            /* insert packet to be sent into JIT queue */
-            if( jit_result == JIT_ERROR_OK )
-            {
-                lgw_get_instcnt( &current_concentrator_time );
-                jit_result =
-                    jit_enqueue( &jit_queue[txpkt.rf_chain], current_concentrator_time, &txpkt, downlink_type );
-                if( jit_result != JIT_ERROR_OK )
-                {
-                    ESP_LOGE( TAG_DOWN, "ERROR: Packet REJECTED (jit error=%d)\n", jit_result );
-                }
-                else
-                {
-                    /* In case of a warning having been raised before, we notify it */
-                    jit_result = warning_result;
-                }
-                pthread_mutex_lock( &mx_meas_dw );
-                meas_nb_tx_requested += 1;
-                pthread_mutex_unlock( &mx_meas_dw );
+                net_pull_resp( sock_down, msg_len, now_us );
             }
+        }
 
-            /* Send acknoledge datagram to server */
-            i = send_tx_ack( buff_down[1], buff_down[2], jit_result, warning_value );
-            if( i < 0 )
-            {
-                ESP_LOGE( TAG_DOWN, "ERROR: Failed to send tx_ack datagram - %d\n", i );
-            }
+        /* acknowledges of the additional servers, and their downlinks if accepted */
+        msg_len = lns_fanout_recv( &fds, net_msg.buff, ( sizeof net_msg.buff ) - 1, &sock );
+        if( msg_len > 0 )
+        {
+            net_pull_resp( sock, msg_len, esp_timer_get_time( ) );
         }
     }
-    ESP_LOGI( TAG_DOWN, "\nINFO: End of downstream thread\n" );
+    ESP_LOGI( TAG_NET, "\nINFO: End of network thread\n" );
 }
 
 /* -------------------------------------------------------------------------- */
@@ -1557,7 +1921,20 @@ void print_tx_status( uint8_t tx_status )
     }
 }
 
-void thread_jit( void )
+static struct pull_resp_msg_s dw_msg; /* PULL_RESP being processed */
+
+/* sleep until the given delay has elapsed, or a PULL_RESP is received */
+static void jit_sleep( int32_t wait_us )
+{
+    esp_timer_start_once( jit_timer, ( uint64_t ) wait_us );
+    ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS( JIT_WAIT_MS ) + 1 );
+    esp_timer_stop( jit_timer ); /* not running anymore if it has woken the thread up */
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* hand the packets due by now to the radio */
+static void jit_dispatch( void )
 {
     int                 result = LGW_HAL_SUCCESS;
     struct lgw_pkt_tx_s pkt;
@@ -1567,110 +1944,171 @@ void thread_jit( void )
     enum jit_pkt_type_e pkt_type;
     uint8_t             tx_status;
     int                 i;
+    int                 k;
+    uint32_t            dispatch_us = 0;
+    int32_t             delay_us;
+    int32_t             lead_us;
+    int64_t             send_us;
 
-    while( !exit_sig )
+    for( i = 0; i < LGW_RF_CHAIN_NB; i++ )
     {
-        // ESP_LOGI(TAG_JIT, "JIT");
-        vTaskDelay( 10 / portTICK_PERIOD_MS );
+        /* the packet due is left in the queue while the previous TX is not over, lgw_send() would reject it */
+        if( jit_tx_busy( i ) == true )
+        {
+            continue;
+        }
 
-        for( i = 0; i < LGW_RF_CHAIN_NB; i++ )
+        /* transfer data and metadata to the concentrator, and schedule TX */
+        jit_next_dispatch( &jit_queue[i], &dispatch_us ); /* scheduled hand-off time of the packet to be peeked */
+        lgw_get_instcnt( &current_concentrator_time );
+        jit_result = jit_peek( &jit_queue[i], current_concentrator_time, &pkt_index );
+        if( jit_result == JIT_ERROR_OK )
         {
-            /* transfer data and metadata to the concentrator, and schedule TX */
-            lgw_get_instcnt( &current_concentrator_time );
-            jit_result = jit_peek( &jit_queue[i], current_concentrator_time, &pkt_index );
-            if( jit_result == JIT_ERROR_OK )
+            if( pkt_index > -1 )
             {
-                if( pkt_index > -1 )
+                jit_result = jit_dequeue( &jit_queue[i], pkt_index, &pkt, &pkt_type );
+                if( jit_result == JIT_ERROR_OK )
                 {
-                    jit_result = jit_dequeue( &jit_queue[i], pkt_index, &pkt, &pkt_type );
-                    if( jit_result == JIT_ERROR_OK )
+                    /* update beacon stats */
+                    if( pkt_type == JIT_PKT_TYPE_BEACON )
                     {
-                        /* update beacon stats */
-                        if( pkt_type == JIT_PKT_TYPE_BEACON )
-                        {
 #if 0
-                            /* Compensate breacon frequency with xtal error */
-                            pthread_mutex_lock(&mx_xcorr);
-                            pkt.freq_hz = (uint32_t)(xtal_correct * (double)pkt.freq_hz);
-                            MSG_DEBUG(DEBUG_BEACON, "beacon_pkt.freq_hz=%lu (xtal_correct=%.15lf)\n", pkt.freq_hz, xtal_correct);
-                            pthread_mutex_unlock(&mx_xcorr);
-
-                            /* Update statistics */
-                            pthread_mutex_lock(&mx_meas_dw);
-                            meas_nb_beacon_sent += 1;
-                            pthread_mutex_unlock(&mx_meas_dw);
-                            ESP_LOGI(TAG_JIT, "INFO: Beacon dequeued (count_us=%lu)\n", pkt.count_us);
+                        /* Compensate breacon frequency with xtal error */
+                        pthread_mutex_lock(&mx_xcorr);
+                        pkt.freq_hz = (uint32_t)(xtal_correct * (double)pkt.freq_hz);
+                        MSG_DEBUG(DEBUG_BEACON, "beacon_pkt.freq_hz=%lu (xtal_correct=%.15lf)\n", pkt.freq_hz, xtal_correct);
+                        pthread_mutex_unlock(&mx_xcorr);
+
+                        /* Update statistics */
+                        pthread_mutex_lock(&mx_meas_dw);
+                        meas_nb_beacon_sent += 1;
+                        pthread_mutex_unlock(&mx_meas_dw);
+                        ESP_LOGI(TAG_JIT, "INFO: Beacon dequeued (count_us=%lu)\n", pkt.count_us);
 #else
-                            ESP_LOGE( TAG_JIT, "NO SUPPORT FOR BEACONING\n" );
-                            continue;
+                        ESP_LOGE( TAG_JIT, "NO SUPPORT FOR BEACONING\n" );
+                        continue;
 #endif
-                        }
-
-                        /* check if concentrator is free for sending new packet */
-                        result = lgw_status( pkt.rf_chain, TX_STATUS, &tx_status );
-                        if( result == LGW_HAL_ERROR )
-                        {
-                            ESP_LOGW( TAG_JIT, "WARNING: [jit%d] lgw_status failed\n", i );
-                        }
-                        else
-                        {
-                            if( tx_status == TX_EMITTING )
-                            {
-                                ESP_LOGE( TAG_JIT, "ERROR: concentrator is currently emitting on rf_chain %d\n", i );
-                                print_tx_status( tx_status );
-                                continue;
-                            }
-                            else if( tx_status == TX_SCHEDULED )
-                            {
-                                ESP_LOGW(
-                                    TAG_JIT,
-                                    "WARNING: a downlink was already scheduled on rf_chain %d, overwritting it...\n",
-                                    i );
-                                print_tx_status( tx_status );
-                            }
-                            else
-                            {
-                                /* Nothing to do */
-                            }
-                        }
+                    }
 
-                        /* send packet to concentrator */
-                        pthread_mutex_lock( &mx_concent ); /* may have to wait for a fetch to finish */
-                        result = lgw_send( &pkt );
-                        pthread_mutex_unlock( &mx_concent ); /* free concentrator ASAP */
-                        if( result != LGW_HAL_SUCCESS )
-                        {
-                            pthread_mutex_lock( &mx_meas_dw );
-                            meas_nb_tx_fail += 1;
-                            pthread_mutex_unlock( &mx_meas_dw );
-                            ESP_LOGW( TAG_JIT, "WARNING: [jit] lgw_send failed on rf_chain %d\n", i );
-                            continue;
-                        }
-                        else
+                    /* send packet to concentrator */
+                    lgw_trace( LGW_TRACE_DW_LOCK, pkt.count_us );
+                    pthread_mutex_lock( &mx_concent ); /* may have to wait for a fetch to finish */
+                    lgw_get_instcnt( &current_concentrator_time );
+                    send_us = esp_timer_get_time( );
+                    result  = lgw_send( &pkt );
+                    send_us = esp_timer_get_time( ) - send_us;
+                    pthread_mutex_unlock( &mx_concent ); /* free concentrator ASAP */
+                    stats_hist_add( meas_dw_lgw_send_hist, hist_lgw_send_bound_us,
+                                    ARRAY_SIZE( hist_lgw_send_bound_us ), ( uint32_t ) send_us );
+
+                    /* time left to the radio before the TX start, a late packet is accounted in the first bucket */
+                    lead_us = ( int32_t ) ( pkt.count_us - current_concentrator_time );
+                    lead_us = ( lead_us > 0 ) ? lead_us : 0;
+                    stats_hist_add( meas_dw_jit_lead_hist, hist_jit_lead_bound_us,
+                                    ARRAY_SIZE( hist_jit_lead_bound_us ), ( uint32_t ) lead_us );
+
+                    /* delay between the scheduled and the actual hand-off to the radio */
+                    delay_us = ( int32_t ) ( current_concentrator_time - dispatch_us );
+                    k        = jit_delay_hist_index( delay_us );
+
+                    if( result != LGW_HAL_SUCCESS )
+                    {
+                        stats_counter_add( &meas_nb_tx_fail, 1 );
+                        stats_counter_add( &meas_dw_jit_delay_hist[k], 1 );
+                        ESP_LOGW( TAG_JIT, "WARNING: [jit] lgw_send failed on rf_chain %d\n", i );
+                        if( lgw_status( pkt.rf_chain, TX_STATUS, &tx_status ) == LGW_HAL_SUCCESS )
                         {
-                            pthread_mutex_lock( &mx_meas_dw );
-                            meas_nb_tx_ok += 1;
-                            pthread_mutex_unlock( &mx_meas_dw );
-                            MSG_DEBUG( DEBUG_PKT_FWD, "lgw_send done on rf_chain %d: count_us=%lu\n", i, pkt.count_us );
-
-                            /* Update display */
-                            display_stats_t rx_tx_stats = { .nb_rx = 0, .nb_tx = 1 };
-                            display_update_statistics( &rx_tx_stats );
+                            print_tx_status( tx_status );
                         }
+                        continue;
                     }
                     else
                     {
-                        ESP_LOGE( TAG_JIT, "ERROR: jit_dequeue failed on rf_chain %d with %d\n", i, jit_result );
+                        /* TX success is accounted when the radio reports the end of the TX */
+                        stats_counter_add( &meas_dw_jit_delay_hist[k], 1 );
+                        MSG_DEBUG( DEBUG_PKT_FWD, "lgw_send done on rf_chain %d: count_us=%lu\n", i, pkt.count_us );
                     }
                 }
+                else
+                {
+                    ESP_LOGE( TAG_JIT, "ERROR: jit_dequeue failed on rf_chain %d with %d\n", i, jit_result );
+                }
+            }
+        }
+        else if( jit_result == JIT_ERROR_EMPTY )
+        {
+            /* Do nothing, it can happen */
+        }
+        else
+        {
+            ESP_LOGE( TAG_JIT, "ERROR: jit_peek failed on rf_chain %d with %d\n", i, jit_result );
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void thread_jit( void )
+{
+    int              k;
+    int32_t          wait_us;
+    esp_err_t        esp_err;
+    enum jit_error_e dw_result     = JIT_ERROR_OK;
+    int32_t          warning_value = 0;
+
+    esp_timer_create_args_t jit_timer_args = { .callback = jit_timer_cb, .name = "jit" };
+
+    /* one-shot timer waking this thread up when the first packet of a queue has to be handed to the radio */
+    jit_timer_args.arg = xTaskGetCurrentTaskHandle( );
+    esp_err            = esp_timer_create( &jit_timer_args, &jit_timer );
+    if( esp_err != ESP_OK )
+    {
+        ESP_LOGE( TAG_JIT, "ERROR: [jit] failed to create timer - %s\n", esp_err_to_name( esp_err ) );
+        wait_on_error( LRHB_ERROR_OS, __LINE__ );
+    }
+    jit_task = ( TaskHandle_t ) jit_timer_args.arg;
+
+    while( !exit_sig )
+    {
+        /* sleep until the first packet of the queues has to be handed to the radio, a PULL_RESP received before it
+         * wakes the thread up to be processed */
+        wait_us = jit_next_wait_us( );
+        if( wait_us > 0 )
+        {
+            jit_sleep( wait_us );
+        }
+
+        /* account for the packet sent previously, its TX has ended by now if the radio is needed again */
+        jit_check_tx_report( );
+
+        /* transfer data and metadata to the concentrator, and schedule TX */
+        jit_dispatch( );
+
+        /* process all the PULL_RESP received meanwhile. Processing one may take up to JIT_DOWN_GUARD_MS, so a packet
+         * to be handed to the radio within that delay is dispatched first, the thread sleeping until then */
+        while( xQueueReceive( dw_queue, &dw_msg, 0 ) == pdTRUE )
+        {
+            while( ( wait_us = jit_next_wait_us( ) ) <= ( JIT_DOWN_GUARD_MS * 1000 ) )
+            {
+                if( wait_us > 0 )
+                {
+                    jit_sleep( wait_us ); /* a PULL_RESP received meanwhile is processed in this loop */
+                }
+                jit_check_tx_report( );
+                jit_dispatch( );
             }
-            else if( jit_result == JIT_ERROR_EMPTY )
+
+            /* same processing for all the servers, nothing is sent back if the datagram is invalid */
+            if( pull_resp_process( dw_msg.buff, dw_msg.size, dw_msg.rx_us, &dw_result, &warning_value ) != 0 )
             {
-                /* Do nothing, it can happen */
+                continue;
             }
-            else
+
+            /* Send acknoledge datagram to the server which sent the PULL_RESP */
+            k = send_tx_ack( dw_msg.sock, dw_msg.buff[1], dw_msg.buff[2], dw_result, warning_value );
+            if( k < 0 )
             {
-                ESP_LOGE( TAG_JIT, "ERROR: jit_peek failed on rf_chain %d with %d\n", i, jit_result );
+                ESP_LOGE( TAG_DOWN, "ERROR: Failed to send tx_ack datagram - %d\n", k );
             }
         }
     }
@@ -1685,13 +2123,9 @@ void thread_pktfwd( void )
     esp_err_t esp_err;
     float     temperature;
 
-    /* network socket creation */
-    struct addrinfo  hints;
-    struct addrinfo* result; /* store result of getaddrinfo */
-
     /* threads */
     pthread_t thrid_up;
-    pthread_t thrid_down;
+    pthread_t thrid_net;
     pthread_t thrid_jit;
 
     /* variables to get local copies of measurements */
@@ -1704,9 +2138,20 @@ void thread_pktfwd( void )
     uint32_t cp_up_payload_byte;
     uint32_t cp_up_dgram_sent;
     uint32_t cp_up_ack_rcv;
+    uint32_t cp_up_ack_late;
+    uint32_t cp_up_ack_nomatch;
+    uint32_t cp_up_ack_rtt_nb;
+    uint32_t cp_up_ack_rtt_p50 = 0;
+    uint32_t cp_up_ack_rtt_p95 = 0;
+    uint32_t cp_up_ack_rtt_p99 = 0;
+    uint32_t cp_up_latency_nb;
+    uint32_t cp_up_latency_sum;
+    uint32_t cp_up_latency_max;
+    uint32_t cp_up_batch_hist[NB_PKT_MAX + 1];
     uint32_t cp_dw_pull_sent;
     uint32_t cp_dw_ack_rcv;
     uint32_t cp_dw_dgram_rcv;
+    uint32_t cp_dw_queue_drop;
     uint32_t cp_dw_network_byte;
     uint32_t cp_dw_payload_byte;
     uint32_t cp_nb_tx_ok;
@@ -1716,6 +2161,24 @@ void thread_pktfwd( void )
     uint32_t cp_nb_tx_rejected_collision_beacon = 0;
     uint32_t cp_nb_tx_rejected_too_late         = 0;
     uint32_t cp_nb_tx_rejected_too_early        = 0;
+    uint32_t cp_dw_jit_delay_hist[JIT_DELAY_HIST_NB];
+    uint32_t cp_dw_tx_start_err_max;
+    uint32_t cp_dw_enqueue_nb;
+    uint32_t cp_dw_enqueue_sum;
+    uint32_t cp_dw_enqueue_max;
+    uint32_t cp_filt_hits[UPLINK_FILTER_RULES_MAX];
+    uint32_t cp_filt_drop;
+    int      nb_filt_rules;
+    int      stat_len;
+    bool     cp_backhaul_up;
+    int      nb_fanout_servers;
+
+    struct uplink_store_stats_s   cp_store;
+    struct lns_supervisor_stats_s cp_lns;
+    struct lns_fanout_stats_s     cp_fanout[LNS_FANOUT_MAX];
+
+    /* local copy of the PUSH_ACK round-trip times, static as too large for the thread stack */
+    static uint32_t cp_up_ack_rtt[PUSH_RTT_SAMPLES_NB];
 
     /* statistics variable */
     time_t t;
@@ -1745,6 +2208,9 @@ void thread_pktfwd( void )
         wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
     }
 
+    /* Recover the uplinks stored before the last reboot, they are replayed once the server is reachable */
+    uplink_store_init( );
+
     /* Update display with connection info */
     display_connection_info_t connect_info = { .gateway_id = lgwm };
     display_update_connection_info( &connect_info );
@@ -1753,62 +2219,57 @@ void thread_pktfwd( void )
     net_mac_h = htonl( ( uint32_t )( 0xFFFFFFFF & ( lgwm >> 32 ) ) );
     net_mac_l = htonl( ( uint32_t )( 0xFFFFFFFF & lgwm ) );
 
-    /* prepare hints to open network sockets */
-    memset( &hints, 0, sizeof hints );
-    hints.ai_family   = AF_INET; /* WA: Forcing IPv4 as AF_UNSPEC makes connection on localhost to fail */
-    hints.ai_socktype = SOCK_DGRAM;
-
-    /* look for server address w/ upstream port */
-    i = getaddrinfo( serv_addr, serv_port_up, &hints, &result );
-    if( i != 0 || result == NULL )
-    {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [up] getaddrinfo on address %s (PORT %s) returned %d\n", serv_addr, serv_port_up,
-                  i );
-        wait_on_error( LRHB_ERROR_LNS, __LINE__ );
-    }
-
-    /* try to open socket for upstream traffic */
-    sock_up = socket( result->ai_family, result->ai_socktype, result->ai_protocol );
+    /* open the sockets once, they are connected to the server in use by the supervisor */
+    sock_up = socket( AF_INET, SOCK_DGRAM, 0 ); /* WA: IPv4 only, as AF_UNSPEC makes connection on localhost to fail */
     if( sock_up < 0 )
     {
         ESP_LOGE( TAG_PKT_FWD, "ERROR: [up] failed to open socket for uplink\n" );
         wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
     }
-
-    /* connect so we can send/receive packet with the server only */
-    i = connect( sock_up, result->ai_addr, result->ai_addrlen );
-    if( i != 0 )
+    sock_down = socket( AF_INET, SOCK_DGRAM, 0 );
+    if( sock_down < 0 )
     {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [up] connect returned %s\n", strerror( errno ) );
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: [down] failed to open socket for downlink\n" );
         wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
     }
-    freeaddrinfo( result );
 
-    /* look for server address w/ downstream port */
-    i = getaddrinfo( serv_addr, serv_port_down, &hints, &result );
-    if( i != 0 || result == NULL )
+    /* primary server first, then the fallback servers, ignored if invalid */
+    struct lns_server_s lns_servers[LNS_SERVERS_MAX];
+    int                 nb_lns_servers;
+    snprintf( lns_servers[0].addr, sizeof lns_servers[0].addr, "%s", serv_addr );
+    snprintf( lns_servers[0].port_up, sizeof lns_servers[0].port_up, "%s", serv_port_up );
+    snprintf( lns_servers[0].port_down, sizeof lns_servers[0].port_down, "%s", serv_port_down );
+    nb_lns_servers = lns_parse_servers( lns_fallbacks_str, serv_port_up, &lns_servers[1], LNS_SERVERS_MAX - 1 );
+    if( nb_lns_servers < 0 )
     {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [up] getaddrinfo on address %s (PORT %s) returned %d\n", serv_addr,
-                  serv_port_down, i );
-        wait_on_error( LRHB_ERROR_LNS, __LINE__ );
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong fallback servers \"%s\", fallback disabled\n", lns_fallbacks_str );
+        nb_lns_servers = 0;
     }
+    lns_supervisor_init( lns_servers, nb_lns_servers + 1, sock_up, sock_down );
 
-    /* try to open socket for downstream traffic */
-    sock_down = socket( result->ai_family, result->ai_socktype, result->ai_protocol );
-    if( sock_down < 0 )
+    /* DNS resolutions needed by the network thread once running, so that it never blocks on them */
+    i = lns_resolver_start( );
+    if( i != 0 )
     {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [down] failed to open socket for downlink\n" );
-        wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: [main] impossible to create resolver thread\n" );
+        wait_on_error( LRHB_ERROR_OS, __LINE__ );
     }
 
-    /* connect so we can send/receive packet with the server only */
-    i = connect( sock_down, result->ai_addr, result->ai_addrlen );
+    /* additional servers receiving a copy of the uplinks, ignored if invalid */
+    nb_lns_servers = lns_parse_servers( lns_fanout_str, serv_port_up, lns_servers, LNS_FANOUT_MAX );
+    if( nb_lns_servers < 0 )
+    {
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: wrong additional servers \"%s\", fan-out disabled\n", lns_fanout_str );
+        nb_lns_servers = 0;
+    }
+    nb_fanout_servers = lns_fanout_init( lns_servers, nb_lns_servers, net_mac_h, net_mac_l );
+
+    /* no server reachable yet, the network thread keeps trying while the uplinks are stored */
+    i = lns_supervisor_connect( );
     if( i != 0 )
     {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [down] connect returned %s\n", strerror( errno ) );
-        wait_on_error( LRHB_ERROR_UNKNOWN, __LINE__ );
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: failed to connect to the server %s or its fallbacks, retrying\n", serv_addr );
     }
-    freeaddrinfo( result );
 
     /* starting the hub */
     i = lgw_start( );
@@ -1822,6 +2283,20 @@ void thread_pktfwd( void )
         wait_on_error( LRHB_ERROR_HAL, __LINE__ );
     }
 
+    /* JIT queue initialization */
+    for( i = 0; i < LGW_RF_CHAIN_NB; i++ )
+    {
+        jit_queue_init( &jit_queue[i] );
+    }
+
+    /* PULL_RESP of all the servers, received by the network thread and processed by the JIT thread */
+    dw_queue = xQueueCreate( DOWN_QUEUE_NB, sizeof( struct pull_resp_msg_s ) );
+    if( dw_queue == NULL )
+    {
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: [main] impossible to create downstream queue\n" );
+        wait_on_error( LRHB_ERROR_OS, __LINE__ );
+    }
+
     /* spawn threads to manage upstream and downstream */
     i = pthread_create( &thrid_up, NULL, ( void* ( * ) ( void* ) ) thread_up, NULL );
     if( i != 0 )
@@ -1829,10 +2304,10 @@ void thread_pktfwd( void )
         ESP_LOGE( TAG_PKT_FWD, "ERROR: [main] impossible to create upstream thread\n" );
         wait_on_error( LRHB_ERROR_OS, __LINE__ );
     }
-    i = pthread_create( &thrid_down, NULL, ( void* ( * ) ( void* ) ) thread_down, NULL );
+    i = pthread_create( &thrid_net, NULL, ( void* ( * ) ( void* ) ) thread_net, NULL );
     if( i != 0 )
     {
-        ESP_LOGE( TAG_PKT_FWD, "ERROR: [main] impossible to create downstream thread\n" );
+        ESP_LOGE( TAG_PKT_FWD, "ERROR: [main] impossible to create network thread\n" );
         wait_on_error( LRHB_ERROR_OS, __LINE__ );
     }
     i = pthread_create( &thrid_jit, NULL, ( void* ( * ) ( void* ) ) thread_jit, NULL );
@@ -1857,27 +2332,47 @@ void thread_pktfwd( void )
         t = time( NULL );
         strftime( stat_timestamp, sizeof stat_timestamp, "%F %T %Z", gmtime( &t ) );
 
-        /* access upstream statistics, copy and reset them */
-        pthread_mutex_lock( &mx_meas_up );
-        cp_nb_rx_rcv         = meas_nb_rx_rcv;
-        cp_nb_rx_ok          = meas_nb_rx_ok;
-        cp_nb_rx_bad         = meas_nb_rx_bad;
-        cp_nb_rx_nocrc       = meas_nb_rx_nocrc;
-        cp_up_pkt_fwd        = meas_up_pkt_fwd;
-        cp_up_network_byte   = meas_up_network_byte;
-        cp_up_payload_byte   = meas_up_payload_byte;
-        cp_up_dgram_sent     = meas_up_dgram_sent;
-        cp_up_ack_rcv        = meas_up_ack_rcv;
-        meas_nb_rx_rcv       = 0;
-        meas_nb_rx_ok        = 0;
-        meas_nb_rx_bad       = 0;
-        meas_nb_rx_nocrc     = 0;
-        meas_up_pkt_fwd      = 0;
-        meas_up_network_byte = 0;
-        meas_up_payload_byte = 0;
-        meas_up_dgram_sent   = 0;
-        meas_up_ack_rcv      = 0;
-        pthread_mutex_unlock( &mx_meas_up );
+        /* access upstream statistics, the counters accumulated since the previous report */
+        cp_nb_rx_rcv       = stats_counter_delta( &meas_nb_rx_rcv );
+        cp_nb_rx_ok        = stats_counter_delta( &meas_nb_rx_ok );
+        cp_nb_rx_bad       = stats_counter_delta( &meas_nb_rx_bad );
+        cp_nb_rx_nocrc     = stats_counter_delta( &meas_nb_rx_nocrc );
+        cp_up_pkt_fwd      = stats_counter_delta( &meas_up_pkt_fwd );
+        cp_up_network_byte = stats_counter_delta( &meas_up_network_byte );
+        cp_up_payload_byte = stats_counter_delta( &meas_up_payload_byte );
+        cp_up_dgram_sent   = stats_counter_delta( &meas_up_dgram_sent );
+        cp_up_ack_rcv      = stats_counter_delta( &meas_up_ack_rcv );
+        cp_up_ack_late     = stats_counter_delta( &meas_up_ack_late );
+        cp_up_ack_nomatch  = stats_counter_delta( &meas_up_ack_nomatch );
+        cp_up_latency_nb   = stats_counter_delta( &meas_up_latency_nb );
+        cp_up_latency_sum  = stats_counter_delta( &meas_up_latency_sum );
+        cp_up_latency_max  = stats_max_take( &meas_up_latency_max );
+        for( i = 0; i <= NB_PKT_MAX; i++ )
+        {
+            cp_up_batch_hist[i] = stats_counter_delta( &meas_up_batch_hist[i] );
+        }
+
+        /* copy the latest round-trip times of the interval, a sample written meanwhile may belong to the next one */
+        cp_up_ack_rtt_nb = stats_counter_delta( &meas_up_ack_rtt_nb );
+        cp_up_ack_rtt_nb = ( cp_up_ack_rtt_nb < PUSH_RTT_SAMPLES_NB ) ? cp_up_ack_rtt_nb : PUSH_RTT_SAMPLES_NB;
+        for( i = 0; i < ( int ) cp_up_ack_rtt_nb; i++ )
+        {
+            cp_up_ack_rtt[i] = meas_up_ack_rtt[( meas_up_ack_rtt_nb.epoch - 1 - i ) % PUSH_RTT_SAMPLES_NB];
+        }
+        if( cp_up_ack_rtt_nb > 0 )
+        {
+            qsort( cp_up_ack_rtt, cp_up_ack_rtt_nb, sizeof( uint32_t ), compare_u32 );
+            cp_up_ack_rtt_p50 = percentile_u32( cp_up_ack_rtt, cp_up_ack_rtt_nb, 50 );
+            cp_up_ack_rtt_p95 = percentile_u32( cp_up_ack_rtt, cp_up_ack_rtt_nb, 95 );
+            cp_up_ack_rtt_p99 = percentile_u32( cp_up_ack_rtt, cp_up_ack_rtt_nb, 99 );
+        }
+        nb_filt_rules = uplink_filter_get_stats( cp_filt_hits, &cp_filt_drop );
+        uplink_store_get_stats( &cp_store );
+        lns_supervisor_get_stats( &cp_lns );
+        lns_fanout_get_stats( cp_fanout );
+        pthread_mutex_lock( &mx_backhaul );
+        cp_backhaul_up = backhaul_up;
+        pthread_mutex_unlock( &mx_backhaul );
         if( cp_nb_rx_rcv > 0 )
         {
             rx_ok_ratio    = ( float ) cp_nb_rx_ok / ( float ) cp_nb_rx_rcv;
@@ -1899,33 +2394,28 @@ void thread_pktfwd( void )
             up_ack_ratio = 0.0;
         }
 
-        /* access downstream statistics, copy and reset them */
-        pthread_mutex_lock( &mx_meas_dw );
-        cp_dw_pull_sent    = meas_dw_pull_sent;
-        cp_dw_ack_rcv      = meas_dw_ack_rcv;
-        cp_dw_dgram_rcv    = meas_dw_dgram_rcv;
-        cp_dw_network_byte = meas_dw_network_byte;
-        cp_dw_payload_byte = meas_dw_payload_byte;
-        cp_nb_tx_ok        = meas_nb_tx_ok;
-        cp_nb_tx_fail      = meas_nb_tx_fail;
-        cp_nb_tx_requested += meas_nb_tx_requested;
-        cp_nb_tx_rejected_collision_packet += meas_nb_tx_rejected_collision_packet;
-        cp_nb_tx_rejected_collision_beacon += meas_nb_tx_rejected_collision_beacon;
-        cp_nb_tx_rejected_too_late += meas_nb_tx_rejected_too_late;
-        cp_nb_tx_rejected_too_early += meas_nb_tx_rejected_too_early;
-        meas_dw_pull_sent                    = 0;
-        meas_dw_ack_rcv                      = 0;
-        meas_dw_dgram_rcv                    = 0;
-        meas_dw_network_byte                 = 0;
-        meas_dw_payload_byte                 = 0;
-        meas_nb_tx_ok                        = 0;
-        meas_nb_tx_fail                      = 0;
-        meas_nb_tx_requested                 = 0;
-        meas_nb_tx_rejected_collision_packet = 0;
-        meas_nb_tx_rejected_collision_beacon = 0;
-        meas_nb_tx_rejected_too_late         = 0;
-        meas_nb_tx_rejected_too_early        = 0;
-        pthread_mutex_unlock( &mx_meas_dw );
+        /* access downstream statistics, the counters accumulated since the previous report */
+        cp_dw_pull_sent    = stats_counter_delta( &meas_dw_pull_sent );
+        cp_dw_ack_rcv      = stats_counter_delta( &meas_dw_ack_rcv );
+        cp_dw_dgram_rcv    = stats_counter_delta( &meas_dw_dgram_rcv );
+        cp_dw_queue_drop   = stats_counter_delta( &meas_dw_queue_drop );
+        cp_dw_network_byte = stats_counter_delta( &meas_dw_network_byte );
+        cp_dw_payload_byte = stats_counter_delta( &meas_dw_payload_byte );
+        cp_nb_tx_ok        = stats_counter_delta( &meas_nb_tx_ok );
+        cp_nb_tx_fail      = stats_counter_delta( &meas_nb_tx_fail );
+        cp_nb_tx_requested += stats_counter_delta( &meas_nb_tx_requested );
+        cp_nb_tx_rejected_collision_packet += stats_counter_delta( &meas_nb_tx_rejected_collision_packet );
+        cp_nb_tx_rejected_collision_beacon += stats_counter_delta( &meas_nb_tx_rejected_collision_beacon );
+        cp_nb_tx_rejected_too_late += stats_counter_delta( &meas_nb_tx_rejected_too_late );
+        cp_nb_tx_rejected_too_early += stats_counter_delta( &meas_nb_tx_rejected_too_early );
+        for( i = 0; i < JIT_DELAY_HIST_NB; i++ )
+        {
+            cp_dw_jit_delay_hist[i] = stats_counter_delta( &meas_dw_jit_delay_hist[i] );
+        }
+        cp_dw_tx_start_err_max = stats_max_take( &meas_dw_tx_start_err_max );
+        cp_dw_enqueue_nb       = stats_counter_delta( &meas_dw_enqueue_nb );
+        cp_dw_enqueue_sum      = stats_counter_delta( &meas_dw_enqueue_sum );
+        cp_dw_enqueue_max      = stats_max_take( &meas_dw_enqueue_max );
         if( cp_dw_pull_sent > 0 )
         {
             dw_ack_ratio = ( float ) cp_dw_ack_rcv / ( float ) cp_dw_pull_sent;
@@ -1942,14 +2432,73 @@ void thread_pktfwd( void )
         printf( "# CRC_OK: %.2f%%, CRC_FAIL: %.2f%%, NO_CRC: %.2f%%\n", 100.0 * rx_ok_ratio, 100.0 * rx_bad_ratio,
                 100.0 * rx_nocrc_ratio );
         printf( "# RF packets forwarded: %lu (%lu bytes)\n", cp_up_pkt_fwd, cp_up_payload_byte );
+        if( nb_filt_rules > 0 )
+        {
+            printf( "# RF packets dropped by filtering: %lu, rule hits:", cp_filt_drop );
+            for( i = 0; i < nb_filt_rules; i++ )
+            {
+                printf( " %d:%lu", i, cp_filt_hits[i] );
+            }
+            printf( "\n" );
+        }
+        printf( "# Server %s, stored uplinks: %lu queued (%lu in flash), %lu replayed, %lu dropped",
+                cp_backhaul_up ? "reachable" : "unreachable", cp_store.nb_queued, cp_store.nb_queued_flash,
+                cp_store.nb_replayed, cp_store.nb_dropped );
+        if( cp_store.flash_enabled == true )
+        {
+            printf( ", %lu corrupted", cp_store.nb_corrupted );
+        }
+        printf( "\n" );
+        printf( "# Server in use: %d (up for %lu s), reconnections: %lu, DNS failures: %lu\n", cp_lns.server_idx,
+                cp_lns.uptime_s, cp_lns.nb_reconnect, cp_lns.nb_resolve_fail );
+        for( i = 0; i < nb_fanout_servers; i++ )
+        {
+            printf( "# Fan-out %s%s: PUSH_DATA acked %lu/%lu, PULL_DATA acked %lu/%lu, downlinks %lu (%lu dropped), "
+                    "DNS failures: %lu\n",
+                    cp_fanout[i].addr, ( cp_fanout[i].connected == true ) ? "" : " (unresolved)",
+                    cp_fanout[i].nb_push_ack, cp_fanout[i].nb_push_sent, cp_fanout[i].nb_pull_ack,
+                    cp_fanout[i].nb_pull_sent, cp_fanout[i].nb_dw_rcv, cp_fanout[i].nb_dw_rejected,
+                    cp_fanout[i].nb_resolve_fail );
+        }
         printf( "# PUSH_DATA datagrams sent: %lu (%lu bytes)\n", cp_up_dgram_sent, cp_up_network_byte );
-        printf( "# PUSH_DATA acknowledged: %.2f%%\n", 100.0 * up_ack_ratio );
+        printf( "# PUSH_DATA acknowledged: %.2f%% (late: %lu, unmatched: %lu)\n", 100.0 * up_ack_ratio, cp_up_ack_late,
+                cp_up_ack_nomatch );
+        if( cp_up_ack_rtt_nb > 0 )
+        {
+            printf( "# PUSH_ACK round-trip time: p50 %lu us, p95 %lu us, p99 %lu us (%lu samples)\n", cp_up_ack_rtt_p50,
+                    cp_up_ack_rtt_p95, cp_up_ack_rtt_p99, cp_up_ack_rtt_nb );
+        }
+        if( cp_up_latency_nb > 0 )
+        {
+            printf( "# Radio IRQ to forward latency: avg %lu us, max %lu us\n", cp_up_latency_sum / cp_up_latency_nb,
+                    cp_up_latency_max );
+        }
+        printf( "# PUSH_DATA rxpk per datagram:" );
+        for( i = 0; i <= NB_PKT_MAX; i++ )
+        {
+            printf( " %d:%lu", i, cp_up_batch_hist[i] );
+        }
+        printf( "\n" );
         printf( "### [DOWNSTREAM] ###\n" );
         printf( "# PULL_DATA sent: %lu (%.2f%% acknowledged)\n", cp_dw_pull_sent, 100.0 * dw_ack_ratio );
         printf( "# PULL_RESP(onse) datagrams received: %lu (%lu bytes)\n", cp_dw_dgram_rcv, cp_dw_network_byte );
+        printf( "# PULL_RESP(onse) datagrams dropped, downstream queue full: %lu\n", cp_dw_queue_drop );
         printf( "# RF packets sent to concentrator: %lu (%lu bytes)\n", ( cp_nb_tx_ok + cp_nb_tx_fail ),
                 cp_dw_payload_byte );
         printf( "# TX errors: %lu\n", cp_nb_tx_fail );
+        printf( "# TX hand-off delay (us):" );
+        for( i = 0; i < ( JIT_DELAY_HIST_NB - 1 ); i++ )
+        {
+            printf( " <=%lu:%lu", jit_delay_hist_bound_us[i], cp_dw_jit_delay_hist[i] );
+        }
+        printf( " >%lu:%lu\n", jit_delay_hist_bound_us[JIT_DELAY_HIST_NB - 2],
+                cp_dw_jit_delay_hist[JIT_DELAY_HIST_NB - 1] );
+        printf( "# TX start error (us): max %lu\n", cp_dw_tx_start_err_max );
+        if( cp_dw_enqueue_nb > 0 )
+        {
+            printf( "# PULL_RESP to JIT enqueue latency: avg %lu us, max %lu us\n",
+                    cp_dw_enqueue_sum / cp_dw_enqueue_nb, cp_dw_enqueue_max );
+        }
         if( cp_nb_tx_requested != 0 )
         {
             printf( "# TX rejected (collision packet): %.2f%% (req:%lu, rej:%lu)\n",
@@ -1967,6 +2516,10 @@ void thread_pktfwd( void )
         }
         printf( "### [JIT] ###\n" );
         jit_print_queue( &jit_queue[0], false, DEBUG_LOG );
+        printf( "### [SPI] ###\n" );
+        lgw_spi_stats_report( );
+        lgw_rx_stats_report( );
+        lgw_tx_stats_report( );
         temperature = 0;
         if( temp_sensor != NULL )
         {
@@ -1988,19 +2541,53 @@ void thread_pktfwd( void )
 
         /* generate a JSON report (will be sent to server by upstream thread) */
         pthread_mutex_lock( &mx_stat_rep );
-        snprintf( status_report, STATUS_SIZE,
-                  "\"stat\":{\"time\":\"%s\",\"rxnb\":%lu,\"rxok\":%lu,\"rxfw\":%lu,\"ackr\":%.1f,\"dwnb\":%lu,"
-                  "\"txnb\":%lu,\"temp\":%.0f}",
-                  stat_timestamp, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio, cp_dw_dgram_rcv,
-                  cp_nb_tx_ok, temperature );
+        stat_len = snprintf( status_report, STATUS_SIZE,
+                             "\"stat\":{\"time\":\"%s\",\"rxnb\":%lu,\"rxok\":%lu,\"rxfw\":%lu,\"ackr\":%.1f,"
+                             "\"dwnb\":%lu,\"txnb\":%lu,\"temp\":%.0f",
+                             stat_timestamp, cp_nb_rx_rcv, cp_nb_rx_ok, cp_up_pkt_fwd, 100.0 * up_ack_ratio,
+                             cp_dw_dgram_rcv, cp_nb_tx_ok, temperature );
+        if( nb_filt_rules > 0 )
+        {
+            /* uplinks dropped by filtering and hits of each rule, non standard fields */
+            stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len, ",\"fdrp\":%lu,\"fhit\":[",
+                                  cp_filt_drop );
+            for( i = 0; i < nb_filt_rules; i++ )
+            {
+                stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len, "%s%lu", ( i == 0 ) ? "" : ",",
+                                      cp_filt_hits[i] );
+            }
+            stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len, "]" );
+        }
+        if( ( cp_store.nb_stored > 0 ) || ( cp_store.nb_queued > 0 ) )
+        {
+            /* store-and-forward queue and counters since boot, non standard fields */
+            stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len,
+                                  ",\"sfq\":%lu,\"sfr\":%lu,\"sfd\":%lu", cp_store.nb_queued, cp_store.nb_replayed,
+                                  cp_store.nb_dropped );
+        }
+        /* server in use, its uptime and the reconnections since boot, non standard fields */
+        stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len,
+                              ",\"lnsi\":%d,\"lnsu\":%lu,\"lnsr\":%lu", cp_lns.server_idx, cp_lns.uptime_s,
+                              cp_lns.nb_reconnect );
+        if( cp_up_ack_rtt_nb > 0 )
+        {
+            /* PUSH_ACK round-trip time percentiles of the interval in milliseconds, non standard field */
+            stat_len += snprintf( status_report + stat_len, STATUS_SIZE - stat_len, ",\"artt\":[%lu,%lu,%lu]",
+                                  ( cp_up_ack_rtt_p50 + 500 ) / 1000, ( cp_up_ack_rtt_p95 + 500 ) / 1000,
+                                  ( cp_up_ack_rtt_p99 + 500 ) / 1000 );
+        }
+        snprintf( status_report + stat_len, STATUS_SIZE - stat_len, "}" );
         report_ready = true;
         pthread_mutex_unlock( &mx_stat_rep );
+
+        /* wake up the upstream thread so that the report is sent right away */
+        lgw_abort_wait_irq( );
     }
 
     /* wait for upstream thread to finish (1 fetch cycle max) */
     pthread_join( thrid_up, NULL );
-    pthread_cancel( thrid_down ); /* don't wait for downstream thread */
-    pthread_cancel( thrid_jit );  /* don't wait for jit thread */
+    pthread_cancel( thrid_net ); /* don't wait for network thread */
+    pthread_cancel( thrid_jit ); /* don't wait for jit thread */
 
     /* shut down network sockets */
     shutdown( sock_up, SHUT_RDWR );
@@ -2037,4 +2624,49 @@ int launch_pkt_fwd( temperature_sensor_handle_t temperature_sensor )
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void pkt_fwd_get_metrics( void ( *write_cb )( void* ctx, const char* str ), void* ctx )
+{
+    char                           line[METRIC_LINE_SIZE];
+    const struct metric_counter_s* c;
+    const struct metric_hist_s*    h;
+    uint32_t                       cumul;
+    unsigned                       i;
+    int                            k;
+
+    /* the counters are only read, the statistics thread keeps its own snapshots */
+    for( i = 0; i < ARRAY_SIZE( metric_counters ); i++ )
+    {
+        c = &metric_counters[i];
+        if( c->help != NULL )
+        {
+            snprintf( line, sizeof line, "# TYPE %s counter\n# HELP %s %s.\n", c->name, c->name, c->help );
+            write_cb( ctx, line );
+        }
+        snprintf( line, sizeof line, "%s_total%s %lu\n", c->name, c->labels, stats_counter_get( c->counter ) );
+        write_cb( ctx, line );
+    }
+
+    /* the buckets are accumulated as read, the one of the unbounded bucket is the count: there is no sum, as 32 bits
+     * of microseconds wrap within hours and 64 bits cannot be updated without a lock on this core */
+    for( i = 0; i < ARRAY_SIZE( metric_hists ); i++ )
+    {
+        h = &metric_hists[i];
+        snprintf( line, sizeof line, "# TYPE %s histogram\n# HELP %s %s.\n", h->name, h->name, h->help );
+        write_cb( ctx, line );
+        cumul = 0;
+        for( k = 0; k < h->nb_bounds; k++ )
+        {
+            cumul += stats_counter_get( &h->buckets[k] );
+            snprintf( line, sizeof line, "%s_bucket{le=\"%g\"} %lu\n", h->name, h->scale * ( double ) h->bounds[k],
+                      cumul );
+            write_cb( ctx, line );
+        }
+        cumul += stats_counter_get( &h->buckets[h->nb_bounds] );
+        snprintf( line, sizeof line, "%s_bucket{le=\"+Inf\"} %lu\n", h->name, cumul );
+        write_cb( ctx, line );
+    }
+}
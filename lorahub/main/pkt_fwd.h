@@ -34,6 +34,13 @@ License: Revised BSD License, see LICENSE.TXT file include in the project
 
 int launch_pkt_fwd( temperature_sensor_handle_t temperature_sensor );
 
+/**
+@brief Export the packet forwarder counters and histograms in the OpenMetrics text format, "# EOF" excluded
+@param write_cb function called with each part of the exposition, in order
+@param ctx context given to write_cb
+*/
+void pkt_fwd_get_metrics( void ( *write_cb )( void* ctx, const char* str ), void* ctx );
+
 #endif  // _PKTFWD_H
 
 /* --- EOF ------------------------------------------------------------------ */
\ No newline at end of file
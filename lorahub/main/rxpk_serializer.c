@@ -0,0 +1,323 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub rxpk JSON object serializer, integer-only formatting
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* memcpy */
+#include <time.h>    /* gmtime_r */
+
+#include "rxpk_serializer.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define PUT_LITERAL( w, lit ) put_str( w, lit, sizeof( lit ) - 1 )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define PROTOCOL_JSON_RXPK_FRAME_FORMAT_STR "1"
+
+/* indexed by datarate (DR_LORA_SF5..DR_LORA_SF12) */
+static const char* const datr_str[] = {
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    ",\"datr\":\"SF5",
+    ",\"datr\":\"SF6",
+    ",\"datr\":\"SF7",
+    ",\"datr\":\"SF8",
+    ",\"datr\":\"SF9",
+    ",\"datr\":\"SF10",
+    ",\"datr\":\"SF11",
+    ",\"datr\":\"SF12",
+};
+
+/* indexed by bandwidth (BW_125KHZ..BW_500KHZ) */
+static const char* const bw_str[] = {
+    NULL, NULL, NULL, NULL, "BW125\"", "BW250\"", "BW500\"",
+};
+
+/* indexed by coderate (CR_LORA_4_5..CR_LORA_4_8), 0 is mostly false sync */
+static const char* const codr_str[] = {
+    ",\"codr\":\"OFF\"", ",\"codr\":\"4/5\"", ",\"codr\":\"4/6\"", ",\"codr\":\"4/7\"", ",\"codr\":\"4/8\"",
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+typedef struct
+{
+    uint8_t* cur;   /* next byte to be written */
+    uint8_t* end;   /* first byte after the buffer */
+    bool     error; /* true if the buffer is too small or a value cannot be formatted */
+} rxpk_writer_t;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void put_str( rxpk_writer_t* w, const char* str, size_t len );
+
+static void put_u32( rxpk_writer_t* w, uint32_t val, int min_digits );
+
+static void put_float( rxpk_writer_t* w, float val, bool one_decimal );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void put_str( rxpk_writer_t* w, const char* str, size_t len )
+{
+    if( ( size_t ) ( w->end - w->cur ) < len )
+    {
+        w->error = true;
+        return;
+    }
+    memcpy( w->cur, str, len );
+    w->cur += len;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void put_u32( rxpk_writer_t* w, uint32_t val, int min_digits )
+{
+    char tmp[10];
+    int  n = 0;
+
+    do
+    {
+        tmp[n++] = ( char ) ( '0' + ( val % 10 ) );
+        val /= 10;
+    } while( ( val > 0 ) || ( n < min_digits ) );
+
+    if( ( w->end - w->cur ) < n )
+    {
+        w->error = true;
+        return;
+    }
+    while( n > 0 )
+    {
+        *( w->cur++ ) = ( uint8_t ) tmp[--n];
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* Same output as printf "%.1f" (round half to even) when one_decimal is true, else as printf "%.0f" of roundf()
+ * (round half away from zero). The value is decoded from its IEEE-754 bits, so no floating point operation is done. */
+static void put_float( rxpk_writer_t* w, float val, bool one_decimal )
+{
+    uint32_t bits;
+    bool     neg;
+    int      shift;
+    uint64_t mant;
+    uint64_t rem;
+    uint64_t half;
+    uint64_t fixed;
+
+    memcpy( &bits, &val, sizeof bits );
+    neg   = ( ( bits >> 31 ) != 0 );
+    shift = ( int ) ( ( bits >> 23 ) & 0xFF );
+    mant  = bits & 0x7FFFFF;
+    if( shift == 0xFF )
+    { /* NaN or infinity are not expected from the radio */
+        w->error = true;
+        return;
+    }
+    if( shift == 0 )
+    { /* subnormal */
+        shift = 1;
+    }
+    else
+    {
+        mant |= 0x800000;
+    }
+    shift -= 150; /* val = mant * 2^shift */
+
+    if( one_decimal == true )
+    {
+        mant *= 10; /* fixed point with one decimal, fits in 28 bits */
+    }
+
+    if( shift >= 0 )
+    {
+        if( shift > 3 )
+        { /* out of the range of a 32-bit integer */
+            w->error = true;
+            return;
+        }
+        fixed = mant << shift;
+    }
+    else if( shift <= -30 )
+    { /* less than half a unit */
+        fixed = 0;
+    }
+    else
+    {
+        fixed = mant >> -shift;
+        rem   = mant & ( ( ( uint64_t ) 1 << -shift ) - 1 );
+        half  = ( uint64_t ) 1 << ( -shift - 1 );
+        if( one_decimal == true )
+        {
+            if( ( rem > half ) || ( ( rem == half ) && ( ( fixed & 1 ) != 0 ) ) )
+            {
+                fixed += 1;
+            }
+        }
+        else if( rem >= half )
+        {
+            fixed += 1;
+        }
+    }
+
+    if( neg == true )
+    {
+        PUT_LITERAL( w, "-" );
+    }
+    if( one_decimal == true )
+    {
+        put_u32( w, ( uint32_t ) ( fixed / 10 ), 1 );
+        PUT_LITERAL( w, "." );
+        put_u32( w, ( uint32_t ) ( fixed % 10 ), 1 );
+    }
+    else
+    {
+        put_u32( w, ( uint32_t ) fixed, 1 );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int rxpk_serialize( const struct lgw_pkt_rx_s* pkt, const struct timeval* rx_time, uint8_t* dest, int dest_size )
+{
+    rxpk_writer_t w = { .cur = dest, .end = dest + dest_size, .error = false };
+    int           j;
+    struct tm     tm;
+
+    /* JSON rxpk frame format version, 8 useful chars */
+    PUT_LITERAL( &w, "{\"jver\":" PROTOCOL_JSON_RXPK_FRAME_FORMAT_STR );
+
+    /* RAW timestamp, 8-17 useful chars */
+    PUT_LITERAL( &w, ",\"tmst\":" );
+    put_u32( &w, pkt->count_us, 1 );
+
+    /* UTC time of reception, ISO 8601 'compact' format with microseconds, 37 useful chars */
+    if( rx_time != NULL )
+    {
+        gmtime_r( &( rx_time->tv_sec ), &tm );
+        PUT_LITERAL( &w, ",\"time\":\"" );
+        put_u32( &w, tm.tm_year + 1900, 4 );
+        PUT_LITERAL( &w, "-" );
+        put_u32( &w, tm.tm_mon + 1, 2 );
+        PUT_LITERAL( &w, "-" );
+        put_u32( &w, tm.tm_mday, 2 );
+        PUT_LITERAL( &w, "T" );
+        put_u32( &w, tm.tm_hour, 2 );
+        PUT_LITERAL( &w, ":" );
+        put_u32( &w, tm.tm_min, 2 );
+        PUT_LITERAL( &w, ":" );
+        put_u32( &w, tm.tm_sec, 2 );
+        PUT_LITERAL( &w, "." );
+        put_u32( &w, rx_time->tv_usec, 6 );
+        PUT_LITERAL( &w, "Z\"" );
+    }
+
+    /* Packet concentrator channel, RF chain & RX frequency (MHz, 6 decimals), 34-36 useful chars */
+    PUT_LITERAL( &w, ",\"chan\":" );
+    put_u32( &w, pkt->if_chain, 1 );
+    PUT_LITERAL( &w, ",\"rfch\":" );
+    put_u32( &w, pkt->rf_chain, 1 );
+    PUT_LITERAL( &w, ",\"freq\":" );
+    put_u32( &w, pkt->freq_hz / 1000000, 1 );
+    PUT_LITERAL( &w, "." );
+    put_u32( &w, pkt->freq_hz % 1000000, 6 );
+
+    /* Packet status, 9-10 useful chars */
+    switch( pkt->status )
+    {
+    case STAT_CRC_OK:
+        PUT_LITERAL( &w, ",\"stat\":1" );
+        break;
+    case STAT_CRC_BAD:
+        PUT_LITERAL( &w, ",\"stat\":-1" );
+        break;
+    case STAT_NO_CRC:
+        PUT_LITERAL( &w, ",\"stat\":0" );
+        break;
+    default:
+        return -1;
+    }
+
+    /* Packet modulation, 13-14 useful chars */
+    if( pkt->modulation != MOD_LORA )
+    {
+        return -1;
+    }
+    PUT_LITERAL( &w, ",\"modu\":\"LORA\"" );
+
+    /* Lora datarate & bandwidth, 16-19 useful chars */
+    if( ( pkt->datarate >= ( sizeof datr_str / sizeof datr_str[0] ) ) || ( datr_str[pkt->datarate] == NULL ) ||
+        ( pkt->bandwidth >= ( sizeof bw_str / sizeof bw_str[0] ) ) || ( bw_str[pkt->bandwidth] == NULL ) )
+    {
+        return -1;
+    }
+    put_str( &w, datr_str[pkt->datarate], strlen( datr_str[pkt->datarate] ) );
+    put_str( &w, bw_str[pkt->bandwidth], strlen( bw_str[pkt->bandwidth] ) );
+
+    /* Packet ECC coding rate, 11-13 useful chars */
+    if( pkt->coderate >= ( sizeof codr_str / sizeof codr_str[0] ) )
+    {
+        return -1;
+    }
+    put_str( &w, codr_str[pkt->coderate], strlen( codr_str[pkt->coderate] ) );
+
+    /* Lora SNR */
+    PUT_LITERAL( &w, ",\"lsnr\":" );
+    put_float( &w, pkt->snr, true );
+
+    /* Channel RSSI, payload size, 18-23 useful chars */
+    PUT_LITERAL( &w, ",\"rssi\":" );
+    put_float( &w, pkt->rssic, false );
+    PUT_LITERAL( &w, ",\"size\":" );
+    put_u32( &w, pkt->size, 1 );
+
+    /* Packet base64-encoded payload, 14-350 useful chars */
+    PUT_LITERAL( &w, ",\"data\":\"" );
+    if( ( w.error == true ) || ( w.cur >= w.end ) )
+    {
+        return -1;
+    }
+    j = bin_to_b64( pkt->payload, pkt->size, ( char* ) w.cur, ( int ) ( w.end - w.cur ) ); /* null char included */
+    if( j < 0 )
+    {
+        return -1;
+    }
+    w.cur += j;
+    PUT_LITERAL( &w, "\"}" );
+
+    if( w.error == true )
+    {
+        return -1;
+    }
+
+    return ( int ) ( w.cur - dest );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,50 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub rxpk JSON object serializer
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _RXPK_SERIALIZER_H
+#define _RXPK_SERIALIZER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>   /* C99 types */
+#include <sys/time.h> /* timeval */
+
+#include "lorahub_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC MACROS -------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Serialize the metadata and payload of a received packet as a JSON rxpk object, braces included
+@param pkt pointer to the received packet
+@param rx_time wall-clock time of the reception, added as a "time" field, NULL to leave it out
+@param dest pointer to the buffer where the object is written (not null terminated)
+@param dest_size usable size of the buffer
+@return >0 number of bytes written, -1 if the packet has an unknown field value or the buffer is too small
+*/
+int rxpk_serialize( const struct lgw_pkt_rx_s* pkt, const struct timeval* rx_time, uint8_t* dest, int dest_size );
+
+#endif  // _RXPK_SERIALIZER_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,132 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub lock-free statistics counters, updated from the hot paths and read by the statistics thread
+
+    Each counter is written by a single thread, so it is updated by a relaxed load and store, without any lock nor
+    read-modify-write instruction. The counters are cumulative and never reset: the statistics thread keeps the value
+    seen at its previous snapshot, and the statistics of an interval are the difference with the current value,
+    modulo 2^32. The maxima may have several writers, they are raised by compare-and-swap and taken and reset in one
+    atomic exchange. All the accesses are relaxed, the counters do not order any other memory access.
+
+    A histogram is an array of counters, one per bucket, plus an unbounded last bucket. Its buckets are read one by
+    one, so a snapshot may miss the samples accounted meanwhile but never counts one twice.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _STATS_COUNTER_H
+#define _STATS_COUNTER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>    /* C99 types */
+#include <stdatomic.h> /* C11 atomics */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct stats_counter_s
+{
+    _Atomic uint32_t value; /* cumulative value, wraps around */
+    uint32_t         epoch; /* value at the previous snapshot, only accessed by the statistics thread */
+};
+
+struct stats_max_s
+{
+    _Atomic uint32_t value; /* maximum since the previous snapshot */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS ----------------------------------------------------- */
+
+/**
+@brief Add a value to a counter, from the thread owning it only
+@param c pointer to the counter
+@param n value to be added
+*/
+static inline void stats_counter_add( struct stats_counter_s* c, uint32_t n )
+{
+    uint32_t value = atomic_load_explicit( &c->value, memory_order_relaxed );
+
+    atomic_store_explicit( &c->value, value + n, memory_order_relaxed );
+}
+
+/**
+@brief Get the cumulative value of a counter, from any thread
+@param c pointer to the counter
+@return the value accumulated since boot, modulo 2^32
+*/
+static inline uint32_t stats_counter_get( struct stats_counter_s* c )
+{
+    return atomic_load_explicit( &c->value, memory_order_relaxed );
+}
+
+/**
+@brief Get the value accumulated by a counter since the previous call, from the statistics thread only
+@param c pointer to the counter
+@return the value accumulated since the previous snapshot
+*/
+static inline uint32_t stats_counter_delta( struct stats_counter_s* c )
+{
+    uint32_t value = atomic_load_explicit( &c->value, memory_order_relaxed );
+    uint32_t delta = value - c->epoch;
+
+    c->epoch = value;
+    return delta;
+}
+
+/**
+@brief Raise a maximum to a value, from any thread
+@param m pointer to the maximum
+@param v value to be accounted
+*/
+static inline void stats_max_update( struct stats_max_s* m, uint32_t v )
+{
+    uint32_t cur = atomic_load_explicit( &m->value, memory_order_relaxed );
+
+    /* only contended when a new maximum is raced with another update or with the snapshot */
+    while( ( v > cur ) && !atomic_compare_exchange_weak_explicit( &m->value, &cur, v, memory_order_relaxed,
+                                                                  memory_order_relaxed ) )
+    {
+    }
+}
+
+/**
+@brief Get a maximum and reset it, from the statistics thread only
+@param m pointer to the maximum
+@return the maximum since the previous snapshot
+*/
+static inline uint32_t stats_max_take( struct stats_max_s* m )
+{
+    return atomic_exchange_explicit( &m->value, 0, memory_order_relaxed );
+}
+
+/**
+@brief Account a sample in a histogram, from the thread owning it only
+@param buckets array of nb_bounds + 1 counters, the last one accounting the samples above all the bounds
+@param bounds inclusive upper bounds of the buckets, in increasing order
+@param nb_bounds number of bounds
+@param v value to be accounted
+*/
+static inline void stats_hist_add( struct stats_counter_s* buckets, const uint32_t* bounds, int nb_bounds, uint32_t v )
+{
+    int k = 0;
+
+    while( ( k < nb_bounds ) && ( v > bounds[k] ) )
+    {
+        k++;
+    }
+    stats_counter_add( &buckets[k], 1 );
+}
+
+#endif  // _STATS_COUNTER_H
+
+/* --- EOF ------------------------------------------------------------------ */
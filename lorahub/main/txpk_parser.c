@@ -0,0 +1,706 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub single-pass parser of PULL_RESP txpk JSON objects
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* memset, memcmp */
+
+#include "txpk_parser.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define FIELD_BIT( field ) ( 1u << ( field ) )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NUMBER_INT_DIGITS_MAX 12 /* limit on the integer part of numbers, keeps values with 6 decimals in an int64_t */
+
+/* indexed by enum txpk_field_e, every field name is "txpk." followed by 4 chars */
+static const char* const field_name[TXPK_FIELD_NB] = {
+    "txpk.imme", "txpk.tmst", "txpk.freq", "txpk.rfch", "txpk.powe", "txpk.modu", "txpk.datr",
+    "txpk.codr", "txpk.ipol", "txpk.prea", "txpk.size", "txpk.data", "txpk.ncrc", "txpk.nhdr",
+};
+
+/* fields that must be present in every txpk object, "tmst" is also mandatory when "imme" is not true */
+static const uint32_t field_mandatory = FIELD_BIT( TXPK_FIELD_FREQ ) | FIELD_BIT( TXPK_FIELD_RFCH ) |
+                                        FIELD_BIT( TXPK_FIELD_MODU ) | FIELD_BIT( TXPK_FIELD_DATR ) |
+                                        FIELD_BIT( TXPK_FIELD_CODR ) | FIELD_BIT( TXPK_FIELD_SIZE ) |
+                                        FIELD_BIT( TXPK_FIELD_DATA );
+
+static const struct
+{
+    char    str[4];
+    uint8_t coderate;
+} codr_table[] = {
+    { "4/5", CR_LORA_4_5 }, { "4/6", CR_LORA_4_6 }, { "2/3", CR_LORA_4_6 },
+    { "4/7", CR_LORA_4_7 }, { "4/8", CR_LORA_4_8 }, { "1/2", CR_LORA_4_8 },
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+typedef struct
+{
+    const char* start; /* beginning of the JSON string, for error offsets */
+    const char* cur;   /* next char to be read */
+    const char* end;   /* first char after the JSON string */
+} txpk_reader_t;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void skip_ws( txpk_reader_t* r );
+
+static bool accept_char( txpk_reader_t* r, char c );
+
+static bool read_string( txpk_reader_t* r, const char** str, int* len, bool* escaped );
+
+static bool skip_value( txpk_reader_t* r );
+
+static enum txpk_error_e read_bool( txpk_reader_t* r, bool* val );
+
+static enum txpk_error_e read_number( txpk_reader_t* r, int decimals, int64_t min, int64_t max, int64_t* val );
+
+static bool is_base64( const char* str, int len );
+
+static enum txpk_error_e read_field( txpk_reader_t* r, enum txpk_field_e field, struct lgw_pkt_tx_s* pkt,
+                                     struct txpk_status_s* status, bool* imme );
+
+static enum txpk_error_e parse_txpk_object( txpk_reader_t* r, struct lgw_pkt_tx_s* pkt,
+                                            struct txpk_status_s* status );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* skip white spaces, and comments as accepted by json_parse_string_with_comments */
+static void skip_ws( txpk_reader_t* r )
+{
+    while( r->cur < r->end )
+    {
+        if( ( *r->cur == ' ' ) || ( *r->cur == '\t' ) || ( *r->cur == '\n' ) || ( *r->cur == '\r' ) )
+        {
+            r->cur += 1;
+        }
+        else if( ( *r->cur == '/' ) && ( ( r->end - r->cur ) >= 2 ) && ( r->cur[1] == '/' ) )
+        {
+            while( ( r->cur < r->end ) && ( *r->cur != '\n' ) )
+            {
+                r->cur += 1;
+            }
+        }
+        else if( ( *r->cur == '/' ) && ( ( r->end - r->cur ) >= 2 ) && ( r->cur[1] == '*' ) )
+        {
+            r->cur += 2;
+            while( ( ( r->end - r->cur ) >= 2 ) && ( ( r->cur[0] != '*' ) || ( r->cur[1] != '/' ) ) )
+            {
+                r->cur += 1;
+            }
+            r->cur = ( ( r->end - r->cur ) >= 2 ) ? r->cur + 2 : r->end;
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool accept_char( txpk_reader_t* r, char c )
+{
+    skip_ws( r );
+    if( ( r->cur < r->end ) && ( *r->cur == c ) )
+    {
+        r->cur += 1;
+        return true;
+    }
+    return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* return the raw content of a string, escape sequences are not decoded */
+static bool read_string( txpk_reader_t* r, const char** str, int* len, bool* escaped )
+{
+    const char* s;
+
+    if( accept_char( r, '"' ) == false )
+    {
+        return false;
+    }
+    s        = r->cur;
+    *escaped = false;
+    while( ( r->cur < r->end ) && ( *r->cur != '"' ) )
+    {
+        if( ( *r->cur == '\\' ) && ( ( r->end - r->cur ) >= 2 ) ) /* not past the end on a truncated escape */
+        {
+            *escaped = true;
+            r->cur += 1;
+        }
+        r->cur += 1;
+    }
+    if( r->cur >= r->end )
+    {
+        return false;
+    }
+    *str = s;
+    *len = ( int ) ( r->cur - s );
+    r->cur += 1; /* closing quote */
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* skip a value of a field that is not used, nested objects and arrays are skipped by tracking their depth */
+static bool skip_value( txpk_reader_t* r )
+{
+    int         depth = 0;
+    const char* str;
+    int         len;
+    bool        escaped;
+
+    do
+    {
+        skip_ws( r );
+        if( r->cur >= r->end )
+        {
+            return false;
+        }
+        switch( *r->cur )
+        {
+        case '"':
+            if( read_string( r, &str, &len, &escaped ) == false )
+            {
+                return false;
+            }
+            break;
+        case '{':
+        case '[':
+            depth += 1;
+            r->cur += 1;
+            break;
+        case '}':
+        case ']':
+            depth -= 1;
+            if( depth < 0 )
+            {
+                return false;
+            }
+            r->cur += 1;
+            break;
+        case ',':
+        case ':':
+            if( depth == 0 )
+            {
+                return false;
+            }
+            r->cur += 1;
+            break;
+        default: /* number, true, false or null */
+            str = r->cur;
+            while( ( r->cur < r->end ) &&
+                   ( ( ( *r->cur >= '0' ) && ( *r->cur <= '9' ) ) || ( ( *r->cur >= 'a' ) && ( *r->cur <= 'z' ) ) ||
+                     ( *r->cur == '-' ) || ( *r->cur == '+' ) || ( *r->cur == '.' ) || ( *r->cur == 'E' ) ) )
+            {
+                r->cur += 1;
+            }
+            if( r->cur == str )
+            {
+                return false;
+            }
+        }
+    } while( depth > 0 );
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static enum txpk_error_e read_bool( txpk_reader_t* r, bool* val )
+{
+    skip_ws( r );
+    if( ( ( r->end - r->cur ) >= 4 ) && ( memcmp( r->cur, "true", 4 ) == 0 ) )
+    {
+        *val = true;
+        r->cur += 4;
+    }
+    else if( ( ( r->end - r->cur ) >= 5 ) && ( memcmp( r->cur, "false", 5 ) == 0 ) )
+    {
+        *val = false;
+        r->cur += 5;
+    }
+    else
+    {
+        return TXPK_ERROR_TYPE;
+    }
+    return TXPK_ERROR_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* read a number as a fixed point value with the given number of decimals, extra decimals are truncated like a cast
+ * from double would do */
+static enum txpk_error_e read_number( txpk_reader_t* r, int decimals, int64_t min, int64_t max, int64_t* val )
+{
+    bool    neg = false;
+    int     nb_digits;
+    int64_t x = 0;
+
+    skip_ws( r );
+    if( ( r->cur < r->end ) && ( *r->cur == '-' ) )
+    {
+        neg = true;
+        r->cur += 1;
+    }
+    if( ( r->cur >= r->end ) || ( *r->cur < '0' ) || ( *r->cur > '9' ) )
+    {
+        return TXPK_ERROR_TYPE;
+    }
+
+    /* integer part */
+    for( nb_digits = 0; ( r->cur < r->end ) && ( *r->cur >= '0' ) && ( *r->cur <= '9' ); nb_digits++ )
+    {
+        if( nb_digits >= NUMBER_INT_DIGITS_MAX )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        x = ( x * 10 ) + ( *r->cur - '0' );
+        r->cur += 1;
+    }
+
+    /* fractional part */
+    nb_digits = 0;
+    if( ( r->cur < r->end ) && ( *r->cur == '.' ) )
+    {
+        r->cur += 1;
+        if( ( r->cur >= r->end ) || ( *r->cur < '0' ) || ( *r->cur > '9' ) )
+        {
+            return TXPK_ERROR_TYPE;
+        }
+        while( ( r->cur < r->end ) && ( *r->cur >= '0' ) && ( *r->cur <= '9' ) )
+        {
+            if( nb_digits < decimals )
+            {
+                x = ( x * 10 ) + ( *r->cur - '0' );
+                nb_digits += 1;
+            }
+            r->cur += 1;
+        }
+    }
+    for( ; nb_digits < decimals; nb_digits++ )
+    {
+        x *= 10;
+    }
+
+    /* exponents are valid JSON but are never used by network servers for txpk fields */
+    if( ( r->cur < r->end ) && ( ( *r->cur == 'e' ) || ( *r->cur == 'E' ) ) )
+    {
+        return TXPK_ERROR_VALUE;
+    }
+
+    if( neg == true )
+    {
+        x = -x;
+    }
+    if( ( x < min ) || ( x > max ) )
+    {
+        return TXPK_ERROR_VALUE;
+    }
+    *val = x;
+    return TXPK_ERROR_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* b64_to_bin exits the application on an invalid char, so the string is checked before being decoded */
+static bool is_base64( const char* str, int len )
+{
+    int i;
+
+    if( ( ( len % 4 ) == 0 ) && ( len >= 4 ) )
+    { /* ignore padding */
+        if( str[len - 2] == '=' )
+        {
+            len -= 2;
+        }
+        else if( str[len - 1] == '=' )
+        {
+            len -= 1;
+        }
+    }
+    for( i = 0; i < len; i++ )
+    {
+        if( ( ( str[i] < 'A' ) || ( str[i] > 'Z' ) ) && ( ( str[i] < 'a' ) || ( str[i] > 'z' ) ) &&
+            ( ( str[i] < '0' ) || ( str[i] > '9' ) ) && ( str[i] != '+' ) && ( str[i] != '/' ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static enum txpk_error_e read_field( txpk_reader_t* r, enum txpk_field_e field, struct lgw_pkt_tx_s* pkt,
+                                     struct txpk_status_s* status, bool* imme )
+{
+    enum txpk_error_e err = TXPK_ERROR_OK;
+    int64_t           x   = 0;
+    const char*       str;
+    int               len;
+    bool              escaped;
+    int               i;
+
+    switch( field )
+    {
+    case TXPK_FIELD_IMME:
+        err = read_bool( r, imme );
+        break;
+    case TXPK_FIELD_TMST:
+        err           = read_number( r, 0, 0, UINT32_MAX, &x );
+        pkt->count_us = ( uint32_t ) x;
+        break;
+    case TXPK_FIELD_FREQ: /* MHz with Hz precision */
+        err          = read_number( r, 6, 0, UINT32_MAX, &x );
+        pkt->freq_hz = ( uint32_t ) x;
+        break;
+    case TXPK_FIELD_RFCH:
+        err           = read_number( r, 0, 0, LGW_RF_CHAIN_NB - 1, &x );
+        pkt->rf_chain = ( uint8_t ) x;
+        break;
+    case TXPK_FIELD_POWE:
+        err           = read_number( r, 0, INT8_MIN, INT8_MAX, &x );
+        pkt->rf_power = ( int8_t ) x;
+        break;
+    case TXPK_FIELD_PREA:
+        err           = read_number( r, 0, 0, UINT16_MAX, &x );
+        pkt->preamble = ( uint16_t ) x;
+        break;
+    case TXPK_FIELD_SIZE:
+        err       = read_number( r, 0, 0, 255, &x );
+        pkt->size = ( uint16_t ) x;
+        break;
+    case TXPK_FIELD_IPOL:
+        err = read_bool( r, &pkt->invert_pol );
+        break;
+    case TXPK_FIELD_NCRC:
+        err = read_bool( r, &pkt->no_crc );
+        break;
+    case TXPK_FIELD_NHDR:
+        err = read_bool( r, &pkt->no_header );
+        break;
+    case TXPK_FIELD_MODU:
+        if( read_string( r, &str, &len, &escaped ) == false )
+        {
+            return TXPK_ERROR_TYPE;
+        }
+        if( ( len != 4 ) || ( memcmp( str, "LORA", 4 ) != 0 ) )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        pkt->modulation = MOD_LORA;
+        break;
+    case TXPK_FIELD_DATR: /* "SF<5..12>BW<125|250|500>" */
+        if( read_string( r, &str, &len, &escaped ) == false )
+        {
+            return TXPK_ERROR_TYPE;
+        }
+        if( ( len < 8 ) || ( len > 9 ) || ( str[0] != 'S' ) || ( str[1] != 'F' ) || ( str[len - 5] != 'B' ) ||
+            ( str[len - 4] != 'W' ) )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        x = 0;
+        for( i = 2; i < ( len - 5 ); i++ )
+        {
+            if( ( str[i] < '0' ) || ( str[i] > '9' ) )
+            {
+                return TXPK_ERROR_VALUE;
+            }
+            x = ( x * 10 ) + ( str[i] - '0' );
+        }
+        if( ( x < DR_LORA_SF5 ) || ( x > DR_LORA_SF12 ) )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        pkt->datarate = ( uint32_t ) x;
+        if( memcmp( str + len - 3, "125", 3 ) == 0 )
+        {
+            pkt->bandwidth = BW_125KHZ;
+        }
+        else if( memcmp( str + len - 3, "250", 3 ) == 0 )
+        {
+            pkt->bandwidth = BW_250KHZ;
+        }
+        else if( memcmp( str + len - 3, "500", 3 ) == 0 )
+        {
+            pkt->bandwidth = BW_500KHZ;
+        }
+        else
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        break;
+    case TXPK_FIELD_CODR:
+        if( read_string( r, &str, &len, &escaped ) == false )
+        {
+            return TXPK_ERROR_TYPE;
+        }
+        err = TXPK_ERROR_VALUE;
+        for( i = 0; ( len == 3 ) && ( i < ( int ) ( sizeof codr_table / sizeof codr_table[0] ) ); i++ )
+        {
+            if( memcmp( str, codr_table[i].str, 3 ) == 0 )
+            {
+                pkt->coderate = codr_table[i].coderate;
+                err           = TXPK_ERROR_OK;
+                break;
+            }
+        }
+        break;
+    case TXPK_FIELD_DATA:
+        if( read_string( r, &str, &len, &escaped ) == false )
+        {
+            return TXPK_ERROR_TYPE;
+        }
+        if( ( escaped == true ) || ( is_base64( str, len ) == false ) )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        status->data_size = b64_to_bin( str, len, pkt->payload, sizeof pkt->payload );
+        if( status->data_size < 0 )
+        {
+            return TXPK_ERROR_VALUE;
+        }
+        break;
+    default:
+        return TXPK_ERROR_SYNTAX;
+    }
+
+    return err;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static enum txpk_error_e parse_txpk_object( txpk_reader_t* r, struct lgw_pkt_tx_s* pkt,
+                                            struct txpk_status_s* status )
+{
+    enum txpk_error_e err;
+    bool              imme = false;
+    const char*       key;
+    int               key_len;
+    bool              escaped;
+    int               f;
+
+    if( accept_char( r, '{' ) == false )
+    {
+        status->field  = "txpk";
+        status->offset = ( int ) ( r->cur - r->start );
+        return TXPK_ERROR_TYPE;
+    }
+
+    if( accept_char( r, '}' ) == false )
+    {
+        do
+        {
+            if( ( read_string( r, &key, &key_len, &escaped ) == false ) || ( accept_char( r, ':' ) == false ) )
+            {
+                return TXPK_ERROR_SYNTAX;
+            }
+
+            /* all known field names have 4 chars */
+            f = TXPK_FIELD_NB;
+            if( ( key_len == 4 ) && ( escaped == false ) )
+            {
+                for( f = 0; ( f < TXPK_FIELD_NB ) && ( memcmp( key, field_name[f] + 5, 4 ) != 0 ); f++ )
+                {
+                }
+            }
+
+            if( f == TXPK_FIELD_NB )
+            {
+                if( skip_value( r ) == false )
+                {
+                    return TXPK_ERROR_SYNTAX;
+                }
+                continue;
+            }
+
+            status->field = field_name[f];
+            skip_ws( r );
+            status->offset = ( int ) ( r->cur - r->start );
+            if( ( status->fields & FIELD_BIT( f ) ) != 0 )
+            {
+                return TXPK_ERROR_DUPLICATE;
+            }
+            status->fields |= FIELD_BIT( f );
+            err = read_field( r, ( enum txpk_field_e ) f, pkt, status, &imme );
+            if( err != TXPK_ERROR_OK )
+            {
+                return err;
+            }
+            status->field = NULL;
+        } while( accept_char( r, ',' ) == true );
+
+        if( accept_char( r, '}' ) == false )
+        {
+            return TXPK_ERROR_SYNTAX;
+        }
+    }
+
+    /* check that mandatory fields are present */
+    status->offset = ( int ) ( r->cur - r->start );
+    if( ( imme == false ) && ( ( status->fields & FIELD_BIT( TXPK_FIELD_TMST ) ) == 0 ) )
+    {
+        status->field = field_name[TXPK_FIELD_TMST];
+        return TXPK_ERROR_MISSING;
+    }
+    for( f = 0; f < TXPK_FIELD_NB; f++ )
+    {
+        if( ( ( field_mandatory & FIELD_BIT( f ) ) != 0 ) && ( ( status->fields & FIELD_BIT( f ) ) == 0 ) )
+        {
+            status->field = field_name[f];
+            return TXPK_ERROR_MISSING;
+        }
+    }
+
+    /* TX mode and defaults */
+    if( imme == true )
+    {
+        pkt->tx_mode  = IMMEDIATE;
+        pkt->count_us = 0;
+    }
+    else
+    {
+        pkt->tx_mode = TIMESTAMPED;
+    }
+    if( ( status->fields & FIELD_BIT( TXPK_FIELD_PREA ) ) == 0 )
+    {
+        pkt->preamble = STD_LORA_PREAMBLE;
+    }
+    else if( pkt->preamble < MIN_LORA_PREAMBLE )
+    {
+        pkt->preamble = MIN_LORA_PREAMBLE;
+    }
+
+    return TXPK_ERROR_OK;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+enum txpk_error_e txpk_parse( const char* json, int json_len, struct lgw_pkt_tx_s* pkt, struct txpk_status_s* status )
+{
+    txpk_reader_t     r     = { .start = json, .cur = json, .end = json + json_len };
+    enum txpk_error_e err   = TXPK_ERROR_NO_TXPK;
+    bool              found = false;
+    const char*       key;
+    int               key_len;
+    bool              escaped;
+
+    memset( pkt, 0, sizeof *pkt );
+    memset( status, 0, sizeof *status );
+
+    /* root object, other fields than "txpk" are ignored */
+    if( accept_char( &r, '{' ) == false )
+    {
+        err = TXPK_ERROR_SYNTAX;
+    }
+    else if( accept_char( &r, '}' ) == false )
+    {
+        do
+        {
+            if( ( read_string( &r, &key, &key_len, &escaped ) == false ) || ( accept_char( &r, ':' ) == false ) )
+            {
+                err = TXPK_ERROR_SYNTAX;
+                break;
+            }
+            if( ( key_len == 4 ) && ( memcmp( key, "txpk", 4 ) == 0 ) )
+            {
+                if( found == true )
+                {
+                    status->field  = "txpk";
+                    status->offset = ( int ) ( r.cur - r.start );
+                    err            = TXPK_ERROR_DUPLICATE;
+                    break;
+                }
+                found = true;
+                err   = parse_txpk_object( &r, pkt, status );
+                if( err != TXPK_ERROR_OK )
+                {
+                    break;
+                }
+            }
+            else if( skip_value( &r ) == false )
+            {
+                err = TXPK_ERROR_SYNTAX;
+                break;
+            }
+        } while( accept_char( &r, ',' ) == true );
+
+        if( ( found == true ) && ( err == TXPK_ERROR_OK ) && ( accept_char( &r, '}' ) == false ) )
+        {
+            err = TXPK_ERROR_SYNTAX;
+        }
+    }
+
+    /* nothing but white spaces or a string terminator is allowed after the root object */
+    if( err == TXPK_ERROR_OK )
+    {
+        skip_ws( &r );
+        if( ( r.cur < r.end ) && ( *r.cur != '\0' ) )
+        {
+            err = TXPK_ERROR_SYNTAX;
+        }
+    }
+
+    if( ( err != TXPK_ERROR_OK ) && ( status->field == NULL ) )
+    {
+        status->offset = ( int ) ( r.cur - r.start );
+    }
+
+    return err;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+const char* txpk_error_str( enum txpk_error_e error )
+{
+    switch( error )
+    {
+    case TXPK_ERROR_OK:
+        return "no error";
+    case TXPK_ERROR_SYNTAX:
+        return "invalid JSON";
+    case TXPK_ERROR_NO_TXPK:
+        return "no \"txpk\" object in JSON";
+    case TXPK_ERROR_MISSING:
+        return "missing mandatory field";
+    case TXPK_ERROR_TYPE:
+        return "wrong type for field";
+    case TXPK_ERROR_VALUE:
+        return "invalid value for field";
+    case TXPK_ERROR_DUPLICATE:
+        return "duplicate field";
+    default:
+        return "unknown error";
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
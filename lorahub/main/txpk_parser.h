@@ -0,0 +1,100 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub single-pass parser of PULL_RESP txpk JSON objects
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _TXPK_PARSER_H
+#define _TXPK_PARSER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+#include "lorahub_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC MACROS -------------------------------------------------------- */
+
+#define TXPK_HAS_FIELD( status, field ) ( ( ( status )->fields & ( 1u << ( field ) ) ) != 0 )
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+enum txpk_field_e
+{
+    TXPK_FIELD_IMME,
+    TXPK_FIELD_TMST,
+    TXPK_FIELD_FREQ,
+    TXPK_FIELD_RFCH,
+    TXPK_FIELD_POWE,
+    TXPK_FIELD_MODU,
+    TXPK_FIELD_DATR,
+    TXPK_FIELD_CODR,
+    TXPK_FIELD_IPOL,
+    TXPK_FIELD_PREA,
+    TXPK_FIELD_SIZE,
+    TXPK_FIELD_DATA,
+    TXPK_FIELD_NCRC,
+    TXPK_FIELD_NHDR,
+    TXPK_FIELD_NB
+};
+
+enum txpk_error_e
+{
+    TXPK_ERROR_OK,       /* txpk object parsed, packet is ready to be queued */
+    TXPK_ERROR_SYNTAX,   /* JSON syntax error */
+    TXPK_ERROR_NO_TXPK,  /* no "txpk" object in the root object */
+    TXPK_ERROR_MISSING,  /* a mandatory field is missing */
+    TXPK_ERROR_TYPE,     /* a field does not have the expected JSON type */
+    TXPK_ERROR_VALUE,    /* a field value is unknown or out of range */
+    TXPK_ERROR_DUPLICATE /* a field is present more than once */
+};
+
+struct txpk_status_s
+{
+    const char* field;     /* name of the field related to the error, NULL if none */
+    int         offset;    /* offset in the JSON string where the error was detected */
+    uint32_t    fields;    /* bitmask of the txpk fields found, see TXPK_HAS_FIELD */
+    int         data_size; /* number of bytes decoded from the base64 "data" field */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Parse the JSON payload of a PULL_RESP and fill a TX packet structure, without memory allocation
+@param json pointer to the JSON string (does not need to be null terminated)
+@param json_len length of the JSON string
+@param pkt pointer to the TX packet to be filled, including the decoded payload
+@param status pointer to the parsing status, with the field and offset of the error if any
+@return TXPK_ERROR_OK if the packet can be queued, the error encountered otherwise
+
+The "powe" field is copied as is in rf_power, the antenna gain is left to the caller. The preamble length is set to
+STD_LORA_PREAMBLE if "prea" is absent and to at least MIN_LORA_PREAMBLE otherwise.
+*/
+enum txpk_error_e txpk_parse( const char* json, int json_len, struct lgw_pkt_tx_s* pkt, struct txpk_status_s* status );
+
+/**
+@brief Return a short description of a txpk parsing error
+@param error the error returned by txpk_parse
+@return a constant string
+*/
+const char* txpk_error_str( enum txpk_error_e error );
+
+#endif  // _TXPK_PARSER_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,371 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub uplink filtering by DevAddr prefix, NetID and JoinEUI
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdlib.h>  /* strtoull */
+#include <string.h>  /* memset, strncmp */
+
+#include <esp_log.h>
+
+#include "uplink_filter.h"
+#include "stats_counter.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define PREFIX_MASK( len ) ( ( ( len ) == 0 ) ? 0 : ( 0xFFFFFFFFUL << ( 32 - ( len ) ) ) )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define BUCKET_BITS 12 /* number of DevAddr MSBs indexing the lookup table */
+#define BUCKET_NB ( 1 << BUCKET_BITS )
+
+#define RULE_NONE 0xFF
+
+#define MTYPE_JOIN_REQUEST 0
+#define MTYPE_UNCONF_DATA_UP 2
+#define MTYPE_CONF_DATA_UP 4
+
+static const char* TAG_FILT = "UPLINK_FILTER";
+
+/* NwkID length per NetID type, from the LoRaWAN backend interfaces specification */
+static const uint8_t nwkid_len[8] = { 6, 6, 9, 11, 12, 13, 15, 17 };
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static struct uplink_filter_rule_s filt_rules[UPLINK_FILTER_RULES_MAX];
+static int                         filt_nb_rules          = 0;
+static bool                        filt_has_devaddr_allow = false;
+static bool                        filt_has_joineui       = false;
+
+static uint8_t filt_bucket_rule[BUCKET_NB];     /* most specific rule of at most BUCKET_BITS covering each bucket */
+static uint8_t filt_bucket_long[BUCKET_NB / 8]; /* bitset of the buckets holding rules of more than BUCKET_BITS */
+
+/* hit counters, written by the thread checking the uplinks only */
+static struct stats_counter_s filt_hits[UPLINK_FILTER_RULES_MAX];
+static struct stats_counter_s filt_nb_drop;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static bool parse_hex( const char* str, int len, uint64_t max, uint64_t* value );
+
+static bool parse_rule( const char* str, int len, struct uplink_filter_rule_s* rule );
+
+static uint8_t lookup_devaddr( uint32_t devaddr );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static bool parse_hex( const char* str, int len, uint64_t max, uint64_t* value )
+{
+    char  buff[17];
+    char* end;
+
+    if( ( len == 0 ) || ( len >= ( int ) sizeof buff ) )
+    {
+        return false;
+    }
+    memcpy( buff, str, len );
+    buff[len] = '\0';
+
+    *value = strtoull( buff, &end, 16 );
+
+    return ( *end == '\0' ) && ( *value <= max );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool parse_rule( const char* str, int len, struct uplink_filter_rule_s* rule )
+{
+    const char* sep;
+    uint64_t    val;
+    uint64_t    val2;
+    uint8_t     type;
+    bool        deny = false;
+
+    memset( rule, 0, sizeof( struct uplink_filter_rule_s ) );
+
+    if( str[0] == '!' )
+    {
+        deny = true;
+        str += 1;
+        len -= 1;
+    }
+
+    if( ( len > 5 ) && ( strncmp( str, "join:", 5 ) == 0 ) && ( deny == false ) )
+    {
+        /* JoinEUI or JoinEUI range */
+        str += 5;
+        len -= 5;
+        sep = memchr( str, '-', len );
+        if( sep == NULL )
+        {
+            if( parse_hex( str, len, UINT64_MAX, &val ) == false )
+            {
+                return false;
+            }
+            val2 = val;
+        }
+        else if( ( parse_hex( str, sep - str, UINT64_MAX, &val ) == false ) ||
+                 ( parse_hex( sep + 1, len - ( sep + 1 - str ), UINT64_MAX, &val2 ) == false ) || ( val2 < val ) )
+        {
+            return false;
+        }
+        rule->type        = UPLINK_FILTER_ALLOW_JOINEUI;
+        rule->joineui_min = val;
+        rule->joineui_max = val2;
+        return true;
+    }
+
+    rule->type = ( deny == true ) ? UPLINK_FILTER_DENY_DEVADDR : UPLINK_FILTER_ALLOW_DEVADDR;
+
+    if( ( len > 6 ) && ( strncmp( str, "netid:", 6 ) == 0 ) )
+    {
+        /* NetID, converted to the DevAddr prefix: type as 1 bits ended by a 0 bit, then the NwkID (NetID LSBs) */
+        if( parse_hex( str + 6, len - 6, 0xFFFFFF, &val ) == false )
+        {
+            return false;
+        }
+        type             = ( uint8_t ) ( val >> 21 );
+        rule->prefix_len = type + 1 + nwkid_len[type];
+        rule->devaddr    = ( ( ( ( 1UL << ( type + 1 ) ) - 2 ) << nwkid_len[type] ) |
+                          ( ( uint32_t ) val & ( ( 1UL << nwkid_len[type] ) - 1 ) ) )
+                        << ( 32 - rule->prefix_len );
+        return true;
+    }
+
+    /* DevAddr prefix */
+    sep = memchr( str, '/', len );
+    if( ( sep == NULL ) || ( parse_hex( str, sep - str, 0xFFFFFFFF, &val ) == false ) )
+    {
+        return false;
+    }
+    val2 = strtoul( sep + 1, NULL, 10 );
+    if( ( sep + 1 == str + len ) || ( strspn( sep + 1, "0123456789" ) != ( size_t ) ( len - ( sep + 1 - str ) ) ) ||
+        ( val2 > 32 ) )
+    {
+        return false;
+    }
+    rule->prefix_len = ( uint8_t ) val2;
+    rule->devaddr    = ( uint32_t ) val & PREFIX_MASK( rule->prefix_len );
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint8_t lookup_devaddr( uint32_t devaddr )
+{
+    uint32_t bucket = devaddr >> ( 32 - BUCKET_BITS );
+    uint8_t  match  = filt_bucket_rule[bucket];
+    uint8_t  match_len;
+    int      i;
+
+    /* the rules longer than the bucket are only checked if there is one in this bucket */
+    if( ( filt_bucket_long[bucket / 8] & ( 1 << ( bucket % 8 ) ) ) != 0 )
+    {
+        match_len = ( match == RULE_NONE ) ? 0 : filt_rules[match].prefix_len;
+        for( i = 0; i < filt_nb_rules; i++ )
+        {
+            if( ( filt_rules[i].type != UPLINK_FILTER_ALLOW_JOINEUI ) && ( filt_rules[i].prefix_len > BUCKET_BITS ) &&
+                ( ( devaddr & PREFIX_MASK( filt_rules[i].prefix_len ) ) == filt_rules[i].devaddr ) &&
+                ( ( filt_rules[i].prefix_len > match_len ) ||
+                  ( ( filt_rules[i].prefix_len == match_len ) &&
+                    ( filt_rules[i].type == UPLINK_FILTER_DENY_DEVADDR ) ) ) )
+            {
+                match     = ( uint8_t ) i;
+                match_len = filt_rules[i].prefix_len;
+            }
+        }
+    }
+
+    return match;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int uplink_filter_parse( const char* str, struct uplink_filter_rule_s* rules )
+{
+    int nb_rules = 0;
+    int len;
+
+    while( *str != '\0' )
+    {
+        len = strcspn( str, " ," );
+        if( len > 0 )
+        {
+            if( nb_rules >= UPLINK_FILTER_RULES_MAX )
+            {
+                ESP_LOGE( TAG_FILT, "ERROR: more than %d rules\n", UPLINK_FILTER_RULES_MAX );
+                return -1;
+            }
+            if( parse_rule( str, len, &rules[nb_rules] ) == false )
+            {
+                ESP_LOGE( TAG_FILT, "ERROR: invalid rule \"%.*s\"\n", len, str );
+                return -1;
+            }
+            nb_rules += 1;
+            str += len;
+        }
+        else
+        {
+            str += 1; /* separator */
+        }
+    }
+
+    return nb_rules;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void uplink_filter_set( const struct uplink_filter_rule_s* rules, int nb_rules )
+{
+    const struct uplink_filter_rule_s* r;
+    uint32_t                           bucket, bucket_first, bucket_last;
+    uint8_t                            current;
+    int                                i;
+
+    memcpy( filt_rules, rules, nb_rules * sizeof( struct uplink_filter_rule_s ) );
+    filt_nb_rules          = nb_rules;
+    filt_has_devaddr_allow = false;
+    filt_has_joineui       = false;
+    memset( filt_bucket_rule, RULE_NONE, sizeof filt_bucket_rule );
+    memset( filt_bucket_long, 0, sizeof filt_bucket_long );
+
+    /* fill the buckets covered by each rule, keeping the most specific one (deny first on a tie) */
+    for( i = 0; i < nb_rules; i++ )
+    {
+        r = &filt_rules[i];
+        if( r->type == UPLINK_FILTER_ALLOW_JOINEUI )
+        {
+            filt_has_joineui = true;
+            continue;
+        }
+        if( r->type == UPLINK_FILTER_ALLOW_DEVADDR )
+        {
+            filt_has_devaddr_allow = true;
+        }
+        bucket_first = r->devaddr >> ( 32 - BUCKET_BITS );
+        if( r->prefix_len > BUCKET_BITS )
+        {
+            filt_bucket_long[bucket_first / 8] |= ( 1 << ( bucket_first % 8 ) );
+            continue;
+        }
+        bucket_last = bucket_first | ( ( 1UL << ( BUCKET_BITS - r->prefix_len ) ) - 1 );
+        for( bucket = bucket_first; bucket <= bucket_last; bucket++ )
+        {
+            current = filt_bucket_rule[bucket];
+            if( ( current == RULE_NONE ) || ( r->prefix_len > filt_rules[current].prefix_len ) ||
+                ( ( r->prefix_len == filt_rules[current].prefix_len ) && ( r->type == UPLINK_FILTER_DENY_DEVADDR ) ) )
+            {
+                filt_bucket_rule[bucket] = ( uint8_t ) i;
+            }
+        }
+    }
+
+    /* no uplink is checked yet, the counters can be cleared */
+    memset( filt_hits, 0, sizeof filt_hits );
+    memset( &filt_nb_drop, 0, sizeof filt_nb_drop );
+
+    ESP_LOGI( TAG_FILT, "%d uplink filtering rules set", nb_rules );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+bool uplink_filter_check( const uint8_t* payload, uint16_t size )
+{
+    uint8_t  mtype;
+    uint8_t  match = RULE_NONE;
+    uint32_t devaddr;
+    uint64_t joineui;
+    bool     forward = true;
+    int      i;
+
+    if( ( filt_nb_rules == 0 ) || ( size == 0 ) )
+    {
+        return true;
+    }
+
+    mtype = payload[0] >> 5;
+    if( ( ( mtype == MTYPE_UNCONF_DATA_UP ) || ( mtype == MTYPE_CONF_DATA_UP ) ) && ( size >= 8 ) )
+    {
+        /* FHDR - DevAddr */
+        devaddr = payload[1] | ( payload[2] << 8 ) | ( payload[3] << 16 ) | ( ( uint32_t ) payload[4] << 24 );
+        match   = lookup_devaddr( devaddr );
+        if( match != RULE_NONE )
+        {
+            forward = ( filt_rules[match].type == UPLINK_FILTER_ALLOW_DEVADDR );
+        }
+        else
+        {
+            forward = !filt_has_devaddr_allow;
+        }
+    }
+    else if( ( mtype == MTYPE_JOIN_REQUEST ) && ( size >= 9 ) && ( filt_has_joineui == true ) )
+    {
+        /* JoinEUI, little endian */
+        joineui = 0;
+        for( i = 8; i >= 1; i-- )
+        {
+            joineui = ( joineui << 8 ) | payload[i];
+        }
+        forward = false;
+        for( i = 0; i < filt_nb_rules; i++ )
+        {
+            if( ( filt_rules[i].type == UPLINK_FILTER_ALLOW_JOINEUI ) && ( joineui >= filt_rules[i].joineui_min ) &&
+                ( joineui <= filt_rules[i].joineui_max ) )
+            {
+                match   = ( uint8_t ) i;
+                forward = true;
+                break;
+            }
+        }
+    }
+
+    if( match != RULE_NONE )
+    {
+        stats_counter_add( &filt_hits[match], 1 );
+    }
+    if( forward == false )
+    {
+        stats_counter_add( &filt_nb_drop, 1 );
+    }
+
+    return forward;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int uplink_filter_get_stats( uint32_t* hits, uint32_t* nb_drop )
+{
+    int i;
+
+    for( i = 0; i < UPLINK_FILTER_RULES_MAX; i++ )
+    {
+        hits[i] = stats_counter_delta( &filt_hits[i] );
+    }
+    *nb_drop = stats_counter_delta( &filt_nb_drop );
+
+    return filt_nb_rules;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
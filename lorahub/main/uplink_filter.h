@@ -0,0 +1,101 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub uplink filtering by DevAddr prefix, NetID and JoinEUI
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _UPLINK_FILTER_H
+#define _UPLINK_FILTER_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define UPLINK_FILTER_RULES_MAX 16     /* Maximum number of rules */
+#define UPLINK_FILTER_STR_MAX_SIZE 256 /* Maximum size of the rules string, including null termination */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+enum uplink_filter_rule_type_e
+{
+    UPLINK_FILTER_ALLOW_DEVADDR, /* forward the data uplinks with this DevAddr prefix */
+    UPLINK_FILTER_DENY_DEVADDR,  /* drop the data uplinks with this DevAddr prefix */
+    UPLINK_FILTER_ALLOW_JOINEUI  /* forward the join-requests with a JoinEUI in this range */
+};
+
+struct uplink_filter_rule_s
+{
+    enum uplink_filter_rule_type_e type;
+    uint8_t                        prefix_len;  /* DevAddr prefix length in bits [0..32] */
+    uint32_t                       devaddr;     /* DevAddr prefix, bits after the prefix cleared */
+    uint64_t                       joineui_min; /* first JoinEUI of the range */
+    uint64_t                       joineui_max; /* last JoinEUI of the range */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Parse a list of filtering rules
+@param str null terminated rules string, rules separated by spaces or commas
+@param rules pointer to an array of UPLINK_FILTER_RULES_MAX rules to be filled
+@return the number of rules parsed, -1 if the string is invalid
+
+Rules syntax, with hexadecimal values:
+  - "26000000/7" forwards the data uplinks whose DevAddr starts with the 7 first bits of 26000000
+  - "netid:000013" forwards the data uplinks whose DevAddr belongs to NetID 000013
+  - "!26000000/7" or "!netid:000013" drops them instead
+  - "join:70B3D57ED0000000-70B3D57ED0FFFFFF" or "join:70B3D57ED0001234" forwards the join-requests from this JoinEUI
+    range
+
+The most specific DevAddr rule matching an uplink applies. If there are allow rules, the data uplinks matching no rule
+are dropped. If there are join rules, the join-requests matching none of them are dropped. An empty string forwards
+everything.
+*/
+int uplink_filter_parse( const char* str, struct uplink_filter_rule_s* rules );
+
+/**
+@brief Set the rules to be applied by uplink_filter_check, and reset the hit counters
+@param rules pointer to the rules, as returned by uplink_filter_parse
+@param nb_rules number of rules
+
+To be called before any uplink is checked, the rules and the counters are not protected against a concurrent check.
+*/
+void uplink_filter_set( const struct uplink_filter_rule_s* rules, int nb_rules );
+
+/**
+@brief Check if an uplink has to be forwarded, and count the rule applied, from a single thread
+@param payload pointer to the LoRaWAN PHYPayload
+@param size size of the payload
+@return true if the uplink has to be forwarded, false if it has to be dropped
+
+Only the data uplinks and the join-requests are filtered. The lookup of a DevAddr is done in a table indexed by its
+12 MSBs, and only the rules longer than 12 bits sharing these bits are then checked.
+*/
+bool uplink_filter_check( const uint8_t* payload, uint16_t size );
+
+/**
+@brief Get the hit counters since last call, from the statistics thread only
+@param hits pointer to an array of UPLINK_FILTER_RULES_MAX counters, number of uplinks each rule has applied to
+@param nb_drop pointer to the number of uplinks dropped, by a rule or for matching no allow rule
+@return the number of rules set
+*/
+int uplink_filter_get_stats( uint32_t* hits, uint32_t* nb_drop );
+
+#endif  // _UPLINK_FILTER_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,435 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub store-and-forward queue of the uplinks received while the server is unreachable
+
+    The uplinks are queued in a RAM ring. When it is full, the oldest uplink is spilled to an append-only log in a
+    dedicated flash partition, so every uplink in flash is older than the ones in RAM and the queue is replayed from
+    the flash log first. Each log record carries the CRC of its body. Replayed records are marked in place by
+    clearing their state byte, which needs no erase, and the used sectors are only erased once the log is drained.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stddef.h>  /* offsetof */
+#include <string.h>  /* memcpy, memset */
+#include <pthread.h>
+
+#include <esp_log.h>
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#endif
+
+#include "uplink_store.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+/* size of the part of an entry which is written in flash, the unused end of the payload buffer is left out */
+#define ENTRY_BODY_SIZE( pkt_size ) ( offsetof( struct uplink_store_entry_s, pkt.payload ) + ( pkt_size ) )
+
+/* size of a flash log record, padded to keep the records word aligned */
+#define REC_SIZE( body_size ) ( ( sizeof( struct store_rec_hdr_s ) + ( body_size ) + 3 ) & ~3U )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define REC_MAGIC 0x5346  /* identifies a record with the current format */
+#define REC_ERASED 0xFFFF /* magic read from erased flash, end of the log */
+#define REC_VALID 0xFF    /* record state: not replayed yet, value of erased flash */
+#define REC_REPLAYED 0x00 /* record state: replayed, cleared in place */
+
+static const char* TAG_STORE = "UPLINK_STORE";
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct uplink_store_entry_s
+{
+    struct timeval      rx_time; /* wall-clock time of the reception */
+    struct lgw_pkt_rx_s pkt;     /* packet, must be the last field */
+};
+
+struct store_rec_hdr_s
+{
+    uint16_t magic;     /* REC_MAGIC */
+    uint16_t body_size; /* size of the entry part stored after the header */
+    uint8_t  state;     /* REC_VALID or REC_REPLAYED */
+    uint8_t  rfu[3];    /* left erased */
+    uint32_t crc;       /* CRC32 of the body */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static pthread_mutex_t             mx_uplink_store = PTHREAD_MUTEX_INITIALIZER; /* control access to the queue */
+static struct uplink_store_entry_s ram_ring[UPLINK_STORE_RAM_NB];
+static unsigned                    ram_head = 0; /* index of the oldest uplink of the RAM ring */
+static unsigned                    ram_nb   = 0; /* number of uplinks in the RAM ring */
+static struct uplink_store_stats_s store_stats;  /* counters, the occupancy fields are filled on request */
+
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+static const esp_partition_t*      log_part      = NULL; /* flash log partition, NULL if not in use */
+static uint32_t                    log_read_off  = 0;    /* offset of the oldest record not replayed */
+static uint32_t                    log_write_off = 0;    /* offset where the next record is appended */
+static uint32_t                    log_nb        = 0;    /* number of records not replayed */
+static struct uplink_store_entry_s log_head;             /* copy of the record at log_read_off */
+static uint32_t                    log_head_size  = 0;   /* size of the record at log_read_off */
+static bool                        log_head_valid = false;
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+static void log_erase( void );
+
+static bool log_append( const struct uplink_store_entry_s* e );
+
+static bool log_load_head( void );
+
+static void log_release_head( void );
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+static void log_erase( void )
+{
+    uint32_t  size;
+    uint32_t  sector_size = log_part->erase_size;
+    esp_err_t err;
+
+    /* only the sectors used by the log need to be erased */
+    size = ( ( log_write_off + sector_size - 1 ) / sector_size ) * sector_size;
+    if( size > log_part->size )
+    {
+        size = log_part->size;
+    }
+    if( size > 0 )
+    {
+        err = esp_partition_erase_range( log_part, 0, size );
+        if( err != ESP_OK )
+        {
+            ESP_LOGE( TAG_STORE, "ERROR: failed to erase flash log - %s\n", esp_err_to_name( err ) );
+            log_part                  = NULL; /* fall back to RAM only */
+            store_stats.flash_enabled = false;
+        }
+    }
+    log_read_off   = 0;
+    log_write_off  = 0;
+    log_nb         = 0;
+    log_head_valid = false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool log_append( const struct uplink_store_entry_s* e )
+{
+    struct store_rec_hdr_s hdr;
+    esp_err_t              err;
+
+    memset( &hdr, 0xFF, sizeof hdr );
+    hdr.magic     = REC_MAGIC;
+    hdr.body_size = ENTRY_BODY_SIZE( e->pkt.size );
+    hdr.state     = REC_VALID;
+    hdr.crc       = esp_rom_crc32_le( 0, ( const uint8_t* ) e, hdr.body_size );
+
+    if( ( log_write_off + REC_SIZE( hdr.body_size ) ) > log_part->size )
+    {
+        return false;
+    }
+
+    /* body first, so that a record with a header always had its body written */
+    err = esp_partition_write( log_part, log_write_off + sizeof hdr, e, hdr.body_size );
+    if( err == ESP_OK )
+    {
+        err = esp_partition_write( log_part, log_write_off, &hdr, sizeof hdr );
+    }
+    if( err != ESP_OK )
+    {
+        ESP_LOGE( TAG_STORE, "ERROR: failed to write flash log - %s\n", esp_err_to_name( err ) );
+        return false;
+    }
+
+    log_write_off += REC_SIZE( hdr.body_size );
+    log_nb += 1;
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool log_load_head( void )
+{
+    struct store_rec_hdr_s hdr;
+    const uint8_t          replayed = REC_REPLAYED;
+
+    /* skip the replayed records, the corrupted ones are discarded on the way */
+    while( ( log_nb > 0 ) && ( log_read_off < log_write_off ) )
+    {
+        if( esp_partition_read( log_part, log_read_off, &hdr, sizeof hdr ) != ESP_OK )
+        {
+            return false;
+        }
+        if( hdr.state == REC_VALID )
+        {
+            if( ( esp_partition_read( log_part, log_read_off + sizeof hdr, &log_head, hdr.body_size ) == ESP_OK ) &&
+                ( esp_rom_crc32_le( 0, ( const uint8_t* ) &log_head, hdr.body_size ) == hdr.crc ) )
+            {
+                log_head_size  = REC_SIZE( hdr.body_size );
+                log_head_valid = true;
+                return true;
+            }
+            ESP_LOGW( TAG_STORE, "WARNING: discarded corrupted record at offset 0x%lX\n", log_read_off );
+            esp_partition_write( log_part, log_read_off + offsetof( struct store_rec_hdr_s, state ), &replayed, 1 );
+            store_stats.nb_corrupted += 1;
+            log_nb -= 1;
+        }
+        log_read_off += REC_SIZE( hdr.body_size );
+    }
+
+    if( log_nb == 0 )
+    {
+        log_erase( );
+    }
+    return false;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void log_release_head( void )
+{
+    const uint8_t replayed = REC_REPLAYED;
+
+    esp_partition_write( log_part, log_read_off + offsetof( struct store_rec_hdr_s, state ), &replayed, 1 );
+    log_read_off += log_head_size;
+    log_nb -= 1;
+    log_head_valid = false;
+
+    /* the erase time grows with the number of sectors used, it is only paid once per outage */
+    if( log_nb == 0 )
+    {
+        log_erase( );
+    }
+}
+#endif
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+int uplink_store_init( void )
+{
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    struct store_rec_hdr_s hdr;
+    uint32_t               off         = 0;
+    bool                   found_valid = false;
+
+    log_part = esp_partition_find_first( ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, UPLINK_STORE_PARTITION );
+    if( log_part == NULL )
+    {
+        ESP_LOGE( TAG_STORE, "ERROR: no \"%s\" partition, uplinks are stored in RAM only\n", UPLINK_STORE_PARTITION );
+        return -1;
+    }
+
+    /* walk the log up to the first erased header to find its end and its oldest record not replayed */
+    pthread_mutex_lock( &mx_uplink_store );
+    while( ( off + sizeof hdr ) <= log_part->size )
+    {
+        if( esp_partition_read( log_part, off, &hdr, sizeof hdr ) != ESP_OK )
+        {
+            break;
+        }
+        if( hdr.magic == REC_ERASED )
+        {
+            break;
+        }
+        if( ( hdr.magic != REC_MAGIC ) || ( hdr.body_size < ENTRY_BODY_SIZE( 0 ) ) ||
+            ( hdr.body_size > sizeof( struct uplink_store_entry_s ) ) ||
+            ( ( off + REC_SIZE( hdr.body_size ) ) > log_part->size ) )
+        {
+            /* unusable end of log, no more appending until it is drained and erased */
+            ESP_LOGW( TAG_STORE, "WARNING: invalid record at offset 0x%lX, end of log ignored\n", off );
+            log_write_off = log_part->size;
+            break;
+        }
+        if( hdr.state == REC_VALID )
+        {
+            if( found_valid == false )
+            {
+                log_read_off = off;
+                found_valid  = true;
+            }
+            log_nb += 1;
+        }
+        off += REC_SIZE( hdr.body_size );
+    }
+    if( log_write_off < off )
+    {
+        log_write_off = off;
+    }
+    store_stats.flash_enabled = true;
+    if( log_nb == 0 )
+    {
+        log_erase( );
+    }
+    pthread_mutex_unlock( &mx_uplink_store );
+
+    if( log_part == NULL )
+    {
+        return -1;
+    }
+    ESP_LOGI( TAG_STORE, "%lu uplinks recovered from flash log (%lu/%lu bytes used)", log_nb, log_write_off,
+              log_part->size );
+    return ( int ) log_nb;
+#else
+    return 0;
+#endif
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void uplink_store_push( const struct lgw_pkt_rx_s* pkt, const struct timeval* rx_time )
+{
+    struct uplink_store_entry_s* e;
+    bool                         spilled = false;
+
+    pthread_mutex_lock( &mx_uplink_store );
+
+    /* make room by moving the oldest uplink to flash, or dropping it */
+    if( ram_nb >= UPLINK_STORE_RAM_NB )
+    {
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+        spilled = ( log_part != NULL ) && log_append( &ram_ring[ram_head] );
+#endif
+        if( spilled == false )
+        {
+            store_stats.nb_dropped += 1;
+        }
+        ram_head = ( ram_head + 1 ) % UPLINK_STORE_RAM_NB;
+        ram_nb -= 1;
+    }
+
+    e          = &ram_ring[( ram_head + ram_nb ) % UPLINK_STORE_RAM_NB];
+    e->rx_time = *rx_time;
+    memcpy( &( e->pkt ), pkt, sizeof( struct lgw_pkt_rx_s ) );
+    ram_nb += 1;
+    store_stats.nb_stored += 1;
+
+    pthread_mutex_unlock( &mx_uplink_store );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+bool uplink_store_is_empty( void )
+{
+    bool empty;
+
+    pthread_mutex_lock( &mx_uplink_store );
+    empty = ( ram_nb == 0 );
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    empty = empty && ( log_nb == 0 );
+#endif
+    pthread_mutex_unlock( &mx_uplink_store );
+
+    return empty;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+bool uplink_store_peek( struct lgw_pkt_rx_s* pkt, struct timeval* rx_time )
+{
+    const struct uplink_store_entry_s* e = NULL;
+
+    pthread_mutex_lock( &mx_uplink_store );
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    if( ( log_part != NULL ) && ( log_nb > 0 ) && ( ( log_head_valid == true ) || ( log_load_head( ) == true ) ) )
+    {
+        e = &log_head;
+    }
+#endif
+    if( ( e == NULL ) && ( ram_nb > 0 ) )
+    {
+        e = &ram_ring[ram_head];
+    }
+    if( e != NULL )
+    {
+        *rx_time = e->rx_time;
+        memcpy( pkt, &( e->pkt ), ENTRY_BODY_SIZE( e->pkt.size ) - offsetof( struct uplink_store_entry_s, pkt ) );
+    }
+    pthread_mutex_unlock( &mx_uplink_store );
+
+    return ( e != NULL );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void uplink_store_pop( void )
+{
+    pthread_mutex_lock( &mx_uplink_store );
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    if( log_head_valid == true )
+    {
+        log_release_head( );
+        store_stats.nb_replayed += 1;
+        pthread_mutex_unlock( &mx_uplink_store );
+        return;
+    }
+#endif
+    if( ram_nb > 0 )
+    {
+        ram_head = ( ram_head + 1 ) % UPLINK_STORE_RAM_NB;
+        ram_nb -= 1;
+        store_stats.nb_replayed += 1;
+    }
+    pthread_mutex_unlock( &mx_uplink_store );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+int uplink_store_sync( void )
+{
+    int nb_moved = 0;
+
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    pthread_mutex_lock( &mx_uplink_store );
+    while( ( log_part != NULL ) && ( ram_nb > 0 ) && ( log_append( &ram_ring[ram_head] ) == true ) )
+    {
+        ram_head = ( ram_head + 1 ) % UPLINK_STORE_RAM_NB;
+        ram_nb -= 1;
+        nb_moved += 1;
+    }
+    pthread_mutex_unlock( &mx_uplink_store );
+#endif
+
+    return nb_moved;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+void uplink_store_get_stats( struct uplink_store_stats_s* stats )
+{
+    pthread_mutex_lock( &mx_uplink_store );
+    *stats                 = store_stats;
+    stats->nb_queued       = ram_nb;
+    stats->nb_queued_flash = 0;
+#if defined( CONFIG_UPLINK_STORE_FLASH )
+    stats->nb_queued += log_nb;
+    stats->nb_queued_flash = log_nb;
+#endif
+    pthread_mutex_unlock( &mx_uplink_store );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,103 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    LoRaHub store-and-forward queue of the uplinks received while the server is unreachable
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _UPLINK_STORE_H
+#define _UPLINK_STORE_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>   /* C99 types */
+#include <stdbool.h>  /* bool type */
+#include <sys/time.h> /* timeval */
+
+#include "lorahub_hal.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+#define UPLINK_STORE_RAM_NB CONFIG_UPLINK_STORE_RAM_NB /* Number of uplinks kept in RAM before spilling to flash */
+#define UPLINK_STORE_PARTITION "uplink_store"          /* Label of the flash partition used for the spill log */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct uplink_store_stats_s
+{
+    uint32_t nb_queued;       /* number of uplinks waiting to be replayed */
+    uint32_t nb_queued_flash; /* number of the queued uplinks held in the flash log */
+    uint32_t nb_stored;       /* number of uplinks stored since boot */
+    uint32_t nb_replayed;     /* number of stored uplinks released for replay since boot */
+    uint32_t nb_dropped;      /* number of stored uplinks dropped because the queue was full */
+    uint32_t nb_corrupted;    /* number of flash records discarded on CRC error */
+    bool     flash_enabled;   /* true if the flash log partition is in use */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Open the flash spill log, if enabled, and recover the uplinks stored before the last reboot
+@return the number of uplinks recovered from flash, -1 if the flash log is enabled but cannot be used
+
+Without flash log, or if it cannot be used, the queue is held in RAM only.
+*/
+int uplink_store_init( void );
+
+/**
+@brief Store an uplink to be replayed later
+@param pkt pointer to the received packet
+@param rx_time wall-clock time of the reception of the packet
+
+When the RAM queue is full, its oldest uplink is moved to the flash log. If there is no room in flash either, the
+oldest uplink of the RAM queue is dropped.
+*/
+void uplink_store_push( const struct lgw_pkt_rx_s* pkt, const struct timeval* rx_time );
+
+/**
+@brief Check if there are uplinks waiting to be replayed
+@return true if the queue is empty
+*/
+bool uplink_store_is_empty( void );
+
+/**
+@brief Get a copy of the oldest stored uplink, without removing it from the queue
+@param pkt pointer to the packet to be filled
+@param rx_time pointer to the wall-clock time of the reception to be filled
+@return false if the queue is empty
+*/
+bool uplink_store_peek( struct lgw_pkt_rx_s* pkt, struct timeval* rx_time );
+
+/**
+@brief Remove the oldest stored uplink from the queue, once it has been replayed
+
+The records of the flash log are only marked as replayed, the used sectors are erased when the log is drained.
+*/
+void uplink_store_pop( void );
+
+/**
+@brief Move all the uplinks of the RAM queue to the flash log, so they survive a reboot
+@return the number of uplinks moved
+*/
+int uplink_store_sync( void );
+
+/**
+@brief Get the queue occupancy and counters
+@param stats pointer to the structure to be filled
+*/
+void uplink_store_get_stats( struct uplink_store_stats_s* stats );
+
+#endif  // _UPLINK_STORE_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -120,6 +120,54 @@ def get_info(base_url, step_number):
     response = requests.get(url)
     return response
 
+def get_dev_stats(base_url, step_number):
+    """
+    Get the per-device uplink statistics of the LoRaHub.
+
+    Args:
+        base_url (str): The base URL of the LoRaHub API.
+        step_number (int): The test step number.
+
+    Returns:
+        response (requests.Response): The response from the server containing the statistics of each device.
+    """
+    url = f"{base_url}/api/v1/get_dev_stats"
+    log_test_step(step_number, "Get Device Statistics", url, "GET")
+    response = requests.get(url)
+    return response
+
+def get_metrics(base_url, step_number):
+    """
+    Get the packet forwarder metrics of the LoRaHub, in the OpenMetrics text format.
+
+    Args:
+        base_url (str): The base URL of the LoRaHub.
+        step_number (int): The test step number.
+
+    Returns:
+        response (requests.Response): The response from the server containing the counters and histograms.
+    """
+    url = f"{base_url}/metrics"
+    log_test_step(step_number, "Get Metrics", url, "GET")
+    response = requests.get(url)
+    return response
+
+def get_trace(base_url, step_number):
+    """
+    Get the per-packet latency trace of the LoRaHub, in the Chrome trace event format.
+
+    Args:
+        base_url (str): The base URL of the LoRaHub.
+        step_number (int): The test step number.
+
+    Returns:
+        response (requests.Response): The response from the server containing the latest trace events.
+    """
+    url = f"{base_url}/api/v1/get_trace"
+    log_test_step(step_number, "Get Trace", url, "GET")
+    response = requests.get(url)
+    return response
+
 def parse_arguments():
     """
     Parse command line arguments.
@@ -135,6 +183,12 @@ def parse_arguments():
     parser.add_argument('--chan_dr', type=int, default=7, help="Channel data rate")
     parser.add_argument('--chan_bw', type=int, default=125, help="Channel bandwidth")
     parser.add_argument('--sntp_addr', type=str, default="pool.ntp.org", help="SNTP address")
+    parser.add_argument('--push_max_pkt', type=int, default=8, help="Max number of packets per PUSH_DATA")
+    parser.add_argument('--push_max_bytes', type=int, default=1200, help="Max number of bytes per PUSH_DATA")
+    parser.add_argument('--push_hold_us', type=int, default=0, help="Max hold time of an uplink in microseconds")
+    parser.add_argument('--uplink_filter', type=str, default="", help="Uplink filtering rules")
+    parser.add_argument('--lns_fallbacks', type=str, default="", help="Fallback LNS, as host[:port] list")
+    parser.add_argument('--lns_fanout', type=str, default="", help="Additional LNS, as [dl:]host[:port] list")
     return parser.parse_args()
 
 def print_response(response):
@@ -186,7 +240,13 @@ if __name__ == "__main__":
         "chan_freq": args.chan_freq,
         "chan_dr": args.chan_dr,
         "chan_bw": args.chan_bw,
-        "sntp_addr": args.sntp_addr
+        "sntp_addr": args.sntp_addr,
+        "push_max_pkt": args.push_max_pkt,
+        "push_max_bytes": args.push_max_bytes,
+        "push_hold_us": args.push_hold_us,
+        "uplink_filter": args.uplink_filter,
+        "lns_fallbacks": args.lns_fallbacks,
+        "lns_fanout": args.lns_fanout
     }
 
     step_number = 1
@@ -201,6 +261,40 @@ if __name__ == "__main__":
     print_response(response)
     step_number += 1
 
+    # Get the per-device statistics
+    response = get_dev_stats(base_url, step_number)
+    if response.status_code != 200:
+        print(f"{COLOR_RED}Get Device Statistics Response: {response.status_code}{COLOR_RESET}")
+        print_response(response)
+        sys.exit(1)
+    print(f"{COLOR_GREEN}Get Device Statistics Response: {response.status_code}{COLOR_RESET}")
+    print_response(response)
+    step_number += 1
+
+    # Get the metrics, which must end with the OpenMetrics terminator
+    response = get_metrics(base_url, step_number)
+    if response.status_code != 200 or not response.text.endswith("# EOF\n"):
+        print(f"{COLOR_RED}Get Metrics Response: {response.status_code}{COLOR_RESET}")
+        print_response(response)
+        sys.exit(1)
+    print(f"{COLOR_GREEN}Get Metrics Response: {response.status_code}{COLOR_RESET}")
+    print_response(response)
+    step_number += 1
+
+    # Get the latency trace, only its number of events as it can be long. The endpoint only exists when the trace is
+    # enabled in the firmware configuration
+    response = get_trace(base_url, step_number)
+    if response.status_code == 404:
+        print(f"{COLOR_GREEN}Get Trace Response: {response.status_code}, trace disabled{COLOR_RESET}")
+    elif response.status_code != 200 or "traceEvents" not in response.json():
+        print(f"{COLOR_RED}Get Trace Response: {response.status_code}{COLOR_RESET}")
+        print_response(response)
+        sys.exit(1)
+    else:
+        print(f"{COLOR_GREEN}Get Trace Response: {response.status_code}{COLOR_RESET}")
+        print(f"{len(response.json()['traceEvents'])} trace events")
+    step_number += 1
+
     # Set the configuration
     response = set_config(base_url, config, step_number)
     if response.status_code != 200:
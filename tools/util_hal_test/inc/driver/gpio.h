@@ -0,0 +1,25 @@
+/*
+Host stub of the ESP-IDF GPIO driver header, the GPIO functions are implemented by the test mocks
+*/
+
+#ifndef _STUB_GPIO_H
+#define _STUB_GPIO_H
+
+#include <stdint.h> /* C99 types */
+
+#include "esp_attr.h"
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef void ( *gpio_isr_t )( void* arg );
+
+esp_err_t gpio_install_isr_service( int intr_alloc_flags );
+
+esp_err_t gpio_isr_handler_add( gpio_num_t gpio_num, gpio_isr_t isr_handler, void* args );
+
+esp_err_t gpio_set_level( gpio_num_t gpio_num, uint32_t level );
+
+int gpio_get_level( gpio_num_t gpio_num );
+
+#endif  // _STUB_GPIO_H
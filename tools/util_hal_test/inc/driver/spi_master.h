@@ -0,0 +1,28 @@
+/*
+Host stub of the ESP-IDF SPI master driver header, the transmit functions are implemented by the SPI mocks
+*/
+
+#ifndef _STUB_SPI_MASTER_H
+#define _STUB_SPI_MASTER_H
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* C99 types */
+
+#include "esp_err.h"
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+typedef struct
+{
+    uint32_t    flags;
+    size_t      length;   /* in bits */
+    size_t      rxlength; /* in bits, 0 for the same as length */
+    const void* tx_buffer;
+    void*       rx_buffer;
+} spi_transaction_t;
+
+esp_err_t spi_device_polling_transmit( spi_device_handle_t handle, spi_transaction_t* trans_desc );
+
+esp_err_t spi_device_transmit( spi_device_handle_t handle, spi_transaction_t* trans_desc );
+
+#endif  // _STUB_SPI_MASTER_H
@@ -0,0 +1,11 @@
+/*
+Host stub of the ESP-IDF memory placement attributes
+*/
+
+#ifndef _STUB_ESP_ATTR_H
+#define _STUB_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DMA_ATTR
+
+#endif  // _STUB_ESP_ATTR_H
@@ -0,0 +1,13 @@
+/*
+Host stub of the ESP-IDF error codes
+*/
+
+#ifndef _STUB_ESP_ERR_H
+#define _STUB_ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#endif  // _STUB_ESP_ERR_H
@@ -0,0 +1,13 @@
+/*
+Host stub of the ESP-IDF logging macros, the logs of the code under test are not displayed
+*/
+
+#ifndef _STUB_ESP_LOG_H
+#define _STUB_ESP_LOG_H
+
+#define ESP_LOGE( tag, ... ) ( void ) ( tag )
+#define ESP_LOGW( tag, ... ) ( void ) ( tag )
+#define ESP_LOGI( tag, ... ) ( void ) ( tag )
+#define ESP_LOGD( tag, ... ) ( void ) ( tag )
+
+#endif  // _STUB_ESP_LOG_H
@@ -0,0 +1,12 @@
+/*
+Host stub of the ESP-IDF ROM functions
+*/
+
+#ifndef _STUB_ESP_ROM_SYS_H
+#define _STUB_ESP_ROM_SYS_H
+
+#include <stdint.h> /* C99 types */
+
+void esp_rom_delay_us( uint32_t us );
+
+#endif  // _STUB_ESP_ROM_SYS_H
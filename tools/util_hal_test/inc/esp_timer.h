@@ -0,0 +1,12 @@
+/*
+Host stub of the ESP-IDF high resolution timer, the time is driven by the test mocks
+*/
+
+#ifndef _STUB_ESP_TIMER_H
+#define _STUB_ESP_TIMER_H
+
+#include <stdint.h> /* C99 types */
+
+int64_t esp_timer_get_time( void );
+
+#endif  // _STUB_ESP_TIMER_H
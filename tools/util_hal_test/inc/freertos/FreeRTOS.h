@@ -0,0 +1,35 @@
+/*
+Host stub of the FreeRTOS kernel header, for the HAL unit tests: the tests are single-threaded, the critical sections
+are no-ops
+*/
+
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+#define portENTER_CRITICAL( mux ) ( void ) ( mux )
+#define portEXIT_CRITICAL( mux ) ( void ) ( mux )
+#define portENTER_CRITICAL_ISR( mux ) ( void ) ( mux )
+#define portEXIT_CRITICAL_ISR( mux ) ( void ) ( mux )
+#define portYIELD_FROM_ISR( woken ) ( void ) ( woken )
+
+#define configTICK_RATE_HZ 100
+#define pdMS_TO_TICKS( ms ) ( ( TickType_t ) ( ( ( uint64_t ) ( ms ) * configTICK_RATE_HZ ) / 1000 ) )
+#define portMAX_DELAY ( ( TickType_t ) 0xFFFFFFFF )
+
+#define pdFALSE 0
+#define pdTRUE 1
+
+#endif  // _STUB_FREERTOS_H
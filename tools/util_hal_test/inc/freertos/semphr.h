@@ -0,0 +1,18 @@
+/*
+Host stub of the FreeRTOS semaphore header, the mutexes are implemented by the test mocks
+*/
+
+#ifndef _STUB_SEMPHR_H
+#define _STUB_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t semaphore, TickType_t ticks_to_wait );
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t semaphore );
+
+#endif  // _STUB_SEMPHR_H
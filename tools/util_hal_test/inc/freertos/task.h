@@ -0,0 +1,20 @@
+/*
+Host stub of the FreeRTOS task header, the task notifications are implemented by the test mocks
+*/
+
+#ifndef _STUB_TASK_H
+#define _STUB_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+
+uint32_t ulTaskNotifyTake( BaseType_t clear_on_exit, TickType_t ticks_to_wait );
+
+BaseType_t xTaskNotifyGive( TaskHandle_t task );
+
+void vTaskNotifyGiveFromISR( TaskHandle_t task, BaseType_t* task_woken );
+
+#endif  // _STUB_TASK_H
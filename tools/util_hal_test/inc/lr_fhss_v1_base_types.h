@@ -0,0 +1,13 @@
+/*
+Host stub of the LR-FHSS types of the radio drivers, which are not used by the HAL unit tests
+*/
+
+#ifndef _STUB_LR_FHSS_V1_BASE_TYPES_H
+#define _STUB_LR_FHSS_V1_BASE_TYPES_H
+
+typedef struct
+{
+    int unused;
+} lr_fhss_v1_params_t;
+
+#endif  // _STUB_LR_FHSS_V1_BASE_TYPES_H
@@ -0,0 +1,29 @@
+/*
+Host stub of the HAL interface of the sx126x driver (Lora-net/sx126x_driver v2.3.2), which is cloned separately and
+is not needed by the HAL unit tests
+*/
+
+#ifndef _STUB_SX126X_HAL_H
+#define _STUB_SX126X_HAL_H
+
+#include <stdint.h> /* C99 types */
+
+typedef enum sx126x_hal_status_e
+{
+    SX126X_HAL_STATUS_OK                  = 0,
+    SX126X_HAL_STATUS_UNSUPPORTED_FEATURE = 1,
+    SX126X_HAL_STATUS_UNKNOWN_VALUE       = 2,
+    SX126X_HAL_STATUS_ERROR               = 3,
+} sx126x_hal_status_t;
+
+sx126x_hal_status_t sx126x_hal_write( const void* context, const uint8_t* command, const uint16_t command_length,
+                                      const uint8_t* data, const uint16_t data_length );
+
+sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
+                                     uint8_t* data, const uint16_t data_length );
+
+sx126x_hal_status_t sx126x_hal_reset( const void* context );
+
+sx126x_hal_status_t sx126x_hal_wakeup( const void* context );
+
+#endif  // _STUB_SX126X_HAL_H
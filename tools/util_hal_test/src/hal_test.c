@@ -0,0 +1,81 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub HAL, the radio and the ESP-IDF services being mocked
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* EXIT_SUCCESS, EXIT_FAILURE */
+
+#include "hal_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct test_group_s
+{
+    const char* name;
+    void ( *run )( void );
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static const struct test_group_s test_groups[] = {
+    { "hal_rx", test_hal_rx },
+    { "hal_aux", test_hal_aux },
+    { "ral_shadow", test_ral_shadow },
+    { "radio_spi", test_radio_spi },
+};
+
+static unsigned nb_checks   = 0;
+static unsigned nb_failures = 0;
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+bool hal_test_check( bool ok, const char* expr, const char* file, int line )
+{
+    nb_checks += 1;
+    if( ok == false )
+    {
+        nb_failures += 1;
+        printf( "%s:%d: FAILED: %s\n", file, line, expr );
+    }
+
+    return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( void )
+{
+    unsigned failures_before;
+    unsigned i;
+
+    for( i = 0; i < sizeof test_groups / sizeof test_groups[0]; i++ )
+    {
+        failures_before = nb_failures;
+        test_groups[i].run( );
+        printf( "%-16s %s\n", test_groups[i].name, ( nb_failures == failures_before ) ? "OK" : "FAILED" );
+    }
+    printf( "%u checks, %u failures\n", nb_checks, nb_failures );
+
+    return ( nb_failures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,87 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub HAL, common definitions
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _HAL_TEST_H
+#define _HAL_TEST_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC MACROS -------------------------------------------------------- */
+
+/**
+@brief Check a condition, the failure is reported with its location and the test goes on
+*/
+#define CHECK( cond ) hal_test_check( ( cond ), #cond, __FILE__, __LINE__ )
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC CONSTANTS ----------------------------------------------------- */
+
+/* GPIOs connected to the mocked radio */
+#define MOCK_GPIO_NSS 2
+#define MOCK_GPIO_BUSY 3
+#define MOCK_GPIO_DIO1 4
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Account the result of a check
+@param ok result of the check
+@param expr text of the condition checked
+@param file source file of the check
+@param line source line of the check
+@return the result of the check
+*/
+bool hal_test_check( bool ok, const char* expr, const char* file, int line );
+
+/**
+@brief Mock of the radio NSS line, driven through gpio_set_level()
+@param level level set on the line
+*/
+void mock_radio_spi_set_nss( uint32_t level );
+
+/**
+@brief Mock of the radio BUSY line, read through gpio_get_level()
+@return level of the line
+*/
+int mock_radio_spi_get_busy( void );
+
+/**
+@brief Tests of the RX layer: DIO interrupt queue, packet queue and wait for the radio events
+*/
+void test_hal_rx( void );
+
+/**
+@brief Tests of the auxiliary functions: LoRa time on air, packet start and end from the header
+*/
+void test_hal_aux( void );
+
+/**
+@brief Tests of the RAL shadow cache: writes elided, invalidation and retry of the failed writes
+*/
+void test_ral_shadow( void );
+
+/**
+@brief Tests of the radio SPI transport: polling or DMA transactions, bytes on the bus, per-opcode statistics
+*/
+void test_radio_spi( void );
+
+#endif  // _HAL_TEST_H
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,197 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub HAL auxiliary functions (lorahub_aux.c)
+
+    The integer time on air is cross-checked against the floating point formula of the sx126x datasheet, for every
+    spreading factor, bandwidth, coding rate, header and CRC setting and payload size, with several preamble lengths.
+    The same combinations check the packet start and end derived from the end of its header.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stddef.h>  /* NULL */
+#include <math.h>    /* ceil */
+
+#include "lorahub_aux.h"
+#include "lorahub_hal.h"
+
+#include "hal_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+static const uint8_t  test_bw[]       = { BW_125KHZ, BW_250KHZ, BW_500KHZ };
+static const double   test_bw_hz[]    = { 125e3, 250e3, 500e3 };
+static const uint16_t test_preamble[] = { 6, 8, 16, 1000 };
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* time on air of a LoRa packet as given by the sx126x datasheet, low datarate optimization for SF11 and SF12 */
+static double ref_time_on_air( double bw_hz, uint8_t sf, uint8_t cr, uint16_t n_symbol_preamble, bool no_header,
+                               bool no_crc, uint8_t size, double* n_symbol, double* n_symbol_payload )
+{
+    int    de     = ( sf >= 11 ) ? 1 : 0;
+    int    n_bit  = 8 * size + ( ( no_crc == false ) ? 16 : 0 ) - 4 * sf + ( ( no_header == false ) ? 20 : 0 );
+    int    n_block;
+    double n_sync = ( sf >= 7 ) ? 4.25 : 6.25;
+
+    if( sf >= 7 )
+    {
+        n_bit += 8;
+    }
+    n_block           = ceil( ( double ) ( ( n_bit > 0 ) ? n_bit : 0 ) / ( double ) ( 4 * ( sf - 2 * de ) ) );
+    *n_symbol_payload = ( double ) n_block * ( cr + 4 );
+    *n_symbol         = ( double ) n_symbol_preamble + n_sync + 8.0 + *n_symbol_payload;
+
+    /* exact as long as the result is an integer number of microseconds: 2^SF / BW is a multiple of 4 us */
+    return *n_symbol * ( double ) ( 1 << sf ) * 1e6 / bw_hz;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* every combination of the LoRa parameters, counting the mismatches to report them once */
+static void test_time_on_air_exhaustive( void )
+{
+    unsigned nb_cases    = 0;
+    unsigned nb_mismatch = 0;
+    unsigned i, j, k;
+    uint8_t  sf, cr;
+    int      size;
+    bool     no_header, no_crc;
+    uint32_t toa_us, n_symbol_x4, n_symbol_payload;
+    uint16_t t_symbol_us;
+    double   ref_toa_us, ref_n_symbol, ref_n_symbol_payload;
+
+    for( i = 0; i < sizeof test_bw / sizeof test_bw[0]; i++ )
+    {
+        for( sf = DR_LORA_SF5; sf <= DR_LORA_SF12; sf++ )
+        {
+            for( cr = CR_LORA_4_5; cr <= CR_LORA_4_8; cr++ )
+            {
+                for( j = 0; j < sizeof test_preamble / sizeof test_preamble[0]; j++ )
+                {
+                    for( k = 0; k < 4; k++ )
+                    {
+                        no_header = ( ( k & 1 ) != 0 );
+                        no_crc    = ( ( k & 2 ) != 0 );
+                        for( size = 0; size <= 255; size++ )
+                        {
+                            toa_us     = lora_packet_time_on_air( test_bw[i], sf, cr, test_preamble[j], no_header,
+                                                                  no_crc, size, &n_symbol_x4, &n_symbol_payload,
+                                                                  &t_symbol_us );
+                            ref_toa_us = ref_time_on_air( test_bw_hz[i], sf, cr, test_preamble[j], no_header, no_crc,
+                                                          size, &ref_n_symbol, &ref_n_symbol_payload );
+                            nb_cases += 1;
+                            if( ( ( double ) toa_us != ref_toa_us ) || ( ( double ) n_symbol_x4 != 4 * ref_n_symbol ) ||
+                                ( ( double ) n_symbol_payload != ref_n_symbol_payload ) ||
+                                ( ( double ) t_symbol_us != ( double ) ( 1 << sf ) * 1e6 / test_bw_hz[i] ) )
+                            {
+                                nb_mismatch += 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    CHECK( nb_cases == 3 * 8 * 4 * 4 * 4 * 256 );
+    CHECK( nb_mismatch == 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the start and the end of an explicit header packet, from the end of its header: the preamble, sync and SFD and the 8
+ * header symbols before, the time on air after the preamble start. Also across the wrap of the counter */
+static void test_end_from_header( void )
+{
+    static const uint32_t test_count_us_preamble[] = { 1000000, 0xFFFFF000 };
+
+    unsigned nb_mismatch = 0;
+    unsigned i, j, k;
+    uint8_t  sf, cr;
+    int      size;
+    bool     no_crc;
+    uint32_t toa_us, t_header_us, count_us_header, count_us_preamble, count_us_end;
+    double   ref_n_symbol, ref_n_symbol_payload;
+
+    for( i = 0; i < sizeof test_bw / sizeof test_bw[0]; i++ )
+    {
+        for( sf = DR_LORA_SF5; sf <= DR_LORA_SF12; sf++ )
+        {
+            for( cr = CR_LORA_4_5; cr <= CR_LORA_4_8; cr++ )
+            {
+                for( j = 0; j < sizeof test_preamble / sizeof test_preamble[0]; j++ )
+                {
+                    for( k = 0; k < 4; k++ )
+                    {
+                        no_crc = ( ( k & 1 ) != 0 );
+                        for( size = 0; size <= 255; size++ )
+                        {
+                            toa_us = lora_packet_time_on_air( test_bw[i], sf, cr, test_preamble[j], false, no_crc,
+                                                              size, NULL, NULL, NULL );
+                            ref_time_on_air( test_bw_hz[i], sf, cr, test_preamble[j], false, no_crc, size,
+                                             &ref_n_symbol, &ref_n_symbol_payload );
+                            t_header_us = ( uint32_t ) ( ( ref_n_symbol - ref_n_symbol_payload ) *
+                                                         ( double ) ( 1 << sf ) * 1e6 / test_bw_hz[i] );
+
+                            count_us_header = test_count_us_preamble[k >> 1] + t_header_us;
+                            count_us_end    = lora_packet_end_from_header( test_bw[i], sf, cr, test_preamble[j], no_crc,
+                                                                           size, count_us_header, &count_us_preamble );
+                            if( ( count_us_preamble != test_count_us_preamble[k >> 1] ) ||
+                                ( count_us_end != test_count_us_preamble[k >> 1] + toa_us ) )
+                            {
+                                nb_mismatch += 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    CHECK( nb_mismatch == 0 );
+
+    /* the start of the packet is optional */
+    CHECK( lora_packet_end_from_header( BW_125KHZ, DR_LORA_SF7, CR_LORA_4_5, 8, false, 10, 100000, NULL ) ==
+           100000 - 20480 - 256 + 41216 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* invalid parameters give a null time on air, the optional outputs may be omitted */
+static void test_time_on_air_params( void )
+{
+    CHECK( lora_packet_time_on_air( BW_UNDEFINED, DR_LORA_SF7, CR_LORA_4_5, 8, false, false, 10, NULL, NULL, NULL ) ==
+           0 );
+    CHECK( lora_packet_time_on_air( BW_125KHZ, 4, CR_LORA_4_5, 8, false, false, 10, NULL, NULL, NULL ) == 0 );
+    CHECK( lora_packet_time_on_air( BW_125KHZ, 13, CR_LORA_4_5, 8, false, false, 10, NULL, NULL, NULL ) == 0 );
+    CHECK( lora_packet_time_on_air( BW_125KHZ, DR_LORA_SF7, 0, 8, false, false, 10, NULL, NULL, NULL ) == 0 );
+
+    /* SF7 125 kHz CR 4/5, 8 symbols of preamble and 10 bytes: 20.25 + 20 symbols of 1.024 ms */
+    CHECK( lora_packet_time_on_air( BW_125KHZ, DR_LORA_SF7, CR_LORA_4_5, 8, false, false, 10, NULL, NULL, NULL ) ==
+           41216 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_hal_aux( void )
+{
+    test_time_on_air_exhaustive( );
+    test_time_on_air_params( );
+    test_end_from_header( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
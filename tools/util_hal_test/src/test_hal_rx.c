@@ -0,0 +1,424 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub HAL RX layer (lorahub_hal_rx.c), on a mocked radio
+
+    The mocked radio holds a set of IRQ flags and its DIO1 line is high while one of them is set, the ISR being called
+    on the rising edges only, as configured by lgw_connect(). The task notifications are counted, and a wait without
+    any pending notification is accounted as a block instead of sleeping.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* memcpy */
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+
+#include "lorahub_hal.h"
+#include "lorahub_hal_rx.h"
+#include "radio_context.h"
+#include "ral.h"
+
+#include "hal_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define MOCK_RSSI -87
+#define MOCK_SNR 7
+
+#define WAIT_MS 100 /* timeout of the waits, never elapsed as the mocked waits do not sleep */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static uint32_t   mock_count_us   = 0; /* internal counter value */
+static uint32_t   mock_notify     = 0; /* notifications pending for the task */
+static uint32_t   mock_nb_block   = 0; /* number of waits without any pending notification */
+static ral_irq_t  mock_irq_status = 0; /* IRQ flags set in the radio */
+static ral_irq_t  mock_irq_race   = 0; /* IRQ flags set by the radio while its IRQ status is read */
+static ral_irq_t  mock_irq_read   = 0; /* IRQ flags set by the radio while a packet payload is read */
+static gpio_isr_t mock_dio_isr    = NULL;
+
+static const uint8_t mock_payload[] = { 0x40, 0x11, 0x22, 0x33, 0x44, 0x00, 0x01, 0x00, 0x01, 0xAA, 0xBB };
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void radio_raise_irq( ral_irq_t irq );
+
+/* -------------------------------------------------------------------------- */
+/* --- MOCKS ---------------------------------------------------------------- */
+
+int lgw_get_instcnt( uint32_t* inst_cnt_us )
+{
+    *inst_cnt_us = mock_count_us;
+    return LGW_HAL_SUCCESS;
+}
+
+void esp_rom_delay_us( uint32_t us )
+{
+    mock_count_us += us;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    return ( TaskHandle_t ) &mock_notify;
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t clear_on_exit, TickType_t ticks_to_wait )
+{
+    uint32_t count = mock_notify;
+
+    ( void ) ticks_to_wait;
+
+    if( count == 0 )
+    {
+        mock_nb_block += 1; /* the task would have slept until the timeout */
+        return 0;
+    }
+    mock_notify = ( clear_on_exit == pdTRUE ) ? 0 : ( count - 1 );
+
+    return count;
+}
+
+BaseType_t xTaskNotifyGive( TaskHandle_t task )
+{
+    ( void ) task;
+    mock_notify += 1;
+    return pdTRUE;
+}
+
+void vTaskNotifyGiveFromISR( TaskHandle_t task, BaseType_t* task_woken )
+{
+    ( void ) task;
+    mock_notify += 1;
+    *task_woken = pdTRUE;
+}
+
+esp_err_t gpio_install_isr_service( int intr_alloc_flags )
+{
+    ( void ) intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add( gpio_num_t gpio_num, gpio_isr_t isr_handler, void* args )
+{
+    ( void ) args;
+    if( gpio_num == MOCK_GPIO_DIO1 )
+    {
+        mock_dio_isr = isr_handler;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level( gpio_num_t gpio_num, uint32_t level )
+{
+    if( gpio_num == MOCK_GPIO_NSS )
+    {
+        mock_radio_spi_set_nss( level );
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level( gpio_num_t gpio_num )
+{
+    if( gpio_num == MOCK_GPIO_BUSY )
+    {
+        return mock_radio_spi_get_busy( );
+    }
+    return ( ( gpio_num == MOCK_GPIO_DIO1 ) && ( mock_irq_status != 0 ) ) ? 1 : 0;
+}
+
+static ral_status_t mock_get_and_clear_irq_status( const void* context, ral_irq_t* irq )
+{
+    ( void ) context;
+    *irq            = mock_irq_status;
+    mock_irq_status = 0;
+
+    /* raised after the read, not cleared: DIO1 stays high, without any rising edge */
+    if( mock_irq_race != 0 )
+    {
+        mock_count_us += 50;
+        mock_irq_status = mock_irq_race;
+        mock_irq_race   = 0;
+    }
+    return RAL_STATUS_OK;
+}
+
+static ral_status_t mock_get_lora_rx_pkt_status( const void* context, ral_lora_rx_pkt_status_t* rx_pkt_status )
+{
+    ( void ) context;
+    rx_pkt_status->rssi_pkt_in_dbm        = MOCK_RSSI;
+    rx_pkt_status->snr_pkt_in_db          = MOCK_SNR;
+    rx_pkt_status->signal_rssi_pkt_in_dbm = MOCK_RSSI;
+    return RAL_STATUS_OK;
+}
+
+static ral_status_t mock_get_pkt_payload( const void* context, uint16_t max_size_in_bytes, uint8_t* buffer,
+                                          uint16_t* size_in_bytes )
+{
+    ( void ) context;
+    ( void ) max_size_in_bytes;
+    memcpy( buffer, mock_payload, sizeof mock_payload );
+    *size_in_bytes = sizeof mock_payload;
+
+    /* raised after the IRQ status was cleared, DIO1 gets a rising edge */
+    if( mock_irq_read != 0 )
+    {
+        radio_raise_irq( mock_irq_read );
+        mock_irq_read = 0;
+    }
+    return RAL_STATUS_OK;
+}
+
+static radio_context_t mock_radio_context = { .gpio_dio1 = MOCK_GPIO_DIO1, .gpio_led_rx = 0xFF, .gpio_led_tx = 0xFF };
+
+static const ral_t mock_ral = {
+    .context = &mock_radio_context,
+    .driver  = {
+         .get_and_clear_irq_status = mock_get_and_clear_irq_status,
+         .get_lora_rx_pkt_status   = mock_get_lora_rx_pkt_status,
+         .get_pkt_payload          = mock_get_pkt_payload,
+    },
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* set IRQ flags in the radio at the current time, the ISR is called on the rising edge of DIO1 */
+static void radio_raise_irq( ral_irq_t irq )
+{
+    bool edge = ( mock_irq_status == 0 );
+
+    mock_irq_status |= irq;
+    if( edge == true )
+    {
+        mock_dio_isr( NULL );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int fetch_pkt( uint32_t* count_us, int8_t* rssi, uint16_t* size )
+{
+    bool     rx_stopped;
+    bool     hdr_received;
+    uint32_t count_us_hdr;
+    int8_t   snr;
+    uint8_t  status;
+    uint8_t  payload[256];
+
+    return lgw_radio_get_pkt( &mock_ral, &rx_stopped, count_us, &hdr_received, &count_us_hdr, rssi, &snr, &status, size,
+                              payload );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* back to an idle radio in RX, no event pending */
+static void reset( void )
+{
+    uint32_t count_us;
+    int8_t   rssi;
+    uint16_t size;
+
+    lgw_radio_clear_irq( &mock_ral );
+    while( fetch_pkt( &count_us, &rssi, &size ) == 1 )
+    {
+    }
+    mock_irq_status = 0;
+    mock_irq_race   = 0;
+    mock_irq_read   = 0;
+    mock_notify     = 0;
+    mock_nb_block   = 0;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a packet received while idle is fetched right away */
+static void test_wait_pkt_rx( void )
+{
+    uint32_t count_us;
+    int8_t   rssi;
+    uint16_t size;
+
+    reset( );
+
+    mock_count_us = 1000;
+    radio_raise_irq( RAL_IRQ_RX_HDR_OK );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 0 );
+
+    mock_count_us = 2000;
+    radio_raise_irq( RAL_IRQ_RX_DONE );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( mock_nb_block == 0 );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( ( count_us == 2000 ) && ( rssi == MOCK_RSSI ) && ( size == sizeof mock_payload ) );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a packet moved to the packet queue by lgw_send_prepare() must not wake up the task until the TX is over, as
+ * lgw_receive() does not fetch it meanwhile */
+static void test_wait_pkt_pending_at_prepare( void )
+{
+    uint32_t count_us;
+    int8_t   rssi;
+    uint16_t size;
+    bool     timeout;
+    int      i;
+
+    reset( );
+
+    /* a packet is received, and the TX is prepared before it is fetched */
+    mock_count_us = 10000;
+    radio_raise_irq( RAL_IRQ_RX_HDR_OK | RAL_IRQ_RX_DONE );
+    lgw_radio_clear_irq( &mock_ral );
+
+    /* the notification of its IRQ wakes up the task once, then the task blocks while the TX is scheduled or emitting */
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_SCHEDULED ) == true );
+    for( i = 0; i < 3; i++ )
+    {
+        CHECK( lgw_radio_wait_irq( WAIT_MS, TX_SCHEDULED ) == false );
+        CHECK( lgw_radio_wait_irq( WAIT_MS, TX_EMITTING ) == false );
+    }
+    CHECK( mock_nb_block == 6 );
+
+    /* TX_DONE wakes it up, then the packet is fetched at once */
+    mock_count_us = 20000;
+    radio_raise_irq( RAL_IRQ_TX_DONE );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_EMITTING ) == true );
+    CHECK( ( lgw_radio_tx_done( &mock_ral, &timeout, &count_us ) == true ) && ( timeout == false ) );
+    CHECK( count_us == 20000 );
+    mock_nb_block = 0;
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( mock_nb_block == 0 );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( count_us == 10000 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* an IRQ queued while a TX is scheduled is only processed once the TX is emitting */
+static void test_wait_irq_pending_while_scheduled( void )
+{
+    uint32_t count_us;
+    bool     timeout;
+
+    reset( );
+
+    /* a header IRQ races the TX configuration */
+    lgw_radio_clear_irq( &mock_ral );
+    mock_count_us = 30000;
+    radio_raise_irq( RAL_IRQ_RX_HDR_OK );
+
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_SCHEDULED ) == true );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_SCHEDULED ) == false );
+    CHECK( mock_nb_block == 1 );
+
+    /* once emitting, lgw_receive() processes it while checking for TX_DONE, then the task blocks again */
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_EMITTING ) == true );
+    CHECK( mock_nb_block == 1 );
+    CHECK( lgw_radio_tx_done( &mock_ral, &timeout, &count_us ) == false );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_EMITTING ) == false );
+    CHECK( mock_nb_block == 2 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* an IRQ raised while the IRQ status is read gets no interrupt, it is processed with the one being read */
+static void test_irq_raised_while_read( void )
+{
+    uint32_t count_us;
+    int8_t   rssi;
+    uint16_t size;
+
+    reset( );
+
+    mock_count_us = 40000;
+    mock_irq_race = RAL_IRQ_RX_DONE;
+    radio_raise_irq( RAL_IRQ_RX_HDR_OK );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( ( count_us == 40050 ) && ( size == sizeof mock_payload ) );
+    CHECK( mock_irq_status == 0 );
+
+    /* the next IRQ gets its rising edge again */
+    mock_count_us = 50000;
+    radio_raise_irq( RAL_IRQ_RX_HDR_OK | RAL_IRQ_RX_DONE );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( count_us == 50000 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* only a packet ended while the previous one was read is counted in the read window, not a header */
+static void test_read_window( void )
+{
+    uint32_t count_us;
+    int8_t   rssi;
+    uint16_t size;
+    uint32_t nb_set_rx;
+    uint32_t nb_window;
+    uint32_t nb_irq_overflow;
+    uint32_t nb_pkt_overflow;
+
+    reset( );
+    lgw_radio_get_rx_stats( &nb_set_rx, &nb_window, &nb_irq_overflow, &nb_pkt_overflow );
+
+    /* the header of the next packet while the payload is read, then its end */
+    mock_count_us = 60000;
+    mock_irq_read = RAL_IRQ_RX_HDR_OK;
+    radio_raise_irq( RAL_IRQ_RX_DONE );
+    CHECK( lgw_radio_wait_irq( WAIT_MS, TX_FREE ) == true );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    mock_count_us = 70000;
+    radio_raise_irq( RAL_IRQ_RX_DONE );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( count_us == 70000 );
+    lgw_radio_get_rx_stats( &nb_set_rx, &nb_window, &nb_irq_overflow, &nb_pkt_overflow );
+    CHECK( nb_window == 0 );
+
+    /* the end of the next packet while the payload is read, both packets are kept */
+    mock_count_us = 80000;
+    mock_irq_read = RAL_IRQ_RX_HDR_OK | RAL_IRQ_RX_DONE;
+    radio_raise_irq( RAL_IRQ_RX_DONE );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 1 );
+    CHECK( fetch_pkt( &count_us, &rssi, &size ) == 0 );
+    lgw_radio_get_rx_stats( &nb_set_rx, &nb_window, &nb_irq_overflow, &nb_pkt_overflow );
+    CHECK( nb_window == 1 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_hal_rx( void )
+{
+    CHECK( lgw_radio_init_rx( &mock_ral ) == LGW_HAL_SUCCESS );
+    CHECK( mock_dio_isr != NULL );
+
+    test_wait_pkt_rx( );
+    test_wait_pkt_pending_at_prepare( );
+    test_wait_irq_pending_while_scheduled( );
+    test_irq_raised_while_read( );
+    test_read_window( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
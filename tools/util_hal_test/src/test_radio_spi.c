@@ -0,0 +1,399 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the radio SPI transport (radio_spi.c) and of the sx126x HAL on top of it (sx126x_hal.c), on a
+    mocked SPI master
+
+    The mocked SPI master records the bytes sent on the bus, clocks in a known pattern and counts the transactions
+    done in polling and in DMA mode. Each transaction checks that NSS is low, BUSY is released and the transport lock
+    is held, and advances the time by 1 us per byte.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stddef.h>  /* NULL */
+#include <string.h>  /* memcpy, memcmp */
+
+#include <driver/spi_master.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+
+#include "radio_context.h"
+#include "radio_spi.h"
+#include "sx126x_hal.h"
+
+#include "hal_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define MOCK_MISO( i ) ( ( uint8_t ) ( 0xA5 ^ ( i ) ) ) /* byte clocked in by the radio at the given position */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+/* sx126x opcodes */
+#define SX126X_SET_STANDBY 0x80
+#define SX126X_GET_IRQ_STATUS 0x12
+#define SX126X_WRITE_BUFFER 0x0E
+#define SX126X_READ_BUFFER 0x1E
+#define SX126X_NOP 0x00
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static uint32_t  mock_nss          = 1;      /* level of the NSS line */
+static unsigned  mock_busy_reads   = 0;      /* reads of BUSY left before it is released */
+static unsigned  mock_nb_busy_read = 0;      /* number of reads of BUSY */
+static unsigned  mock_nb_polling   = 0;      /* number of transactions in polling mode */
+static unsigned  mock_nb_dma       = 0;      /* number of transactions queued to the DMA */
+static unsigned  mock_nb_bad_state = 0;      /* number of transactions with NSS high, BUSY or the lock not ready */
+static int       mock_lock_depth   = 0;      /* number of takes of the transport lock not given back */
+static unsigned  mock_nb_lock      = 0;      /* number of takes of the transport lock */
+static size_t    mock_bus_length   = 0;      /* number of bytes of the last transaction */
+static bool      mock_bus_rx       = false;  /* the bytes clocked in by the last transaction were kept */
+static esp_err_t mock_spi_err      = ESP_OK; /* result of the transactions */
+static int64_t   mock_time_us      = 0;
+
+static uint8_t mock_bus_mosi[RADIO_SPI_BUFFER_SIZE]; /* bytes sent by the last transaction */
+
+static radio_context_t mock_radio_context = { .spi_nss = MOCK_GPIO_NSS, .gpio_busy = MOCK_GPIO_BUSY };
+
+/* -------------------------------------------------------------------------- */
+/* --- MOCKS ---------------------------------------------------------------- */
+
+static esp_err_t mock_transmit( spi_transaction_t* trans_desc )
+{
+    size_t   i;
+    uint8_t* rx = ( uint8_t* ) trans_desc->rx_buffer;
+
+    if( ( mock_nss != 0 ) || ( mock_busy_reads != 0 ) || ( mock_lock_depth != 1 ) )
+    {
+        mock_nb_bad_state += 1;
+    }
+
+    mock_bus_length = trans_desc->length / 8;
+    mock_bus_rx     = ( rx != NULL );
+    memcpy( mock_bus_mosi, trans_desc->tx_buffer, mock_bus_length );
+    for( i = 0; ( rx != NULL ) && ( i < mock_bus_length ); i++ )
+    {
+        rx[i] = MOCK_MISO( i );
+    }
+    mock_time_us += mock_bus_length;
+
+    return mock_spi_err;
+}
+
+esp_err_t spi_device_polling_transmit( spi_device_handle_t handle, spi_transaction_t* trans_desc )
+{
+    ( void ) handle;
+    mock_nb_polling += 1;
+    return mock_transmit( trans_desc );
+}
+
+esp_err_t spi_device_transmit( spi_device_handle_t handle, spi_transaction_t* trans_desc )
+{
+    ( void ) handle;
+    mock_nb_dma += 1;
+    return mock_transmit( trans_desc );
+}
+
+int64_t esp_timer_get_time( void )
+{
+    return mock_time_us;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void )
+{
+    static int mock_mutex;
+
+    return &mock_mutex;
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t semaphore, TickType_t ticks_to_wait )
+{
+    ( void ) semaphore;
+    ( void ) ticks_to_wait;
+    mock_lock_depth += 1;
+    mock_nb_lock += 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t semaphore )
+{
+    ( void ) semaphore;
+    mock_lock_depth -= 1;
+    return pdTRUE;
+}
+
+void mock_radio_spi_set_nss( uint32_t level )
+{
+    mock_nss = level;
+}
+
+int mock_radio_spi_get_busy( void )
+{
+    mock_nb_busy_read += 1;
+    if( mock_busy_reads == 0 )
+    {
+        return 0;
+    }
+    mock_busy_reads -= 1;
+
+    return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void reset( void )
+{
+    mock_nss          = 1;
+    mock_busy_reads   = 0;
+    mock_nb_busy_read = 0;
+    mock_nb_polling   = 0;
+    mock_nb_dma       = 0;
+    mock_nb_bad_state = 0;
+    mock_lock_depth   = 0;
+    mock_nb_lock      = 0;
+    mock_bus_length   = 0;
+    mock_bus_rx       = false;
+    mock_spi_err      = ESP_OK;
+    memset( mock_bus_mosi, 0, sizeof mock_bus_mosi );
+    radio_spi_stats_reset( );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* statistics of an opcode, NULL if it was not accounted */
+static const radio_spi_cmd_stats_t* find_stats( const radio_spi_cmd_stats_t* stats, int nb, uint16_t opcode )
+{
+    int i;
+
+    for( i = 0; i < nb; i++ )
+    {
+        if( stats[i].opcode == opcode )
+        {
+            return &stats[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* up to RADIO_SPI_POLLING_MAX_SIZE bytes, command and data together, the transaction is polled, above it goes to the
+ * DMA */
+static void test_polling_dma_split( void )
+{
+    static const uint8_t command[] = { SX126X_WRITE_BUFFER, 0x00 };
+
+    uint8_t data[RADIO_SPI_BUFFER_SIZE] = { 0 };
+
+    reset( );
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, data, NULL, RADIO_SPI_POLLING_MAX_SIZE - 2 ) == true );
+    CHECK( ( mock_nb_polling == 1 ) && ( mock_nb_dma == 0 ) );
+    CHECK( mock_bus_length == RADIO_SPI_POLLING_MAX_SIZE );
+
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, data, NULL, RADIO_SPI_POLLING_MAX_SIZE - 1 ) == true );
+    CHECK( ( mock_nb_polling == 1 ) && ( mock_nb_dma == 1 ) );
+    CHECK( mock_bus_length == RADIO_SPI_POLLING_MAX_SIZE + 1 );
+
+    /* the size of the data alone does not matter */
+    CHECK( radio_spi_transfer( &mock_radio_context, NULL, 0, data, NULL, RADIO_SPI_POLLING_MAX_SIZE ) == true );
+    CHECK( ( mock_nb_polling == 2 ) && ( mock_nb_dma == 1 ) );
+
+    /* a full buffer */
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, data, NULL, RADIO_SPI_BUFFER_SIZE - 2 ) == true );
+    CHECK( ( mock_nb_polling == 2 ) && ( mock_nb_dma == 2 ) );
+    CHECK( mock_bus_length == RADIO_SPI_BUFFER_SIZE );
+
+    CHECK( mock_nb_bad_state == 0 );
+    CHECK( mock_nss == 1 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the command and the data are sent in one transaction, the bytes clocked in during the command are dropped */
+static void test_transfer_bytes( void )
+{
+    static const uint8_t command[] = { SX126X_READ_BUFFER, 0x10, SX126X_NOP };
+
+    uint8_t  data_out[40];
+    uint8_t  data_in[40];
+    uint16_t data_length;
+    unsigned i, j;
+    bool     ok;
+
+    for( i = 0; i < sizeof data_out; i++ )
+    {
+        data_out[i] = ( uint8_t ) ( i + 1 );
+    }
+
+    /* write in polling mode, then in DMA mode */
+    reset( );
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 3, data_out, NULL, 8 ) == true );
+    CHECK( ( mock_bus_length == 11 ) && ( mock_bus_rx == false ) );
+    CHECK( ( memcmp( mock_bus_mosi, command, 3 ) == 0 ) && ( memcmp( mock_bus_mosi + 3, data_out, 8 ) == 0 ) );
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 3, data_out, NULL, 40 ) == true );
+    CHECK( ( mock_bus_length == 43 ) && ( mock_nb_dma == 1 ) );
+    CHECK( ( memcmp( mock_bus_mosi, command, 3 ) == 0 ) && ( memcmp( mock_bus_mosi + 3, data_out, 40 ) == 0 ) );
+
+    /* read in both modes: zeros are sent after the command */
+    for( i = 0; i < 2; i++ )
+    {
+        data_length = ( i == 0 ) ? 8 : 40;
+        memset( data_in, 0, sizeof data_in );
+        memset( mock_bus_mosi, 0xFF, sizeof mock_bus_mosi );
+        CHECK( radio_spi_transfer( &mock_radio_context, command, 3, NULL, data_in, data_length ) == true );
+        CHECK( ( mock_bus_length == 3u + data_length ) && ( mock_bus_rx == true ) );
+        CHECK( memcmp( mock_bus_mosi, command, 3 ) == 0 );
+        ok = true;
+        for( j = 0; j < data_length; j++ )
+        {
+            ok = ok && ( mock_bus_mosi[3 + j] == 0x00 ) && ( data_in[j] == MOCK_MISO( 3 + j ) );
+        }
+        CHECK( ok == true );
+    }
+    CHECK( ( mock_nb_polling == 2 ) && ( mock_nb_dma == 2 ) );
+    CHECK( mock_nb_bad_state == 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* an empty transaction does nothing, a too long one and a failed one are reported, NSS being released */
+static void test_transfer_errors( void )
+{
+    static const uint8_t command[] = { SX126X_WRITE_BUFFER, 0x00 };
+
+    uint8_t data[RADIO_SPI_BUFFER_SIZE] = { 0 };
+
+    reset( );
+    CHECK( radio_spi_transfer( &mock_radio_context, NULL, 0, NULL, NULL, 0 ) == true );
+    CHECK( ( mock_nb_polling == 0 ) && ( mock_nb_dma == 0 ) );
+
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, data, NULL, RADIO_SPI_BUFFER_SIZE - 1 ) == false );
+    CHECK( ( mock_nb_polling == 0 ) && ( mock_nb_dma == 0 ) );
+
+    mock_spi_err = ESP_FAIL;
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, data, NULL, 4 ) == false );
+    CHECK( radio_spi_transfer( &mock_radio_context, command, 2, NULL, data, 100 ) == false );
+    CHECK( ( mock_nb_polling == 1 ) && ( mock_nb_dma == 1 ) );
+    CHECK( mock_nss == 1 );
+
+    /* the lock is only taken around the bus accesses, and given back on failure */
+    CHECK( ( mock_nb_lock == 2 ) && ( mock_lock_depth == 0 ) );
+    CHECK( mock_nb_bad_state == 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the sx126x commands wait for BUSY to be released, the short ones are polled, the buffer accesses of a full payload
+ * use the DMA, and each command is accounted under its opcode */
+static void test_sx126x_commands( void )
+{
+    static const uint8_t set_standby[]    = { SX126X_SET_STANDBY, 0x00 };
+    static const uint8_t get_irq_status[] = { SX126X_GET_IRQ_STATUS, SX126X_NOP };
+    static const uint8_t write_buffer[]   = { SX126X_WRITE_BUFFER, 0x00 };
+    static const uint8_t read_buffer[]    = { SX126X_READ_BUFFER, 0x00, SX126X_NOP };
+
+    radio_spi_cmd_stats_t        stats[RADIO_SPI_STATS_CMD_NB];
+    const radio_spi_cmd_stats_t* s;
+    uint8_t                      payload[255];
+    uint8_t                      irq[2];
+    int                          nb;
+
+    memset( payload, 0x5A, sizeof payload );
+
+    reset( );
+    mock_busy_reads = 3;
+    CHECK( sx126x_hal_write( &mock_radio_context, set_standby, 2, NULL, 0 ) == SX126X_HAL_STATUS_OK );
+    CHECK( mock_nb_busy_read == 4 );
+    CHECK( ( mock_nb_polling == 1 ) && ( mock_bus_length == 2 ) && ( memcmp( mock_bus_mosi, set_standby, 2 ) == 0 ) );
+
+    mock_busy_reads = 1;
+    CHECK( sx126x_hal_write( &mock_radio_context, write_buffer, 2, payload, 255 ) == SX126X_HAL_STATUS_OK );
+    CHECK( ( mock_nb_dma == 1 ) && ( mock_bus_length == 257 ) && ( memcmp( mock_bus_mosi + 2, payload, 255 ) == 0 ) );
+
+    CHECK( sx126x_hal_read( &mock_radio_context, get_irq_status, 2, irq, 2 ) == SX126X_HAL_STATUS_OK );
+    CHECK( ( mock_nb_polling == 2 ) && ( irq[0] == MOCK_MISO( 2 ) ) && ( irq[1] == MOCK_MISO( 3 ) ) );
+
+    CHECK( sx126x_hal_read( &mock_radio_context, read_buffer, 3, payload, 255 ) == SX126X_HAL_STATUS_OK );
+    CHECK( ( mock_nb_dma == 2 ) && ( mock_bus_length == 258 ) && ( payload[254] == MOCK_MISO( 257 ) ) );
+
+    CHECK( sx126x_hal_write( &mock_radio_context, set_standby, 2, NULL, 0 ) == SX126X_HAL_STATUS_OK );
+    CHECK( mock_nb_bad_state == 0 );
+
+    /* the time of a command is the time of its transaction, 1 us per byte in the mock */
+    nb = radio_spi_stats_get( stats, RADIO_SPI_STATS_CMD_NB );
+    CHECK( nb == 4 );
+    s = find_stats( stats, nb, SX126X_SET_STANDBY );
+    CHECK( ( s != NULL ) && ( s->nb_calls == 2 ) && ( s->nb_bytes == 4 ) );
+    CHECK( ( s != NULL ) && ( s->total_us == 4 ) && ( s->max_us == 2 ) );
+    s = find_stats( stats, nb, SX126X_WRITE_BUFFER );
+    CHECK( ( s != NULL ) && ( s->nb_calls == 1 ) && ( s->nb_bytes == 257 ) && ( s->max_us == 257 ) );
+    s = find_stats( stats, nb, SX126X_GET_IRQ_STATUS );
+    CHECK( ( s != NULL ) && ( s->nb_calls == 1 ) && ( s->nb_bytes == 4 ) );
+    s = find_stats( stats, nb, SX126X_READ_BUFFER );
+    CHECK( ( s != NULL ) && ( s->nb_calls == 1 ) && ( s->nb_bytes == 258 ) );
+
+    /* a failed transaction is reported to the driver and still accounted */
+    mock_spi_err = ESP_FAIL;
+    CHECK( sx126x_hal_read( &mock_radio_context, get_irq_status, 2, irq, 2 ) == SX126X_HAL_STATUS_ERROR );
+    nb = radio_spi_stats_get( stats, RADIO_SPI_STATS_CMD_NB );
+    s  = find_stats( stats, nb, SX126X_GET_IRQ_STATUS );
+    CHECK( ( s != NULL ) && ( s->nb_calls == 2 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the opcodes beyond the size of the table are not accounted, the copy is limited to the size given */
+static void test_stats_table( void )
+{
+    radio_spi_cmd_stats_t stats[RADIO_SPI_STATS_CMD_NB];
+    uint16_t              opcode;
+
+    reset( );
+    for( opcode = 0; opcode <= RADIO_SPI_STATS_CMD_NB; opcode++ )
+    {
+        radio_spi_stats_add( 0x0100 + opcode, 1, radio_spi_stats_start( ) );
+    }
+    radio_spi_stats_add( 0x0100, 1, radio_spi_stats_start( ) );
+
+    CHECK( radio_spi_stats_get( stats, RADIO_SPI_STATS_CMD_NB ) == RADIO_SPI_STATS_CMD_NB );
+    CHECK( find_stats( stats, RADIO_SPI_STATS_CMD_NB, 0x0100 + RADIO_SPI_STATS_CMD_NB ) == NULL );
+    CHECK( ( stats[0].opcode == 0x0100 ) && ( stats[0].nb_calls == 2 ) );
+    CHECK( radio_spi_stats_get( stats, 4 ) == 4 );
+    CHECK( radio_spi_stats_get( NULL, RADIO_SPI_STATS_CMD_NB ) == 0 );
+
+    radio_spi_stats_reset( );
+    CHECK( radio_spi_stats_get( stats, RADIO_SPI_STATS_CMD_NB ) == 0 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_radio_spi( void )
+{
+    CHECK( radio_spi_init( ) == true );
+
+    test_polling_dma_split( );
+    test_transfer_bytes( );
+    test_transfer_errors( );
+    test_sx126x_commands( );
+    test_stats_table( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
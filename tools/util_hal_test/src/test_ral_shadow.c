@@ -0,0 +1,205 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the RAL shadow cache (ral_shadow.c), on a fake driver table counting the calls forwarded to it
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* memset */
+
+#include "ral.h"
+#include "ral_shadow.h"
+
+#include "hal_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static uint32_t     fake_nb_call[RAL_SHADOW_CMD_NB]; /* calls forwarded to the fake driver, per command */
+static uint32_t     fake_nb_reset = 0;
+static ral_status_t fake_status   = RAL_STATUS_OK; /* status returned by the fake driver */
+
+/* -------------------------------------------------------------------------- */
+/* --- MOCKS ---------------------------------------------------------------- */
+
+static ral_status_t fake_reset( const void* context )
+{
+    ( void ) context;
+    fake_nb_reset += 1;
+    return RAL_STATUS_OK;
+}
+
+static ral_status_t fake_set_pkt_type( const void* context, const ral_pkt_type_t pkt_type )
+{
+    ( void ) context;
+    ( void ) pkt_type;
+    fake_nb_call[RAL_SHADOW_CMD_PKT_TYPE] += 1;
+    return fake_status;
+}
+
+static ral_status_t fake_set_rf_freq( const void* context, const uint32_t freq_in_hz )
+{
+    ( void ) context;
+    ( void ) freq_in_hz;
+    fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] += 1;
+    return fake_status;
+}
+
+static ral_status_t fake_set_lora_mod_params( const void* context, const ral_lora_mod_params_t* params )
+{
+    ( void ) context;
+    ( void ) params;
+    fake_nb_call[RAL_SHADOW_CMD_LORA_MOD_PARAMS] += 1;
+    return fake_status;
+}
+
+static ral_status_t fake_set_dio_irq_params( const void* context, const ral_irq_t irq )
+{
+    ( void ) context;
+    ( void ) irq;
+    fake_nb_call[RAL_SHADOW_CMD_DIO_IRQ_PARAMS] += 1;
+    return fake_status;
+}
+
+static ral_t fake_ral = {
+    .context = NULL,
+    .driver  = {
+         .reset               = fake_reset,
+         .set_pkt_type        = fake_set_pkt_type,
+         .set_rf_freq         = fake_set_rf_freq,
+         .set_lora_mod_params = fake_set_lora_mod_params,
+         .set_dio_irq_params  = fake_set_dio_irq_params,
+    },
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* a cold cache on a fake radio accepting the writes */
+static void reset( void )
+{
+    ral_shadow_invalidate( );
+    memset( fake_nb_call, 0, sizeof fake_nb_call );
+    fake_nb_reset = 0;
+    fake_status   = RAL_STATUS_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a write is skipped when the value is the last one written, and counted as elided */
+static void test_elide_same_value( void )
+{
+    ral_shadow_cmd_stats_t stats[RAL_SHADOW_CMD_NB];
+
+    reset( );
+
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] == 1 );
+    CHECK( ral_set_rf_freq( &fake_ral, 868300000 ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] == 2 );
+
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_RX_DONE ) == RAL_STATUS_OK );
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_RX_DONE | RAL_IRQ_TX_DONE ) == RAL_STATUS_OK );
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_RX_DONE | RAL_IRQ_TX_DONE ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_DIO_IRQ_PARAMS] == 2 );
+
+    ral_shadow_get_stats( stats );
+    CHECK( ( stats[RAL_SHADOW_CMD_RF_FREQ].issued == 2 ) && ( stats[RAL_SHADOW_CMD_RF_FREQ].elided == 1 ) );
+    CHECK( ( stats[RAL_SHADOW_CMD_DIO_IRQ_PARAMS].issued == 2 ) &&
+           ( stats[RAL_SHADOW_CMD_DIO_IRQ_PARAMS].elided == 1 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* every field of the modulation parameters is compared */
+static void test_mod_params_fields( void )
+{
+    ral_lora_mod_params_t params = { .sf = RAL_LORA_SF7, .bw = RAL_LORA_BW_125_KHZ, .cr = RAL_LORA_CR_4_5, .ldro = 0 };
+
+    reset( );
+
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_LORA_MOD_PARAMS] == 1 );
+
+    params.sf = RAL_LORA_SF12;
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    params.ldro = 1;
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    params.cr = RAL_LORA_CR_4_8;
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    params.bw = RAL_LORA_BW_500_KHZ;
+    CHECK( ral_set_lora_mod_params( &fake_ral, &params ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_LORA_MOD_PARAMS] == 5 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a reset of the radio and a change of packet type invalidate the whole cache */
+static void test_invalidate( void )
+{
+    reset( );
+
+    CHECK( ral_set_pkt_type( &fake_ral, RAL_PKT_TYPE_LORA ) == RAL_STATUS_OK );
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( ral_reset( &fake_ral ) == RAL_STATUS_OK );
+    CHECK( fake_nb_reset == 1 );
+    CHECK( ral_set_pkt_type( &fake_ral, RAL_PKT_TYPE_LORA ) == RAL_STATUS_OK );
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_PKT_TYPE] == 2 );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] == 2 );
+
+    CHECK( ral_set_pkt_type( &fake_ral, RAL_PKT_TYPE_LORA ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_PKT_TYPE] == 2 );
+    CHECK( ral_set_pkt_type( &fake_ral, RAL_PKT_TYPE_GFSK ) == RAL_STATUS_OK );
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_PKT_TYPE] == 3 );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] == 3 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a failed write is forwarded again, the other entries staying valid */
+static void test_failed_write( void )
+{
+    reset( );
+
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_RX_DONE ) == RAL_STATUS_OK );
+    fake_status = RAL_STATUS_ERROR;
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_TX_DONE ) == RAL_STATUS_ERROR );
+    fake_status = RAL_STATUS_OK;
+    CHECK( ral_set_dio_irq_params( &fake_ral, RAL_IRQ_TX_DONE ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_DIO_IRQ_PARAMS] == 3 );
+    CHECK( ral_set_rf_freq( &fake_ral, 868100000 ) == RAL_STATUS_OK );
+    CHECK( fake_nb_call[RAL_SHADOW_CMD_RF_FREQ] == 1 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_ral_shadow( void )
+{
+    ral_shadow_attach( &fake_ral );
+    CHECK( fake_ral.driver.set_rf_freq != fake_set_rf_freq );
+
+    test_elide_same_value( );
+    test_mod_params_fields( );
+    test_invalidate( );
+    test_failed_write( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,9 @@
+/*
+Host stub of the project configuration, the options used by the code under test. The latency trace is disabled, as in
+the default configuration
+*/
+
+#ifndef _STUB_SDKCONFIG_H
+#define _STUB_SDKCONFIG_H
+
+#endif  // _STUB_SDKCONFIG_H
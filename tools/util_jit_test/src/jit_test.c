@@ -0,0 +1,667 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host randomized differential test and benchmark of the JiT queue of the packet forwarder (jitqueue.c), against
+    the linear queue sorted with qsort_r it replaced
+
+    The same random sequence of enqueues, peeks and dequeues is applied to both queues, the concentrator time crossing
+    the 2^31 and 2^32 us boundaries. The results and the contents of both queues must be the same after each
+    operation, except for the Class C downlinks: the former queue only checked the gap after each packet against the
+    next packet, and missed some free slots. Their timestamp must be the earliest valid one, which is checked with the
+    former queue by enqueuing the candidate slots as Class A downlinks, and no later than the former one.
+
+    Back-to-back Class A downlinks are then checked: the second one, held while the radio is busy with the first one,
+    must still be peeked in time to be started.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* printf, fprintf */
+#include <stdlib.h>  /* atoi, exit */
+#include <string.h>  /* memset */
+#include <time.h>    /* clock_gettime */
+#include <unistd.h>  /* getopt, dup */
+
+#include "jitqueue.h"
+#include "jitqueue_linear.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_ITERATIONS 1000000 /* random operations of the differential test */
+#define DEFAULT_SEED 1
+#define BENCH_ITERATIONS 200000
+#define B2B_ITERATIONS 10000
+#define B2B_TX_DONE_LAG_MAX_US 20000 /* max delay for the end of a TX to be seen by the packet forwarder */
+
+#define TOA_US_PER_BYTE 10000 /* time on air of the stub, in the range of SF11/SF12 at 125 kHz */
+/* same values as jitqueue.c */
+#define TX_START_DELAY 1500
+#define TX_MARGIN_DELAY 1000
+#define TX_JIT_DELAY 30000
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static uint32_t prng_state;
+static FILE*    out; /* report, stdout carrying the error logs of the JiT queue */
+
+static struct jit_queue_s     queue;
+static struct jit_lin_queue_s ref;
+static uint32_t               time_us;
+
+static int it;
+static int nb_mismatch = 0;
+static int nb_accepted = 0; /* enqueues */
+static int nb_rejected = 0;
+static int nb_earlier  = 0; /* Class C downlinks placed earlier than by the former queue */
+static int nb_sent     = 0; /* peeked and dequeued packets */
+static int nb_held     = 0; /* back-to-back downlinks due while the previous TX was not over */
+
+/* -------------------------------------------------------------------------- */
+/* --- STUBS ---------------------------------------------------------------- */
+
+uint32_t lgw_time_on_air( const struct lgw_pkt_tx_s* packet )
+{
+    return ( ( uint32_t ) packet->size * TOA_US_PER_BYTE + 500 ) / 1000; /* in ms, rounded like the HAL */
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void usage( void )
+{
+    printf( "Usage: jit_test [-n iterations] [-s seed] [-b] [-v]\n" );
+    printf( " -n <int> number of random operations of the differential test, %d by default\n", DEFAULT_ITERATIONS );
+    printf( " -s <int> seed of the test, %d by default\n", DEFAULT_SEED );
+    printf( " -b       benchmark both queues instead of the differential test\n" );
+    printf( " -v       display the error logs of the JiT queue\n" );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double now_s( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return ( double ) t.tv_sec + ( 1E-9 * ( double ) t.tv_nsec );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* xorshift32, so that a run can be reproduced from its seed */
+static uint32_t prng( void )
+{
+    prng_state ^= prng_state << 13;
+    prng_state ^= prng_state >> 17;
+    prng_state ^= prng_state << 5;
+    return prng_state;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint32_t prng_range( uint32_t min, uint32_t max )
+{
+    return min + ( prng( ) % ( max - min + 1 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void mismatch( const char* what )
+{
+    fprintf( out, "MISMATCH: iteration %d, time %u: %s\n", it, time_us, what );
+    nb_mismatch += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void make_pkt( struct lgw_pkt_tx_s* pkt, uint32_t count_us )
+{
+    memset( pkt, 0, sizeof( *pkt ) );
+    pkt->tx_mode  = TIMESTAMPED;
+    pkt->count_us = count_us;
+    pkt->size     = ( uint16_t ) prng_range( 1, 255 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* position in the reference queue of the packet with the given timestamp, -1 if none */
+static int ref_find( uint32_t count_us )
+{
+    int i;
+
+    for( i = 0; i < ref.num_pkt; i++ )
+    {
+        if( ref.nodes[i].pkt.count_us == count_us )
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* both queues hold the same packets, and the order of the JiT queue is a sorted permutation of its nodes */
+static void check_queues( void )
+{
+    const struct jit_node_s* a;
+    const struct jit_node_s* b;
+    bool                     used[JIT_QUEUE_MAX] = { false };
+    int                      pos;
+
+    if( ( queue.num_pkt != ref.num_pkt ) || ( queue.num_beacon != ref.num_beacon ) )
+    {
+        mismatch( "number of packets" );
+        return;
+    }
+    for( pos = 0; pos < queue.num_pkt; pos++ )
+    {
+        if( ( queue.order[pos] >= queue.num_pkt ) || ( used[queue.order[pos]] == true ) )
+        {
+            mismatch( "order is not a permutation of the nodes" );
+            return;
+        }
+        used[queue.order[pos]] = true;
+        a                      = &queue.nodes[queue.order[pos]];
+        b                      = &ref.nodes[pos];
+        if( ( pos > 0 ) && ( ( int32_t ) ( a->pkt.count_us - queue.nodes[queue.order[pos - 1]].pkt.count_us ) <= 0 ) )
+        {
+            mismatch( "order is not sorted" );
+        }
+        if( ( a->pkt.count_us != b->pkt.count_us ) || ( a->pkt.size != b->pkt.size ) ||
+            ( a->pkt_type != b->pkt_type ) || ( a->pre_delay != b->pre_delay ) || ( a->post_delay != b->post_delay ) )
+        {
+            mismatch( "queued packets differ" );
+            return;
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a Class C slot is valid if the former queue accepts it as a Class A downlink, the beacon guard being ignored and the
+ * neighbours checked the same way for both classes */
+static bool ref_slot_valid( uint32_t count_us, const struct lgw_pkt_tx_s* packet )
+{
+    static struct jit_lin_queue_s tmp;
+    struct lgw_pkt_tx_s           pkt = *packet;
+
+    tmp          = ref;
+    pkt.count_us = count_us;
+    return jit_lin_enqueue( &tmp, time_us, &pkt, JIT_PKT_TYPE_DOWNLINK_CLASS_A ) == JIT_ERROR_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* earliest valid Class C slot, 1 s from now or right after a queued packet */
+static bool ref_earliest_slot( const struct lgw_pkt_tx_s* packet, uint32_t* count_us )
+{
+    uint32_t pre_delay = TX_START_DELAY + TX_JIT_DELAY;
+    uint32_t slot_us   = time_us + 1000000;
+    bool     found     = false;
+    int      i;
+
+    for( i = -1; i < ref.num_pkt; i++ )
+    {
+        if( i >= 0 )
+        {
+            slot_us = ref.nodes[i].pkt.count_us + ref.nodes[i].post_delay + pre_delay + TX_JIT_DELAY + TX_MARGIN_DELAY;
+        }
+        if( ( ( found == false ) || ( ( int32_t ) ( slot_us - *count_us ) < 0 ) ) &&
+            ( ref_slot_valid( slot_us, packet ) == true ) )
+        {
+            *count_us = slot_us;
+            found     = true;
+        }
+    }
+
+    return found;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void test_enqueue( uint32_t count_us, enum jit_pkt_type_e pkt_type )
+{
+    struct lgw_pkt_tx_s pkt;
+    struct lgw_pkt_tx_s pkt_ref;
+    enum jit_error_e    err;
+    enum jit_error_e    err_ref;
+
+    make_pkt( &pkt, count_us );
+    pkt_ref = pkt;
+
+    err     = jit_enqueue( &queue, time_us, &pkt, pkt_type );
+    err_ref = jit_lin_enqueue( &ref, time_us, &pkt_ref, pkt_type );
+    if( ( err != err_ref ) || ( pkt.count_us != pkt_ref.count_us ) )
+    {
+        mismatch( "enqueue result differs" );
+    }
+    *( ( err == JIT_ERROR_OK ) ? &nb_accepted : &nb_rejected ) += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void test_enqueue_class_c( void )
+{
+    struct lgw_pkt_tx_s pkt;
+    struct lgw_pkt_tx_s pkt_ref;
+    struct lgw_pkt_tx_s pkt_out;
+    enum jit_pkt_type_e pkt_type;
+    enum jit_error_e    err;
+    enum jit_error_e    err_ref;
+    uint32_t            slot_us = 0;
+    bool                slot_found;
+    int                 i;
+
+    make_pkt( &pkt, 0 );
+    pkt_ref    = pkt;
+    slot_found = ref_earliest_slot( &pkt, &slot_us );
+
+    err     = jit_enqueue( &queue, time_us, &pkt, JIT_PKT_TYPE_DOWNLINK_CLASS_C );
+    err_ref = jit_lin_enqueue( &ref, time_us, &pkt_ref, JIT_PKT_TYPE_DOWNLINK_CLASS_C );
+
+    *( ( err == JIT_ERROR_OK ) ? &nb_accepted : &nb_rejected ) += 1;
+    if( err == JIT_ERROR_FULL )
+    {
+        if( err_ref != JIT_ERROR_FULL )
+        {
+            mismatch( "Class C enqueue result differs on a full queue" );
+        }
+        return;
+    }
+    if( slot_found != ( err == JIT_ERROR_OK ) )
+    {
+        mismatch( ( slot_found == true ) ? "Class C downlink rejected while a slot is free"
+                                         : "Class C downlink accepted while no slot is free" );
+    }
+    if( err != JIT_ERROR_OK )
+    {
+        if( err_ref == JIT_ERROR_OK )
+        {
+            mismatch( "Class C downlink rejected, accepted by the former queue" );
+            jit_lin_dequeue( &ref, ref_find( pkt_ref.count_us ), &pkt_out, &pkt_type );
+        }
+        return;
+    }
+    if( pkt.count_us != slot_us )
+    {
+        mismatch( "Class C downlink not in the earliest slot" );
+    }
+    if( ( err_ref == JIT_ERROR_OK ) && ( ( int32_t ) ( pkt.count_us - pkt_ref.count_us ) > 0 ) )
+    {
+        mismatch( "Class C downlink later than with the former queue" );
+    }
+
+    if( ( err_ref != JIT_ERROR_OK ) || ( pkt.count_us != pkt_ref.count_us ) )
+    {
+        nb_earlier += 1;
+    }
+
+    /* resync the reference queue on the slot of the JiT queue */
+    if( err_ref == JIT_ERROR_OK )
+    {
+        jit_lin_dequeue( &ref, ref_find( pkt_ref.count_us ), &pkt_out, &pkt_type );
+    }
+    pkt_ref.count_us = pkt.count_us;
+    if( jit_lin_enqueue( &ref, time_us, &pkt_ref, JIT_PKT_TYPE_DOWNLINK_CLASS_A ) != JIT_ERROR_OK )
+    {
+        mismatch( "Class C downlink collides in the former queue" );
+        return;
+    }
+    i                     = ref_find( pkt.count_us );
+    ref.nodes[i].pkt_type = JIT_PKT_TYPE_DOWNLINK_CLASS_C;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void test_dequeue( int index, int index_ref )
+{
+    struct lgw_pkt_tx_s pkt;
+    struct lgw_pkt_tx_s pkt_ref;
+    enum jit_pkt_type_e pkt_type;
+    enum jit_pkt_type_e pkt_type_ref;
+    enum jit_error_e    err;
+    enum jit_error_e    err_ref;
+
+    err     = jit_dequeue( &queue, index, &pkt, &pkt_type );
+    err_ref = jit_lin_dequeue( &ref, index_ref, &pkt_ref, &pkt_type_ref );
+    if( ( err != JIT_ERROR_OK ) || ( err_ref != JIT_ERROR_OK ) || ( pkt.count_us != pkt_ref.count_us ) ||
+        ( pkt_type != pkt_type_ref ) )
+    {
+        mismatch( "dequeued packets differ" );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void test_peek( void )
+{
+    enum jit_error_e err;
+    enum jit_error_e err_ref;
+    int              idx;
+    int              idx_ref;
+
+    err     = jit_peek( &queue, time_us, &idx );
+    err_ref = jit_lin_peek( &ref, time_us, &idx_ref );
+    if( ( err != err_ref ) || ( ( idx < 0 ) != ( idx_ref < 0 ) ) )
+    {
+        mismatch( "peek result differs" );
+        return;
+    }
+    check_queues( ); /* same outdated packets dropped */
+    if( idx < 0 )
+    {
+        return;
+    }
+    if( queue.nodes[idx].pkt.count_us != ref.nodes[idx_ref].pkt.count_us )
+    {
+        mismatch( "peeked packets differ" );
+        return;
+    }
+
+    /* the packet is usually sent, else it is dropped once outdated */
+    if( prng( ) % 8 != 0 )
+    {
+        test_dequeue( idx, idx_ref );
+        nb_sent += 1;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* two Class A downlinks as close as the queue accepts them: the second one is due before the end of the first TX is
+ * seen, and has to be held until then. It must still be peeked, in time to be loaded and started, and not dropped */
+static void test_back_to_back( void )
+{
+    struct lgw_pkt_tx_s pkt[2];
+    enum jit_pkt_type_e pkt_type;
+    uint32_t            dispatch_us;
+    uint32_t            busy_until_us;
+    int                 idx;
+
+    jit_queue_init( &queue );
+    time_us = prng( );
+
+    make_pkt( &pkt[0], time_us + prng_range( 1000000, 2000000 ) );
+    make_pkt( &pkt[1], 0 );
+    pkt[1].count_us = pkt[0].count_us + ( lgw_time_on_air( &pkt[0] ) * 1000 ) + TX_START_DELAY + TX_JIT_DELAY +
+                      TX_MARGIN_DELAY;
+    if( ( jit_enqueue( &queue, time_us, &pkt[0], JIT_PKT_TYPE_DOWNLINK_CLASS_A ) != JIT_ERROR_OK ) ||
+        ( jit_enqueue( &queue, time_us, &pkt[1], JIT_PKT_TYPE_DOWNLINK_CLASS_A ) == JIT_ERROR_OK ) )
+    {
+        mismatch( "back-to-back downlink accepted within the collision margin" );
+        return;
+    }
+    pkt[1].count_us += 1;
+    if( jit_enqueue( &queue, time_us, &pkt[1], JIT_PKT_TYPE_DOWNLINK_CLASS_A ) != JIT_ERROR_OK )
+    {
+        mismatch( "back-to-back downlink rejected" );
+        return;
+    }
+
+    /* the first packet is handed to the radio when due, the radio is busy until the end of its TX is seen */
+    jit_next_dispatch( &queue, &dispatch_us );
+    time_us = dispatch_us;
+    if( ( jit_peek( &queue, time_us, &idx ) != JIT_ERROR_OK ) || ( idx < 0 ) ||
+        ( jit_dequeue( &queue, idx, &pkt[0], &pkt_type ) != JIT_ERROR_OK ) )
+    {
+        mismatch( "first back-to-back downlink not peeked when due" );
+        return;
+    }
+    busy_until_us = pkt[0].count_us + ( ( uint32_t ) pkt[0].size * TOA_US_PER_BYTE ) +
+                    prng_range( 0, B2B_TX_DONE_LAG_MAX_US );
+
+    /* the second packet is due before that, it is left in the queue and peeked once the radio is free */
+    jit_next_dispatch( &queue, &dispatch_us );
+    if( ( int32_t ) ( busy_until_us - dispatch_us ) > 0 )
+    {
+        nb_held += 1;
+        time_us = busy_until_us;
+    }
+    else
+    {
+        time_us = dispatch_us;
+    }
+    if( ( jit_peek( &queue, time_us, &idx ) != JIT_ERROR_OK ) || ( idx < 0 ) ||
+        ( jit_dequeue( &queue, idx, &pkt[1], &pkt_type ) != JIT_ERROR_OK ) )
+    {
+        mismatch( "held back-to-back downlink dropped" );
+        return;
+    }
+    if( ( int32_t ) ( pkt[1].count_us - time_us ) < TX_START_DELAY )
+    {
+        mismatch( "held back-to-back downlink too late to be started" );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int run_test( int nb_iterations )
+{
+    static const uint32_t start_us[] = { 0, 0x80000000 - 200000000, 0xFFFFFFFF - 200000000 };
+    uint32_t              dispatch_us;
+    uint32_t              r;
+    int                   pos;
+
+    jit_queue_init( &queue );
+    jit_lin_init( &ref );
+    time_us = start_us[prng( ) % 3];
+
+    for( it = 0; it < nb_iterations; it++ )
+    {
+        r = prng( ) % 100;
+        if( r < 30 )
+        {
+            /* Class A, a RX window 1 to 2 s after an uplink, some already too late */
+            test_enqueue( time_us + prng_range( 0, 3000000 ) - 100000, JIT_PKT_TYPE_DOWNLINK_CLASS_A );
+        }
+        else if( r < 44 )
+        {
+            /* Class B, a ping slot in the next beacon periods */
+            test_enqueue( time_us + prng_range( 0, 130000000 ), JIT_PKT_TYPE_DOWNLINK_CLASS_B );
+        }
+        else if( r < 45 )
+        {
+            /* too much in advance */
+            test_enqueue( time_us + prng_range( 600000000, 0x7FFFFFFF ), JIT_PKT_TYPE_DOWNLINK_CLASS_B );
+        }
+        else if( r < 58 )
+        {
+            test_enqueue_class_c( );
+        }
+        else if( r < 62 )
+        {
+            /* beacons are loaded up to JIT_NUM_BEACON_IN_QUEUE periods in advance */
+            test_enqueue( time_us + prng_range( 1000000, JIT_NUM_BEACON_IN_QUEUE * 128000000 ), JIT_PKT_TYPE_BEACON );
+        }
+        else if( r < 65 )
+        {
+            /* a packet removed out of order */
+            if( queue.num_pkt > 0 )
+            {
+                pos = ( int ) ( prng( ) % queue.num_pkt );
+                test_dequeue( queue.order[pos], ref_find( queue.nodes[queue.order[pos]].pkt.count_us ) );
+            }
+        }
+        else
+        {
+            /* time goes on, up to the next packet to be sent or by small steps to peek the packets in time, and
+             * sometimes by big ones to drop them */
+            r = prng( ) % 1000;
+            if( ( r < 500 ) && ( jit_next_dispatch( &queue, &dispatch_us ) == JIT_ERROR_OK ) &&
+                ( ( int32_t ) ( dispatch_us - time_us ) > 0 ) )
+            {
+                time_us = dispatch_us + prng_range( 0, 20000 );
+            }
+            else
+            {
+                time_us += ( r < 980 ) ? prng_range( 0, 40000 ) : ( r < 999 ) ? prng_range( 0, 5000000 ) : 600000000;
+            }
+            test_peek( );
+        }
+        check_queues( );
+        if( nb_mismatch > 10 )
+        {
+            break;
+        }
+    }
+
+    fprintf( out, "%d operations, final time %u us\n", it, time_us );
+    fprintf( out, "enqueues accepted: %d, rejected: %d, Class C earlier than the former queue: %d, packets sent: %d\n",
+             nb_accepted, nb_rejected, nb_earlier, nb_sent );
+
+    for( it = 0; ( it < B2B_ITERATIONS ) && ( nb_mismatch <= 10 ); it++ )
+    {
+        test_back_to_back( );
+    }
+    fprintf( out, "back-to-back downlinks: %d, held until the end of the previous TX: %d\n", it, nb_held );
+    fprintf( out, "%d mismatches\n", nb_mismatch );
+
+    return ( nb_mismatch == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* enqueue then dequeue a downlink in a queue holding Class B downlinks of 100 ms, either 1 s apart or with gaps too
+ * small for another downlink */
+static void run_bench( void )
+{
+    static const int sizes[] = { 1, 8, JIT_QUEUE_MAX - 1 };
+    static const struct
+    {
+        const char*         name;
+        enum jit_pkt_type_e type;
+        uint32_t            first_us;
+        uint32_t            spacing_us;
+    } cases[] = {
+        { "A", JIT_PKT_TYPE_DOWNLINK_CLASS_A, 2000000, 1000000 },      /* between two packets of the queue */
+        { "C", JIT_PKT_TYPE_DOWNLINK_CLASS_C, 2000000, 1000000 },      /* at the ASAP time */
+        { "C full", JIT_PKT_TYPE_DOWNLINK_CLASS_C, 1050000, 140000 }, /* after the last packet of the queue */
+    };
+    struct lgw_pkt_tx_s pkt;
+    enum jit_pkt_type_e pkt_type;
+    double              t_new, t_old, t;
+    uint32_t            count_us;
+    unsigned            s, c;
+    int                 n;
+    int                 i;
+
+    fprintf( out, "queued  downlink  jit_queue (ns)  linear (ns)  ratio\n" );
+    for( s = 0; s < sizeof sizes / sizeof sizes[0]; s++ )
+    {
+        for( c = 0; c < sizeof cases / sizeof cases[0]; c++ )
+        {
+            time_us = 0;
+            jit_queue_init( &queue );
+            jit_lin_init( &ref );
+            for( n = 0; n < sizes[s]; n++ )
+            {
+                make_pkt( &pkt, cases[c].first_us + n * cases[c].spacing_us );
+                pkt.size = 10;
+                jit_enqueue( &queue, time_us, &pkt, JIT_PKT_TYPE_DOWNLINK_CLASS_B );
+                jit_lin_enqueue( &ref, time_us, &pkt, JIT_PKT_TYPE_DOWNLINK_CLASS_B );
+            }
+            count_us = cases[c].first_us + ( sizes[s] / 2 ) * cases[c].spacing_us - cases[c].spacing_us / 2;
+
+            t = now_s( );
+            for( i = 0; i < BENCH_ITERATIONS; i++ )
+            {
+                make_pkt( &pkt, count_us );
+                pkt.size = 10;
+                jit_enqueue( &queue, time_us, &pkt, cases[c].type );
+                jit_dequeue( &queue, queue.num_pkt - 1, &pkt, &pkt_type );
+            }
+            t_new = ( now_s( ) - t ) / BENCH_ITERATIONS;
+
+            t = now_s( );
+            for( i = 0; i < BENCH_ITERATIONS; i++ )
+            {
+                make_pkt( &pkt, count_us );
+                pkt.size = 10;
+                jit_lin_enqueue( &ref, time_us, &pkt, cases[c].type );
+                jit_lin_dequeue( &ref, ref_find( pkt.count_us ), &pkt, &pkt_type );
+            }
+            t_old = ( now_s( ) - t ) / BENCH_ITERATIONS;
+
+            if( ( queue.num_pkt != sizes[s] ) || ( ref.num_pkt != sizes[s] ) )
+            {
+                fprintf( out, "ERROR: downlink not enqueued\n" );
+                exit( EXIT_FAILURE );
+            }
+            fprintf( out, "%6d  %8s  %14.1f  %11.1f  %5.1f\n", sizes[s], cases[c].name, 1E9 * t_new, 1E9 * t_old,
+                     t_old / t_new );
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( int argc, char** argv )
+{
+    int  nb_iterations = DEFAULT_ITERATIONS;
+    bool bench         = false;
+    bool verbose       = false;
+    int  i;
+
+    prng_state = DEFAULT_SEED;
+
+    while( ( i = getopt( argc, argv, "hn:s:bv" ) ) != -1 )
+    {
+        switch( i )
+        {
+        case 'n':
+            nb_iterations = atoi( optarg );
+            break;
+        case 's':
+            prng_state = ( uint32_t ) atoi( optarg );
+            break;
+        case 'b':
+            bench = true;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+        default:
+            usage( );
+            return ( i == 'h' ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if( ( nb_iterations <= 0 ) || ( prng_state == 0 ) )
+    {
+        usage( );
+        return EXIT_FAILURE;
+    }
+
+    /* the JiT queue logs its rejections on stdout, they are expected here */
+    out = fdopen( dup( STDOUT_FILENO ), "w" );
+    if( ( verbose == false ) && ( freopen( "/dev/null", "w", stdout ) == NULL ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    if( bench == true )
+    {
+        run_bench( );
+        return EXIT_SUCCESS;
+    }
+
+    return run_test( nb_iterations );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
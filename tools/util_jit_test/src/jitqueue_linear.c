@@ -0,0 +1,311 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Reference model of the JiT queue: the former linear queue, sorted with qsort_r after each change
+
+    The code is the one of jitqueue.c before the sorted index, without its mutex and logs, and with two fixes so that
+    it can be used as a reference:
+    - the sort compares the timestamps with a roll-over safe signed difference, instead of the difference of their
+      conversions to int which overflows,
+    - the peek restarts its search at the first node after a drop (node 0 was skipped), and returns an empty queue
+      when all packets were dropped (nodes[-1] was read).
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#define _GNU_SOURCE /* qsort_r, with the argument of the comparison last as in newlib */
+
+#include <stdlib.h> /* qsort_r */
+#include <string.h> /* memset, memcpy */
+
+#include "jitqueue_linear.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+/* same values as jitqueue.c */
+#define TX_START_DELAY 1500  /* microseconds */
+#define TX_MARGIN_DELAY 1000 /* Packet overlap margin in microseconds */
+#define TX_JIT_DELAY 30000   /* Pre-delay to program packet for TX in microseconds */
+#define TX_MAX_ADVANCE_DELAY ( ( JIT_NUM_BEACON_IN_QUEUE + 1 ) * 128 * 1E6 )
+#define BEACON_GUARD 3000000
+#define BEACON_RESERVED 2120000
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static int compare( const void* a, const void* b, void* arg )
+{
+    const struct jit_node_s* p = ( const struct jit_node_s* ) a;
+    const struct jit_node_s* q = ( const struct jit_node_s* ) b;
+    int32_t                  diff;
+
+    ( void ) arg;
+
+    diff = ( int32_t ) ( p->pkt.count_us - q->pkt.count_us );
+    return ( diff > 0 ) - ( diff < 0 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void jit_sort_queue( struct jit_lin_queue_s* queue )
+{
+    if( queue->num_pkt == 0 )
+    {
+        return;
+    }
+
+    qsort_r( queue->nodes, queue->num_pkt, sizeof( queue->nodes[0] ), compare, NULL );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool jit_collision_test( uint32_t p1_count_us, uint32_t p1_pre_delay, uint32_t p1_post_delay,
+                                uint32_t p2_count_us, uint32_t p2_pre_delay, uint32_t p2_post_delay )
+{
+    return ( ( p1_count_us - p2_count_us ) <= ( p1_pre_delay + p2_post_delay + TX_MARGIN_DELAY ) ) ||
+           ( ( p2_count_us - p1_count_us ) <= ( p2_pre_delay + p1_post_delay + TX_MARGIN_DELAY ) );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void jit_lin_init( struct jit_lin_queue_s* queue )
+{
+    memset( queue, 0, sizeof( *queue ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum jit_error_e jit_lin_enqueue( struct jit_lin_queue_s* queue, uint32_t time_us, struct lgw_pkt_tx_s* packet,
+                                  enum jit_pkt_type_e pkt_type )
+{
+    int      i                 = 0;
+    uint32_t packet_post_delay = 0;
+    uint32_t packet_pre_delay  = 0;
+    uint32_t target_pre_delay  = 0;
+    uint32_t asap_count_us;
+
+    if( packet == NULL )
+    {
+        return JIT_ERROR_INVALID;
+    }
+
+    if( queue->num_pkt == JIT_QUEUE_MAX )
+    {
+        return JIT_ERROR_FULL;
+    }
+
+    switch( pkt_type )
+    {
+    case JIT_PKT_TYPE_DOWNLINK_CLASS_A:
+    case JIT_PKT_TYPE_DOWNLINK_CLASS_B:
+    case JIT_PKT_TYPE_DOWNLINK_CLASS_C:
+        packet_pre_delay  = TX_START_DELAY + TX_JIT_DELAY;
+        packet_post_delay = lgw_time_on_air( packet ) * 1000UL; /* in us */
+        break;
+    case JIT_PKT_TYPE_BEACON:
+        packet_pre_delay  = TX_START_DELAY + BEACON_GUARD + TX_JIT_DELAY;
+        packet_post_delay = BEACON_RESERVED;
+        break;
+    default:
+        break;
+    }
+
+    if( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C )
+    {
+        packet->tx_mode = TIMESTAMPED;
+
+        asap_count_us = time_us + 1E6; /* take 1 second margin */
+        if( queue->num_pkt > 0 )
+        {
+            /* First, try if the ASAP time collides with an already enqueued downlink */
+            for( i = 0; i < queue->num_pkt; i++ )
+            {
+                if( jit_collision_test( asap_count_us, packet_pre_delay, packet_post_delay,
+                                        queue->nodes[i].pkt.count_us, queue->nodes[i].pre_delay,
+                                        queue->nodes[i].post_delay ) == true )
+                {
+                    break;
+                }
+            }
+            if( i < queue->num_pkt )
+            {
+                /* Search for the best slot then: after the last packet, or between 2 packets */
+                for( i = 0; i < queue->num_pkt; i++ )
+                {
+                    asap_count_us = queue->nodes[i].pkt.count_us + queue->nodes[i].post_delay + packet_pre_delay +
+                                    TX_JIT_DELAY + TX_MARGIN_DELAY;
+                    if( i == ( queue->num_pkt - 1 ) )
+                    {
+                        break;
+                    }
+                    if( jit_collision_test( asap_count_us, packet_pre_delay, packet_post_delay,
+                                            queue->nodes[i + 1].pkt.count_us, queue->nodes[i + 1].pre_delay,
+                                            queue->nodes[i + 1].post_delay ) == false )
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+        packet->count_us = asap_count_us;
+    }
+
+    /* Check criteria_1: is it already too late to send this packet ? */
+    if( ( packet->count_us - time_us ) <= ( TX_START_DELAY + TX_MARGIN_DELAY + TX_JIT_DELAY ) )
+    {
+        return JIT_ERROR_TOO_LATE;
+    }
+
+    /* Check criteria_2: Does packet timestamp seem plausible compared to current time */
+    if( ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A ) || ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_B ) )
+    {
+        if( ( packet->count_us - time_us ) > TX_MAX_ADVANCE_DELAY )
+        {
+            return JIT_ERROR_TOO_EARLY;
+        }
+    }
+
+    /* Check criteria_3: does this new packet overlap with a packet already enqueued ? */
+    for( i = 0; i < queue->num_pkt; i++ )
+    {
+        /* We ignore Beacon Guard for Class A/C downlinks */
+        if( ( ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_A ) || ( pkt_type == JIT_PKT_TYPE_DOWNLINK_CLASS_C ) ) &&
+            ( queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON ) )
+        {
+            target_pre_delay = TX_START_DELAY;
+        }
+        else
+        {
+            target_pre_delay = queue->nodes[i].pre_delay;
+        }
+
+        if( jit_collision_test( packet->count_us, packet_pre_delay, packet_post_delay, queue->nodes[i].pkt.count_us,
+                                target_pre_delay, queue->nodes[i].post_delay ) == true )
+        {
+            return ( queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON ) ? JIT_ERROR_COLLISION_BEACON
+                                                                       : JIT_ERROR_COLLISION_PACKET;
+        }
+    }
+
+    /* Insert packet at the end of the queue, then sort it */
+    memcpy( &( queue->nodes[queue->num_pkt].pkt ), packet, sizeof( struct lgw_pkt_tx_s ) );
+    queue->nodes[queue->num_pkt].pre_delay  = packet_pre_delay;
+    queue->nodes[queue->num_pkt].post_delay = packet_post_delay;
+    queue->nodes[queue->num_pkt].pkt_type   = pkt_type;
+    if( pkt_type == JIT_PKT_TYPE_BEACON )
+    {
+        queue->num_beacon++;
+    }
+    queue->num_pkt++;
+    jit_sort_queue( queue );
+
+    return JIT_ERROR_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum jit_error_e jit_lin_dequeue( struct jit_lin_queue_s* queue, int index, struct lgw_pkt_tx_s* packet,
+                                  enum jit_pkt_type_e* pkt_type )
+{
+    if( ( packet == NULL ) || ( index < 0 ) || ( index >= JIT_QUEUE_MAX ) )
+    {
+        return JIT_ERROR_INVALID;
+    }
+
+    if( queue->num_pkt == 0 )
+    {
+        return JIT_ERROR_EMPTY;
+    }
+
+    memcpy( packet, &( queue->nodes[index].pkt ), sizeof( struct lgw_pkt_tx_s ) );
+    queue->num_pkt--;
+    *pkt_type = queue->nodes[index].pkt_type;
+    if( *pkt_type == JIT_PKT_TYPE_BEACON )
+    {
+        queue->num_beacon--;
+    }
+
+    /* Replace dequeued packet with last packet of the queue, then sort it */
+    memcpy( &( queue->nodes[index] ), &( queue->nodes[queue->num_pkt] ), sizeof( struct jit_node_s ) );
+    memset( &( queue->nodes[queue->num_pkt] ), 0, sizeof( struct jit_node_s ) );
+    jit_sort_queue( queue );
+
+    return JIT_ERROR_OK;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+enum jit_error_e jit_lin_peek( struct jit_lin_queue_s* queue, uint32_t time_us, int* pkt_idx )
+{
+    int i                    = 0;
+    int idx_highest_priority = -1;
+
+    if( pkt_idx == NULL )
+    {
+        return JIT_ERROR_INVALID;
+    }
+
+    *pkt_idx = -1;
+
+    if( queue->num_pkt == 0 )
+    {
+        return JIT_ERROR_EMPTY;
+    }
+
+    /* Search for highest priority packet to be sent */
+    for( i = 0; i < queue->num_pkt; i++ )
+    {
+        /* First check if that packet is outdated, we drop it to avoid lock-up */
+        if( ( queue->nodes[i].pkt.count_us - time_us ) >= TX_MAX_ADVANCE_DELAY )
+        {
+            queue->num_pkt--;
+            if( queue->nodes[i].pkt_type == JIT_PKT_TYPE_BEACON )
+            {
+                queue->num_beacon--;
+            }
+
+            /* Replace dropped packet with last packet of the queue, then sort it */
+            memcpy( &( queue->nodes[i] ), &( queue->nodes[queue->num_pkt] ), sizeof( struct jit_node_s ) );
+            memset( &( queue->nodes[queue->num_pkt] ), 0, sizeof( struct jit_node_s ) );
+            jit_sort_queue( queue );
+
+            /* restart loop after purge to find packet to be sent, the nodes were moved */
+            i                    = -1;
+            idx_highest_priority = -1;
+            continue;
+        }
+
+        /* Then look for highest priority packet to be sent */
+        if( ( idx_highest_priority == -1 ) || ( ( ( queue->nodes[i].pkt.count_us - time_us ) <
+                                                  ( queue->nodes[idx_highest_priority].pkt.count_us - time_us ) ) ) )
+        {
+            idx_highest_priority = i;
+        }
+    }
+
+    if( idx_highest_priority == -1 )
+    {
+        return JIT_ERROR_EMPTY; /* all packets dropped */
+    }
+
+    /* Peek criteria 1: look for a packet to be sent in next TX_JIT_DELAY ms timeframe */
+    if( ( queue->nodes[idx_highest_priority].pkt.count_us - time_us ) < TX_JIT_DELAY )
+    {
+        *pkt_idx = idx_highest_priority;
+    }
+
+    return JIT_ERROR_OK;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
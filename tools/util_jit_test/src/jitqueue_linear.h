@@ -0,0 +1,61 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Reference model of the JiT queue: the former linear queue, sorted with qsort_r after each change
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _JITQUEUE_LINEAR_H
+#define _JITQUEUE_LINEAR_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h> /* C99 types */
+
+#include "jitqueue.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC TYPES --------------------------------------------------------- */
+
+struct jit_lin_queue_s
+{
+    uint8_t           num_pkt;              /* Total number of packets in the queue (downlinks, beacons...) */
+    uint8_t           num_beacon;           /* Number of beacons in the queue */
+    struct jit_node_s nodes[JIT_QUEUE_MAX]; /* Nodes/packets array in the queue, sorted by packet timestamp */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Same as jit_queue_init, on the reference queue
+*/
+void jit_lin_init( struct jit_lin_queue_s* queue );
+
+/**
+@brief Same as jit_enqueue, on the reference queue
+*/
+enum jit_error_e jit_lin_enqueue( struct jit_lin_queue_s* queue, uint32_t time_us, struct lgw_pkt_tx_s* packet,
+                                  enum jit_pkt_type_e pkt_type );
+
+/**
+@brief Same as jit_dequeue, on the reference queue
+*/
+enum jit_error_e jit_lin_dequeue( struct jit_lin_queue_s* queue, int index, struct lgw_pkt_tx_s* packet,
+                                  enum jit_pkt_type_e* pkt_type );
+
+/**
+@brief Same as jit_peek, on the reference queue
+*/
+enum jit_error_e jit_lin_peek( struct jit_lin_queue_s* queue, uint32_t time_us, int* pkt_idx );
+
+#endif
+/* --- EOF ------------------------------------------------------------------ */
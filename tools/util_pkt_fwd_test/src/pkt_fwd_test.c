@@ -0,0 +1,92 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub packet forwarder modules, the ESP-IDF services being stubbed
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* printf */
+#include <stdlib.h>  /* EXIT_SUCCESS, EXIT_FAILURE */
+
+#include <esp_timer.h>
+
+#include "pkt_fwd_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct test_group_s
+{
+    const char* name;
+    void ( *run )( void );
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static const struct test_group_s test_groups[] = {
+    { "uplink_filter", test_uplink_filter },
+    { "lns_supervisor", test_lns_supervisor },
+    { "dev_stats", test_dev_stats },
+};
+
+static unsigned nb_checks   = 0;
+static unsigned nb_failures = 0;
+
+int64_t mock_time_us = 0;
+
+/* -------------------------------------------------------------------------- */
+/* --- MOCKS ---------------------------------------------------------------- */
+
+int64_t esp_timer_get_time( void )
+{
+    return mock_time_us;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+bool pkt_fwd_test_check( bool ok, const char* expr, const char* file, int line )
+{
+    nb_checks += 1;
+    if( ok == false )
+    {
+        nb_failures += 1;
+        printf( "%s:%d: FAILED: %s\n", file, line, expr );
+    }
+
+    return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( void )
+{
+    unsigned failures_before;
+    unsigned i;
+
+    for( i = 0; i < sizeof test_groups / sizeof test_groups[0]; i++ )
+    {
+        failures_before = nb_failures;
+        test_groups[i].run( );
+        printf( "%-16s %s\n", test_groups[i].name, ( nb_failures == failures_before ) ? "OK" : "FAILED" );
+    }
+    printf( "%u checks, %u failures\n", nb_checks, nb_failures );
+
+    return ( nb_failures == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
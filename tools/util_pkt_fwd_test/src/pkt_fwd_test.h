@@ -0,0 +1,67 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the LoRaHub packet forwarder modules, common definitions
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+#ifndef _PKT_FWD_TEST_H
+#define _PKT_FWD_TEST_H
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC MACROS -------------------------------------------------------- */
+
+/**
+@brief Check a condition, the failure is reported with its location and the test goes on
+*/
+#define CHECK( cond ) pkt_fwd_test_check( ( cond ), #cond, __FILE__, __LINE__ )
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC VARIABLES ----------------------------------------------------- */
+
+extern int64_t mock_time_us; /* time returned by the esp_timer_get_time() mock */
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS PROTOTYPES ------------------------------------------ */
+
+/**
+@brief Account the result of a check
+@param ok result of the check
+@param expr text of the condition checked
+@param file source file of the check
+@param line source line of the check
+@return the result of the check
+*/
+bool pkt_fwd_test_check( bool ok, const char* expr, const char* file, int line );
+
+/**
+@brief Tests of the uplink filter: NetID to DevAddr prefix, lookup table, JoinEUI ranges and hit counters
+*/
+void test_uplink_filter( void );
+
+/**
+@brief Tests of the connection supervisor: parsing of the server lists
+*/
+void test_lns_supervisor( void );
+
+/**
+@brief Tests of the per-device statistics: colliding DevAddrs, backward shift deletion and LRU eviction
+*/
+void test_dev_stats( void );
+
+#endif  // _PKT_FWD_TEST_H
+
+/* --- EOF ------------------------------------------------------------------ */
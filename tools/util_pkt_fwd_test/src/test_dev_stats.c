@@ -0,0 +1,305 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the per-device statistics (dev_stats.c), built with a capacity of 16 devices
+
+    The hash table has 2 * DEV_STATS_CAPACITY slots, a power of two here, and the Knuth hash is a multiplication: the
+    DevAddrs which are a multiple of the number of slots apart share their home slot, and make the clusters collide.
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdlib.h>  /* rand_r */
+
+#include "dev_stats.h"
+
+#include "pkt_fwd_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NB_SLOTS ( 2 * DEV_STATS_CAPACITY )
+
+#define DEVADDR_BASE 0x26000000
+
+#define MODEL_NB_DEVADDR 40  /* DevAddrs drawn by the randomized test, in two families sharing a home slot */
+#define MODEL_NB_UPDATES 5000
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* reference model of a device, a linear table being enough for it */
+struct model_dev_s
+{
+    uint32_t devaddr;
+    uint32_t nb_pkt;
+    int64_t  last_seen_us;
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static struct model_dev_s model_devs[DEV_STATS_CAPACITY];
+static int                model_nb_dev = 0;
+
+static uint32_t filler_devaddr = 0xFFFF0000; /* next DevAddr filling the table, never used before */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static void clear( void );
+
+static void update( uint32_t devaddr, uint16_t fcnt, int16_t rssi, int16_t snr );
+
+static int nb_devices( void );
+
+static int find( uint32_t devaddr, struct dev_stats_entry_s* entry );
+
+static void model_update( uint32_t devaddr );
+
+static bool model_check( void );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* fill the table with new devices, evicting the ones of the previous test, and reset the model to them */
+static void clear( void )
+{
+    int i;
+
+    model_nb_dev = 0;
+    for( i = 0; i < DEV_STATS_CAPACITY; i++ )
+    {
+        update( filler_devaddr, 0, 0, 0 );
+        model_update( filler_devaddr );
+        filler_devaddr += 1;
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* an uplink received 1 ms after the previous one, so that the least recent device is unique */
+static void update( uint32_t devaddr, uint16_t fcnt, int16_t rssi, int16_t snr )
+{
+    mock_time_us += 1000;
+    dev_stats_update( devaddr, fcnt, rssi, snr );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int nb_devices( void )
+{
+    struct dev_stats_entry_s entries[DEV_STATS_CAPACITY];
+
+    return dev_stats_get( entries, DEV_STATS_CAPACITY );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the number of entries of the table with this DevAddr, the last one being copied */
+static int find( uint32_t devaddr, struct dev_stats_entry_s* entry )
+{
+    struct dev_stats_entry_s entries[DEV_STATS_CAPACITY];
+    int                      nb_entries = dev_stats_get( entries, DEV_STATS_CAPACITY );
+    int                      nb_found   = 0;
+    int                      i;
+
+    for( i = 0; i < nb_entries; i++ )
+    {
+        if( entries[i].devaddr == devaddr )
+        {
+            *entry = entries[i];
+            nb_found += 1;
+        }
+    }
+
+    return nb_found;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void model_update( uint32_t devaddr )
+{
+    int i;
+    int lru = 0;
+
+    for( i = 0; i < model_nb_dev; i++ )
+    {
+        if( model_devs[i].devaddr == devaddr )
+        {
+            break;
+        }
+    }
+    if( i == model_nb_dev )
+    {
+        if( model_nb_dev < DEV_STATS_CAPACITY )
+        {
+            model_nb_dev += 1;
+        }
+        else
+        {
+            for( i = 1; i < model_nb_dev; i++ )
+            {
+                if( model_devs[i].last_seen_us < model_devs[lru].last_seen_us )
+                {
+                    lru = i;
+                }
+            }
+            i = lru;
+        }
+        model_devs[i].devaddr = devaddr;
+        model_devs[i].nb_pkt  = 0;
+    }
+    model_devs[i].nb_pkt += 1;
+    model_devs[i].last_seen_us = mock_time_us;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the table holds the devices of the model, each one once, with the same number of uplinks */
+static bool model_check( void )
+{
+    struct dev_stats_entry_s entry;
+    int                      i;
+
+    if( nb_devices( ) != model_nb_dev )
+    {
+        return false;
+    }
+    for( i = 0; i < model_nb_dev; i++ )
+    {
+        if( ( find( model_devs[i].devaddr, &entry ) != 1 ) || ( entry.nb_pkt != model_devs[i].nb_pkt ) ||
+            ( entry.last_seen_us != ( uint64_t ) model_devs[i].last_seen_us ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* RSSI and SNR extrema and sums, SNR in 0.25 dB, FCnt gaps and resets */
+static void test_counters( void )
+{
+    struct dev_stats_entry_s entry;
+
+    clear( );
+
+    update( DEVADDR_BASE, 10, -100, -17 );
+    update( DEVADDR_BASE, 11, -90, 38 );
+    update( DEVADDR_BASE, 15, -110, 2 );
+    CHECK( find( DEVADDR_BASE, &entry ) == 1 );
+    CHECK( ( entry.nb_pkt == 3 ) && ( entry.nb_lost == 3 ) && ( entry.last_fcnt == 15 ) );
+    CHECK( ( entry.rssi_min == -110 ) && ( entry.rssi_max == -90 ) && ( entry.rssi_sum == -300 ) );
+    CHECK( ( entry.snr_min == -17 ) && ( entry.snr_max == 38 ) && ( entry.snr_sum == 23 ) );
+
+    /* repeated FCnt, FCnt going backward, FCnt rolling over */
+    update( DEVADDR_BASE, 15, -100, 0 );
+    update( DEVADDR_BASE, 2, -100, 0 );
+    update( DEVADDR_BASE + 1, 0xFFFE, -100, 0 );
+    update( DEVADDR_BASE + 1, 1, -100, 0 );
+    CHECK( find( DEVADDR_BASE, &entry ) == 1 );
+    CHECK( ( entry.nb_pkt == 5 ) && ( entry.nb_lost == 3 ) && ( entry.last_fcnt == 2 ) );
+    CHECK( find( DEVADDR_BASE + 1, &entry ) == 1 );
+    CHECK( ( entry.nb_pkt == 2 ) && ( entry.nb_lost == 2 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a full table of devices sharing one home slot, the least recent one being evicted from the middle of the cluster */
+static void test_collisions( void )
+{
+    struct dev_stats_entry_s entry;
+    int                      i;
+
+    clear( );
+
+    for( i = 0; i < DEV_STATS_CAPACITY; i++ )
+    {
+        update( DEVADDR_BASE + i * NB_SLOTS, i, -100, 0 );
+    }
+    for( i = 0; i < DEV_STATS_CAPACITY; i++ )
+    {
+        CHECK( ( find( DEVADDR_BASE + i * NB_SLOTS, &entry ) == 1 ) && ( entry.nb_pkt == 1 ) );
+    }
+
+    /* every device heard again but the 6th one, which is then replaced by a new device */
+    for( i = 0; i < DEV_STATS_CAPACITY; i++ )
+    {
+        if( i != 5 )
+        {
+            update( DEVADDR_BASE + i * NB_SLOTS, 100 + i, -100, 0 );
+        }
+    }
+    update( DEVADDR_BASE + DEV_STATS_CAPACITY * NB_SLOTS, 0, -100, 0 );
+    CHECK( find( DEVADDR_BASE + 5 * NB_SLOTS, &entry ) == 0 );
+    CHECK( nb_devices( ) == DEV_STATS_CAPACITY );
+
+    /* the devices after the evicted one were shifted back, they are still found and not added again */
+    for( i = 0; i <= DEV_STATS_CAPACITY; i++ )
+    {
+        if( i != 5 )
+        {
+            update( DEVADDR_BASE + i * NB_SLOTS, 200 + i, -100, 0 );
+        }
+    }
+    for( i = 0; i <= DEV_STATS_CAPACITY; i++ )
+    {
+        if( i != 5 )
+        {
+            CHECK( ( find( DEVADDR_BASE + i * NB_SLOTS, &entry ) == 1 ) &&
+                   ( entry.nb_pkt == ( ( i == DEV_STATS_CAPACITY ) ? 2u : 3u ) ) );
+        }
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* random uplinks from more devices than the table holds, in two families of colliding DevAddrs whose clusters
+ * overlap and wrap around the end of the table, compared to a linear LRU table */
+static void test_lru_model( void )
+{
+    unsigned int seed = 1;
+    uint32_t     devaddr;
+    int          k;
+    int          i;
+    bool         ok = true;
+
+    clear( );
+
+    for( i = 0; ( i < MODEL_NB_UPDATES ) && ( ok == true ); i++ )
+    {
+        k       = rand_r( &seed ) % MODEL_NB_DEVADDR;
+        devaddr = DEVADDR_BASE + ( k % 2 ) * 7 + ( k / 2 ) * NB_SLOTS;
+        update( devaddr, i, -100, 0 );
+        model_update( devaddr );
+        ok = model_check( );
+    }
+    CHECK( ok == true );
+    CHECK( i == MODEL_NB_UPDATES );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_dev_stats( void )
+{
+    test_counters( );
+    test_collisions( );
+    test_lru_model( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
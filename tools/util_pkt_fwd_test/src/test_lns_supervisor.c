@@ -0,0 +1,100 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the connection supervisor (lns_supervisor.c), table driven
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* strcmp */
+
+#include "lns_supervisor.h"
+
+#include "pkt_fwd_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* a server list and the servers expected, nb_servers being -1 if the list is invalid */
+struct servers_case_s
+{
+    const char*         str;
+    int                 nb_servers;
+    struct lns_server_s servers[LNS_SERVERS_MAX];
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static const struct servers_case_s servers_cases[] = {
+    { "", 0, { { "", "", "", false } } },
+    { " , ", 0, { { "", "", "", false } } },
+    { "eu1.cloud.thethings.network", 1, { { "eu1.cloud.thethings.network", "1700", "1700", false } } },
+    { "192.168.1.10:1680", 1, { { "192.168.1.10", "1680", "1680", false } } },
+    { "dl:lns.example.com", 1, { { "lns.example.com", "1700", "1700", true } } },
+    { "a:1,b  dl:c:65535,d",
+      4,
+      { { "a", "1", "1", false }, { "b", "1700", "1700", false }, { "c", "65535", "65535", true },
+        { "d", "1700", "1700", false } } },
+    { "a b c d e", -1, { { "", "", "", false } } },            /* too many servers */
+    { "a:0", -1, { { "", "", "", false } } },                  /* port out of range */
+    { "a:65536", -1, { { "", "", "", false } } },              /* port out of range */
+    { "a:", -1, { { "", "", "", false } } },                   /* no port after the colon */
+    { "a:17x0", -1, { { "", "", "", false } } },               /* port not numeric */
+    { ":1700", -1, { { "", "", "", false } } },                /* no host */
+    { "dl:", -1, { { "", "", "", false } } },                  /* no host after the prefix */
+    { "a:1700:1701", -1, { { "", "", "", false } } },          /* two ports */
+    { "0123456789012345678901234567890123456789012345678901234567890123",
+      -1,
+      { { "", "", "", false } } }, /* host longer than LNS_SERVER_ADDR_STR_MAX_SIZE - 1 */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* the entries are parsed in order, with the default port when none is given */
+static void test_parse_servers( void )
+{
+    struct lns_server_s servers[LNS_SERVERS_MAX];
+    int                 nb_servers;
+    int                 j;
+    unsigned            i;
+
+    for( i = 0; i < sizeof servers_cases / sizeof servers_cases[0]; i++ )
+    {
+        nb_servers = lns_parse_servers( servers_cases[i].str, "1700", servers, LNS_SERVERS_MAX );
+        CHECK( nb_servers == servers_cases[i].nb_servers );
+        for( j = 0; j < nb_servers; j++ )
+        {
+            CHECK( strcmp( servers[j].addr, servers_cases[i].servers[j].addr ) == 0 );
+            CHECK( strcmp( servers[j].port_up, servers_cases[i].servers[j].port_up ) == 0 );
+            CHECK( strcmp( servers[j].port_down, servers_cases[i].servers[j].port_down ) == 0 );
+            CHECK( servers[j].downlink == servers_cases[i].servers[j].downlink );
+        }
+    }
+
+    /* the maximum is the one of the caller, the primary server taking the first entry */
+    CHECK( lns_parse_servers( "a b c", "1700", servers, LNS_SERVERS_MAX - 1 ) == LNS_SERVERS_MAX - 1 );
+    CHECK( lns_parse_servers( "a b c d", "1700", servers, LNS_SERVERS_MAX - 1 ) == -1 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_lns_supervisor( void )
+{
+    test_parse_servers( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
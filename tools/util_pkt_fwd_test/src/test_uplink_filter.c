@@ -0,0 +1,343 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host unit tests of the uplink filter (uplink_filter.c), table driven
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <string.h>  /* memset */
+
+#include "uplink_filter.h"
+
+#include "pkt_fwd_test.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define NO_RULE -1
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+/* a NetID rule and the DevAddr prefix it must be converted to */
+struct netid_case_s
+{
+    const char* rule;
+    uint8_t     prefix_len;
+    uint32_t    devaddr;
+};
+
+/* a set of rules, an uplink and the decision expected */
+struct lookup_case_s
+{
+    const char* rules;
+    uint32_t    devaddr;
+    bool        forward;
+    int         rule; /* index of the rule applied, NO_RULE if none */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+/* DevAddr prefixes computed by hand from the LoRaWAN backend interfaces specification: type as 1 bits ended by a 0 bit,
+ * then the NwkID, i.e. the 6, 6, 9, 11, 12, 13, 15 or 17 LSBs of the NetID */
+static const struct netid_case_s netid_cases[] = {
+    { "netid:000013", 7, 0x26000000 },  /* type 0, The Things Network */
+    { "netid:0000FF", 7, 0x7E000000 },  /* type 0, the NetID bits above the NwkID ignored */
+    { "netid:200005", 8, 0x85000000 },  /* type 1 */
+    { "netid:400001", 12, 0xC0100000 }, /* type 2 */
+    { "netid:600011", 15, 0xE0220000 }, /* type 3 */
+    { "netid:800002", 17, 0xF0010000 }, /* type 4 */
+    { "netid:A00003", 19, 0xF8006000 }, /* type 5 */
+    { "netid:C00005", 22, 0xFC001400 }, /* type 6 */
+    { "netid:E00001", 25, 0xFE000080 }, /* type 7 */
+    { "netid:FFFFFF", 25, 0xFEFFFF80 }, /* type 7, largest NwkID */
+};
+
+static const char* invalid_rules[] = {
+    "26000000",      /* no prefix length */
+    "26000000/33",   /* prefix longer than a DevAddr */
+    "26000000/7x",   /* trailing characters */
+    "126000000/7",   /* more than 32 bits */
+    "netid:1000000", /* more than 24 bits */
+    "netid:0013G",   /* not hexadecimal */
+    "join:5-1",      /* empty range */
+    "join:1-",       /* no end of range */
+    "!join:1",       /* no deny rule for the JoinEUI */
+    "!",             /* no rule */
+};
+
+/* the rules are applied in the 4096 buckets of the 12 DevAddr MSBs, the longer ones being checked one by one */
+static const struct lookup_case_s lookup_cases[] = {
+    /* nested rules shorter and longer than a bucket, the most specific one applies */
+    { "26000000/7 !26010000/16 26010200/24", 0x26123456, true, 0 },
+    { "26000000/7 !26010000/16 26010200/24", 0x27FFFFFF, true, 0 },
+    { "26000000/7 !26010000/16 26010200/24", 0x26010001, false, 1 },
+    { "26000000/7 !26010000/16 26010200/24", 0x260102AB, true, 2 },
+    { "26000000/7 !26010000/16 26010200/24", 0x28000000, false, NO_RULE }, /* matching no allow rule */
+    /* rules of 11, 12 and 13 bits, around the bucket size */
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFF00000, true, 0 },
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFF12345, true, 0 },
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFE12345, true, 1 },
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFEFFFFF, true, 1 },
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFF80000, false, 2 },
+    { "FFF00000/12 FFE00000/11 !FFF80000/13", 0xFFDFFFFF, false, NO_RULE },
+    /* same prefix allowed and denied, the deny rule applies, in a bucket and in the long rules */
+    { "!0/0 C0100000/12 !C0100000/12", 0xC0100001, false, 2 },
+    { "!0/0 C0100000/12 !C0100000/12", 0x12345678, false, 0 },
+    { "C0100000/20 !C0100000/20", 0xC0100FFF, false, 1 },
+    /* deny rules only, the other uplinks are forwarded */
+    { "!26000000/7", 0x01020304, true, NO_RULE },
+    { "!26000000/7", 0x26000000, false, 0 },
+    /* full DevAddr */
+    { "26000000/32", 0x26000000, true, 0 },
+    { "26000000/32", 0x26000001, false, NO_RULE },
+    /* NetID rules, converted to prefixes of 7 and 25 bits */
+    { "netid:000013 !netid:E00001", 0x26ABCDEF, true, 0 },
+    { "netid:000013 !netid:E00001", 0xFE0000FF, false, 1 },
+    { "netid:000013 !netid:E00001", 0xFE000100, false, NO_RULE },
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DECLARATION ---------------------------------------- */
+
+static uint16_t data_uplink( uint8_t* payload, uint32_t devaddr );
+
+static uint16_t join_request( uint8_t* payload, uint64_t joineui );
+
+static bool set_rules( const char* str );
+
+static bool check_hits( int rule, bool forward );
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+/* an unconfirmed data uplink, without FOpts nor FRMPayload */
+static uint16_t data_uplink( uint8_t* payload, uint32_t devaddr )
+{
+    memset( payload, 0, 12 );
+    payload[0] = 0x40;
+    payload[1] = ( uint8_t ) devaddr;
+    payload[2] = ( uint8_t ) ( devaddr >> 8 );
+    payload[3] = ( uint8_t ) ( devaddr >> 16 );
+    payload[4] = ( uint8_t ) ( devaddr >> 24 );
+
+    return 12;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static uint16_t join_request( uint8_t* payload, uint64_t joineui )
+{
+    int i;
+
+    memset( payload, 0, 23 );
+    for( i = 1; i <= 8; i++ )
+    {
+        payload[i] = ( uint8_t ) joineui;
+        joineui >>= 8;
+    }
+
+    return 23;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool set_rules( const char* str )
+{
+    struct uplink_filter_rule_s rules[UPLINK_FILTER_RULES_MAX];
+    int                         nb_rules = uplink_filter_parse( str, rules );
+
+    if( nb_rules < 0 )
+    {
+        return false;
+    }
+    uplink_filter_set( rules, nb_rules );
+
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the counters since the previous call hold one uplink, accounted to this rule, and dropped if not forwarded */
+static bool check_hits( int rule, bool forward )
+{
+    uint32_t hits[UPLINK_FILTER_RULES_MAX];
+    uint32_t nb_drop;
+    int      nb_rules = uplink_filter_get_stats( hits, &nb_drop );
+    int      i;
+
+    for( i = 0; i < nb_rules; i++ )
+    {
+        if( hits[i] != ( ( i == rule ) ? 1 : 0 ) )
+        {
+            return false;
+        }
+    }
+
+    return ( nb_drop == ( ( forward == true ) ? 0 : 1 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* every NetID type is converted to the DevAddr prefix of its NwkID */
+static void test_netid( void )
+{
+    struct uplink_filter_rule_s rules[UPLINK_FILTER_RULES_MAX];
+    unsigned                    i;
+
+    for( i = 0; i < sizeof netid_cases / sizeof netid_cases[0]; i++ )
+    {
+        CHECK( uplink_filter_parse( netid_cases[i].rule, rules ) == 1 );
+        CHECK( rules[0].type == UPLINK_FILTER_ALLOW_DEVADDR );
+        CHECK( rules[0].prefix_len == netid_cases[i].prefix_len );
+        CHECK( rules[0].devaddr == netid_cases[i].devaddr );
+    }
+
+    CHECK( uplink_filter_parse( "!netid:000013", rules ) == 1 );
+    CHECK( rules[0].type == UPLINK_FILTER_DENY_DEVADDR );
+    CHECK( ( rules[0].prefix_len == 7 ) && ( rules[0].devaddr == 0x26000000 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the rules strings are split on spaces and commas, a single invalid rule rejects the whole string */
+static void test_parse( void )
+{
+    struct uplink_filter_rule_s rules[UPLINK_FILTER_RULES_MAX];
+    unsigned                    i;
+
+    CHECK( uplink_filter_parse( "", rules ) == 0 );
+    CHECK( uplink_filter_parse( " ,26000000/7,, !27000000/8 ", rules ) == 2 );
+    CHECK( ( rules[0].type == UPLINK_FILTER_ALLOW_DEVADDR ) && ( rules[1].type == UPLINK_FILTER_DENY_DEVADDR ) );
+    CHECK( uplink_filter_parse( "26FFFFFF/7", rules ) == 1 );
+    CHECK( rules[0].devaddr == 0x26000000 );
+    CHECK( uplink_filter_parse( "0/0", rules ) == 1 );
+    CHECK( ( rules[0].prefix_len == 0 ) && ( rules[0].devaddr == 0 ) );
+
+    CHECK( uplink_filter_parse( "join:70B3D57ED0000000-70B3D57ED0FFFFFF join:0000000000001234", rules ) == 2 );
+    CHECK( rules[0].type == UPLINK_FILTER_ALLOW_JOINEUI );
+    CHECK( ( rules[0].joineui_min == 0x70B3D57ED0000000 ) && ( rules[0].joineui_max == 0x70B3D57ED0FFFFFF ) );
+    CHECK( ( rules[1].joineui_min == 0x1234 ) && ( rules[1].joineui_max == 0x1234 ) );
+
+    for( i = 0; i < sizeof invalid_rules / sizeof invalid_rules[0]; i++ )
+    {
+        CHECK( uplink_filter_parse( invalid_rules[i], rules ) == -1 );
+    }
+    CHECK( uplink_filter_parse( "1/1 2/2 3/3 4/4 5/5 6/6 7/7 8/8 9/9 A/10 B/11 C/12 D/13 E/14 F/15 10/16", rules ) ==
+           UPLINK_FILTER_RULES_MAX );
+    CHECK( uplink_filter_parse( "1/1 2/2 3/3 4/4 5/5 6/6 7/7 8/8 9/9 A/10 B/11 C/12 D/13 E/14 F/15 10/16 11/17",
+                                rules ) == -1 );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the rule found through the bucket table is the most specific one, and it is the one counted */
+static void test_lookup( void )
+{
+    uint8_t  payload[32];
+    uint16_t size;
+    unsigned i;
+
+    for( i = 0; i < sizeof lookup_cases / sizeof lookup_cases[0]; i++ )
+    {
+        CHECK( set_rules( lookup_cases[i].rules ) == true );
+        size = data_uplink( payload, lookup_cases[i].devaddr );
+        CHECK( uplink_filter_check( payload, size ) == lookup_cases[i].forward );
+        CHECK( check_hits( lookup_cases[i].rule, lookup_cases[i].forward ) == true );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the join-requests are only filtered by the join rules, the data uplinks by the DevAddr rules */
+static void test_join( void )
+{
+    uint8_t  payload[32];
+    uint16_t size;
+
+    CHECK( set_rules( "join:70B3D57ED0000000-70B3D57ED0FFFFFF 26000000/7" ) == true );
+
+    size = join_request( payload, 0x70B3D57ED0001234 );
+    CHECK( uplink_filter_check( payload, size ) == true );
+    CHECK( check_hits( 0, true ) == true );
+    size = join_request( payload, 0x70B3D57ED1000000 );
+    CHECK( uplink_filter_check( payload, size ) == false );
+    CHECK( check_hits( NO_RULE, false ) == true );
+    size = data_uplink( payload, 0x26000001 );
+    CHECK( uplink_filter_check( payload, size ) == true );
+    CHECK( check_hits( 1, true ) == true );
+
+    /* without join rules, every join-request is forwarded */
+    CHECK( set_rules( "26000000/7" ) == true );
+    size = join_request( payload, 0x70B3D57ED1000000 );
+    CHECK( uplink_filter_check( payload, size ) == true );
+    CHECK( check_hits( NO_RULE, true ) == true );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the counters are read as deltas since the previous snapshot, and cleared when the rules are set */
+static void test_stats( void )
+{
+    uint32_t hits[UPLINK_FILTER_RULES_MAX];
+    uint32_t nb_drop;
+    uint8_t  payload[32];
+    uint16_t size;
+    int      i;
+
+    CHECK( set_rules( "26000000/7 !27000000/8" ) == true );
+    for( i = 0; i < 3; i++ )
+    {
+        size = data_uplink( payload, 0x26000000 + i );
+        CHECK( uplink_filter_check( payload, size ) == true );
+    }
+    size = data_uplink( payload, 0x27000000 );
+    CHECK( uplink_filter_check( payload, size ) == false );
+    size = data_uplink( payload, 0x01000000 );
+    CHECK( uplink_filter_check( payload, size ) == false );
+
+    CHECK( uplink_filter_get_stats( hits, &nb_drop ) == 2 );
+    CHECK( ( hits[0] == 3 ) && ( hits[1] == 1 ) && ( nb_drop == 2 ) );
+    CHECK( uplink_filter_get_stats( hits, &nb_drop ) == 2 );
+    CHECK( ( hits[0] == 0 ) && ( hits[1] == 0 ) && ( nb_drop == 0 ) );
+
+    size = data_uplink( payload, 0x27000000 );
+    CHECK( uplink_filter_check( payload, size ) == false );
+    CHECK( set_rules( "26000000/7 !27000000/8" ) == true );
+    CHECK( uplink_filter_get_stats( hits, &nb_drop ) == 2 );
+    CHECK( ( hits[1] == 0 ) && ( nb_drop == 0 ) );
+
+    /* no rule, everything is forwarded and nothing counted */
+    CHECK( set_rules( "" ) == true );
+    size = data_uplink( payload, 0x27000000 );
+    CHECK( uplink_filter_check( payload, size ) == true );
+    CHECK( uplink_filter_get_stats( hits, &nb_drop ) == 0 );
+    CHECK( nb_drop == 0 );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- PUBLIC FUNCTIONS DEFINITION ------------------------------------------ */
+
+void test_uplink_filter( void )
+{
+    test_netid( );
+    test_parse( );
+    test_lookup( );
+    test_join( );
+    test_stats( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
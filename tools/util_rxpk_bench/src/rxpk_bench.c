@@ -0,0 +1,673 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host golden test and benchmark of the rxpk serializer of the packet forwarder (rxpk_serializer.c), against the
+    snprintf based serialization it replaced
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>   /* C99 types */
+#include <stdbool.h>  /* bool type */
+#include <stdio.h>    /* printf, snprintf, fopen */
+#include <stdlib.h>   /* atoi, exit */
+#include <string.h>   /* memcpy, memcmp, strlen */
+#include <math.h>     /* roundf, nextafterf */
+#include <time.h>     /* clock_gettime, gmtime_r */
+#include <unistd.h>   /* getopt */
+#include <sys/time.h> /* timeval */
+
+#include "lorahub_hal.h"
+#include "rxpk_serializer.h"
+#include "base64.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define ARRAY_SIZE( a ) ( sizeof( a ) / sizeof( ( a )[0] ) )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_ITERATIONS 200000 /* datagrams serialized per serializer in benchmark mode */
+#define DEFAULT_RANDOM 1000000    /* random packets compared in test mode */
+#define DEFAULT_SEED 1
+
+#define PKT_PER_DGRAM 4    /* as NB_PKT_MAX of the packet forwarder */
+#define DGRAM_SIZE 1500    /* as TX_BUFF_SIZE of the packet forwarder */
+#define OBJ_SIZE_MAX 640   /* above the largest rxpk object, with the "time" field and a 255-byte payload */
+#define ROUNDING_ULPS 8    /* floats checked on each side of a rounding boundary */
+#define ROUNDING_RANGE 200 /* boundaries checked for SNR and RSSI in [-ROUNDING_RANGE, ROUNDING_RANGE] */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+struct golden_case_s
+{
+    const char* name;
+    uint32_t    freq_hz;
+    uint8_t     status;
+    uint32_t    count_us;
+    uint32_t    datarate;
+    uint8_t     bandwidth;
+    uint8_t     coderate;
+    float       snr;
+    float       rssic;
+    uint16_t    size;
+    int64_t     time_us; /* wall-clock time of the reception, -1 to leave the "time" field out */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+/* edge cases, each line of the golden file is the output of the former serializer for one of them, in order */
+static const struct golden_case_s golden_cases[] = {
+    { "sf5_bw125_cr45", 868100000, STAT_CRC_OK, 0, DR_LORA_SF5, BW_125KHZ, CR_LORA_4_5, 9.5f, -57.0f, 12, -1 },
+    { "sf6_bw250_cr46", 868300000, STAT_CRC_OK, 1, DR_LORA_SF6, BW_250KHZ, CR_LORA_4_6, 7.0f, -60.0f, 12, -1 },
+    { "sf7_bw500_cr47", 868500000, STAT_CRC_OK, 2, DR_LORA_SF7, BW_500KHZ, CR_LORA_4_7, 5.0f, -70.0f, 12, -1 },
+    { "sf8_bw125_cr48", 867100000, STAT_CRC_OK, 3, DR_LORA_SF8, BW_125KHZ, CR_LORA_4_8, 2.0f, -80.0f, 12, -1 },
+    { "sf9_cr_off", 867300000, STAT_CRC_OK, 4, DR_LORA_SF9, BW_125KHZ, 0, -2.0f, -90.0f, 12, -1 },
+    { "sf10", 867500000, STAT_CRC_OK, 5, DR_LORA_SF10, BW_125KHZ, CR_LORA_4_5, -5.0f, -100.0f, 12, -1 },
+    { "sf11", 867700000, STAT_CRC_OK, 6, DR_LORA_SF11, BW_125KHZ, CR_LORA_4_5, -10.0f, -110.0f, 12, -1 },
+    { "sf12", 867900000, STAT_CRC_OK, 7, DR_LORA_SF12, BW_125KHZ, CR_LORA_4_5, -20.0f, -120.0f, 12, -1 },
+    { "stat_crc_bad", 868100000, STAT_CRC_BAD, 8, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "stat_no_crc", 868100000, STAT_NO_CRC, 9, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "tmst_max", 868100000, STAT_CRC_OK, UINT32_MAX, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "freq_zero", 0, STAT_CRC_OK, 10, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "freq_below_1mhz", 999999, STAT_CRC_OK, 11, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "freq_1hz", 433050001, STAT_CRC_OK, 12, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "freq_max", UINT32_MAX, STAT_CRC_OK, 13, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, -1 },
+    { "snr_zero", 868100000, STAT_CRC_OK, 14, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 0.0f, -50.0f, 12, -1 },
+    { "snr_minus_zero", 868100000, STAT_CRC_OK, 15, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, -0.0f, -50.0f, 12, -1 },
+    { "snr_small_neg", 868100000, STAT_CRC_OK, 16, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, -0.04f, -50.0f, 12, -1 },
+    { "snr_neg_half", 868100000, STAT_CRC_OK, 17, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, -0.05f, -50.0f, 12, -1 },
+    { "snr_half_even_down", 868100000, STAT_CRC_OK, 18, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 0.25f, -50.0f, 12, -1 },
+    { "snr_half_even_up", 868100000, STAT_CRC_OK, 19, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 13.75f, -50.0f, 12, -1 },
+    { "snr_below_half", 868100000, STAT_CRC_OK, 20, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 0.35f, -50.0f, 12, -1 },
+    { "snr_carry", 868100000, STAT_CRC_OK, 21, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, -9.96f, -50.0f, 12, -1 },
+    { "snr_quarter_db", 868100000, STAT_CRC_OK, 22, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, -17.25f, -50.0f, 12, -1 },
+    { "snr_tiny", 868100000, STAT_CRC_OK, 23, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1e-30f, -50.0f, 12, -1 },
+    { "rssi_zero", 868100000, STAT_CRC_OK, 24, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, 0.0f, 12, -1 },
+    { "rssi_minus_zero", 868100000, STAT_CRC_OK, 25, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -0.4f, 12, -1 },
+    { "rssi_neg_half", 868100000, STAT_CRC_OK, 26, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -0.5f, 12, -1 },
+    { "rssi_half_away", 868100000, STAT_CRC_OK, 27, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, 2.5f, 12, -1 },
+    { "rssi_neg_half_away", 868100000, STAT_CRC_OK, 28, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -127.5f, 12, -1 },
+    { "rssi_below_half", 868100000, STAT_CRC_OK, 29, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -139.49f, 12, -1 },
+    { "rssi_quarter_db", 868100000, STAT_CRC_OK, 30, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -96.75f, 12, -1 },
+    { "size_0", 868100000, STAT_CRC_OK, 31, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 0, -1 },
+    { "size_1", 868100000, STAT_CRC_OK, 32, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 1, -1 },
+    { "size_2", 868100000, STAT_CRC_OK, 33, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 2, -1 },
+    { "size_3", 868100000, STAT_CRC_OK, 34, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 3, -1 },
+    { "size_255", 868100000, STAT_CRC_OK, 35, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 255, -1 },
+    { "time_epoch", 868100000, STAT_CRC_OK, 36, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12, 0 },
+    { "time_leap_day", 868100000, STAT_CRC_OK, 37, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12,
+      1709251199999999 },
+    { "time_usec_pad", 868100000, STAT_CRC_OK, 38, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12,
+      1735689600000007 },
+    { "time_2038", 868100000, STAT_CRC_OK, 39, DR_LORA_SF7, BW_125KHZ, CR_LORA_4_5, 1.0f, -50.0f, 12,
+      2147483648500000 },
+};
+
+static uint32_t prng_state;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void usage( void )
+{
+    printf( "Usage: rxpk_bench [-n iterations] [-t golden_file] [-r packets] [-w golden_file] [-s seed]\n" );
+    printf( " -n <int> number of %d-packet datagrams per serializer, %d by default\n", PKT_PER_DGRAM,
+            DEFAULT_ITERATIONS );
+    printf( " -t <path> test the serializer against the golden file, random packets and rounding boundaries\n" );
+    printf( " -r <int> number of random packets compared in test mode, %d by default\n", DEFAULT_RANDOM );
+    printf( " -w <path> write the golden file with the former serializer\n" );
+    printf( " -s <int> seed of the random packets, %d by default\n", DEFAULT_SEED );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double now_s( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return ( double ) t.tv_sec + ( 1E-9 * ( double ) t.tv_nsec );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* xorshift32, so that a run can be reproduced from its seed */
+static uint32_t prng( void )
+{
+    prng_state ^= prng_state << 13;
+    prng_state ^= prng_state >> 17;
+    prng_state ^= prng_state << 5;
+    return prng_state;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/**
+@brief Serialize a received packet as the packet forwarder did before rxpk_serializer.c
+@param p pointer to the received packet
+@param rx_time wall-clock time of the reception, NULL to leave the "time" field out
+@param dest pointer to the buffer where the object is written
+@param dest_size usable size of the buffer
+@return number of bytes written, -1 where the former code called wait_on_error
+
+The former code is kept as is. The "time" field, which it did not send, is formatted as in the Semtech packet
+forwarder.
+*/
+static int serialize_snprintf( const struct lgw_pkt_rx_s* p, const struct timeval* rx_time, uint8_t* dest,
+                               int dest_size )
+{
+    int       buff_index = 0;
+    int       j;
+    struct tm tm;
+
+    dest[buff_index++] = '{';
+
+    j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index, "\"jver\":%d", 1 );
+    buff_index += j;
+
+    j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index, ",\"tmst\":%lu",
+                  ( unsigned long ) p->count_us );
+    buff_index += j;
+
+    if( rx_time != NULL )
+    {
+        gmtime_r( &( rx_time->tv_sec ), &tm );
+        j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index,
+                      ",\"time\":\"%04i-%02i-%02iT%02i:%02i:%02i.%06liZ\"", tm.tm_year + 1900, tm.tm_mon + 1,
+                      tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, ( long ) rx_time->tv_usec );
+        buff_index += j;
+    }
+
+    j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index, ",\"chan\":%1u,\"rfch\":%1u,\"freq\":%.6lf",
+                  p->if_chain, p->rf_chain, ( ( double ) p->freq_hz / 1e6 ) );
+    buff_index += j;
+
+    switch( p->status )
+    {
+    case STAT_CRC_OK:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"stat\":1", 9 );
+        buff_index += 9;
+        break;
+    case STAT_CRC_BAD:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"stat\":-1", 10 );
+        buff_index += 10;
+        break;
+    case STAT_NO_CRC:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"stat\":0", 9 );
+        buff_index += 9;
+        break;
+    default:
+        return -1;
+    }
+
+    if( p->modulation != MOD_LORA )
+    {
+        return -1;
+    }
+    memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"modu\":\"LORA\"", 14 );
+    buff_index += 14;
+
+    switch( p->datarate )
+    {
+    case DR_LORA_SF5:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF5", 12 );
+        buff_index += 12;
+        break;
+    case DR_LORA_SF6:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF6", 12 );
+        buff_index += 12;
+        break;
+    case DR_LORA_SF7:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF7", 12 );
+        buff_index += 12;
+        break;
+    case DR_LORA_SF8:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF8", 12 );
+        buff_index += 12;
+        break;
+    case DR_LORA_SF9:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF9", 12 );
+        buff_index += 12;
+        break;
+    case DR_LORA_SF10:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF10", 13 );
+        buff_index += 13;
+        break;
+    case DR_LORA_SF11:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF11", 13 );
+        buff_index += 13;
+        break;
+    case DR_LORA_SF12:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"datr\":\"SF12", 13 );
+        buff_index += 13;
+        break;
+    default:
+        return -1;
+    }
+    switch( p->bandwidth )
+    {
+    case BW_125KHZ:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) "BW125\"", 6 );
+        buff_index += 6;
+        break;
+    case BW_250KHZ:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) "BW250\"", 6 );
+        buff_index += 6;
+        break;
+    case BW_500KHZ:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) "BW500\"", 6 );
+        buff_index += 6;
+        break;
+    default:
+        return -1;
+    }
+
+    switch( p->coderate )
+    {
+    case CR_LORA_4_5:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"codr\":\"4/5\"", 13 );
+        buff_index += 13;
+        break;
+    case CR_LORA_4_6:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"codr\":\"4/6\"", 13 );
+        buff_index += 13;
+        break;
+    case CR_LORA_4_7:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"codr\":\"4/7\"", 13 );
+        buff_index += 13;
+        break;
+    case CR_LORA_4_8:
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"codr\":\"4/8\"", 13 );
+        buff_index += 13;
+        break;
+    case 0: /* treat the CR0 case (mostly false sync) */
+        memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"codr\":\"OFF\"", 13 );
+        buff_index += 13;
+        break;
+    default:
+        return -1;
+    }
+
+    j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index, ",\"lsnr\":%.1f", p->snr );
+    buff_index += j;
+
+    j = snprintf( ( char* ) ( dest + buff_index ), dest_size - buff_index, ",\"rssi\":%.0f,\"size\":%u",
+                  roundf( p->rssic ), p->size );
+    buff_index += j;
+
+    memcpy( ( void* ) ( dest + buff_index ), ( void* ) ",\"data\":\"", 9 );
+    buff_index += 9;
+    j = bin_to_b64( p->payload, p->size, ( char* ) ( dest + buff_index ), 341 );
+    if( j < 0 )
+    {
+        return -1;
+    }
+    buff_index += j;
+    dest[buff_index++] = '"';
+    dest[buff_index++] = '}';
+
+    return buff_index;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void fill_payload( struct lgw_pkt_rx_s* pkt )
+{
+    int i;
+
+    for( i = 0; i < pkt->size; i++ )
+    {
+        pkt->payload[i] = ( uint8_t ) ( ( 37 * i ) + pkt->size );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void golden_pkt( const struct golden_case_s* c, struct lgw_pkt_rx_s* pkt, struct timeval* tv )
+{
+    memset( pkt, 0, sizeof *pkt );
+    pkt->freq_hz    = c->freq_hz;
+    pkt->status     = c->status;
+    pkt->count_us   = c->count_us;
+    pkt->modulation = MOD_LORA;
+    pkt->datarate   = c->datarate;
+    pkt->bandwidth  = c->bandwidth;
+    pkt->coderate   = c->coderate;
+    pkt->snr        = c->snr;
+    pkt->rssic      = c->rssic;
+    pkt->size       = c->size;
+    fill_payload( pkt );
+
+    if( c->time_us >= 0 )
+    {
+        tv->tv_sec  = ( time_t ) ( c->time_us / 1000000 );
+        tv->tv_usec = ( suseconds_t ) ( c->time_us % 1000000 );
+    }
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* random packet with valid field values, SNR and RSSI from random bits within the radio range */
+static void random_pkt( struct lgw_pkt_rx_s* pkt )
+{
+    static const uint8_t status[]    = { STAT_CRC_OK, STAT_CRC_BAD, STAT_NO_CRC };
+    static const uint8_t bandwidth[] = { BW_125KHZ, BW_250KHZ, BW_500KHZ };
+
+    memset( pkt, 0, sizeof *pkt );
+    pkt->freq_hz    = prng( );
+    pkt->if_chain   = ( uint8_t ) ( prng( ) % 10 );
+    pkt->rf_chain   = ( uint8_t ) ( prng( ) % 2 );
+    pkt->status     = status[prng( ) % ARRAY_SIZE( status )];
+    pkt->count_us   = prng( );
+    pkt->modulation = MOD_LORA;
+    pkt->datarate   = DR_LORA_SF5 + ( prng( ) % 8 );
+    pkt->bandwidth  = bandwidth[prng( ) % ARRAY_SIZE( bandwidth )];
+    pkt->coderate   = ( uint8_t ) ( prng( ) % 5 );
+    pkt->snr        = -30.0f + ( 50.0f * ( float ) ( prng( ) & 0xFFFFFF ) / ( float ) 0x1000000 );
+    pkt->rssic      = -160.0f + ( 160.0f * ( float ) ( prng( ) & 0xFFFFFF ) / ( float ) 0x1000000 );
+    pkt->size       = ( uint16_t ) ( prng( ) % 256 );
+    fill_payload( pkt );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* serialize a packet with both serializers, returns true if the outputs are identical */
+static bool compare( const struct lgw_pkt_rx_s* pkt, const struct timeval* tv, const char* name )
+{
+    uint8_t ref[OBJ_SIZE_MAX];
+    uint8_t out[OBJ_SIZE_MAX];
+    int     ref_len;
+    int     out_len;
+
+    ref_len = serialize_snprintf( pkt, tv, ref, sizeof ref );
+    out_len = rxpk_serialize( pkt, tv, out, sizeof out );
+    if( ( out_len != ref_len ) || ( memcmp( ref, out, ref_len ) != 0 ) )
+    {
+        printf( "MISMATCH: %s\n  snprintf:  %.*s\n  serialize: %.*s\n", name, ref_len, ref,
+                ( out_len > 0 ) ? out_len : 0, out );
+        return false;
+    }
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int write_golden( const char* path )
+{
+    struct lgw_pkt_rx_s pkt;
+    struct timeval      tv;
+    uint8_t             out[OBJ_SIZE_MAX];
+    FILE*               f;
+    unsigned            i;
+    int                 len;
+
+    f = fopen( path, "w" );
+    if( f == NULL )
+    {
+        printf( "ERROR: cannot open %s\n", path );
+        return EXIT_FAILURE;
+    }
+    for( i = 0; i < ARRAY_SIZE( golden_cases ); i++ )
+    {
+        golden_pkt( &golden_cases[i], &pkt, &tv );
+        len = serialize_snprintf( &pkt, ( golden_cases[i].time_us >= 0 ) ? &tv : NULL, out, sizeof out );
+        fprintf( f, "%s %.*s\n", golden_cases[i].name, len, out );
+    }
+    fclose( f );
+    printf( "%u cases written to %s\n", ( unsigned ) ARRAY_SIZE( golden_cases ), path );
+
+    return EXIT_SUCCESS;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* every case of the golden file is serialized, and compared to the expected line */
+static int test_golden( const char* path )
+{
+    struct lgw_pkt_rx_s pkt;
+    struct timeval      tv;
+    uint8_t             out[OBJ_SIZE_MAX];
+    char                line[OBJ_SIZE_MAX + 64];
+    char                expected[OBJ_SIZE_MAX + 64];
+    FILE*               f;
+    unsigned            i;
+    int                 len;
+    int                 nb_errors = 0;
+
+    f = fopen( path, "r" );
+    if( f == NULL )
+    {
+        printf( "ERROR: cannot open %s\n", path );
+        return 1;
+    }
+    for( i = 0; i < ARRAY_SIZE( golden_cases ); i++ )
+    {
+        golden_pkt( &golden_cases[i], &pkt, &tv );
+        len = rxpk_serialize( &pkt, ( golden_cases[i].time_us >= 0 ) ? &tv : NULL, out, sizeof out );
+        snprintf( expected, sizeof expected, "%s %.*s\n", golden_cases[i].name, ( len > 0 ) ? len : 0, out );
+        if( ( fgets( line, sizeof line, f ) == NULL ) || ( strcmp( line, expected ) != 0 ) )
+        {
+            printf( "MISMATCH: golden case %s\n  expected:  %s  serialize: %s", golden_cases[i].name, line, expected );
+            nb_errors += 1;
+        }
+    }
+    if( fgets( line, sizeof line, f ) != NULL )
+    {
+        printf( "MISMATCH: golden file has more cases than the utility\n" );
+        nb_errors += 1;
+    }
+    fclose( f );
+    printf( "golden file: %u cases, %d mismatches\n", ( unsigned ) ARRAY_SIZE( golden_cases ), nb_errors );
+
+    return nb_errors;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int test_random( int nb_packets )
+{
+    struct lgw_pkt_rx_s pkt;
+    struct timeval      tv;
+    char                name[32];
+    int                 nb_errors = 0;
+    int                 i;
+
+    for( i = 0; ( i < nb_packets ) && ( nb_errors < 10 ); i++ )
+    {
+        random_pkt( &pkt );
+        tv.tv_sec  = ( time_t ) prng( );
+        tv.tv_usec = ( suseconds_t ) ( prng( ) % 1000000 );
+        snprintf( name, sizeof name, "random packet %d", i );
+        if( compare( &pkt, ( ( i % 2 ) == 0 ) ? &tv : NULL, name ) == false )
+        {
+            nb_errors += 1;
+        }
+    }
+    printf( "random packets: %d, %d mismatches\n", i, nb_errors );
+
+    return nb_errors;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* the floats around each rounding boundary: x.x5 for the SNR, x.5 for the RSSI */
+static int test_rounding( void )
+{
+    struct lgw_pkt_rx_s pkt;
+    char                name[64];
+    int                 nb_checked = 0;
+    int                 nb_errors  = 0;
+    int                 k;
+    int                 u;
+    float               bound;
+    float               x;
+
+    golden_pkt( &golden_cases[0], &pkt, NULL );
+    for( k = -20 * ROUNDING_RANGE; ( k <= 20 * ROUNDING_RANGE ) && ( nb_errors < 10 ); k++ )
+    {
+        bound = ( float ) ( ( 2 * k ) + 1 ) / 20.0f; /* SNR */
+        x     = bound;
+        for( u = 0; u < ROUNDING_ULPS; u++ )
+        {
+            x = nextafterf( x, -INFINITY );
+        }
+        for( u = -ROUNDING_ULPS; u <= ROUNDING_ULPS; u++ )
+        {
+            pkt.snr   = x;
+            pkt.rssic = -50.0f;
+            snprintf( name, sizeof name, "snr %.9g", pkt.snr );
+            if( compare( &pkt, NULL, name ) == false )
+            {
+                nb_errors += 1;
+            }
+            nb_checked += 1;
+            x = nextafterf( x, INFINITY );
+        }
+    }
+    for( k = -ROUNDING_RANGE; ( k <= ROUNDING_RANGE ) && ( nb_errors < 10 ); k++ )
+    {
+        bound = ( float ) ( ( 2 * k ) + 1 ) / 2.0f; /* RSSI */
+        x     = bound;
+        for( u = 0; u < ROUNDING_ULPS; u++ )
+        {
+            x = nextafterf( x, -INFINITY );
+        }
+        for( u = -ROUNDING_ULPS; u <= ROUNDING_ULPS; u++ )
+        {
+            pkt.snr   = 1.0f;
+            pkt.rssic = x;
+            snprintf( name, sizeof name, "rssi %.9g", pkt.rssic );
+            if( compare( &pkt, NULL, name ) == false )
+            {
+                nb_errors += 1;
+            }
+            nb_checked += 1;
+            x = nextafterf( x, INFINITY );
+        }
+    }
+    printf( "rounding boundaries: %d values, %d mismatches\n", nb_checked, nb_errors );
+
+    return nb_errors;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void run_bench( int nb_iterations )
+{
+    static struct lgw_pkt_rx_s pkt[PKT_PER_DGRAM];
+    uint8_t                    dgram[DGRAM_SIZE];
+    double                     t_new, t_old, t;
+    int                        index;
+    int                        it;
+    int                        i;
+
+    for( i = 0; i < PKT_PER_DGRAM; i++ )
+    {
+        random_pkt( &pkt[i] );
+        pkt[i].size = 20 + ( 10 * i ); /* typical LoRaWAN uplinks */
+        fill_payload( &pkt[i] );
+    }
+
+    t = now_s( );
+    for( it = 0; it < nb_iterations; it++ )
+    {
+        index = 0;
+        for( i = 0; i < PKT_PER_DGRAM; i++ )
+        {
+            index += rxpk_serialize( &pkt[i], NULL, dgram + index, sizeof dgram - index );
+        }
+    }
+    t_new = ( now_s( ) - t ) / ( nb_iterations * PKT_PER_DGRAM );
+
+    t = now_s( );
+    for( it = 0; it < nb_iterations; it++ )
+    {
+        index = 0;
+        for( i = 0; i < PKT_PER_DGRAM; i++ )
+        {
+            index += serialize_snprintf( &pkt[i], NULL, dgram + index, sizeof dgram - index );
+        }
+    }
+    t_old = ( now_s( ) - t ) / ( nb_iterations * PKT_PER_DGRAM );
+
+    printf( "rxpk_serialize: %.0f ns/packet\n", 1E9 * t_new );
+    printf( "snprintf:       %.0f ns/packet\n", 1E9 * t_old );
+    printf( "ratio:          %.1f\n", t_old / t_new );
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( int argc, char** argv )
+{
+    int         nb_iterations = DEFAULT_ITERATIONS;
+    int         nb_random     = DEFAULT_RANDOM;
+    const char* golden_test   = NULL;
+    const char* golden_write  = NULL;
+    int         nb_errors;
+    int         i;
+
+    prng_state = DEFAULT_SEED;
+
+    while( ( i = getopt( argc, argv, "hn:t:r:w:s:" ) ) != -1 )
+    {
+        switch( i )
+        {
+        case 'n':
+            nb_iterations = atoi( optarg );
+            break;
+        case 't':
+            golden_test = optarg;
+            break;
+        case 'r':
+            nb_random = atoi( optarg );
+            break;
+        case 'w':
+            golden_write = optarg;
+            break;
+        case 's':
+            prng_state = ( uint32_t ) atoi( optarg );
+            break;
+        case 'h':
+        default:
+            usage( );
+            return ( i == 'h' ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if( ( nb_iterations <= 0 ) || ( nb_random < 0 ) || ( prng_state == 0 ) )
+    {
+        usage( );
+        return EXIT_FAILURE;
+    }
+
+    if( golden_write != NULL )
+    {
+        return write_golden( golden_write );
+    }
+    if( golden_test != NULL )
+    {
+        nb_errors = test_golden( golden_test );
+        nb_errors += test_random( nb_random );
+        nb_errors += test_rounding( );
+        return ( nb_errors == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    run_bench( nb_iterations );
+
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,288 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host microbenchmark of the packet forwarder statistics counters, comparing the lock-free counters of
+    stats_counter.h with the mutex-protected counters they replaced, under the same producers and reader
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* printf, fprintf */
+#include <stdlib.h>  /* atoi, exit */
+#include <time.h>    /* clock_gettime */
+#include <unistd.h>  /* getopt, usleep */
+#include <pthread.h>
+
+#include "stats_counter.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_PRODUCERS 3         /* upstream, network and JIT threads of the packet forwarder */
+#define DEFAULT_ITERATIONS 2000000  /* packets accounted per producer */
+#define DEFAULT_READ_PERIOD_US 1000 /* statistics snapshot period, far shorter than on the hub to stress it */
+#define PRODUCERS_MAX 16
+
+#define NB_COUNTERS 4 /* counters updated per packet, as for a received uplink */
+#define CACHE_LINE 64
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE TYPES -------------------------------------------------------- */
+
+enum bench_mode_e
+{
+    BENCH_MUTEX,    /* one mutex for all the producers, counters zeroed by the reader, as before */
+    BENCH_LOCKFREE, /* stats_counter.h */
+};
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+static enum bench_mode_e bench_mode;
+static int               nb_iterations  = DEFAULT_ITERATIONS;
+static int               read_period_us = DEFAULT_READ_PERIOD_US;
+static volatile bool     producers_done;
+
+/* each producer owns its counters, as each thread of the packet forwarder, only the maximum is shared */
+struct producer_counters_s
+{
+    uint32_t               mx[NB_COUNTERS]; /* mutex version */
+    struct stats_counter_s lf[NB_COUNTERS]; /* lock-free version */
+} __attribute__( ( aligned( CACHE_LINE ) ) );
+
+/* mutex version, one mutex for all the producers as mx_meas_dw was */
+static pthread_mutex_t mx_meas = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t        meas_mx_max;
+
+/* lock-free version */
+static struct stats_max_s meas_lf_max;
+
+static struct producer_counters_s meas[PRODUCERS_MAX];
+static int                        nb_producers_running;
+
+/* totals accumulated by the reader, to check that no update is lost */
+static uint64_t total[NB_COUNTERS];
+static uint32_t total_max;
+static unsigned nb_snapshots;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void usage( void )
+{
+    printf( "Usage: stats_bench [-p producers] [-n iterations] [-r read_period_us]\n" );
+    printf( " -p <int> number of producer threads, %d by default, %d max\n", DEFAULT_PRODUCERS, PRODUCERS_MAX );
+    printf( " -n <int> number of packets accounted per producer, %d by default\n", DEFAULT_ITERATIONS );
+    printf( " -r <int> period of the statistics snapshots in us, %d by default\n", DEFAULT_READ_PERIOD_US );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double now_s( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return ( double ) t.tv_sec + ( 1E-9 * ( double ) t.tv_nsec );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void snapshot( void )
+{
+    uint32_t max;
+    int      p;
+    int      k;
+
+    if( bench_mode == BENCH_MUTEX )
+    {
+        pthread_mutex_lock( &mx_meas );
+        for( p = 0; p < nb_producers_running; p++ )
+        {
+            for( k = 0; k < NB_COUNTERS; k++ )
+            {
+                total[k] += meas[p].mx[k];
+                meas[p].mx[k] = 0;
+            }
+        }
+        max         = meas_mx_max;
+        meas_mx_max = 0;
+        pthread_mutex_unlock( &mx_meas );
+    }
+    else
+    {
+        for( p = 0; p < nb_producers_running; p++ )
+        {
+            for( k = 0; k < NB_COUNTERS; k++ )
+            {
+                total[k] += stats_counter_delta( &meas[p].lf[k] );
+            }
+        }
+        max = stats_max_take( &meas_lf_max );
+    }
+    total_max = ( max > total_max ) ? max : total_max;
+    nb_snapshots += 1;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void* thread_producer( void* arg )
+{
+    int                         idx  = ( int ) ( uintptr_t ) arg;
+    struct producer_counters_s* c    = &meas[idx];
+    uint32_t                    seed = ( uint32_t ) idx + 1;
+    uint32_t                    latency;
+    int                         i;
+    int                         k;
+
+    for( i = 0; i < nb_iterations; i++ )
+    {
+        seed    = ( seed * 1103515245 ) + 12345; /* cheap pseudo-random latency */
+        latency = ( seed >> 16 ) & 0x7FFF;
+
+        if( bench_mode == BENCH_MUTEX )
+        {
+            pthread_mutex_lock( &mx_meas );
+            for( k = 0; k < NB_COUNTERS; k++ )
+            {
+                c->mx[k] += 1;
+            }
+            if( latency > meas_mx_max )
+            {
+                meas_mx_max = latency;
+            }
+            pthread_mutex_unlock( &mx_meas );
+        }
+        else
+        {
+            for( k = 0; k < NB_COUNTERS; k++ )
+            {
+                stats_counter_add( &c->lf[k], 1 );
+            }
+            stats_max_update( &meas_lf_max, latency );
+        }
+    }
+
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void* thread_reader( void* arg )
+{
+    ( void ) arg;
+
+    while( !producers_done )
+    {
+        usleep( read_period_us );
+        snapshot( );
+    }
+
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static bool run( enum bench_mode_e mode, int nb_producers )
+{
+    pthread_t producers[PRODUCERS_MAX];
+    pthread_t reader;
+    double    start;
+    double    elapsed;
+    uint64_t  expected = ( uint64_t ) nb_producers * ( uint64_t ) nb_iterations;
+    bool      ok       = true;
+    int       i;
+
+    bench_mode           = mode;
+    nb_producers_running = nb_producers;
+    producers_done       = false;
+    nb_snapshots         = 0;
+    total_max            = 0;
+    for( i = 0; i < NB_COUNTERS; i++ )
+    {
+        total[i] = 0;
+    }
+
+    start = now_s( );
+    pthread_create( &reader, NULL, thread_reader, NULL );
+    for( i = 0; i < nb_producers; i++ )
+    {
+        pthread_create( &producers[i], NULL, thread_producer, ( void* ) ( uintptr_t ) i );
+    }
+    for( i = 0; i < nb_producers; i++ )
+    {
+        pthread_join( producers[i], NULL );
+    }
+    elapsed        = now_s( ) - start;
+    producers_done = true;
+    pthread_join( reader, NULL );
+    snapshot( ); /* what was accounted after the last periodic snapshot */
+
+    for( i = 0; i < NB_COUNTERS; i++ )
+    {
+        ok = ok && ( total[i] == expected );
+    }
+
+    printf( "%-9s %2d producers: %7.1f ns/packet, %8.1f Mpackets/s, %6u snapshots, max %5u, totals %s\n",
+            ( mode == BENCH_MUTEX ) ? "mutex" : "lock-free", nb_producers, 1E9 * elapsed / ( double ) nb_iterations,
+            ( double ) expected / elapsed / 1E6, nb_snapshots, total_max, ok ? "OK" : "MISMATCH" );
+
+    return ok;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( int argc, char** argv )
+{
+    int  nb_producers = DEFAULT_PRODUCERS;
+    bool ok           = true;
+    int  i;
+
+    while( ( i = getopt( argc, argv, "hp:n:r:" ) ) != -1 )
+    {
+        switch( i )
+        {
+        case 'p':
+            nb_producers = atoi( optarg );
+            break;
+        case 'n':
+            nb_iterations = atoi( optarg );
+            break;
+        case 'r':
+            read_period_us = atoi( optarg );
+            break;
+        case 'h':
+        default:
+            usage( );
+            return ( i == 'h' ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if( ( nb_producers < 1 ) || ( nb_producers > PRODUCERS_MAX ) || ( nb_iterations < 1 ) || ( read_period_us < 1 ) )
+    {
+        usage( );
+        return EXIT_FAILURE;
+    }
+
+    /* from uncontended to the requested number of producers */
+    for( i = 1; i <= nb_producers; i++ )
+    {
+        ok = run( BENCH_MUTEX, i ) && ok;
+        ok = run( BENCH_LOCKFREE, i ) && ok;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,595 @@
+/*______                              _
+ / _____)             _              | |
+( (____  _____ ____ _| |_ _____  ____| |__
+ \____ \| ___ |    (_   _) ___ |/ ___)  _ \
+ _____) ) ____| | | || |_| ____( (___| | | |
+(______/|_____)_|_|_| \__)_____)\____)_| |_|
+  (C)2024 Semtech
+
+Description:
+    Host benchmark and differential fuzzer of the txpk parser of the packet forwarder (txpk_parser.c), against the
+    parson based parsing it replaced
+
+License: Revised BSD License, see LICENSE.TXT file include in the project
+*/
+
+/* -------------------------------------------------------------------------- */
+/* --- DEPENDENCIES --------------------------------------------------------- */
+
+#include <stdint.h>  /* C99 types */
+#include <stdbool.h> /* bool type */
+#include <stdio.h>   /* printf, fprintf, sscanf */
+#include <stdlib.h>  /* atoi, malloc, exit */
+#include <string.h>  /* memcpy, memcmp, strlen */
+#include <time.h>    /* clock_gettime */
+#include <unistd.h>  /* getopt */
+
+#include "lorahub_hal.h"
+#include "txpk_parser.h"
+#include "base64.h"
+#include "parson.h"
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE MACROS ------------------------------------------------------- */
+
+#define ARRAY_SIZE( a ) ( sizeof( a ) / sizeof( ( a )[0] ) )
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE CONSTANTS ---------------------------------------------------- */
+
+#define DEFAULT_ITERATIONS 100000 /* parses per sample and per parser in benchmark mode */
+#define DEFAULT_SEED 1
+
+#define FUZZ_LEN_MAX 1000     /* PULL_RESP payload size limit of the packet forwarder */
+#define FUZZ_MUTATIONS_MAX 4  /* mutations applied to a sample to build an input */
+#define FREQ_TOLERANCE_HZ 1   /* the former parser converted the frequency through a double */
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE VARIABLES (GLOBAL) ------------------------------------------- */
+
+/* PULL_RESP payloads as sent by network servers, used for the benchmark and as fuzzer seeds */
+static const char* const samples[] = {
+    "{\"txpk\":{\"imme\":false,\"tmst\":3512348611,\"freq\":868.1,\"rfch\":0,\"powe\":14,\"modu\":\"LORA\","
+    "\"datr\":\"SF7BW125\",\"codr\":\"4/5\",\"ipol\":true,\"size\":32,"
+    "\"data\":\"YHBhYUoAAgABAAAAbGFzdCBieXRlcyBvZiBwYXlsb2Fk\"}}",
+    "{\"txpk\":{\"imme\":true,\"freq\":869.525,\"rfch\":0,\"powe\":27,\"modu\":\"LORA\",\"datr\":\"SF12BW125\","
+    "\"codr\":\"4/5\",\"ipol\":true,\"size\":12,\"data\":\"YHBhYUoAAQABAAAA\",\"ncrc\":true}}",
+    "{\"txpk\":{\"tmst\":1000000,\"freq\":923.3,\"rfch\":0,\"powe\":20,\"modu\":\"LORA\",\"datr\":\"SF10BW500\","
+    "\"codr\":\"4/6\",\"ipol\":true,\"prea\":10,\"size\":17,\"data\":\"IHBhYUoAAgADAAAAAQIDBAUGBwg=\"}}",
+    "{ \"txpk\" : { \"tmst\" : 4294967295 , \"freq\" : 433.175 , \"rfch\" : 0 , \"modu\" : \"LORA\" ,\n"
+    "  \"datr\" : \"SF5BW250\" , \"codr\" : \"4/8\" , \"ipol\" : false , \"prea\" : 4 , \"size\" : 1 ,\n"
+    "  \"data\" : \"AA==\" , \"nhdr\" : true } }",
+    "{\"txpk\":{\"imme\":false,\"rfch\":0,\"powe\":14,\"ant\":0,\"brd\":0,\"tmst\":56003812,\"freq\":869.525,"
+    "\"modu\":\"LORA\",\"datr\":\"SF9BW125\",\"codr\":\"4/5\",\"ipol\":true,\"size\":33,"
+    "\"data\":\"YHBhYUoAAwAGABEHjgAFwCwLC9zoDUx7+3Mys1R0NyLz4mWTfdjgvGrYrKSn\"}}",
+    "/* downlink */ {\"txpk\":{\"imme\":true,\"freq\":915.2,\"rfch\":0,\"powe\":-3,\"modu\":\"LORA\","
+    "\"datr\":\"SF8BW125\",\"codr\":\"2/3\",\"size\":0,\"data\":\"\"}, // empty payload\n\"info\":[1,2,{\"a\":null}]}",
+};
+
+/* tokens inserted by the fuzzer, to reach past the JSON syntax checks */
+static const char* const tokens[] = {
+    "\"", "{", "}", "[", "]", ":", ",", "\\", " ", "\n", "/*", "*/", "//", "-", ".", "e", "E", "0", "1", "9", "true",
+    "false", "null", "\\u0000", "\\\"", "\"imme\":true,", "\"tmst\":", "\"freq\":", "\"size\":255,", "\"data\":\"",
+    "\"datr\":\"SF7BW125\",", "\"codr\":\"1/2\",", "\"txpk\":", "=", "+", "/", "4294967296", "1e3", "868.1000009",
+};
+
+static uint32_t prng_state;
+
+/* -------------------------------------------------------------------------- */
+/* --- PRIVATE FUNCTIONS DEFINITION ----------------------------------------- */
+
+static void usage( void )
+{
+    printf( "Usage: txpk_bench [-n iterations] [-f iterations] [-s seed]\n" );
+    printf( " -n <int> number of parses per sample and per parser, %d by default\n", DEFAULT_ITERATIONS );
+    printf( " -f <int> fuzz both parsers with the given number of mutated samples instead of the benchmark\n" );
+    printf( " -s <int> seed of the fuzzer, %d by default\n", DEFAULT_SEED );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static double now_s( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return ( double ) t.tv_sec + ( 1E-9 * ( double ) t.tv_nsec );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* xorshift32, so that a run can be reproduced from its seed */
+static uint32_t prng( void )
+{
+    prng_state ^= prng_state << 13;
+    prng_state ^= prng_state >> 17;
+    prng_state ^= prng_state << 5;
+    return prng_state;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* same check as txpk_parser.c, b64_to_bin exits the application on an invalid char */
+static bool is_base64( const char* str )
+{
+    int len = ( int ) strlen( str );
+    int i;
+
+    if( ( ( len % 4 ) == 0 ) && ( len >= 4 ) )
+    {
+        if( str[len - 2] == '=' )
+        {
+            len -= 2;
+        }
+        else if( str[len - 1] == '=' )
+        {
+            len -= 1;
+        }
+    }
+    for( i = 0; i < len; i++ )
+    {
+        if( ( ( str[i] < 'A' ) || ( str[i] > 'Z' ) ) && ( ( str[i] < 'a' ) || ( str[i] > 'z' ) ) &&
+            ( ( str[i] < '0' ) || ( str[i] > '9' ) ) && ( str[i] != '+' ) && ( str[i] != '/' ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* a number converted by a cast in the former parser, which is undefined out of the range of the destination type */
+static bool get_number( const JSON_Value* val, double min, double max, double* x )
+{
+    *x = json_value_get_number( val );
+    return ( *x > ( min - 1.0 ) ) && ( *x < ( max + 1.0 ) );
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/**
+@brief Parse a PULL_RESP payload as the packet forwarder did before txpk_parser.c, with a null antenna gain
+@param json null terminated JSON string
+@param pkt pointer to the TX packet to be filled
+@param data_size pointer to the number of bytes decoded from the "data" field
+@return true if the packet would have been queued, false if the TX would have been aborted
+
+The former code is kept as is, except where it had an undefined behavior: a number out of the range of the integer it
+is cast to, an RF chain used as an index without check, and an invalid base64 char, on which b64_to_bin exits, are
+rejected.
+*/
+static bool parse_parson( const char* json, struct lgw_pkt_tx_s* pkt, int* data_size )
+{
+    JSON_Value*  root_val = NULL;
+    JSON_Object* txpk_obj = NULL;
+    JSON_Value*  val      = NULL;
+    const char*  str;
+    short        x0, x1;
+    double       x;
+    int          i;
+    bool         ok = false;
+
+    memset( pkt, 0, sizeof *pkt );
+    *data_size = 0;
+
+    root_val = json_parse_string_with_comments( json );
+    if( root_val == NULL )
+    {
+        return false;
+    }
+    txpk_obj = json_object_get_object( json_value_get_object( root_val ), "txpk" );
+    if( txpk_obj == NULL )
+    {
+        goto out;
+    }
+
+    /* immediate or timestamped */
+    if( json_object_get_boolean( txpk_obj, "imme" ) == 1 )
+    {
+        pkt->tx_mode = IMMEDIATE;
+    }
+    else
+    {
+        pkt->tx_mode = TIMESTAMPED;
+        val          = json_object_get_value( txpk_obj, "tmst" );
+        if( ( val == NULL ) || ( get_number( val, 0, UINT32_MAX, &x ) == false ) )
+        {
+            goto out;
+        }
+        pkt->count_us = ( uint32_t ) x;
+    }
+
+    val = json_object_get_value( txpk_obj, "ncrc" );
+    if( val != NULL )
+    {
+        pkt->no_crc = ( bool ) json_value_get_boolean( val );
+    }
+    val = json_object_get_value( txpk_obj, "nhdr" );
+    if( val != NULL )
+    {
+        pkt->no_header = ( bool ) json_value_get_boolean( val );
+    }
+
+    val = json_object_get_value( txpk_obj, "freq" );
+    if( ( val == NULL ) || ( get_number( val, 0, UINT32_MAX / 1.0e6, &x ) == false ) ||
+        ( ( 1.0e6 * x ) >= ( double ) UINT32_MAX + 1.0 ) )
+    {
+        goto out;
+    }
+    pkt->freq_hz = ( uint32_t ) ( ( double ) ( 1.0e6 ) * x );
+
+    val = json_object_get_value( txpk_obj, "rfch" );
+    if( ( val == NULL ) || ( get_number( val, 0, LGW_RF_CHAIN_NB - 1, &x ) == false ) )
+    {
+        goto out;
+    }
+    pkt->rf_chain = ( uint8_t ) x;
+
+    val = json_object_get_value( txpk_obj, "powe" );
+    if( val != NULL )
+    {
+        if( get_number( val, INT8_MIN, INT8_MAX, &x ) == false )
+        {
+            goto out;
+        }
+        pkt->rf_power = ( int8_t ) x;
+    }
+
+    str = json_object_get_string( txpk_obj, "modu" );
+    if( ( str == NULL ) || ( strcmp( str, "LORA" ) != 0 ) )
+    {
+        goto out;
+    }
+    pkt->modulation = MOD_LORA;
+
+    str = json_object_get_string( txpk_obj, "datr" );
+    if( ( str == NULL ) || ( sscanf( str, "SF%2hdBW%3hd", &x0, &x1 ) != 2 ) )
+    {
+        goto out;
+    }
+    if( ( x0 < 5 ) || ( x0 > 12 ) )
+    {
+        goto out;
+    }
+    pkt->datarate = ( uint32_t ) x0; /* DR_LORA_SF5..DR_LORA_SF12 */
+    switch( x1 )
+    {
+    case 125:
+        pkt->bandwidth = BW_125KHZ;
+        break;
+    case 250:
+        pkt->bandwidth = BW_250KHZ;
+        break;
+    case 500:
+        pkt->bandwidth = BW_500KHZ;
+        break;
+    default:
+        goto out;
+    }
+
+    str = json_object_get_string( txpk_obj, "codr" );
+    if( str == NULL )
+    {
+        goto out;
+    }
+    if( strcmp( str, "4/5" ) == 0 )
+        pkt->coderate = CR_LORA_4_5;
+    else if( strcmp( str, "4/6" ) == 0 )
+        pkt->coderate = CR_LORA_4_6;
+    else if( strcmp( str, "2/3" ) == 0 )
+        pkt->coderate = CR_LORA_4_6;
+    else if( strcmp( str, "4/7" ) == 0 )
+        pkt->coderate = CR_LORA_4_7;
+    else if( strcmp( str, "4/8" ) == 0 )
+        pkt->coderate = CR_LORA_4_8;
+    else if( strcmp( str, "1/2" ) == 0 )
+        pkt->coderate = CR_LORA_4_8;
+    else
+        goto out;
+
+    val = json_object_get_value( txpk_obj, "ipol" );
+    if( val != NULL )
+    {
+        pkt->invert_pol = ( bool ) json_value_get_boolean( val );
+    }
+
+    val = json_object_get_value( txpk_obj, "prea" );
+    if( val != NULL )
+    {
+        if( get_number( val, INT32_MIN, UINT16_MAX, &x ) == false )
+        {
+            goto out;
+        }
+        i             = ( int ) x;
+        pkt->preamble = ( uint16_t ) ( ( i >= MIN_LORA_PREAMBLE ) ? i : MIN_LORA_PREAMBLE );
+    }
+    else
+    {
+        pkt->preamble = ( uint16_t ) STD_LORA_PREAMBLE;
+    }
+
+    val = json_object_get_value( txpk_obj, "size" );
+    if( ( val == NULL ) || ( get_number( val, 0, UINT16_MAX, &x ) == false ) )
+    {
+        goto out;
+    }
+    pkt->size = ( uint16_t ) x;
+
+    str = json_object_get_string( txpk_obj, "data" );
+    if( ( str == NULL ) || ( is_base64( str ) == false ) )
+    {
+        goto out;
+    }
+    *data_size = b64_to_bin( str, strlen( str ), pkt->payload, sizeof pkt->payload );
+    ok         = ( *data_size >= 0 ); /* a mismatch with "size" was only a warning */
+
+out:
+    json_value_free( root_val );
+    return ok;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* compare the packets of both parsers, returns the name of the first field that differs, NULL if none */
+static const char* compare_pkt( const struct lgw_pkt_tx_s* a, int a_data_size, const struct lgw_pkt_tx_s* b,
+                                int b_data_size )
+{
+    uint32_t freq_diff = ( a->freq_hz > b->freq_hz ) ? ( a->freq_hz - b->freq_hz ) : ( b->freq_hz - a->freq_hz );
+
+    if( a->tx_mode != b->tx_mode )
+        return "tx_mode";
+    if( ( a->tx_mode == TIMESTAMPED ) && ( a->count_us != b->count_us ) )
+        return "count_us";
+    if( freq_diff > FREQ_TOLERANCE_HZ )
+        return "freq_hz";
+    if( a->rf_chain != b->rf_chain )
+        return "rf_chain";
+    if( a->rf_power != b->rf_power )
+        return "rf_power";
+    if( a->modulation != b->modulation )
+        return "modulation";
+    if( a->datarate != b->datarate )
+        return "datarate";
+    if( a->bandwidth != b->bandwidth )
+        return "bandwidth";
+    if( a->coderate != b->coderate )
+        return "coderate";
+    if( a->invert_pol != b->invert_pol )
+        return "invert_pol";
+    if( a->preamble != b->preamble )
+        return "preamble";
+    if( a->no_crc != b->no_crc )
+        return "no_crc";
+    if( a->no_header != b->no_header )
+        return "no_header";
+    if( a->size != b->size )
+        return "size";
+    if( ( a_data_size != b_data_size ) || ( memcmp( a->payload, b->payload, a_data_size ) != 0 ) )
+        return "data";
+    return NULL;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+/* apply a random mutation to the input, which is kept within FUZZ_LEN_MAX */
+static int mutate( char* buf, int len )
+{
+    const char* tok;
+    int         tok_len;
+    int         pos = ( len > 0 ) ? ( int ) ( prng( ) % ( uint32_t ) len ) : 0;
+    int         n;
+
+    switch( prng( ) % 6 )
+    {
+    case 0: /* random byte */
+        if( len > 0 )
+        {
+            buf[pos] = ( char ) prng( );
+        }
+        break;
+    case 1: /* printable byte */
+        if( len > 0 )
+        {
+            buf[pos] = ( char ) ( ' ' + ( prng( ) % 95 ) );
+        }
+        break;
+    case 2: /* delete a few bytes */
+        n = 1 + ( int ) ( prng( ) % 8 );
+        n = ( n > ( len - pos ) ) ? ( len - pos ) : n;
+        memmove( buf + pos, buf + pos + n, len - pos - n );
+        len -= n;
+        break;
+    case 3: /* insert a token */
+        tok     = tokens[prng( ) % ARRAY_SIZE( tokens )];
+        tok_len = ( int ) strlen( tok );
+        if( ( len + tok_len ) <= FUZZ_LEN_MAX )
+        {
+            memmove( buf + pos + tok_len, buf + pos, len - pos );
+            memcpy( buf + pos, tok, tok_len );
+            len += tok_len;
+        }
+        break;
+    case 4: /* duplicate a chunk of the input somewhere else */
+        n = 1 + ( int ) ( prng( ) % 32 );
+        n = ( n > ( len - pos ) ) ? ( len - pos ) : n;
+        if( ( len + n ) <= FUZZ_LEN_MAX )
+        {
+            char chunk[32];
+            int  dst = ( int ) ( prng( ) % ( uint32_t ) ( len + 1 ) );
+
+            memcpy( chunk, buf + pos, n );
+            memmove( buf + dst + n, buf + dst, len - dst );
+            memcpy( buf + dst, chunk, n );
+            len += n;
+        }
+        break;
+    default: /* truncate */
+        len = pos;
+        break;
+    }
+
+    return len;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static int run_fuzz( int nb_iterations )
+{
+    struct lgw_pkt_tx_s  pkt_new;
+    struct lgw_pkt_tx_s  pkt_old;
+    struct txpk_status_s status;
+    enum txpk_error_e    err;
+    const char*          diff;
+    char                 buf[FUZZ_LEN_MAX + 1];
+    char*                json;
+    int                  data_size;
+    bool                 ok_old;
+    int                  len;
+    int                  nb_mutations;
+    int                  nb_both = 0, nb_new_only = 0, nb_old_only = 0, nb_skipped = 0, nb_mismatch = 0;
+    int                  it, m;
+
+    for( it = 0; it < nb_iterations; it++ )
+    {
+        len = ( int ) strlen( samples[it % ARRAY_SIZE( samples )] );
+        memcpy( buf, samples[it % ARRAY_SIZE( samples )], len );
+        nb_mutations = ( int ) ( prng( ) % ( FUZZ_MUTATIONS_MAX + 1 ) );
+        for( m = 0; m < nb_mutations; m++ )
+        {
+            len = mutate( buf, len );
+        }
+
+        /* exact size allocation without terminator, so that the sanitizer catches any read past the end */
+        json = malloc( ( len > 0 ) ? len : 1 );
+        memcpy( json, buf, len );
+        err = txpk_parse( json, len, &pkt_new, &status );
+        free( json );
+        if( ( status.offset < 0 ) || ( status.offset > len ) )
+        {
+            printf( "MISMATCH: iteration %d, error offset %d out of the input\n", it, status.offset );
+            nb_mismatch += 1;
+        }
+
+        /* the packet forwarder terminates the payload, which may then be shorter than the datagram */
+        buf[len] = 0;
+        ok_old   = parse_parson( buf, &pkt_old, &data_size );
+
+        if( strstr( buf, "\\u0000" ) != NULL )
+        {
+            nb_skipped += 1; /* parson truncates the strings at an escaped null char, "powe\u0000" is "powe" */
+        }
+        else if( ( err == TXPK_ERROR_OK ) && ( ok_old == true ) )
+        {
+            nb_both += 1;
+            diff = compare_pkt( &pkt_new, status.data_size, &pkt_old, data_size );
+            if( diff != NULL )
+            {
+                printf( "MISMATCH: iteration %d, field %s differs for input: %s\n", it, diff, buf );
+                nb_mismatch += 1;
+            }
+        }
+        else if( err == TXPK_ERROR_OK )
+        {
+            nb_new_only += 1;
+        }
+        else if( ok_old == true )
+        {
+            nb_old_only += 1;
+        }
+    }
+
+    printf( "%d inputs, accepted by both parsers: %d, by txpk_parse only: %d, by parson only: %d, not compared: %d\n",
+            nb_iterations, nb_both, nb_new_only, nb_old_only, nb_skipped );
+    printf( "%d mismatches\n", nb_mismatch );
+
+    return ( nb_mismatch == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+
+static void run_bench( int nb_iterations )
+{
+    struct lgw_pkt_tx_s  pkt;
+    struct txpk_status_s status;
+    int                  data_size;
+    double               t_new, t_old, t;
+    int                  len;
+    unsigned             s;
+    int                  it;
+
+    printf( "sample  size  txpk_parse (us)  parson (us)  ratio\n" );
+    for( s = 0; s < ARRAY_SIZE( samples ); s++ )
+    {
+        len = ( int ) strlen( samples[s] );
+        if( ( txpk_parse( samples[s], len, &pkt, &status ) != TXPK_ERROR_OK ) ||
+            ( parse_parson( samples[s], &pkt, &data_size ) == false ) )
+        {
+            printf( "ERROR: sample %u rejected\n", s );
+            exit( EXIT_FAILURE );
+        }
+
+        t = now_s( );
+        for( it = 0; it < nb_iterations; it++ )
+        {
+            txpk_parse( samples[s], len, &pkt, &status );
+        }
+        t_new = ( now_s( ) - t ) / nb_iterations;
+
+        t = now_s( );
+        for( it = 0; it < nb_iterations; it++ )
+        {
+            parse_parson( samples[s], &pkt, &data_size );
+        }
+        t_old = ( now_s( ) - t ) / nb_iterations;
+
+        printf( "%6u  %4d  %15.3f  %11.3f  %5.1f\n", s, len, 1E6 * t_new, 1E6 * t_old, t_old / t_new );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* --- MAIN FUNCTION -------------------------------------------------------- */
+
+int main( int argc, char** argv )
+{
+    int nb_iterations = DEFAULT_ITERATIONS;
+    int nb_fuzz       = 0;
+    int i;
+
+    prng_state = DEFAULT_SEED;
+
+    while( ( i = getopt( argc, argv, "hn:f:s:" ) ) != -1 )
+    {
+        switch( i )
+        {
+        case 'n':
+            nb_iterations = atoi( optarg );
+            break;
+        case 'f':
+            nb_fuzz = atoi( optarg );
+            break;
+        case 's':
+            prng_state = ( uint32_t ) atoi( optarg );
+            break;
+        case 'h':
+        default:
+            usage( );
+            return ( i == 'h' ) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if( ( nb_iterations <= 0 ) || ( nb_fuzz < 0 ) || ( prng_state == 0 ) )
+    {
+        usage( );
+        return EXIT_FAILURE;
+    }
+
+    if( nb_fuzz > 0 )
+    {
+        return run_fuzz( nb_fuzz );
+    }
+    run_bench( nb_iterations );
+
+    return EXIT_SUCCESS;
+}
+
+/* --- EOF ------------------------------------------------------------------ */